@@ -73,7 +73,8 @@ static bool build_stream(const char *const filename,
                          const unsigned long max_packets,
                          const int use_large_cid,
                          const size_t wlsb_width,
-                         const unsigned int max_contexts)
+                         const unsigned int max_contexts,
+                         const unsigned int flows_nr)
 	__attribute__((warn_unused_result, nonnull(1, 2)));
 
 static void print_rohc_traces(void *const priv_ctxt,
@@ -118,6 +119,7 @@ int main(int argc, char *argv[])
 	char *cid_type = NULL;
 	int max_contexts = ROHC_SMALL_CID_MAX + 1;
 	int wlsb_width = 4;
+	int flows_nr = 1;
 	int is_failure = 1;
 	int use_large_cid;
 	int args_used;
@@ -171,6 +173,12 @@ int main(int argc, char *argv[])
 			wlsb_width = atoi(argv[1]);
 			args_used++;
 		}
+		else if(!strcmp(*argv, "--flows"))
+		{
+			/* get the number of flows the packets are spread over */
+			flows_nr = atoi(argv[1]);
+			args_used++;
+		}
 		else if(stream_type == NULL)
 		{
 			/* get the type of the stream to perform */
@@ -236,6 +244,14 @@ int main(int argc, char *argv[])
 		goto error;
 	}
 
+	/* check the number of flows */
+	if(flows_nr < 1 || flows_nr > 0xffff - 1024)
+	{
+		fprintf(stderr, "invalid number of flows %d: should be between 1 and "
+		        "%d\n", flows_nr, 0xffff - 1024);
+		goto error;
+	}
+
 	/* the stream type is mandatory */
 	if(stream_type == NULL)
 	{
@@ -261,7 +277,7 @@ int main(int argc, char *argv[])
 
 	/* test ROHC compression/decompression with the packets from the file */
 	if(!build_stream(filename, stream_type, max_packets,
-	                 use_large_cid, wlsb_width, max_contexts))
+	                 use_large_cid, wlsb_width, max_contexts, flows_nr))
 	{
 		fprintf(stderr, "failed to build stream\n");
 		goto error;
@@ -295,6 +311,9 @@ static void usage(void)
 	       "      --max-contexts NUM  The maximum number of ROHC contexts to\n"
 	       "                          simultaneously use during the test\n"
 	       "      --wlsb-width NUM    The width of the WLSB window to use\n"
+	       "Stream options:\n"
+	       "      --flows NUM         The number of RTP flows to interleave\n"
+	       "                          in the stream (default 1)\n"
 	       "Mandatory parameters:\n"
 	       "  MAX                     The number of packets to generate\n"
 	       "  OUTPUT                  The name of the output file with the\n"
@@ -306,6 +325,9 @@ static void usage(void)
 	       "  rohc_gen_stream comp 500 rohc.pcap    Generate 500 RTP packets,\n"
 	       "                                        compress them, then store\n"
 	       "                                        them in file rohc.pcap\n"
+	       "  rohc_gen_stream --flows 1000 uncomp 100000 flows.pcap\n"
+	       "                                        Generate 100000 packets\n"
+	       "                                        of 1000 RTP flows\n"
 	       "\n"
 	       "Report bugs to <" PACKAGE_BUGREPORT ">.\n");
 }
@@ -320,6 +342,9 @@ static void usage(void)
  * @param use_large_cid  Whether the compressor shall use large CIDs
  * @param max_contexts   The maximum number of ROHC contexts to use
  * @param wlsb_width     The width of the WLSB window to use
+ * @param flows_nr       The number of RTP flows the packets are spread over:
+ *                       the flows share the same IP addresses but have
+ *                       different UDP source ports and RTP SSRCs
  * @return               true in case of success,
  *                       false in case of failure
  */
@@ -328,7 +353,8 @@ static bool build_stream(const char *const filename,
                          const unsigned long max_packets,
                          const int use_large_cid,
                          const size_t wlsb_width,
-                         const unsigned int max_contexts)
+                         const unsigned int max_contexts,
+                         const unsigned int flows_nr)
 {
 	const rohc_cid_type_t cid_type =
 		(use_large_cid ? ROHC_LARGE_CID : ROHC_SMALL_CID);
@@ -422,6 +448,8 @@ static bool build_stream(const char *const filename,
 			rohc_buf_init_empty(output, ETHER_HDR_LEN + rohc_max_len);
 
 		struct pcap_pkthdr header = { .ts = { .tv_sec = 0, .tv_usec = 0 } };
+		const unsigned int flow = (counter - 1) % flows_nr;
+		const unsigned long flow_counter = (counter - 1) / flows_nr + 1;
 		struct ipv4_hdr *ipv4;
 		struct udphdr *udp;
 		struct rtphdr *rtp;
@@ -438,8 +466,8 @@ static bool build_stream(const char *const filename,
 		ipv4->version = 4;
 		ipv4->ihl = 5;
 		ipv4->tos = 0;
-		ipv4->tot_len = htons(packet.len);
-		ipv4->id = htons(42 + counter);
+		ipv4->tot_len = htons(packet_len);
+		ipv4->id = htons(42 + flow_counter);
 		ipv4->frag_off = 0;
 		ipv4->ttl = 64;
 		ipv4->protocol = IPPROTO_UDP;
@@ -452,9 +480,9 @@ static bool build_stream(const char *const filename,
 		/* build UDP header */
 		packet.len += sizeof(struct udphdr);
 		udp = (struct udphdr *) rohc_buf_data(packet);
-		udp->source = htons(1234);
+		udp->source = htons(flows_nr == 1 ? 1234 : 1024 + flow);
 		udp->dest = htons(1234);
-		udp->len = htons(packet.len);
+		udp->len = htons(packet_len - sizeof(struct ipv4_hdr));
 		udp->check = 0; /* UDP checksum disabled */
 		rohc_buf_pull(&packet, sizeof(struct udphdr));
 
@@ -467,9 +495,9 @@ static bool build_stream(const char *const filename,
 		rtp->cc = 0;
 		rtp->m = 0;
 		rtp->pt = 0x72; /* speex */
-		rtp->sn = htons(counter);
-		rtp->timestamp = htonl(500000 + counter * 160);
-		rtp->ssrc = htonl(0x42424242);
+		rtp->sn = htons(flow_counter);
+		rtp->timestamp = htonl(500000 + flow_counter * 160);
+		rtp->ssrc = htonl(0x42424242 + flow);
 		rohc_buf_pull(&packet, sizeof(struct rtphdr));
 
 		/* build RTP payload */
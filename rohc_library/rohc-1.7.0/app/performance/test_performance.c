@@ -117,7 +117,8 @@ static int test_compression_perfs(const bool is_verbose,
                                   const rohc_cid_type_t cid_type,
                                   const size_t wlsb_width,
                                   const unsigned int max_contexts,
-                                  unsigned long *packet_count);
+                                  unsigned long *packet_count,
+                                  uint64_t *elapsed_ns);
 static int time_compress_packet(struct rohc_comp *comp,
                                 unsigned long num_packet,
                                 struct pcap_pkthdr header,
@@ -128,7 +129,8 @@ static int test_decompression_perfs(const bool is_verbose,
                                     char *filename,
                                     const rohc_cid_type_t cid_type,
                                     const unsigned int max_contexts,
-                                    unsigned long *packet_count);
+                                    unsigned long *packet_count,
+                                    uint64_t *elapsed_ns);
 static int time_decompress_packet(struct rohc_decomp *decomp,
                                   unsigned long num_packet,
                                   struct pcap_pkthdr header,
@@ -136,6 +138,9 @@ static int time_decompress_packet(struct rohc_decomp *decomp,
                                   size_t link_len,
                                   const struct rohc_ts arrival_time);
 
+static uint64_t get_time_ns(void)
+	__attribute__((warn_unused_result));
+
 static void print_rohc_traces(void *const is_verbose__,
                               const rohc_trace_level_t level,
                               const rohc_trace_entity_t entity,
@@ -174,6 +179,7 @@ int main(int argc, char *argv[])
 	char *filename = NULL; /* the name of the PCAP capture used as input */
 	rohc_cid_type_t cid_type;
 	unsigned long packet_count = 0;
+	uint64_t elapsed_ns = 0;
 	bool is_verbose = false; /* set to quiet mode by default */
 	int status = 1;
 	int ret;
@@ -296,13 +302,14 @@ int main(int argc, char *argv[])
 	{
 		/* test ROHC compression with the packets from the capture */
 		ret = test_compression_perfs(is_verbose, filename, cid_type, wlsb_width,
-		                             max_contexts, &packet_count);
+		                             max_contexts, &packet_count, &elapsed_ns);
 	}
 	else if(strcmp(test_type, "decomp") == 0)
 	{
 		/* test ROHC decompression with the packets from the capture */
 		ret = test_decompression_perfs(is_verbose, filename, cid_type,
-		                               max_contexts, &packet_count);
+		                               max_contexts, &packet_count,
+		                               &elapsed_ns);
 	}
 	else
 	{
@@ -320,6 +327,13 @@ int main(int argc, char *argv[])
 	/* print performance statistics */
 	fprintf(stderr, "%scompression: %lu packets\n",
 	        (strcmp(test_type, "comp") == 0 ? "" : "de"), packet_count);
+	if(elapsed_ns > 0)
+	{
+		fprintf(stderr, "%scompression: %.3f seconds, %.0f packets/s, "
+		        "%.0f ns/packet\n", (strcmp(test_type, "comp") == 0 ? "" : "de"),
+		        elapsed_ns / 1e9, packet_count * 1e9 / elapsed_ns,
+		        ((double) elapsed_ns) / packet_count);
+	}
 
 	/* everything went fine */
 	status = 0;
@@ -376,6 +390,8 @@ static void usage(void)
  * @param max_contexts  The maximum number of ROHC contexts to use
  * @param packet_count  OUT: the number of compressed packets, undefined if
  *                      compression failed
+ * @param elapsed_ns    OUT: the time spent compressing the packets (in ns),
+ *                      undefined if compression failed
  * @return              0 in case of success, 1 otherwise
  */
 static int test_compression_perfs(const bool is_verbose,
@@ -383,7 +399,8 @@ static int test_compression_perfs(const bool is_verbose,
                                   const rohc_cid_type_t cid_type,
                                   const size_t wlsb_width,
                                   const unsigned int max_contexts,
-                                  unsigned long *packet_count)
+                                  unsigned long *packet_count,
+                                  uint64_t *elapsed_ns)
 {
 	pcap_t *handle;
 	char errbuf[PCAP_ERRBUF_SIZE];
@@ -392,6 +409,7 @@ static int test_compression_perfs(const bool is_verbose,
 	struct pcap_pkthdr header;
 	unsigned char *packet;
 	struct rohc_comp *comp;
+	uint64_t start_ns;
 	int is_failure = 1;
 	int ret;
 
@@ -473,6 +491,7 @@ static int test_compression_perfs(const bool is_verbose,
 
 	/* for each packet in the dump */
 	*packet_count = 0;
+	*elapsed_ns = 0;
 	while((packet = (unsigned char *) pcap_next(handle, &header)) != NULL)
 	{
 		(*packet_count)++;
@@ -483,8 +502,10 @@ static int test_compression_perfs(const bool is_verbose,
 		}
 
 		/* compress the IP packet */
+		start_ns = get_time_ns();
 		ret = time_compress_packet(comp, *packet_count,
 		                           header, packet, link_len);
+		*elapsed_ns += get_time_ns() - start_ns;
 		if(ret != 0)
 		{
 			fprintf(stderr, "packet %lu: performance test failed\n",
@@ -613,13 +634,16 @@ error:
  * @param max_contexts  The maximum number of ROHC contexts to use
  * @param packet_count  OUT: the number of decompressed packets, undefined if
  *                      decompression failed
+ * @param elapsed_ns    OUT: the time spent decompressing the packets (in ns),
+ *                      undefined if decompression failed
  * @return              0 in case of success, 1 otherwise
  */
 static int test_decompression_perfs(const bool is_verbose,
                                     char *filename,
                                     const rohc_cid_type_t cid_type,
                                     const unsigned int max_contexts,
-                                    unsigned long *packet_count)
+                                    unsigned long *packet_count,
+                                    uint64_t *elapsed_ns)
 {
 	const struct rohc_ts arrival_time = { .sec = 0, .nsec = 0 };
 	pcap_t *handle;
@@ -629,6 +653,7 @@ static int test_decompression_perfs(const bool is_verbose,
 	struct pcap_pkthdr header;
 	unsigned char *packet;
 	struct rohc_decomp *decomp;
+	uint64_t start_ns;
 	int is_failure = 1;
 	int ret;
 
@@ -696,6 +721,7 @@ static int test_decompression_perfs(const bool is_verbose,
 
 	/* for each packet in the dump */
 	*packet_count = 0;
+	*elapsed_ns = 0;
 	while((packet = (unsigned char *) pcap_next(handle, &header)) != NULL)
 	{
 		(*packet_count)++;
@@ -706,8 +732,10 @@ static int test_decompression_perfs(const bool is_verbose,
 		}
 
 		/* decompress the ROHC packet */
+		start_ns = get_time_ns();
 		ret = time_decompress_packet(decomp, *packet_count,
 		                             header, packet, link_len, arrival_time);
+		*elapsed_ns += get_time_ns() - start_ns;
 		if(ret != 0)
 		{
 			fprintf(stderr, "packet %lu: performance test failed\n",
@@ -786,6 +814,24 @@ error:
 }
 
 
+/**
+ * @brief Get the current time of a monotonic clock
+ *
+ * @return  The current time (in nanoseconds)
+ */
+static uint64_t get_time_ns(void)
+{
+	struct timespec now;
+
+	if(clock_gettime(CLOCK_MONOTONIC, &now) != 0)
+	{
+		return 0;
+	}
+
+	return ((uint64_t) now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+
 /**
  * @brief Print traces emitted by the ROHC library in verbose mode
  *
@@ -53,6 +53,11 @@
 /** The length (in bytes) of the FCS-32 CRC */
 #define CRC_FCS32_LEN  4U
 
+/** The number of slices of the CRC tables, i.e. bytes handled per iteration */
+#define ROHC_CRC_TABLE_SLICES  8U
+/** The length (in bytes) of the table for the CRC-3, CRC-7 and CRC-8 types */
+#define ROHC_CRC_TABLE_LEN  (ROHC_CRC_TABLE_SLICES * 256U)
+
 /** The different types of CRC used to protect ROHC headers */
 typedef enum
 {
@@ -62,6 +67,13 @@ typedef enum
 	ROHC_CRC_TYPE_8 = 8,     /**< The CRC-8 type */
 } rohc_crc_type_t;
 
+/** The different implementations of the FCS-32 CRC */
+typedef enum
+{
+	ROHC_CRC_FCS32_TABLE = 0,  /**< Slicing-by-8 tables, always available */
+	ROHC_CRC_FCS32_CLMUL = 1,  /**< Carry-less multiplication (x86 PCLMULQDQ) */
+} rohc_crc_fcs32_impl_t;
+
 
 /*
  * Function prototypes.
@@ -83,6 +95,15 @@ uint32_t ROHC_EXPORT crc_calc_fcs32(const uint8_t *const data,
                                     const uint32_t init_val)
 	__attribute__((nonnull(1), warn_unused_result));
 
+bool ROHC_EXPORT crc_fcs32_impl_supported(const rohc_crc_fcs32_impl_t impl)
+	__attribute__((warn_unused_result));
+
+uint32_t ROHC_EXPORT crc_calc_fcs32_impl(const rohc_crc_fcs32_impl_t impl,
+                                         const uint8_t *const data,
+                                         const size_t length,
+                                         const uint32_t init_val)
+	__attribute__((nonnull(2), warn_unused_result));
+
 uint8_t ROHC_EXPORT compute_crc_static(const uint8_t *const ip,
                                        const uint8_t *const ip2,
                                        const uint8_t *const next_header,
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2026 Simplemux contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * @file   rohc_pool.c
+ * @brief  Keep the memory of released objects for reuse
+ */
+
+#include "rohc_pool.h"
+
+#ifndef __KERNEL__
+#  include <string.h>
+#endif
+#include <assert.h>
+
+
+/**
+ * @brief The header that precedes every object of a pool
+ *
+ * The header is two words long, so the object that follows is aligned as the
+ * memory returned by malloc().
+ */
+struct rohc_pool_obj
+{
+	struct rohc_pool_obj *next;  /**< The next object available for reuse */
+	size_t size;                 /**< The size of the object */
+};
+
+
+/**
+ * @brief Initialize an empty pool
+ *
+ * @param pool  The pool to initialize
+ */
+void rohc_pool_init(struct rohc_pool *const pool)
+{
+	pool->free_objs = NULL;
+	pool->free_objs_nr = 0;
+	pool->objs_nr = 0;
+}
+
+
+/**
+ * @brief Get an object of at least the given size from the pool
+ *
+ * The last released object is reused if it is large enough, a new object is
+ * allocated otherwise. The object is filled with zeroes: the new objects are
+ * allocated with calloc() that gets zeroed memory from the system for large
+ * objects, only the reused objects are cleared.
+ *
+ * @param pool  The pool to get the object from
+ * @param size  The minimal size of the object
+ * @return      The object, NULL if no memory is available
+ */
+void * rohc_pool_get(struct rohc_pool *const pool,
+                     const size_t size)
+{
+	struct rohc_pool_obj *obj;
+
+	obj = pool->free_objs;
+	if(obj != NULL && obj->size >= size)
+	{
+		pool->free_objs = obj->next;
+		assert(pool->free_objs_nr > 0);
+		pool->free_objs_nr--;
+		memset(obj + 1, 0, obj->size);
+	}
+	else
+	{
+		obj = calloc(1, sizeof(struct rohc_pool_obj) + size);
+		if(obj == NULL)
+		{
+			goto error;
+		}
+		obj->size = size;
+		pool->objs_nr++;
+	}
+	obj->next = NULL;
+
+	return obj + 1;
+
+error:
+	return NULL;
+}
+
+
+/**
+ * @brief Release an object to the pool it was got from
+ *
+ * @param pool  The pool the object was got from
+ * @param obj   The object to release
+ */
+void rohc_pool_put(struct rohc_pool *const pool,
+                   void *const obj)
+{
+	struct rohc_pool_obj *const pool_obj = ((struct rohc_pool_obj *) obj) - 1;
+
+	assert(pool->free_objs_nr < pool->objs_nr);
+	pool_obj->next = pool->free_objs;
+	pool->free_objs = pool_obj;
+	pool->free_objs_nr++;
+}
+
+
+/**
+ * @brief Free the objects of the pool
+ *
+ * All the objects shall have been released to the pool before.
+ *
+ * @param pool  The pool to free the objects of
+ */
+void rohc_pool_free(struct rohc_pool *const pool)
+{
+	assert(pool->free_objs_nr == pool->objs_nr);
+
+	while(pool->free_objs != NULL)
+	{
+		struct rohc_pool_obj *const obj = pool->free_objs;
+		pool->free_objs = obj->next;
+		free(obj);
+	}
+	pool->free_objs_nr = 0;
+	pool->objs_nr = 0;
+}
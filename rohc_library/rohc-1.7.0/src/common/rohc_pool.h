@@ -0,0 +1,65 @@
+/*
+ * Copyright 2026 Simplemux contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * @file   rohc_pool.h
+ * @brief  Keep the memory of released objects for reuse
+ */
+
+#ifndef ROHC_COMMON_POOL_H
+#define ROHC_COMMON_POOL_H
+
+#include "dllexport.h"
+
+#include <stdlib.h>
+
+
+struct rohc_pool_obj;
+
+
+/**
+ * @brief A pool of objects owned by one compressor or decompressor
+ *
+ * The objects are allocated on demand. The released objects are kept in the
+ * pool and given back by the next requests instead of being freed, so that
+ * the memory of the contexts that are destroyed is reused by the contexts
+ * that are created later. All the objects are freed with the pool.
+ */
+struct rohc_pool
+{
+	struct rohc_pool_obj *free_objs;  /**< The objects available for reuse */
+	size_t free_objs_nr;              /**< The number of objects available for reuse */
+	size_t objs_nr;                   /**< The number of objects allocated by the pool */
+};
+
+
+void ROHC_EXPORT rohc_pool_init(struct rohc_pool *const pool)
+	__attribute__((nonnull(1)));
+
+void ROHC_EXPORT * rohc_pool_get(struct rohc_pool *const pool,
+                                 const size_t size)
+	__attribute__((warn_unused_result, nonnull(1)));
+
+void ROHC_EXPORT rohc_pool_put(struct rohc_pool *const pool,
+                               void *const obj)
+	__attribute__((nonnull(1, 2)));
+
+void ROHC_EXPORT rohc_pool_free(struct rohc_pool *const pool)
+	__attribute__((nonnull(1)));
+
+#endif
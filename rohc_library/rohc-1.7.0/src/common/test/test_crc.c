@@ -0,0 +1,524 @@
+/*
+ * Copyright 2026 Simplemux contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * @file   test_crc.c
+ * @brief  Check the CRC implementations against the byte-per-byte tables
+ *
+ * The CRCs are linear, so checking every byte value at every position of a
+ * buffer, for every initial value, covers every input of that length.
+ *
+ * Run with the 'bench' argument to also measure the speed of the CRCs.
+ */
+
+#include "crc.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+
+/** The length of the buffers checked exhaustively */
+#define TEST_CRC_EXHAUSTIVE_LEN  32U
+
+/** The maximal length of the random buffers */
+#define TEST_CRC_RANDOM_MAX_LEN  1100U
+
+/** Print trace on stdout only in verbose mode */
+#define trace(is_verbose, format, ...) \
+	do { \
+		if(is_verbose) { \
+			printf(format, ##__VA_ARGS__); \
+		} \
+	} while(0)
+
+static void ref_init_table_8bits(uint8_t table[256], const uint8_t polynom);
+static uint8_t ref_crc_8bits(const uint8_t table[256],
+                             const uint8_t crc_mask,
+                             const uint8_t *const data,
+                             const size_t length,
+                             const uint8_t init_val);
+static void ref_init_table_fcs32(uint32_t table[256]);
+static uint32_t ref_crc_fcs32(const uint32_t table[256],
+                              const uint8_t *const data,
+                              const size_t length,
+                              const uint32_t init_val);
+
+static bool test_crc_8bits(const bool be_verbose,
+                           const rohc_crc_type_t crc_type,
+                           const uint8_t polynom,
+                           const uint8_t crc_mask);
+static bool test_crc_fcs32(const bool be_verbose,
+                           const rohc_crc_fcs32_impl_t impl);
+static void bench_crc(void);
+
+static uint8_t random_byte(void);
+
+
+/**
+ * @brief Check the CRC implementations
+ *
+ * @param argc  The number of command line arguments
+ * @param argv  The command line arguments
+ * @return      0 if test succeeds, non-zero if test fails
+ */
+int main(int argc, char *argv[])
+{
+	bool verbose = false; /* whether to run in verbose mode or not */
+	bool bench = false; /* whether to measure the speed of the CRCs or not */
+	int is_failure = 1; /* test fails by default */
+	int i;
+
+	for(i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "verbose") == 0)
+		{
+			verbose = true;
+		}
+		else if(strcmp(argv[i], "bench") == 0)
+		{
+			bench = true;
+		}
+		else
+		{
+			printf("Check the CRC implementations\n");
+			printf("usage: %s [verbose] [bench]\n", argv[0]);
+			goto error;
+		}
+	}
+
+	if(!test_crc_8bits(verbose, ROHC_CRC_TYPE_3, 0x6, 0x07) ||
+	   !test_crc_8bits(verbose, ROHC_CRC_TYPE_7, 0x79, 0x7f) ||
+	   !test_crc_8bits(verbose, ROHC_CRC_TYPE_8, 0xe0, 0xff))
+	{
+		goto error;
+	}
+
+	if(!test_crc_fcs32(verbose, ROHC_CRC_FCS32_TABLE))
+	{
+		goto error;
+	}
+	if(!crc_fcs32_impl_supported(ROHC_CRC_FCS32_CLMUL))
+	{
+		trace(verbose, "FCS-32 with carry-less multiplication: not supported "
+		      "by the CPU, skip it\n");
+	}
+	else if(!test_crc_fcs32(verbose, ROHC_CRC_FCS32_CLMUL))
+	{
+		goto error;
+	}
+
+	if(bench)
+	{
+		bench_crc();
+	}
+
+	/* test succeeds */
+	trace(verbose, "all tests are successful\n");
+	is_failure = 0;
+
+error:
+	return is_failure;
+}
+
+
+/**
+ * @brief Check one CRC type of 8 bits or less against the byte-per-byte table
+ *
+ * @param be_verbose  Whether to print traces or not
+ * @param crc_type    The CRC type to check
+ * @param polynom     The polynom of the CRC type
+ * @param crc_mask    The mask of the CRC bits
+ * @return            true if the CRC type is correct, false otherwise
+ */
+static bool test_crc_8bits(const bool be_verbose,
+                           const rohc_crc_type_t crc_type,
+                           const uint8_t polynom,
+                           const uint8_t crc_mask)
+{
+	uint8_t crc_table[ROHC_CRC_TABLE_LEN];
+	uint8_t ref_table[256];
+	uint8_t data[TEST_CRC_RANDOM_MAX_LEN];
+	unsigned int init_val;
+	size_t len;
+	size_t pos;
+	unsigned int val;
+
+	trace(be_verbose, "CRC-%d: ", crc_type);
+
+	ref_init_table_8bits(ref_table, polynom);
+	if(!rohc_crc_init_table(crc_table, crc_type))
+	{
+		trace(be_verbose, "failed to initialize the table\n");
+		goto error;
+	}
+	if(memcmp(crc_table, ref_table, 256) != 0)
+	{
+		trace(be_verbose, "first slice differs from the reference table\n");
+		goto error;
+	}
+
+	/* every byte value at every position, for every initial value */
+	for(init_val = 0; init_val <= 0xff; init_val++)
+	{
+		memset(data, 0, TEST_CRC_EXHAUSTIVE_LEN);
+		for(pos = 0; pos < TEST_CRC_EXHAUSTIVE_LEN; pos++)
+		{
+			for(val = 0; val <= 0xff; val++)
+			{
+				uint8_t crc;
+				uint8_t ref;
+
+				data[pos] = val;
+				crc = crc_calculate(crc_type, data, TEST_CRC_EXHAUSTIVE_LEN,
+				                    init_val, crc_table);
+				ref = ref_crc_8bits(ref_table, crc_mask, data,
+				                    TEST_CRC_EXHAUSTIVE_LEN, init_val);
+				if(crc != ref)
+				{
+					trace(be_verbose, "byte 0x%02x at position %zu with initial "
+					      "value 0x%02x: CRC 0x%02x instead of 0x%02x\n", val,
+					      pos, init_val, crc, ref);
+					goto error;
+				}
+			}
+			data[pos] = 0;
+		}
+	}
+
+	/* random data of every length, for every initial value */
+	for(pos = 0; pos < TEST_CRC_RANDOM_MAX_LEN; pos++)
+	{
+		data[pos] = random_byte();
+	}
+	for(len = 0; len <= 128; len++)
+	{
+		for(init_val = 0; init_val <= 0xff; init_val++)
+		{
+			const uint8_t crc =
+				crc_calculate(crc_type, data, len, init_val, crc_table);
+			const uint8_t ref =
+				ref_crc_8bits(ref_table, crc_mask, data, len, init_val);
+			if(crc != ref)
+			{
+				trace(be_verbose, "%zu random bytes with initial value 0x%02x: "
+				      "CRC 0x%02x instead of 0x%02x\n", len, init_val, crc, ref);
+				goto error;
+			}
+		}
+	}
+
+	trace(be_verbose, "OK\n");
+	return true;
+
+error:
+	return false;
+}
+
+
+/**
+ * @brief Check one implementation of the FCS-32 CRC against the RFC 1662 table
+ *
+ * @param be_verbose  Whether to print traces or not
+ * @param impl        The implementation of the FCS-32 CRC to check
+ * @return            true if the implementation is correct, false otherwise
+ */
+static bool test_crc_fcs32(const bool be_verbose,
+                           const rohc_crc_fcs32_impl_t impl)
+{
+	const uint32_t init_vals[] = { 0x00000000, CRC_INIT_FCS32, 0x12345678 };
+	const size_t init_vals_nr = sizeof(init_vals) / sizeof(init_vals[0]);
+	uint32_t ref_table[256];
+	uint8_t data[TEST_CRC_RANDOM_MAX_LEN + 16];
+	size_t offset;
+	size_t len;
+	size_t pos;
+	size_t i;
+	unsigned int val;
+
+	trace(be_verbose, "FCS-32 with %s: ",
+	      impl == ROHC_CRC_FCS32_CLMUL ? "carry-less multiplication" : "tables");
+
+	ref_init_table_fcs32(ref_table);
+
+	/* every byte value at every position of a buffer long enough for the
+	 * carry-less multiplication, for the usual initial values */
+	memset(data, 0, sizeof(data));
+	for(i = 0; i < init_vals_nr; i++)
+	{
+		for(pos = 0; pos < (TEST_CRC_EXHAUSTIVE_LEN * 4); pos++)
+		{
+			for(val = 0; val <= 0xff; val++)
+			{
+				uint32_t crc;
+				uint32_t ref;
+
+				data[pos] = val;
+				crc = crc_calc_fcs32_impl(impl, data, TEST_CRC_EXHAUSTIVE_LEN * 4,
+				                          init_vals[i]);
+				ref = ref_crc_fcs32(ref_table, data, TEST_CRC_EXHAUSTIVE_LEN * 4,
+				                    init_vals[i]);
+				if(crc != ref)
+				{
+					trace(be_verbose, "byte 0x%02x at position %zu with initial "
+					      "value 0x%08x: CRC 0x%08x instead of 0x%08x\n", val,
+					      pos, init_vals[i], crc, ref);
+					goto error;
+				}
+			}
+			data[pos] = 0;
+		}
+	}
+
+	/* random data of every length at every alignment */
+	for(pos = 0; pos < sizeof(data); pos++)
+	{
+		data[pos] = random_byte();
+	}
+	for(offset = 0; offset < 16; offset++)
+	{
+		for(len = 0; len <= TEST_CRC_RANDOM_MAX_LEN; len++)
+		{
+			for(i = 0; i < init_vals_nr; i++)
+			{
+				const uint32_t crc =
+					crc_calc_fcs32_impl(impl, data + offset, len, init_vals[i]);
+				const uint32_t ref =
+					ref_crc_fcs32(ref_table, data + offset, len, init_vals[i]);
+				if(crc != ref)
+				{
+					trace(be_verbose, "%zu random bytes at offset %zu with initial "
+					      "value 0x%08x: CRC 0x%08x instead of 0x%08x\n", len,
+					      offset, init_vals[i], crc, ref);
+					goto error;
+				}
+			}
+		}
+	}
+
+	trace(be_verbose, "OK\n");
+	return true;
+
+error:
+	return false;
+}
+
+
+/**
+ * @brief Measure the speed of the CRCs for several lengths of data
+ */
+static void bench_crc(void)
+{
+	const size_t lens[] = { 8, 20, 40, 64, 256, 1500 };
+	const size_t lens_nr = sizeof(lens) / sizeof(lens[0]);
+	const size_t bytes_per_len = 200U * 1000U * 1000U;
+	uint8_t crc_table[ROHC_CRC_TABLE_LEN];
+	uint8_t ref_table_8[256];
+	uint32_t ref_table_32[256];
+	uint8_t data[1500];
+	volatile uint32_t sink = 0;
+	size_t i;
+
+	if(!rohc_crc_init_table(crc_table, ROHC_CRC_TYPE_8))
+	{
+		return;
+	}
+	ref_init_table_8bits(ref_table_8, 0xe0);
+	ref_init_table_fcs32(ref_table_32);
+	for(i = 0; i < sizeof(data); i++)
+	{
+		data[i] = random_byte();
+	}
+
+	printf("%6s  %12s  %12s  %12s  %12s  %12s\n", "bytes", "CRC-8 byte",
+	       "CRC-8 sliced", "FCS-32 byte", "FCS-32 table", "FCS-32 clmul");
+	for(i = 0; i < lens_nr; i++)
+	{
+		const size_t len = lens[i];
+		const size_t iters = bytes_per_len / len;
+		double ns[5] = { 0, 0, 0, 0, 0 };
+		int engine;
+
+		for(engine = 0; engine < 5; engine++)
+		{
+			struct timespec start;
+			struct timespec end;
+			uint32_t crc = 0;
+			size_t iter;
+
+			if(engine == 4 && !crc_fcs32_impl_supported(ROHC_CRC_FCS32_CLMUL))
+			{
+				continue;
+			}
+
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			for(iter = 0; iter < iters; iter++)
+			{
+				/* chain the CRCs so that the calls cannot be skipped */
+				data[0] = crc;
+				switch(engine)
+				{
+					case 0:
+						crc = ref_crc_8bits(ref_table_8, 0xff, data, len, CRC_INIT_8);
+						break;
+					case 1:
+						crc = crc_calculate(ROHC_CRC_TYPE_8, data, len, CRC_INIT_8,
+						                    crc_table);
+						break;
+					case 2:
+						crc = ref_crc_fcs32(ref_table_32, data, len, CRC_INIT_FCS32);
+						break;
+					case 3:
+						crc = crc_calc_fcs32_impl(ROHC_CRC_FCS32_TABLE, data, len,
+						                          CRC_INIT_FCS32);
+						break;
+					default:
+						crc = crc_calc_fcs32_impl(ROHC_CRC_FCS32_CLMUL, data, len,
+						                          CRC_INIT_FCS32);
+						break;
+				}
+			}
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			sink ^= crc;
+
+			ns[engine] = ((end.tv_sec - start.tv_sec) * 1e9 +
+			              (end.tv_nsec - start.tv_nsec)) / iters;
+		}
+
+		printf("%6zu  %9.1f ns  %9.1f ns  %9.1f ns  %9.1f ns  %9.1f ns\n",
+		       len, ns[0], ns[1], ns[2], ns[3], ns[4]);
+	}
+}
+
+
+/**
+ * @brief Build the byte-per-byte table of a CRC type of 8 bits or less
+ *
+ * @param table    OUT: The table
+ * @param polynom  The polynom of the CRC type
+ */
+static void ref_init_table_8bits(uint8_t table[256], const uint8_t polynom)
+{
+	unsigned int i;
+	unsigned int j;
+
+	for(i = 0; i < 256; i++)
+	{
+		uint8_t crc = i;
+		for(j = 0; j < 8; j++)
+		{
+			crc = (crc & 1) ? ((crc >> 1) ^ polynom) : (crc >> 1);
+		}
+		table[i] = crc;
+	}
+}
+
+
+/**
+ * @brief Compute a CRC of 8 bits or less one byte at a time
+ *
+ * @param table     The byte-per-byte table of the CRC type
+ * @param crc_mask  The mask of the CRC bits
+ * @param data      The data to compute the CRC for
+ * @param length    The length of the data
+ * @param init_val  The initial CRC value
+ * @return          The CRC
+ */
+static uint8_t ref_crc_8bits(const uint8_t table[256],
+                             const uint8_t crc_mask,
+                             const uint8_t *const data,
+                             const size_t length,
+                             const uint8_t init_val)
+{
+	uint8_t crc = init_val;
+	size_t i;
+
+	for(i = 0; i < length; i++)
+	{
+		crc = table[data[i] ^ (crc & crc_mask)];
+	}
+
+	return crc;
+}
+
+
+/**
+ * @brief Build the byte-per-byte table of the FCS-32 CRC
+ *
+ * @param table  OUT: The table, as in RFC 1662, appendix C.3
+ */
+static void ref_init_table_fcs32(uint32_t table[256])
+{
+	unsigned int i;
+	unsigned int j;
+
+	for(i = 0; i < 256; i++)
+	{
+		uint32_t crc = i;
+		for(j = 0; j < 8; j++)
+		{
+			crc = (crc & 1) ? ((crc >> 1) ^ 0xedb88320) : (crc >> 1);
+		}
+		table[i] = crc;
+	}
+}
+
+
+/**
+ * @brief Compute the FCS-32 CRC one byte at a time
+ *
+ * @param table     The byte-per-byte table of the FCS-32 CRC
+ * @param data      The data to compute the CRC for
+ * @param length    The length of the data
+ * @param init_val  The initial CRC value
+ * @return          The CRC
+ */
+static uint32_t ref_crc_fcs32(const uint32_t table[256],
+                              const uint8_t *const data,
+                              const size_t length,
+                              const uint32_t init_val)
+{
+	uint32_t crc = init_val;
+	size_t i;
+
+	for(i = 0; i < length; i++)
+	{
+		crc = (crc >> 8) ^ table[(crc ^ data[i]) & 0xff];
+	}
+
+	return crc;
+}
+
+
+/**
+ * @brief Get a pseudo-random byte, the same sequence for every run
+ *
+ * @return  The pseudo-random byte
+ */
+static uint8_t random_byte(void)
+{
+	static uint32_t state = 0x2545f491;
+
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+
+	return (state & 0xff);
+}
@@ -71,12 +71,14 @@ static bool c_esp_create(struct rohc_comp_ctxt *const context,
 	__attribute__((warn_unused_result, nonnull(1, 2)));
 
 static bool c_esp_check_profile(const struct rohc_comp *const comp,
-                                const struct net_pkt *const packet)
-	__attribute__((warn_unused_result, nonnull(1, 2)));
+                                const struct net_pkt *const packet,
+                                const struct rohc_comp_pkt_class *const pkt_class)
+	__attribute__((warn_unused_result, nonnull(1, 2, 3)));
 
 static bool c_esp_check_context(const struct rohc_comp_ctxt *const context,
-                                const struct net_pkt *const packet)
-	__attribute__((warn_unused_result, nonnull(1, 2)));
+                                const struct net_pkt *const packet,
+                                const struct rohc_comp_pkt_class *const pkt_class)
+	__attribute__((warn_unused_result, nonnull(1, 2, 3)));
 
 static int c_esp_encode(struct rohc_comp_ctxt *const context,
                         const struct net_pkt *const packet,
@@ -203,38 +205,32 @@ quit:
  * This function is one of the functions that must exist in one profile for the
  * framework to work.
  *
- * @param comp    The ROHC compressor
- * @param packet  The packet to check
- * @return        Whether the IP packet corresponds to the profile:
- *                  \li true if the IP packet corresponds to the profile,
- *                  \li false if the IP packet does not correspond to
- *                      the profile
+ * @param comp       The ROHC compressor
+ * @param packet     The packet to check
+ * @param pkt_class  The classification of the packet
+ * @return           Whether the IP packet corresponds to the profile:
+ *                     \li true if the IP packet corresponds to the profile,
+ *                     \li false if the IP packet does not correspond to
+ *                         the profile
  */
 static bool c_esp_check_profile(const struct rohc_comp *const comp,
-                                const struct net_pkt *const packet)
+                                const struct net_pkt *const packet,
+                                const struct rohc_comp_pkt_class *const pkt_class)
 {
-	bool ip_check;
-
 	assert(comp != NULL);
 	assert(packet != NULL);
 
 	/* check that the the versions of outer and inner IP headers are 4 or 6
 	   and that outer and inner IP headers are not IP fragments */
-	ip_check = c_generic_check_profile(comp, packet);
-	if(!ip_check)
+	if(!pkt_class->ip_ok)
 	{
 		goto bad_profile;
 	}
 
-	/* IP payload shall be large enough for ESP header */
-	if(packet->transport->len < sizeof(struct esphdr))
-	{
-		goto bad_profile;
-	}
-
-	/* check that the transport protocol is ESP */
-	if(packet->transport->data == NULL ||
-	   packet->transport->proto != ROHC_IPPROTO_ESP)
+	/* check that the transport protocol is ESP and that the IP payload is
+	 * large enough for the ESP header */
+	if(pkt_class->transport_proto != ROHC_IPPROTO_ESP ||
+	   !pkt_class->transport_ok)
 	{
 		goto bad_profile;
 	}
@@ -264,13 +260,15 @@ bad_profile:
  * This function is one of the functions that must exist in one profile for the
  * framework to work.
  *
- * @param context  The compression context
- * @param packet   The IP/UDP packet to check
- * @return         true if the packet belongs to the context,
- *                 false if it does not belong to the context
+ * @param context    The compression context
+ * @param packet     The IP/ESP packet to check
+ * @param pkt_class  The classification of the IP/ESP packet
+ * @return           true if the packet belongs to the context,
+ *                   false if it does not belong to the context
  */
 static bool c_esp_check_context(const struct rohc_comp_ctxt *const context,
-                                const struct net_pkt *const packet)
+                                const struct net_pkt *const packet,
+                                const struct rohc_comp_pkt_class *const pkt_class)
 {
 	struct c_generic_context *g_context;
 	struct sc_esp_context *esp_context;
@@ -285,7 +283,7 @@ static bool c_esp_check_context(const struct rohc_comp_ctxt *const context,
 	esp_context = (struct sc_esp_context *) g_context->specific;
 
 	/* first, check the same parameters as for the IP-only profile */
-	if(!c_ip_check_context(context, packet))
+	if(!c_ip_check_context(context, packet, pkt_class))
 	{
 		goto bad_context;
 	}
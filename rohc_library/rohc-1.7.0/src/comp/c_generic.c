@@ -501,16 +501,16 @@ bool c_generic_create(struct rohc_comp_ctxt *const context,
 
 	rohc_comp_debug(context, "new generic context required for a new stream");
 
-	/* allocate memory for the generic part of the context */
-	g_context =
-		(struct c_generic_context *) malloc(sizeof(struct c_generic_context));
+	/* take memory for the generic part of the context from the pool of the
+	 * compressor */
+	g_context = rohc_pool_get(&context->compressor->generic_ctxts_pool,
+	                          sizeof(struct c_generic_context));
 	if(g_context == NULL)
 	{
 		rohc_error(context->compressor, ROHC_TRACE_COMP, context->profile->id,
 		           "no memory for generic part of the profile context");
 		goto quit;
 	}
-	memset(g_context, 0, sizeof(struct c_generic_context));
 	context->specific = g_context;
 
 	/* initialize some context variables:
@@ -607,7 +607,7 @@ free_header_info:
 free_sn_window:
 	c_destroy_wlsb(g_context->sn_window);
 free_generic_context:
-	free(g_context);
+	rohc_pool_put(&context->compressor->generic_ctxts_pool, g_context);
 quit:
 	return false;
 }
@@ -640,7 +640,7 @@ void c_generic_destroy(struct rohc_comp_ctxt *const context)
 		zfree(g_context->specific);
 	}
 
-	free(g_context);
+	rohc_pool_put(&context->compressor->generic_ctxts_pool, g_context);
 }
 
 
@@ -43,6 +43,11 @@ static bool rohc_ip_ctxt_create(struct rohc_comp_ctxt *const context,
                                 const struct net_pkt *const packet)
 	__attribute__((warn_unused_result, nonnull(1, 2)));
 
+static bool c_ip_check_profile(const struct rohc_comp *const comp,
+                               const struct net_pkt *const packet,
+                               const struct rohc_comp_pkt_class *const pkt_class)
+	__attribute__((warn_unused_result, nonnull(1, 2, 3)));
+
 
 /*
  * Definitions of public functions
@@ -95,6 +100,31 @@ error:
 }
 
 
+/**
+ * @brief Check if the given packet corresponds to the IP-only profile
+ *
+ * The IP headers were already checked when the packet was classified, see
+ * \ref c_generic_check_profile for the conditions.
+ *
+ * This function is one of the functions that must exist in one profile for the
+ * framework to work.
+ *
+ * @param comp       The ROHC compressor
+ * @param packet     The packet to check
+ * @param pkt_class  The classification of the packet
+ * @return           Whether the IP packet corresponds to the profile:
+ *                     \li true if the IP packet corresponds to the profile,
+ *                     \li false if the IP packet does not correspond to
+ *                         the profile
+ */
+static bool c_ip_check_profile(const struct rohc_comp *const comp __attribute__((unused)),
+                               const struct net_pkt *const packet __attribute__((unused)),
+                               const struct rohc_comp_pkt_class *const pkt_class)
+{
+	return pkt_class->ip_ok;
+}
+
+
 /**
  * @brief Check if an IP packet belongs to the context.
  *
@@ -111,13 +141,15 @@ error:
  * This function is one of the functions that must exist in one profile for the
  * framework to work.
  *
- * @param context  The compression context
- * @param packet   The IP packet to check
- * @return         true if the IP packet belongs to the context
- *                 false if it does not belong to the context
+ * @param context    The compression context
+ * @param packet     The IP packet to check
+ * @param pkt_class  The classification of the IP packet
+ * @return           true if the IP packet belongs to the context
+ *                   false if it does not belong to the context
  */
 bool c_ip_check_context(const struct rohc_comp_ctxt *const context,
-                        const struct net_pkt *const packet)
+                        const struct net_pkt *const packet,
+                        const struct rohc_comp_pkt_class *const pkt_class)
 {
 	struct c_generic_context *g_context;
 	struct ip_header_info *outer_ip_flags;
@@ -218,7 +250,7 @@ bool c_ip_check_context(const struct rohc_comp_ctxt *const context,
 	}
 
 	/* check the transport protocol */
-	if(packet->transport->proto != g_context->next_header_proto)
+	if(pkt_class->transport_proto != g_context->next_header_proto)
 	{
 		goto bad_context;
 	}
@@ -524,7 +556,7 @@ const struct rohc_comp_profile c_ip_profile =
 	.protocol       = 0,                   /* IP protocol */
 	.create         = rohc_ip_ctxt_create, /* profile handlers */
 	.destroy        = c_generic_destroy,
-	.check_profile  = c_generic_check_profile,
+	.check_profile  = c_ip_check_profile,
 	.check_context  = c_ip_check_context,
 	.encode         = c_generic_encode,
 	.reinit_context = c_generic_reinit_context,
@@ -34,8 +34,9 @@
  */
 
 bool c_ip_check_context(const struct rohc_comp_ctxt *const context,
-                        const struct net_pkt *const packet)
-	__attribute__((warn_unused_result, nonnull(1, 2)));
+                        const struct net_pkt *const packet,
+                        const struct rohc_comp_pkt_class *const pkt_class)
+	__attribute__((warn_unused_result, nonnull(1, 2, 3)));
 
 rohc_packet_t c_ip_decide_FO_packet(const struct rohc_comp_ctxt *context);
 rohc_packet_t c_ip_decide_SO_packet(const struct rohc_comp_ctxt *context);
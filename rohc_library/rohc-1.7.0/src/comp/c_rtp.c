@@ -58,8 +58,9 @@ static void c_rtp_destroy(struct rohc_comp_ctxt *const context)
 	__attribute__((nonnull(1)));
 
 static bool c_rtp_check_profile(const struct rohc_comp *const comp,
-                                const struct net_pkt *const packet)
-		__attribute__((warn_unused_result, nonnull(1, 2)));
+                                const struct net_pkt *const packet,
+                                const struct rohc_comp_pkt_class *const pkt_class)
+		__attribute__((warn_unused_result, nonnull(1, 2, 3)));
 #if !defined(ROHC_ENABLE_DEPRECATED_API) || ROHC_ENABLE_DEPRECATED_API == 1
 static bool rtp_is_udp_port_for_rtp(const struct rohc_comp *const comp,
                                     const uint16_t port);
@@ -68,8 +69,9 @@ static bool c_rtp_use_udp_port(const struct rohc_comp_ctxt *const context,
                                const unsigned int port);
 
 static bool c_rtp_check_context(const struct rohc_comp_ctxt *const context,
-                                const struct net_pkt *const packet)
-	__attribute__((warn_unused_result, nonnull(1, 2)));
+                                const struct net_pkt *const packet,
+                                const struct rohc_comp_pkt_class *const pkt_class)
+	__attribute__((warn_unused_result, nonnull(1, 2, 3)));
 
 static int c_rtp_encode(struct rohc_comp_ctxt *const context,
                         const struct net_pkt *const uncomp_pkt,
@@ -265,15 +267,17 @@ static void c_rtp_destroy(struct rohc_comp_ctxt *const context)
  * This function is one of the functions that must exist in one profile for the
  * framework to work.
  *
- * @param comp    The ROHC compressor
- * @param packet  The packet to check
- * @return        Whether the IP packet corresponds to the profile:
- *                  \li true if the IP packet corresponds to the profile,
- *                  \li false if the IP packet does not correspond to
- *                      the profile
+ * @param comp       The ROHC compressor
+ * @param packet     The packet to check
+ * @param pkt_class  The classification of the packet
+ * @return           Whether the IP packet corresponds to the profile:
+ *                     \li true if the IP packet corresponds to the profile,
+ *                     \li false if the IP packet does not correspond to
+ *                         the profile
  */
 static bool c_rtp_check_profile(const struct rohc_comp *const comp,
-                                const struct net_pkt *const packet)
+                                const struct net_pkt *const packet,
+                                const struct rohc_comp_pkt_class *const pkt_class)
 {
 	const struct udphdr *udp_header;
 	const unsigned char *udp_payload;
@@ -287,7 +291,7 @@ static bool c_rtp_check_profile(const struct rohc_comp *const comp,
 	 *  - the IP payload is at least 8-byte long for UDP header,
 	 *  - the UDP Length field and the UDP payload match.
 	 */
-	udp_check = c_udp_check_profile(comp, packet);
+	udp_check = c_udp_check_profile(comp, packet, pkt_class);
 	if(!udp_check)
 	{
 		goto bad_profile;
@@ -301,7 +305,7 @@ static bool c_rtp_check_profile(const struct rohc_comp *const comp,
 	udp_payload_size = packet->transport->len - sizeof(struct udphdr);
 
 	/* UDP payload shall be large enough for RTP header  */
-	if(udp_payload_size < sizeof(struct rtphdr))
+	if(!pkt_class->rtp_candidate)
 	{
 		goto bad_profile;
 	}
@@ -438,15 +442,17 @@ static bool rtp_is_udp_port_for_rtp(const struct rohc_comp *const comp,
  * This function is one of the functions that must exist in one profile for the
  * framework to work.
  *
- * @param context  The compression context
- * @param packet   The IP/UDP/RTP packet to check
- * @return         true if the IP/UDP/RTP packet belongs to the context
- *                 false if it does not belong to the context
+ * @param context    The compression context
+ * @param packet     The IP/UDP/RTP packet to check
+ * @param pkt_class  The classification of the IP/UDP/RTP packet
+ * @return           true if the IP/UDP/RTP packet belongs to the context
+ *                   false if it does not belong to the context
  *
  * @see c_udp_check_context
  */
 static bool c_rtp_check_context(const struct rohc_comp_ctxt *const context,
-                                const struct net_pkt *const packet)
+                                const struct net_pkt *const packet,
+                                const struct rohc_comp_pkt_class *const pkt_class)
 {
 	const struct c_generic_context *g_context;
 	const struct sc_rtp_context *rtp_context;
@@ -455,7 +461,7 @@ static bool c_rtp_check_context(const struct rohc_comp_ctxt *const context,
 	bool udp_check;
 
 	/* check IP and UDP headers */
-	udp_check = c_udp_check_context(context, packet);
+	udp_check = c_udp_check_context(context, packet, pkt_class);
 	if(!udp_check)
 	{
 		goto bad_context;
@@ -462,12 +462,14 @@ static void c_tcp_destroy(struct rohc_comp_ctxt *const context)
 	__attribute__((nonnull(1)));
 
 static bool c_tcp_check_profile(const struct rohc_comp *const comp,
-                                const struct net_pkt *const packet)
-	__attribute__((warn_unused_result, nonnull(1, 2)));
+                                const struct net_pkt *const packet,
+                                const struct rohc_comp_pkt_class *const pkt_class)
+	__attribute__((warn_unused_result, nonnull(1, 2, 3)));
 
 static bool c_tcp_check_context(const struct rohc_comp_ctxt *const context,
-                                const struct net_pkt *const packet)
-	__attribute__((warn_unused_result, nonnull(1, 2)));
+                                const struct net_pkt *const packet,
+                                const struct rohc_comp_pkt_class *const pkt_class)
+	__attribute__((warn_unused_result, nonnull(1, 2, 3)));
 
 static int c_tcp_encode(struct rohc_comp_ctxt *const context,
                         const struct net_pkt *const uncomp_pkt,
@@ -870,8 +872,10 @@ static bool c_tcp_create(struct rohc_comp_ctxt *const context,
 
 	tcp = base_header.tcphdr;
 
-	/* create the TCP part of the profile context */
-	tcp_context = malloc(sizeof(struct sc_tcp_context) + size_context + 1);
+	/* create the TCP part of the profile context from the pool of the
+	 * compressor */
+	tcp_context = rohc_pool_get(&context->compressor->tcp_ctxts_pool,
+	                            sizeof(struct sc_tcp_context) + size_context + 1);
 	if(tcp_context == NULL)
 	{
 		rohc_error(context->compressor, ROHC_TRACE_COMP, context->profile->id,
@@ -1096,6 +1100,11 @@ free_wlsb_seq_scaled:
 free_wlsb_seq:
 	c_destroy_wlsb(tcp_context->seq_wlsb);
 free_context:
+	if(g_context->specific != NULL)
+	{
+		rohc_pool_put(&context->compressor->tcp_ctxts_pool, g_context->specific);
+		g_context->specific = NULL;
+	}
 	c_generic_destroy(context);
 error:
 	return false;
@@ -1124,6 +1133,8 @@ static void c_tcp_destroy(struct rohc_comp_ctxt *const context)
 	c_destroy_wlsb(tcp_context->ack_wlsb);
 	c_destroy_wlsb(tcp_context->seq_scaled_wlsb);
 	c_destroy_wlsb(tcp_context->seq_wlsb);
+	rohc_pool_put(&context->compressor->tcp_ctxts_pool, tcp_context);
+	g_context->specific = NULL;
 	c_generic_destroy(context);
 }
 
@@ -1145,49 +1156,38 @@ static void c_tcp_destroy(struct rohc_comp_ctxt *const context)
  * This function is one of the functions that must exist in one profile for the
  * framework to work.
  *
- * @param comp    The ROHC compressor
- * @param packet  The packet to check
- * @return        Whether the IP packet corresponds to the profile:
- *                  \li true if the IP packet corresponds to the profile,
- *                  \li false if the IP packet does not correspond to
- *                      the profile
+ * @param comp       The ROHC compressor
+ * @param packet     The packet to check
+ * @param pkt_class  The classification of the packet
+ * @return           Whether the IP packet corresponds to the profile:
+ *                     \li true if the IP packet corresponds to the profile,
+ *                     \li false if the IP packet does not correspond to
+ *                         the profile
  */
 static bool c_tcp_check_profile(const struct rohc_comp *const comp,
-                                const struct net_pkt *const packet)
+                                const struct net_pkt *const packet,
+                                const struct rohc_comp_pkt_class *const pkt_class)
 {
 	const struct tcphdr *tcp_header;
-	bool ip_check;
 
 	assert(comp != NULL);
 	assert(packet != NULL);
 
 	/* check that the the versions of outer and inner IP headers are 4 or 6
 	   and that outer and inner IP headers are not IP fragments */
-	ip_check = c_generic_check_profile(comp, packet);
-	if(!ip_check)
+	if(!pkt_class->ip_ok)
 	{
 		goto bad_profile;
 	}
 
-	/* IP payload shall be large enough for TCP header */
-	if(packet->transport->len < sizeof(struct tcphdr))
+	/* check that the transport protocol is TCP and that the IP payload is
+	 * large enough for the TCP header and its options */
+	if(pkt_class->transport_proto != ROHC_IPPROTO_TCP ||
+	   !pkt_class->transport_ok)
 	{
 		goto bad_profile;
 	}
-
-	/* check that the transport protocol is TCP */
-	if(packet->transport->data == NULL ||
-	   packet->transport->proto != ROHC_IPPROTO_TCP)
-	{
-		goto bad_profile;
-	}
-
-	/* retrieve the TCP header */
 	tcp_header = (const struct tcphdr *) packet->transport->data;
-	if(packet->transport->len < (tcp_header->data_offset * 4U))
-	{
-		goto bad_profile;
-	}
 
 	/* the TCP profile doesn't handle TCP packets with more than 15 options */
 	{
@@ -1275,26 +1275,35 @@ bad_profile:
  * This function is one of the functions that must exist in one profile for the
  * framework to work.
  *
- * @param context  The compression context
- * @param packet   The IP/TCP packet to check
- * @return         true if the IP/TCP packet belongs to the context
- *                 false if it does not belong to the context
+ * @param context    The compression context
+ * @param packet     The IP/TCP packet to check
+ * @param pkt_class  The classification of the IP/TCP packet
+ * @return           true if the IP/TCP packet belongs to the context
+ *                   false if it does not belong to the context
  */
 static bool c_tcp_check_context(const struct rohc_comp_ctxt *const context,
-                                const struct net_pkt *const packet)
+                                const struct net_pkt *const packet,
+                                const struct rohc_comp_pkt_class *const pkt_class)
 {
 	struct c_generic_context *g_context;
 	struct sc_tcp_context *tcp_context;
 	ip_context_ptr_t ip_context;
 	base_header_ip_t base_header;   // Source
 	uint8_t proto;
-	tcphdr_t *tcp;
-	bool is_tcp_same;
 	size_t size;
 
 	g_context = (struct c_generic_context *) context->specific;
 	tcp_context = (struct sc_tcp_context *) g_context->specific;
 
+	/* the TCP ports were retrieved when the packet was classified, compare
+	 * them first to skip the walk through the IP headers of other flows */
+	if(tcp_context->old_tcphdr.src_port != pkt_class->src_port ||
+	   tcp_context->old_tcphdr.dst_port != pkt_class->dst_port)
+	{
+		rohc_comp_debug(context, "  TCP not same Source and Destination ports");
+		goto bad_context;
+	}
+
 	// Init pointer to the initial packet
 	base_header.ipvx = (base_header_ip_vx_t *) packet->outer_ip.data;
 	ip_context.uint8 = tcp_context->ip_context;
@@ -1389,12 +1398,8 @@ static bool c_tcp_check_context(const struct rohc_comp_ctxt *const context,
 	}
 	while(rohc_is_tunneling(proto) && size >= sizeof(tcphdr_t));
 
-	tcp = base_header.tcphdr;
-	is_tcp_same = tcp_context->old_tcphdr.src_port == tcp->src_port &&
-	              tcp_context->old_tcphdr.dst_port == tcp->dst_port;
-	rohc_comp_debug(context, "  TCP %ssame Source and Destination ports",
-	                is_tcp_same ? "" : "not ");
-	return is_tcp_same;
+	rohc_comp_debug(context, "  TCP same Source and Destination ports");
+	return true;
 
 bad_context:
 	return false;
@@ -205,51 +205,39 @@ quit:
  *  \li the inner IP payload is at least 8-byte long for UDP header
  *  \li the UDP Length field and the UDP payload match
  *
+ * The conditions were already checked when the packet was classified.
+ *
  * @see c_generic_check_profile
  *
  * This function is one of the functions that must exist in one profile for the
  * framework to work.
  *
- * @param comp    The ROHC compressor
- * @param packet  The packet to check
- * @return        Whether the IP packet corresponds to the profile:
- *                  \li true if the IP packet corresponds to the profile,
- *                  \li false if the IP packet does not correspond to
- *                      the profile
+ * @param comp       The ROHC compressor
+ * @param packet     The packet to check
+ * @param pkt_class  The classification of the packet
+ * @return           Whether the IP packet corresponds to the profile:
+ *                     \li true if the IP packet corresponds to the profile,
+ *                     \li false if the IP packet does not correspond to
+ *                         the profile
  */
 bool c_udp_check_profile(const struct rohc_comp *const comp,
-                         const struct net_pkt *const packet)
+                         const struct net_pkt *const packet,
+                         const struct rohc_comp_pkt_class *const pkt_class)
 {
-	const struct udphdr *udp_header;
-	bool ip_check;
-
 	assert(comp != NULL);
 	assert(packet != NULL);
 
 	/* check that the the versions of outer and inner IP headers are 4 or 6
 	   and that outer and inner IP headers are not IP fragments */
-	ip_check = c_generic_check_profile(comp, packet);
-	if(!ip_check)
+	if(!pkt_class->ip_ok)
 	{
 		goto bad_profile;
 	}
 
-	/* IP payload shall be large enough for UDP header */
-	if(packet->transport->len < sizeof(struct udphdr))
-	{
-		goto bad_profile;
-	}
-
-	/* check that the transport protocol is UDP */
-	if(packet->transport->data == NULL ||
-	   packet->transport->proto != ROHC_IPPROTO_UDP)
-	{
-		goto bad_profile;
-	}
-
-	/* retrieve the UDP header */
-	udp_header = (const struct udphdr *) packet->transport->data;
-	if(packet->transport->len != rohc_ntoh16(udp_header->len))
+	/* check that the transport protocol is UDP, that the IP payload is large
+	 * enough for the UDP header and that the UDP length is correct */
+	if(pkt_class->transport_proto != ROHC_IPPROTO_UDP ||
+	   !pkt_class->transport_ok)
 	{
 		goto bad_profile;
 	}
@@ -279,32 +267,31 @@ bad_profile:
  * This function is one of the functions that must exist in one profile for the
  * framework to work.
  *
- * @param context  The compression context
- * @param packet   The IP/UDP packet to check
- * @return         true if the IP/UDP packet belongs to the context
- *                 false if it does not belong to the context
+ * @param context    The compression context
+ * @param packet     The IP/UDP packet to check
+ * @param pkt_class  The classification of the IP/UDP packet
+ * @return           true if the IP/UDP packet belongs to the context
+ *                   false if it does not belong to the context
  */
 bool c_udp_check_context(const struct rohc_comp_ctxt *const context,
-                         const struct net_pkt *const packet)
+                         const struct net_pkt *const packet,
+                         const struct rohc_comp_pkt_class *const pkt_class)
 {
 	struct c_generic_context *g_context;
 	struct sc_udp_context *udp_context;
-	const struct udphdr *udp;
 
 	g_context = (struct c_generic_context *) context->specific;
 	udp_context = (struct sc_udp_context *) g_context->specific;
 
 	/* first, check the same parameters as for the IP-only profile */
-	if(!c_ip_check_context(context, packet))
+	if(!c_ip_check_context(context, packet, pkt_class))
 	{
 		goto bad_context;
 	}
 
 	/* in addition, check UDP ports */
-	assert(packet->transport->data != NULL);
-	udp = (struct udphdr *) packet->transport->data;
-	if(udp_context->old_udp.source != udp->source ||
-	   udp_context->old_udp.dest != udp->dest)
+	if(udp_context->old_udp.source != pkt_class->src_port ||
+	   udp_context->old_udp.dest != pkt_class->dst_port)
 	{
 		goto bad_context;
 	}
@@ -38,12 +38,14 @@
  */
 
 bool c_udp_check_profile(const struct rohc_comp *const comp,
-                         const struct net_pkt *const packet)
-	__attribute__((warn_unused_result, nonnull(1, 2)));
+                         const struct net_pkt *const packet,
+                         const struct rohc_comp_pkt_class *const pkt_class)
+	__attribute__((warn_unused_result, nonnull(1, 2, 3)));
 
 bool c_udp_check_context(const struct rohc_comp_ctxt *context,
-                         const struct net_pkt *const packet)
-	__attribute__((warn_unused_result, nonnull(1, 2)));
+                         const struct net_pkt *const packet,
+                         const struct rohc_comp_pkt_class *const pkt_class)
+	__attribute__((warn_unused_result, nonnull(1, 2, 3)));
 
 size_t udp_code_uo_remainder(const struct rohc_comp_ctxt *context,
                              const unsigned char *next_header,
@@ -113,12 +113,14 @@ static bool c_udp_lite_create(struct rohc_comp_ctxt *const context,
 	__attribute__((warn_unused_result, nonnull(1, 2)));
 
 static bool c_udp_lite_check_profile(const struct rohc_comp *const comp,
-                                     const struct net_pkt *const packet)
-		__attribute__((warn_unused_result, nonnull(1, 2)));
+                                     const struct net_pkt *const packet,
+                                     const struct rohc_comp_pkt_class *const pkt_class)
+		__attribute__((warn_unused_result, nonnull(1, 2, 3)));
 
 static bool c_udp_lite_check_context(const struct rohc_comp_ctxt *const context,
-                                     const struct net_pkt *const packet)
-	__attribute__((warn_unused_result, nonnull(1, 2)));
+                                     const struct net_pkt *const packet,
+                                     const struct rohc_comp_pkt_class *const pkt_class)
+	__attribute__((warn_unused_result, nonnull(1, 2, 3)));
 
 static int c_udp_lite_encode(struct rohc_comp_ctxt *const context,
                              const struct net_pkt *const uncomp_pkt,
@@ -263,38 +265,32 @@ quit:
  * This function is one of the functions that must exist in one profile for the
  * framework to work.
  *
- * @param comp    The ROHC compressor
- * @param packet  The packet to check
- * @return        Whether the IP packet corresponds to the profile:
- *                  \li true if the IP packet corresponds to the profile,
- *                  \li false if the IP packet does not correspond to
- *                      the profile
+ * @param comp       The ROHC compressor
+ * @param packet     The packet to check
+ * @param pkt_class  The classification of the packet
+ * @return           Whether the IP packet corresponds to the profile:
+ *                     \li true if the IP packet corresponds to the profile,
+ *                     \li false if the IP packet does not correspond to
+ *                         the profile
  */
 static bool c_udp_lite_check_profile(const struct rohc_comp *const comp,
-                                     const struct net_pkt *const packet)
+                                     const struct net_pkt *const packet,
+                                     const struct rohc_comp_pkt_class *const pkt_class)
 {
-	bool ip_check;
-
 	assert(comp != NULL);
 	assert(packet != NULL);
 
 	/* check that the the versions of outer and inner IP headers are 4 or 6
 	   and that outer and inner IP headers are not IP fragments */
-	ip_check = c_generic_check_profile(comp, packet);
-	if(!ip_check)
+	if(!pkt_class->ip_ok)
 	{
 		goto bad_profile;
 	}
 
-	/* IP payload shall be large enough for UDP-Lite header */
-	if(packet->transport->len < sizeof(struct udphdr))
-	{
-		goto bad_profile;
-	}
-
-	/* check that the transport protocol is UDP-Lite */
-	if(packet->transport->data == NULL ||
-	   packet->transport->proto != ROHC_IPPROTO_UDPLITE)
+	/* check that the transport protocol is UDP-Lite and that the IP payload is
+	 * large enough for the UDP-Lite header */
+	if(pkt_class->transport_proto != ROHC_IPPROTO_UDPLITE ||
+	   !pkt_class->transport_ok)
 	{
 		goto bad_profile;
 	}
@@ -324,32 +320,31 @@ bad_profile:
  * This function is one of the functions that must exist in one profile for the
  * framework to work.
  *
- * @param context  The compression context
- * @param packet   The IP/UDP-Lite packet to check
- * @return         true if the IP/UDP-Lite packet belongs to the context,
- *                 false if it does not belong to the context
+ * @param context    The compression context
+ * @param packet     The IP/UDP-Lite packet to check
+ * @param pkt_class  The classification of the IP/UDP-Lite packet
+ * @return           true if the IP/UDP-Lite packet belongs to the context,
+ *                   false if it does not belong to the context
  */
 static bool c_udp_lite_check_context(const struct rohc_comp_ctxt *const context,
-                                     const struct net_pkt *const packet)
+                                     const struct net_pkt *const packet,
+                                     const struct rohc_comp_pkt_class *const pkt_class)
 {
 	struct c_generic_context *g_context;
 	struct sc_udp_lite_context *udp_lite_context;
-	const struct udphdr *udp_lite;
 
 	g_context = (struct c_generic_context *) context->specific;
 	udp_lite_context = (struct sc_udp_lite_context *) g_context->specific;
 
 	/* first, check the same parameters as for the IP-only profile */
-	if(!c_ip_check_context(context, packet))
+	if(!c_ip_check_context(context, packet, pkt_class))
 	{
 		goto bad_context;
 	}
 
 	/* in addition, check UDP-Lite ports */
-	assert(packet->transport->data != NULL);
-	udp_lite = (struct udphdr *) packet->transport->data;
-	if(udp_lite_context->old_udp_lite.source != udp_lite->source ||
-	   udp_lite_context->old_udp_lite.dest != udp_lite->dest)
+	if(udp_lite_context->old_udp_lite.source != pkt_class->src_port ||
+	   udp_lite_context->old_udp_lite.dest != pkt_class->dst_port)
 	{
 		goto bad_context;
 	}
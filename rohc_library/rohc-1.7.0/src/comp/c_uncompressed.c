@@ -64,15 +64,17 @@ static bool c_uncompressed_create(struct rohc_comp_ctxt *const context,
 static void c_uncompressed_destroy(struct rohc_comp_ctxt *const context)
 	__attribute__((nonnull(1)));
 static bool c_uncompressed_check_profile(const struct rohc_comp *const comp,
-                                         const struct net_pkt *const packet)
-		__attribute__((warn_unused_result, nonnull(1, 2)));
+                                         const struct net_pkt *const packet,
+                                         const struct rohc_comp_pkt_class *const pkt_class)
+		__attribute__((warn_unused_result, nonnull(1, 2, 3)));
 bool c_uncompressed_use_udp_port(const struct rohc_comp_ctxt *const context,
                                  const unsigned int port);
 
 /* check whether a packet belongs to a context */
 static bool c_uncompressed_check_context(const struct rohc_comp_ctxt *const context,
-                                         const struct net_pkt *const packet)
-	__attribute__((warn_unused_result, nonnull(1, 2)));
+                                         const struct net_pkt *const packet,
+                                         const struct rohc_comp_pkt_class *const pkt_class)
+	__attribute__((warn_unused_result, nonnull(1, 2, 3)));
 
 /* encode uncompressed packets */
 static int c_uncompressed_encode(struct rohc_comp_ctxt *const context,
@@ -195,16 +197,18 @@ static void c_uncompressed_destroy(struct rohc_comp_ctxt *const context)
  * This function is one of the functions that must exist in one profile for the
  * framework to work.
  *
- * @param comp    The ROHC compressor
- * @param packet  The packet to check
- * @return        Whether the packet corresponds to the profile:
- *                  \li true if the packet corresponds to the profile,
- *                  \li false if the packet does not correspond to
- *                      the profile
+ * @param comp       The ROHC compressor
+ * @param packet     The packet to check
+ * @param pkt_class  The classification of the packet
+ * @return           Whether the packet corresponds to the profile:
+ *                     \li true if the packet corresponds to the profile,
+ *                     \li false if the packet does not correspond to
+ *                         the profile
 
  */
 static bool c_uncompressed_check_profile(const struct rohc_comp *const comp __attribute__((unused)),
-                                         const struct net_pkt *const packet __attribute__((unused)))
+                                         const struct net_pkt *const packet __attribute__((unused)),
+                                         const struct rohc_comp_pkt_class *const pkt_class __attribute__((unused)))
 {
 	return true;
 }
@@ -216,13 +220,15 @@ static bool c_uncompressed_check_profile(const struct rohc_comp *const comp __at
  * This function is one of the functions that must exist in one profile for the
  * framework to work.
  *
- * @param context  The compression context
- * @param packet   The packet to check
- * @return         Always return true to tell that the packet belongs
- *                 to the context
+ * @param context    The compression context
+ * @param packet     The packet to check
+ * @param pkt_class  The classification of the packet
+ * @return           Always return true to tell that the packet belongs
+ *                   to the context
  */
 static bool c_uncompressed_check_context(const struct rohc_comp_ctxt *const context __attribute__((unused)),
-                                         const struct net_pkt *const packet __attribute__((unused)))
+                                         const struct net_pkt *const packet __attribute__((unused)),
+                                         const struct rohc_comp_pkt_class *const pkt_class __attribute__((unused)))
 {
 	return true;
 }
@@ -52,8 +52,12 @@
 #include "ip.h"
 #include "crc.h"
 #include "protocols/udp.h"
+#include "protocols/tcp.h"
+#include "protocols/esp.h"
+#include "protocols/rtp.h"
 #include "protocols/ip_numbers.h"
 #include "feedback_parse.h"
+#include "c_generic.h"
 
 #include "config.h" /* for PACKAGE_(NAME|URL|VERSION) */
 
@@ -111,8 +115,14 @@ static const struct rohc_comp_profile *
 
 static const struct rohc_comp_profile *
 	c_get_profile_from_packet(const struct rohc_comp *const comp,
-	                          const struct net_pkt *const packet)
-	__attribute__((warn_unused_result, nonnull(1, 2)));
+	                          const struct net_pkt *const packet,
+	                          const struct rohc_comp_pkt_class *const pkt_class)
+	__attribute__((warn_unused_result, nonnull(1, 2, 3)));
+
+static void c_classify_packet(const struct rohc_comp *const comp,
+                              const struct net_pkt *const packet,
+                              struct rohc_comp_pkt_class *const pkt_class)
+	__attribute__((nonnull(1, 2, 3)));
 
 
 /*
@@ -126,17 +136,45 @@ static struct rohc_comp_ctxt *
 	c_create_context(struct rohc_comp *const comp,
 	                 const struct rohc_comp_profile *const profile,
 	                 const struct net_pkt *const packet,
+	                 const uint32_t hash,
 	                 const struct rohc_ts arrival_time)
     __attribute__((nonnull(1, 2, 3), warn_unused_result));
 static struct rohc_comp_ctxt *
 	rohc_comp_find_ctxt(struct rohc_comp *const comp,
 	                    const struct net_pkt *const packet,
+	                    const struct rohc_comp_pkt_class *const pkt_class,
 	                    const int profile_id_hint,
 	                    const struct rohc_ts arrival_time)
-	__attribute__((nonnull(1, 2), warn_unused_result));
+	__attribute__((nonnull(1, 2, 3), warn_unused_result));
 static struct rohc_comp_ctxt *
 	c_get_context(struct rohc_comp *const comp, const rohc_cid_t cid)
 	__attribute__((nonnull(1), warn_unused_result));
+static struct rohc_comp_ctxt *
+	c_ctxt_at(const struct rohc_comp *const comp, const rohc_cid_t cid)
+	__attribute__((nonnull(1), warn_unused_result, pure));
+static struct rohc_comp_ctxt *
+	c_ctxt_alloc(struct rohc_comp *const comp, const rohc_cid_t cid)
+	__attribute__((nonnull(1), warn_unused_result));
+
+static uint32_t c_ctxt_hash(const struct rohc_comp_profile *const profile,
+                            const struct net_pkt *const packet,
+                            const struct rohc_comp_pkt_class *const pkt_class)
+	__attribute__((nonnull(1, 2, 3), warn_unused_result, pure));
+static void c_ctxt_hash_add(struct rohc_comp *const comp,
+                            struct rohc_comp_ctxt *const context)
+	__attribute__((nonnull(1, 2)));
+static void c_ctxt_hash_remove(struct rohc_comp *const comp,
+                               struct rohc_comp_ctxt *const context)
+	__attribute__((nonnull(1, 2)));
+static void c_ctxt_lru_push(struct rohc_comp *const comp,
+                            struct rohc_comp_ctxt *const context)
+	__attribute__((nonnull(1, 2)));
+static void c_ctxt_lru_remove(struct rohc_comp *const comp,
+                              struct rohc_comp_ctxt *const context)
+	__attribute__((nonnull(1, 2)));
+static void c_destroy_context(struct rohc_comp *const comp,
+                              struct rohc_comp_ctxt *const context)
+	__attribute__((nonnull(1, 2)));
 
 
 #if !defined(ROHC_ENABLE_DEPRECATED_API) || ROHC_ENABLE_DEPRECATED_API == 1
@@ -1349,6 +1387,7 @@ rohc_status_t rohc_compress4(struct rohc_comp *const comp,
                              struct rohc_buf *const rohc_packet)
 {
 	struct net_pkt ip_pkt;
+	struct rohc_comp_pkt_class pkt_class;
 	struct rohc_comp_ctxt *c;
 	rohc_packet_t packet_type;
 	int rohc_hdr_size;
@@ -1417,8 +1456,11 @@ rohc_status_t rohc_compress4(struct rohc_comp *const comp,
 		goto error;
 	}
 
+	/* check the headers of the packet once for all the profiles */
+	c_classify_packet(comp, &ip_pkt, &pkt_class);
+
 	/* find the best context for the packet */
-	c = rohc_comp_find_ctxt(comp, &ip_pkt, -1, uncomp_packet.time);
+	c = rohc_comp_find_ctxt(comp, &ip_pkt, &pkt_class, -1, uncomp_packet.time);
 	if(c == NULL)
 	{
 		rohc_warning(comp, ROHC_TRACE_COMP, ROHC_PROFILE_GENERAL,
@@ -1447,15 +1489,12 @@ rohc_status_t rohc_compress4(struct rohc_comp *const comp,
 		/* free context if it was just created */
 		if(c->num_sent_packets <= 1)
 		{
-			c->profile->destroy(c);
-			c->used = 0;
-			assert(comp->num_contexts_used > 0);
-			comp->num_contexts_used--;
+			c_destroy_context(comp, c);
 		}
 
 		/* find the best context for the Uncompressed profile */
-		c = rohc_comp_find_ctxt(comp, &ip_pkt, ROHC_PROFILE_UNCOMPRESSED,
-		                        uncomp_packet.time);
+		c = rohc_comp_find_ctxt(comp, &ip_pkt, &pkt_class,
+		                        ROHC_PROFILE_UNCOMPRESSED, uncomp_packet.time);
 		if(c == NULL)
 		{
 			rohc_warning(comp, ROHC_TRACE_COMP, ROHC_PROFILE_GENERAL,
@@ -1611,10 +1650,7 @@ error_free_new_context:
 	/* free context if it was just created */
 	if(c->num_sent_packets <= 1)
 	{
-		c->profile->destroy(c);
-		c->used = 0;
-		assert(comp->num_contexts_used > 0);
-		comp->num_contexts_used--;
+		c_destroy_context(comp, c);
 	}
 error:
 	return ROHC_STATUS_ERROR;
@@ -1883,9 +1919,11 @@ bool rohc_comp_force_contexts_reinit(struct rohc_comp *const comp)
 
 	for(i = 0; i <= comp->medium.max_cid; i++)
 	{
-		if(comp->contexts[i].used)
+		struct rohc_comp_ctxt *const context = c_ctxt_at(comp, i);
+
+		if(context != NULL && context->used)
 		{
-			if(!comp->contexts[i].profile->reinit_context(&(comp->contexts[i])))
+			if(!context->profile->reinit_context(context))
 			{
 				rohc_warning(comp, ROHC_TRACE_COMP, ROHC_PROFILE_GENERAL,
 				             "failed to force re-initialization for CID %zu", i);
@@ -3071,18 +3109,16 @@ bool rohc_comp_remove_rtp_port(struct rohc_comp *const comp,
 		/* deactivate all contexts which used this port */
 		for(i = 0; i <= comp->medium.max_cid; i++)
 		{
-			if(comp->contexts[i].used &&
-			   comp->contexts[i].profile->use_udp_port(&comp->contexts[i],
-			                                           rohc_hton16(port)))
+			struct rohc_comp_ctxt *const context = c_ctxt_at(comp, i);
+
+			if(context != NULL && context->used &&
+			   context->profile->use_udp_port(context, rohc_hton16(port)))
 			{
 				rohc_debug(comp, ROHC_TRACE_COMP, ROHC_PROFILE_GENERAL,
 				           "destroy context with CID %zu because it uses "
 				           "UDP port %u that is removed from the list of "
 				           "RTP ports", i, port);
-				comp->contexts[i].profile->destroy(&comp->contexts[i]);
-				comp->contexts[i].used = 0;
-				assert(comp->num_contexts_used > 0);
-				comp->num_contexts_used--;
+				c_destroy_context(comp, context);
 			}
 		}
 
@@ -3485,8 +3521,8 @@ static int __rohc_c_context(struct rohc_comp *comp,
 		return -2;
 	}
 
-	c = &comp->contexts[cid];
-	if(!c->used)
+	c = c_ctxt_at(comp, cid);
+	if(c == NULL || !c->used)
 	{
 		return -1;
 	}
@@ -4329,13 +4365,17 @@ bool rohc_comp_get_general_info(const struct rohc_comp *const comp,
 		info->comp_bytes_nr = comp->total_compressed_size;
 
 		/* new fields added by minor versions */
-		if(info->version_minor > 0)
+		if(info->version_minor > 1)
 		{
 			rohc_error(comp, ROHC_TRACE_COMP, ROHC_PROFILE_GENERAL,
 			           "unsupported minor version (%u) of the structure for "
 			           "general information", info->version_minor);
 			goto error;
 		}
+		if(info->version_minor >= 1)
+		{
+			info->contexts_recycled_nr = comp->num_contexts_recycled;
+		}
 	}
 	else
 	{
@@ -4593,60 +4633,158 @@ static const struct rohc_comp_profile *
 /**
  * @brief Find out a ROHC profile given an IP protocol ID
  *
- * @param comp    The ROHC compressor
- * @param packet  The packet to find a compression profile for
- * @return        The ROHC profile if found, NULL otherwise
+ * The profiles are looked up by the transport protocol of the packet: only
+ * the profiles dedicated to that protocol, and the profiles that do not
+ * depend on the transport protocol, are asked whether they accept the
+ * packet.
+ *
+ * @param comp       The ROHC compressor
+ * @param packet     The packet to find a compression profile for
+ * @param pkt_class  The classification of the packet
+ * @return           The ROHC profile if found, NULL otherwise
  */
 static const struct rohc_comp_profile *
 	c_get_profile_from_packet(const struct rohc_comp *const comp,
-	                          const struct net_pkt *const packet)
+	                          const struct net_pkt *const packet,
+	                          const struct rohc_comp_pkt_class *const pkt_class)
 {
 	size_t i;
 
 	rohc_debug(comp, ROHC_TRACE_COMP, ROHC_PROFILE_GENERAL,
 	           "try to find the best profile for packet with transport "
-	           "protocol %u", packet->transport->proto);
+	           "protocol %u", pkt_class->transport_proto);
 
-	/* test all compression profiles */
+	/* test the compression profiles for the transport protocol */
 	for(i = 0; i < C_NUM_PROFILES; i++)
 	{
-		bool check_profile;
+		const struct rohc_comp_profile *const profile = rohc_comp_profiles[i];
 
 		/* skip profile if the profile is not enabled */
 		if(!comp->enabled_profiles[i])
 		{
 			rohc_debug(comp, ROHC_TRACE_COMP, ROHC_PROFILE_GENERAL,
 			           "skip disabled profile '%s' (0x%04x)",
-			           rohc_get_profile_descr(rohc_comp_profiles[i]->id),
-			           rohc_comp_profiles[i]->id);
+			           rohc_get_profile_descr(profile->id), profile->id);
+			continue;
+		}
+
+		/* skip profile if it is dedicated to another transport protocol */
+		if(profile->protocol != 0 &&
+		   profile->protocol != pkt_class->transport_proto)
+		{
 			continue;
 		}
 
 		/* does the profile accept the packet? */
-		check_profile = rohc_comp_profiles[i]->check_profile(comp, packet);
-		if(!check_profile)
+		if(!profile->check_profile(comp, packet, pkt_class))
 		{
 			rohc_debug(comp, ROHC_TRACE_COMP, ROHC_PROFILE_GENERAL,
 			           "skip profile '%s' (0x%04x) because it does not match "
-			           "packet",rohc_get_profile_descr(rohc_comp_profiles[i]->id),
-			           rohc_comp_profiles[i]->id);
+			           "packet", rohc_get_profile_descr(profile->id),
+			           profile->id);
 			continue;
 		}
 
 		/* the packet is compatible with the profile, let's go with it! */
-		return rohc_comp_profiles[i];
+		return profile;
 	}
 
 	return NULL;
 }
 
 
+/**
+ * @brief Check the IP and transport headers of a packet once for all the
+ *        profiles
+ *
+ * @param comp       The ROHC compressor
+ * @param packet     The packet to classify
+ * @param pkt_class  OUT: The classification of the packet
+ */
+static void c_classify_packet(const struct rohc_comp *const comp,
+                              const struct net_pkt *const packet,
+                              struct rohc_comp_pkt_class *const pkt_class)
+{
+	const size_t len = packet->transport->len;
+
+	/* the versions, options, fragmentation and checksums of the outer and
+	 * inner IP headers are shared by all the IP-based profiles */
+	pkt_class->ip_ok = c_generic_check_profile(comp, packet);
+
+	pkt_class->transport_ok = false;
+	pkt_class->rtp_candidate = false;
+	pkt_class->transport_proto = packet->transport->proto;
+	pkt_class->src_port = 0;
+	pkt_class->dst_port = 0;
+
+	if(packet->transport->data == NULL)
+	{
+		return;
+	}
+
+	switch(pkt_class->transport_proto)
+	{
+		case ROHC_IPPROTO_UDP:
+		{
+			const struct udphdr *const udp =
+				(const struct udphdr *) packet->transport->data;
+
+			if(len >= sizeof(struct udphdr) && len == rohc_ntoh16(udp->len))
+			{
+				pkt_class->transport_ok = true;
+				pkt_class->rtp_candidate =
+					((len - sizeof(struct udphdr)) >= sizeof(struct rtphdr));
+				pkt_class->src_port = udp->source;
+				pkt_class->dst_port = udp->dest;
+			}
+			break;
+		}
+		case ROHC_IPPROTO_UDPLITE:
+		{
+			const struct udphdr *const udp_lite =
+				(const struct udphdr *) packet->transport->data;
+
+			if(len >= sizeof(struct udphdr))
+			{
+				pkt_class->transport_ok = true;
+				pkt_class->src_port = udp_lite->source;
+				pkt_class->dst_port = udp_lite->dest;
+			}
+			break;
+		}
+		case ROHC_IPPROTO_TCP:
+		{
+			const struct tcphdr *const tcp =
+				(const struct tcphdr *) packet->transport->data;
+
+			if(len >= sizeof(struct tcphdr) && len >= (tcp->data_offset * 4U))
+			{
+				pkt_class->transport_ok = true;
+				pkt_class->src_port = tcp->src_port;
+				pkt_class->dst_port = tcp->dst_port;
+			}
+			break;
+		}
+		case ROHC_IPPROTO_ESP:
+		{
+			pkt_class->transport_ok = (len >= sizeof(struct esphdr));
+			break;
+		}
+		default:
+		{
+			break;
+		}
+	}
+}
+
+
 /**
  * @brief Create a compression context
  *
  * @param comp          The ROHC compressor
  * @param profile       The profile to associate the context with
  * @param packet        The packet to create a compression context for
+ * @param hash          The hash of the packet for the profile
  * @param arrival_time  The time at which packet was received (0 if unknown,
  *                      or to disable time-related features in ROHC protocol)
  * @return              The compression context if successful, NULL otherwise
@@ -4655,6 +4793,7 @@ static struct rohc_comp_ctxt *
 	c_create_context(struct rohc_comp *const comp,
 	                 const struct rohc_comp_profile *const profile,
 	                 const struct net_pkt *const packet,
+	                 const uint32_t hash,
 	                 const struct rohc_ts arrival_time)
 {
 	struct rohc_comp_ctxt *c;
@@ -4673,31 +4812,16 @@ static struct rohc_comp_ctxt *
 	 */
 	if(comp->num_contexts_used > comp->medium.max_cid)
 	{
-		/* all the contexts in the array were used, recycle the oldest context
-		 * to make some room */
-
-		uint64_t oldest;
-		rohc_cid_t i;
-
-		/* find the oldest context */
-		oldest = 0xffffffff;
-		for(i = 0; i <= comp->medium.max_cid; i++)
-		{
-			if(comp->contexts[i].latest_used < oldest)
-			{
-				oldest = comp->contexts[i].latest_used;
-				cid_to_use = i;
-			}
-		}
+		/* all the contexts in the array were used, recycle the least recently
+		 * used context (the tail of the LRU list) to make some room */
+		assert(comp->lru_last != NULL);
+		cid_to_use = comp->lru_last->cid;
 
 		/* destroy the oldest context before replacing it with a new one */
 		rohc_debug(comp, ROHC_TRACE_COMP, ROHC_PROFILE_GENERAL,
 		           "recycle oldest context (CID = %zu)", cid_to_use);
-		comp->contexts[cid_to_use].profile->destroy(&comp->contexts[cid_to_use]);
-		comp->contexts[cid_to_use].key = 0; /* reset context key */
-		comp->contexts[cid_to_use].used = 0;
-		assert(comp->num_contexts_used > 0);
-		comp->num_contexts_used--;
+		c_destroy_context(comp, comp->lru_last);
+		comp->num_contexts_recycled++;
 	}
 	else
 	{
@@ -4706,10 +4830,13 @@ static struct rohc_comp_ctxt *
 
 		rohc_cid_t i;
 
-		/* find the first unused context */
-		for(i = 0; i <= comp->medium.max_cid; i++)
+		/* find the first unused context, the contexts of the chunks that are
+		 * not allocated yet are unused */
+		for(i = comp->ctxt_first_free; i <= comp->medium.max_cid; i++)
 		{
-			if(comp->contexts[i].used == 0)
+			const struct rohc_comp_ctxt *const context = c_ctxt_at(comp, i);
+
+			if(context == NULL || context->used == 0)
 			{
 				cid_to_use = i;
 				break;
@@ -4720,8 +4847,16 @@ static struct rohc_comp_ctxt *
 		           "take the first unused context (CID = %zu)", cid_to_use);
 	}
 
-	/* initialize the previously found context */
-	c = &comp->contexts[cid_to_use];
+	/* initialize the previously found context, allocate its chunk if the
+	 * context was never used before */
+	c = c_ctxt_alloc(comp, cid_to_use);
+	if(c == NULL)
+	{
+		rohc_error(comp, ROHC_TRACE_COMP, ROHC_PROFILE_GENERAL,
+		           "cannot allocate memory for the context with CID %zu",
+		           cid_to_use);
+		return NULL;
+	}
 
 	c->total_uncompressed_size = 0;
 	c->total_compressed_size = 0;
@@ -4743,6 +4878,7 @@ static struct rohc_comp_ctxt *
 	c->cid = cid_to_use;
 	c->profile = profile;
 	c->key = packet->key;
+	c->hash = hash;
 
 	c->mode = ROHC_U_MODE;
 	c->state = ROHC_COMP_STATE_IR;
@@ -4761,6 +4897,12 @@ static struct rohc_comp_ctxt *
 	c->latest_used = arrival_time.sec;
 	assert(comp->num_contexts_used <= comp->medium.max_cid);
 	comp->num_contexts_used++;
+	if(c->cid == comp->ctxt_first_free)
+	{
+		comp->ctxt_first_free++;
+	}
+	c_ctxt_hash_add(comp, c);
+	c_ctxt_lru_push(comp, c);
 
 	rohc_debug(comp, ROHC_TRACE_COMP, ROHC_PROFILE_GENERAL,
 	           "context (CID = %zu) created (num_used = %zu)",
@@ -4774,6 +4916,7 @@ static struct rohc_comp_ctxt *
  *
  * @param comp             The ROHC compressor
  * @param packet           The packet to find a compression context for
+ * @param pkt_class        The classification of the packet
  * @param profile_id_hint  If positive, indicate the profile to use
  * @param arrival_time     The time at which packet was received
  *                         (0 if unknown, or to disable time-related features
@@ -4784,19 +4927,19 @@ static struct rohc_comp_ctxt *
 static struct rohc_comp_ctxt *
 	rohc_comp_find_ctxt(struct rohc_comp *const comp,
 	                    const struct net_pkt *const packet,
+	                    const struct rohc_comp_pkt_class *const pkt_class,
 	                    const int profile_id_hint,
 	                    const struct rohc_ts arrival_time)
 {
 	const struct rohc_comp_profile *profile;
 	struct rohc_comp_ctxt *context;
-	size_t num_used_ctxt_seen = 0;
-	rohc_cid_t i;
+	uint32_t hash;
 
 	/* use the suggested profile if any, otherwise find the best profile for
 	 * the packet */
 	if(profile_id_hint < 0)
 	{
-		profile = c_get_profile_from_packet(comp, packet);
+		profile = c_get_profile_from_packet(comp, packet, pkt_class);
 	}
 	else
 	{
@@ -4812,17 +4955,19 @@ static struct rohc_comp_ctxt *
 	           "using profile '%s' (0x%04x)",
 	           rohc_get_profile_descr(profile->id), profile->id);
 
-	/* get the context using help from the profile we just found */
-	for(i = 0; i <= comp->medium.max_cid; i++)
+	/* get the context using help from the profile we just found: only the
+	 * contexts in the bucket of the packet hash are candidates */
+	hash = c_ctxt_hash(profile, packet, pkt_class);
+	for(context = comp->contexts_hash[hash & (comp->contexts_hash_size - 1)];
+	    context != NULL; context = context->hash_next)
 	{
-		context = &comp->contexts[i];
+		assert(context->used);
 
-		/* don't even look at unused contexts */
-		if(!context->used)
+		/* don't look at contexts with another hash in the same bucket */
+		if(context->hash != hash)
 		{
 			continue;
 		}
-		num_used_ctxt_seen++;
 
 		/* don't look at contexts with the wrong profile */
 		if(context->profile->id != profile->id)
@@ -4837,28 +4982,19 @@ static struct rohc_comp_ctxt *
 		}
 
 		/* ask the profile whether the packet matches the context */
-		if(context->profile->check_context(context, packet))
+		if(context->profile->check_context(context, packet, pkt_class))
 		{
 			rohc_debug(comp, ROHC_TRACE_COMP, ROHC_PROFILE_GENERAL,
 			           "using context CID = %zu", context->cid);
 			break;
 		}
-
-		/* if all used contexts were checked, no need go search further */
-		if(num_used_ctxt_seen >= comp->num_contexts_used)
-		{
-			rohc_debug(comp, ROHC_TRACE_COMP, ROHC_PROFILE_GENERAL,
-			           "no context was found");
-			context = NULL;
-			break;
-		}
 	}
-	if(context == NULL || i > comp->medium.max_cid)
+	if(context == NULL)
 	{
 		/* context not found, create a new one */
 		rohc_debug(comp, ROHC_TRACE_COMP, ROHC_PROFILE_GENERAL,
 		           "no existing context found for packet, create a new one");
-		context = c_create_context(comp, profile, packet, arrival_time);
+		context = c_create_context(comp, profile, packet, hash, arrival_time);
 		if(context == NULL)
 		{
 			rohc_warning(comp, ROHC_TRACE_COMP, ROHC_PROFILE_GENERAL,
@@ -4868,8 +5004,14 @@ static struct rohc_comp_ctxt *
 	}
 	else
 	{
-		/* matching context found, update use timestamp */
+		/* matching context found, update use timestamp and move the context
+		 * to the head of the LRU list */
 		context->latest_used = arrival_time.sec;
+		if(context != comp->lru_first)
+		{
+			c_ctxt_lru_remove(comp, context);
+			c_ctxt_lru_push(comp, context);
+		}
 	}
 
 	return context;
@@ -4889,6 +5031,8 @@ not_found:
 static struct rohc_comp_ctxt *
 	c_get_context(struct rohc_comp *const comp, const rohc_cid_t cid)
 {
+	struct rohc_comp_ctxt *context;
+
 	/* the CID must not be larger than the context array */
 	if(cid > comp->medium.max_cid)
 	{
@@ -4896,66 +5040,302 @@ static struct rohc_comp_ctxt *
 	}
 
 	/* the context with the given CID must be in use */
-	if(comp->contexts[cid].used == 0)
+	context = c_ctxt_at(comp, cid);
+	if(context == NULL || context->used == 0)
 	{
 		goto not_found;
 	}
 
-	return &(comp->contexts[cid]);
+	return context;
 
 not_found:
 	return NULL;
 }
 
 
+/**
+ * @brief Get the storage of the context with the given CID
+ *
+ * @param comp The ROHC compressor
+ * @param cid  The CID of the context, not larger than MAX_CID
+ * @return     The context with the given CID, NULL if the chunk of contexts
+ *             that contains it was not allocated yet
+ */
+static struct rohc_comp_ctxt *
+	c_ctxt_at(const struct rohc_comp *const comp, const rohc_cid_t cid)
+{
+	struct rohc_comp_ctxt *chunk;
+
+	assert(cid <= comp->medium.max_cid);
+	chunk = comp->ctxt_chunks[cid / ROHC_COMP_CTXT_CHUNK_SIZE];
+	if(chunk == NULL)
+	{
+		return NULL;
+	}
+
+	return &(chunk[cid % ROHC_COMP_CTXT_CHUNK_SIZE]);
+}
+
+
+/**
+ * @brief Get the storage of the context with the given CID, allocate it if
+ *        needed
+ *
+ * The contexts are allocated by chunks of ROHC_COMP_CTXT_CHUNK_SIZE contexts,
+ * the contexts of a new chunk are unused.
+ *
+ * @param comp The ROHC compressor
+ * @param cid  The CID of the context, not larger than MAX_CID
+ * @return     The context with the given CID, NULL if no memory is available
+ */
+static struct rohc_comp_ctxt *
+	c_ctxt_alloc(struct rohc_comp *const comp, const rohc_cid_t cid)
+{
+	const size_t chunk_idx = cid / ROHC_COMP_CTXT_CHUNK_SIZE;
+
+	assert(cid <= comp->medium.max_cid);
+
+	if(comp->ctxt_chunks[chunk_idx] == NULL)
+	{
+		struct rohc_comp_ctxt *chunk;
+
+		rohc_debug(comp, ROHC_TRACE_COMP, ROHC_PROFILE_GENERAL,
+		           "allocate room for contexts with CID %zu to %zu",
+		           chunk_idx * ROHC_COMP_CTXT_CHUNK_SIZE,
+		           (chunk_idx + 1) * ROHC_COMP_CTXT_CHUNK_SIZE - 1);
+		chunk = calloc(ROHC_COMP_CTXT_CHUNK_SIZE, sizeof(struct rohc_comp_ctxt));
+		if(chunk == NULL)
+		{
+			return NULL;
+		}
+		comp->ctxt_chunks[chunk_idx] = chunk;
+	}
+
+	return c_ctxt_at(comp, cid);
+}
+
+
+/**
+ * @brief Compute the hash that indexes a compression context
+ *
+ * The hash mixes the key of the packet (built from the IP addresses) with the
+ * profile ID. The key does not depend on the transport layer, so all the
+ * flows between two hosts share it: the ports are mixed too for the profiles
+ * whose contexts are bound to them (RTP, UDP, UDP-Lite and TCP). Packets that
+ * match a context always have its hash, but the hash may not be unique.
+ *
+ * @param profile    The profile of the context
+ * @param packet     The packet to compute the hash for
+ * @param pkt_class  The classification of the packet
+ * @return           The hash of the packet for the profile
+ */
+static uint32_t c_ctxt_hash(const struct rohc_comp_profile *const profile,
+                            const struct net_pkt *const packet,
+                            const struct rohc_comp_pkt_class *const pkt_class)
+{
+	uint32_t hash = packet->key ^ (profile->id * 0x9e3779b1U);
+
+	/* the ports of the packet are known only for the UDP, UDP-Lite and TCP
+	 * headers, they are 0 otherwise */
+	if(profile->id == ROHC_PROFILE_RTP ||
+	   profile->id == ROHC_PROFILE_UDP ||
+	   profile->id == ROHC_PROFILE_UDPLITE ||
+	   profile->id == ROHC_PROFILE_TCP)
+	{
+		hash ^= (((uint32_t) pkt_class->dst_port) << 16) | pkt_class->src_port;
+	}
+
+	/* mix the bits, so that the lowest ones select the bucket */
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bU;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35U;
+	hash ^= hash >> 16;
+
+	return hash;
+}
+
+
+/**
+ * @brief Add a compression context to the hash table of the compressor
+ *
+ * @param comp     The ROHC compressor
+ * @param context  The context to add, its hash shall be already computed
+ */
+static void c_ctxt_hash_add(struct rohc_comp *const comp,
+                            struct rohc_comp_ctxt *const context)
+{
+	const size_t bucket = context->hash & (comp->contexts_hash_size - 1);
+
+	context->hash_next = comp->contexts_hash[bucket];
+	comp->contexts_hash[bucket] = context;
+}
+
+
+/**
+ * @brief Remove a compression context from the hash table of the compressor
+ *
+ * @param comp     The ROHC compressor
+ * @param context  The context to remove
+ */
+static void c_ctxt_hash_remove(struct rohc_comp *const comp,
+                               struct rohc_comp_ctxt *const context)
+{
+	const size_t bucket = context->hash & (comp->contexts_hash_size - 1);
+	struct rohc_comp_ctxt **link;
+
+	for(link = &comp->contexts_hash[bucket]; *link != NULL;
+	    link = &(*link)->hash_next)
+	{
+		if((*link) == context)
+		{
+			*link = context->hash_next;
+			break;
+		}
+	}
+	context->hash_next = NULL;
+}
+
+
+/**
+ * @brief Put a compression context at the head of the LRU list
+ *
+ * @param comp     The ROHC compressor
+ * @param context  The context to put in the list, it shall not be in the
+ *                 list yet
+ */
+static void c_ctxt_lru_push(struct rohc_comp *const comp,
+                            struct rohc_comp_ctxt *const context)
+{
+	context->lru_prev = NULL;
+	context->lru_next = comp->lru_first;
+	if(comp->lru_first != NULL)
+	{
+		comp->lru_first->lru_prev = context;
+	}
+	else
+	{
+		comp->lru_last = context;
+	}
+	comp->lru_first = context;
+}
+
+
+/**
+ * @brief Remove a compression context from the LRU list
+ *
+ * @param comp     The ROHC compressor
+ * @param context  The context to remove from the list
+ */
+static void c_ctxt_lru_remove(struct rohc_comp *const comp,
+                              struct rohc_comp_ctxt *const context)
+{
+	if(context->lru_prev != NULL)
+	{
+		context->lru_prev->lru_next = context->lru_next;
+	}
+	else
+	{
+		assert(comp->lru_first == context);
+		comp->lru_first = context->lru_next;
+	}
+	if(context->lru_next != NULL)
+	{
+		context->lru_next->lru_prev = context->lru_prev;
+	}
+	else
+	{
+		assert(comp->lru_last == context);
+		comp->lru_last = context->lru_prev;
+	}
+	context->lru_prev = NULL;
+	context->lru_next = NULL;
+}
+
+
+/**
+ * @brief Destroy a compression context in use
+ *
+ * The context is removed from the hash table and from the LRU list, then its
+ * profile-specific part is destroyed and it is marked as unused.
+ *
+ * @param comp     The ROHC compressor
+ * @param context  The context to destroy
+ */
+static void c_destroy_context(struct rohc_comp *const comp,
+                              struct rohc_comp_ctxt *const context)
+{
+	assert(context->used);
+
+	c_ctxt_hash_remove(comp, context);
+	c_ctxt_lru_remove(comp, context);
+	context->profile->destroy(context);
+	context->used = 0;
+	assert(comp->num_contexts_used > 0);
+	comp->num_contexts_used--;
+	if(context->cid < comp->ctxt_first_free)
+	{
+		comp->ctxt_first_free = context->cid;
+	}
+}
+
+
 /**
  * @brief Create the array of compression contexts
  *
+ * Only the array of chunks is allocated, the chunks of contexts are allocated
+ * when their contexts are used for the first time.
+ *
  * @param comp The ROHC compressor
  * @return     true if the creation is successful, false otherwise
  */
 static bool c_create_contexts(struct rohc_comp *const comp)
 {
-#if !defined(ROHC_ENABLE_DEPRECATED_API) || ROHC_ENABLE_DEPRECATED_API == 1
-	rohc_cid_t i;
-#endif
-
 	assert(comp != NULL);
-	assert(comp->contexts == NULL);
+	assert(comp->ctxt_chunks == NULL);
 
 	comp->num_contexts_used = 0;
+	comp->ctxt_first_free = 0;
 
 	rohc_info(comp, ROHC_TRACE_COMP, ROHC_PROFILE_GENERAL,
 	          "create enough room for %zu contexts (MAX_CID = %zu)",
 	          comp->medium.max_cid + 1, comp->medium.max_cid);
 
-	comp->contexts = calloc(comp->medium.max_cid + 1,
-	                        sizeof(struct rohc_comp_ctxt));
-	if(comp->contexts == NULL)
+	comp->ctxt_chunks_nr = comp->medium.max_cid / ROHC_COMP_CTXT_CHUNK_SIZE + 1;
+	comp->ctxt_chunks = calloc(comp->ctxt_chunks_nr,
+	                           sizeof(struct rohc_comp_ctxt *));
+	if(comp->ctxt_chunks == NULL)
 	{
 		rohc_error(comp, ROHC_TRACE_COMP, ROHC_PROFILE_GENERAL,
 		           "cannot allocate memory for contexts");
 		goto error;
 	}
 
-#if !defined(ROHC_ENABLE_DEPRECATED_API) || ROHC_ENABLE_DEPRECATED_API == 1
-	/* initialize all the contexts */
-	for(i = 0; i <= comp->medium.max_cid; i++)
+	/* the hash table has at least one bucket per context */
+	comp->contexts_hash_size = 1;
+	while(comp->contexts_hash_size < (comp->medium.max_cid + 1))
 	{
-		/* create contexts for statistics */
-		memset(&comp->contexts[i].total_16_uncompressed, 0,
-		       sizeof(struct rohc_stats));
-		memset(&comp->contexts[i].total_16_compressed, 0,
-		       sizeof(struct rohc_stats));
-		memset(&comp->contexts[i].header_16_uncompressed, 0,
-		       sizeof(struct rohc_stats));
-		memset(&comp->contexts[i].header_16_compressed, 0,
-		       sizeof(struct rohc_stats));
+		comp->contexts_hash_size <<= 1;
 	}
-#endif
+	comp->contexts_hash = calloc(comp->contexts_hash_size,
+	                             sizeof(struct rohc_comp_ctxt *));
+	if(comp->contexts_hash == NULL)
+	{
+		rohc_error(comp, ROHC_TRACE_COMP, ROHC_PROFILE_GENERAL,
+		           "cannot allocate memory for the hash table of contexts");
+		goto free_contexts;
+	}
+
+	/* the profile contexts are taken from the pools of the compressor */
+	rohc_pool_init(&comp->generic_ctxts_pool);
+	rohc_pool_init(&comp->tcp_ctxts_pool);
 
 	return true;
 
+free_contexts:
+	free(comp->ctxt_chunks);
+	comp->ctxt_chunks = NULL;
+	comp->ctxt_chunks_nr = 0;
 error:
 	return false;
 }
@@ -4970,29 +5350,49 @@ error:
  */
 static void c_destroy_contexts(struct rohc_comp *const comp)
 {
-	rohc_cid_t i;
+	size_t i;
 
 	assert(comp != NULL);
-	assert(comp->contexts != NULL);
+	assert(comp->ctxt_chunks != NULL);
 
-	for(i = 0; i <= comp->medium.max_cid; i++)
+	for(i = 0; i < comp->ctxt_chunks_nr; i++)
 	{
-		if(comp->contexts[i].used && comp->contexts[i].profile != NULL)
+		struct rohc_comp_ctxt *const chunk = comp->ctxt_chunks[i];
+		size_t j;
+
+		if(chunk == NULL)
 		{
-			comp->contexts[i].profile->destroy(&comp->contexts[i]);
+			continue;
 		}
 
-		if(comp->contexts[i].used)
+		for(j = 0; j < ROHC_COMP_CTXT_CHUNK_SIZE; j++)
 		{
-			comp->contexts[i].used = 0;
-			assert(comp->num_contexts_used > 0);
-			comp->num_contexts_used--;
+			if(chunk[j].used && chunk[j].profile != NULL)
+			{
+				chunk[j].profile->destroy(&chunk[j]);
+			}
+
+			if(chunk[j].used)
+			{
+				chunk[j].used = 0;
+				assert(comp->num_contexts_used > 0);
+				comp->num_contexts_used--;
+			}
 		}
+		free(chunk);
 	}
 	assert(comp->num_contexts_used == 0);
 
-	free(comp->contexts);
-	comp->contexts = NULL;
+	rohc_pool_free(&comp->generic_ctxts_pool);
+	rohc_pool_free(&comp->tcp_ctxts_pool);
+	free(comp->contexts_hash);
+	comp->contexts_hash = NULL;
+	comp->contexts_hash_size = 0;
+	comp->lru_first = NULL;
+	comp->lru_last = NULL;
+	free(comp->ctxt_chunks);
+	comp->ctxt_chunks = NULL;
+	comp->ctxt_chunks_nr = 0;
 }
 
 
@@ -248,6 +248,7 @@ typedef struct
  * Supported versions:
  *  - major 0 and minor = 0 contains: version_major, version_minor,
  *    contexts_nr, packets_nr, uncomp_bytes_nr, and comp_bytes_nr.
+ *  - major 0 and minor = 1 adds: contexts_recycled_nr.
  *
  * @ingroup rohc_comp
  *
@@ -267,6 +268,9 @@ typedef struct
 	unsigned long uncomp_bytes_nr;
 	/** The number of compressed bytes produced by the compressor */
 	unsigned long comp_bytes_nr;
+	/** The number of contexts recycled because all the contexts were in use
+	 *  (since minor version 1) */
+	unsigned long contexts_recycled_nr;
 } __attribute__((packed)) rohc_comp_general_info_t;
 
 
@@ -34,6 +34,8 @@
 #include "schemes/wlsb.h"
 #include "net_pkt.h"
 #include "rohc_stats.h"
+#include "crc.h"
+#include "rohc_pool.h"
 
 #ifdef __KERNEL__
 #	include <linux/types.h>
@@ -49,6 +51,10 @@
 /** The number of ROHC profiles ready to be used */
 #define C_NUM_PROFILES 7U
 
+/** The number of compression contexts allocated at once, the storage of the
+ *  contexts grows by chunks of this size up to MAX_CID + 1 contexts */
+#define ROHC_COMP_CTXT_CHUNK_SIZE 64U
+
 /** The maximal number of outgoing feedbacks that can be queued */
 #define FEEDBACK_RING_SIZE 1000U
 
@@ -144,10 +150,34 @@ struct rohc_comp
 	/** Enabled/disabled features for the compressor */
 	rohc_comp_features_t features;
 
-	/** The array of compression contexts that use the compressor */
-	struct rohc_comp_ctxt *contexts;
+	/** The chunks of compression contexts that use the compressor, the
+	 *  context with CID n is in chunk n / ROHC_COMP_CTXT_CHUNK_SIZE. A chunk
+	 *  is allocated when one of its CIDs is used for the first time */
+	struct rohc_comp_ctxt **ctxt_chunks;
+	/** The number of entries in the array of chunks */
+	size_t ctxt_chunks_nr;
 	/** The number of compression contexts in use in the array */
 	size_t num_contexts_used;
+	/** All the contexts with a lower CID are in use, the search for an unused
+	 *  context starts there */
+	rohc_cid_t ctxt_first_free;
+	/** The hash table that indexes the compression contexts in use, every
+	 *  bucket is a list of contexts chained by their hash_next field */
+	struct rohc_comp_ctxt **contexts_hash;
+	/** The number of buckets in the hash table (a power of two) */
+	size_t contexts_hash_size;
+	/** The most recently used context, head of the LRU list of the contexts
+	 *  in use */
+	struct rohc_comp_ctxt *lru_first;
+	/** The least recently used context, tail of the LRU list of the contexts
+	 *  in use: it is recycled first when all the contexts are in use */
+	struct rohc_comp_ctxt *lru_last;
+	/** The number of contexts recycled to make room for new flows */
+	unsigned long num_contexts_recycled;
+	/** The memory of the generic part of the profile contexts */
+	struct rohc_pool generic_ctxts_pool;
+	/** The memory of the TCP part of the TCP profile contexts */
+	struct rohc_pool tcp_ctxts_pool;
 
 	/** Which profiles are enabled and with one are not? */
 	bool enabled_profiles[C_NUM_PROFILES];
@@ -156,11 +186,11 @@ struct rohc_comp
 	/* CRC-related variables: */
 
 	/** The table to enable fast CRC-3 computation */
-	unsigned char crc_table_3[256];
+	unsigned char crc_table_3[ROHC_CRC_TABLE_LEN];
 	/** The table to enable fast CRC-7 computation */
-	unsigned char crc_table_7[256];
+	unsigned char crc_table_7[ROHC_CRC_TABLE_LEN];
 	/** The table to enable fast CRC-8 computation */
-	unsigned char crc_table_8[256];
+	unsigned char crc_table_8[ROHC_CRC_TABLE_LEN];
 
 
 #if !defined(ROHC_ENABLE_DEPRECATED_API) || ROHC_ENABLE_DEPRECATED_API == 1
@@ -254,6 +284,33 @@ struct rohc_comp
 };
 
 
+/**
+ * @brief The classification of an uncompressed packet
+ *
+ * The IP and transport headers of a packet are checked once before the
+ * compression profile is chosen. The profiles and their context matching
+ * rely on the classification instead of checking the headers again.
+ */
+struct rohc_comp_pkt_class
+{
+	/** Whether the IP headers may be compressed by the IP-based profiles */
+	bool ip_ok;
+	/** Whether the transport header is complete (for UDP, the UDP length
+	 *  shall also match the UDP header and payload) */
+	bool transport_ok;
+	/** Whether the UDP payload is large enough for a RTP header */
+	bool rtp_candidate;
+	/** The transport protocol, as found in the innermost IP header */
+	uint8_t transport_proto;
+	/** The source port of the UDP, UDP-Lite or TCP header (network byte
+	 *  order), 0 for other transport protocols */
+	uint16_t src_port;
+	/** The destination port of the UDP, UDP-Lite or TCP header (network
+	 *  byte order), 0 for other transport protocols */
+	uint16_t dst_port;
+};
+
+
 /**
  * @brief The ROHC compression profile
  *
@@ -267,7 +324,8 @@ struct rohc_comp_profile
 
 	/**
 	 * @brief The IP protocol ID used to find out which profile is able to
-	 *        compress an IP packet
+	 *        compress an IP packet, 0 if the profile does not depend on the
+	 *        transport protocol
 	 */
 	const unsigned short protocol;
 
@@ -291,16 +349,18 @@ struct rohc_comp_profile
 	 *        fits the current profile or not
 	 */
 	bool (*check_profile)(const struct rohc_comp *const comp,
-	                      const struct net_pkt *const packet)
-		__attribute__((warn_unused_result, nonnull(1, 2)));
+	                      const struct net_pkt *const packet,
+	                      const struct rohc_comp_pkt_class *const pkt_class)
+		__attribute__((warn_unused_result, nonnull(1, 2, 3)));
 
 	/**
 	 * @brief The handler used to check whether an uncompressed IP packet
 	 *        belongs to a context or not
 	 */
 	bool (*check_context)(const struct rohc_comp_ctxt *const context,
-	                      const struct net_pkt *const packet)
-		__attribute__((warn_unused_result, nonnull(1, 2)));
+	                      const struct net_pkt *const packet,
+	                      const struct rohc_comp_pkt_class *const pkt_class)
+		__attribute__((warn_unused_result, nonnull(1, 2, 3)));
 
 	/**
 	 * @brief The handler used to encode uncompressed IP packets
@@ -362,6 +422,14 @@ struct rohc_comp_ctxt
 
 	/** The key to help finding the context associated with a packet */
 	rohc_ctxt_key_t key; /* may not be unique */
+	/** The hash of the key, profile and ports of the context */
+	uint32_t hash;
+	/** The next context in the same bucket of the hash table */
+	struct rohc_comp_ctxt *hash_next;
+	/** The context used just before this one (towards the LRU list head) */
+	struct rohc_comp_ctxt *lru_prev;
+	/** The context used just after this one (towards the LRU list tail) */
+	struct rohc_comp_ctxt *lru_next;
 
 	/** The associated compressor */
 	struct rohc_comp *compressor;
@@ -323,6 +323,10 @@ int main(int argc, char *argv[])
 		CHECK(rohc_comp_get_general_info(comp, &info) == false);
 		info.version_minor = 0;
 		CHECK(rohc_comp_get_general_info(comp, &info) == true);
+		info.version_minor = 1;
+		info.contexts_recycled_nr = 0xffff;
+		CHECK(rohc_comp_get_general_info(comp, &info) == true);
+		CHECK(info.contexts_recycled_nr == 0);
 	}
 
 	/* rohc_comp_get_state_descr() */
@@ -412,15 +412,17 @@ void * d_generic_create(const struct rohc_decomp_ctxt *const context,
 {
 	struct d_generic_context *g_context;
 
-	/* allocate memory for the generic context */
-	g_context = malloc(sizeof(struct d_generic_context));
+	/* take memory for the generic context from the pool of the
+	 * decompressor */
+	g_context = rohc_pool_get(&context->decompressor->generic_ctxts_pool,
+	                          sizeof(struct d_generic_context));
 	if(g_context == NULL)
 	{
 		rohc_error(context->decompressor, ROHC_TRACE_DECOMP, context->profile->id,
 		           "no memory for the generic decompression context");
 		goto quit;
 	}
-	memset(g_context, 0, sizeof(struct d_generic_context));
+	g_context->pool = &context->decompressor->generic_ctxts_pool;
 
 	/* create the Offset IP-ID decoding context for outer IP header */
 	g_context->outer_ip_id_offset_ctxt = ip_id_offset_new();
@@ -500,7 +502,7 @@ free_inner_ip_id_offset_ctxt:
 free_outer_ip_id_offset_ctxt:
 	ip_id_offset_free(g_context->outer_ip_id_offset_ctxt);
 free_context:
-	zfree(g_context);
+	rohc_pool_put(g_context->pool, g_context);
 quit:
 	return NULL;
 }
@@ -542,8 +544,8 @@ void d_generic_destroy(void *const context)
 		zfree(g_context->specific);
 	}
 
-	/* destroy generic context itself */
-	free(g_context);
+	/* give the generic context itself back to the pool of the decompressor */
+	rohc_pool_put(g_context->pool, g_context);
 }
 
 
@@ -336,6 +336,9 @@ typedef enum
  */
 struct d_generic_context
 {
+	/// The pool of the decompressor the context was taken from
+	struct rohc_pool *pool;
+
 	/// Information about the outer IP header
 	struct d_generic_changes *outer_ip_changes;
 	/// Information about the inner IP header
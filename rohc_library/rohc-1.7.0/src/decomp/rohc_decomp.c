@@ -426,6 +426,7 @@ struct rohc_decomp * rohc_alloc_decompressor(struct rohc_comp *compressor)
 	/* initialize the array of decompression contexts to its minimal value */
 	decomp->contexts = NULL;
 	decomp->num_contexts_used = 0;
+	rohc_pool_init(&decomp->generic_ctxts_pool);
 	is_fine = rohc_decomp_create_contexts(decomp, decomp->medium.max_cid);
 	if(!is_fine)
 	{
@@ -514,6 +515,7 @@ void rohc_free_decompressor(struct rohc_decomp *decomp)
 	}
 	zfree(decomp->contexts);
 	assert(decomp->num_contexts_used == 0);
+	rohc_pool_free(&decomp->generic_ctxts_pool);
 
 	/* destroy the decompressor itself */
 	free(decomp);
@@ -782,6 +784,7 @@ struct rohc_decomp * rohc_decomp_new2(const rohc_cid_type_t cid_type,
 	/* initialize the array of decompression contexts to its minimal value */
 	decomp->contexts = NULL;
 	decomp->num_contexts_used = 0;
+	rohc_pool_init(&decomp->generic_ctxts_pool);
 	is_fine = rohc_decomp_create_contexts(decomp, decomp->medium.max_cid);
 	if(!is_fine)
 	{
@@ -884,6 +887,7 @@ void rohc_decomp_free(struct rohc_decomp *const decomp)
 	}
 	zfree(decomp->contexts);
 	assert(decomp->num_contexts_used == 0);
+	rohc_pool_free(&decomp->generic_ctxts_pool);
 
 	/* destroy the decompressor itself */
 	free(decomp);
@@ -30,6 +30,8 @@
 #include "rohc_internal.h"
 #include "rohc_decomp.h"
 #include "rohc_stats.h"
+#include "crc.h"
+#include "rohc_pool.h"
 
 
 
@@ -107,6 +109,8 @@ struct rohc_decomp
 	struct rohc_decomp_ctxt **contexts;
 	/** The number of decompression contexts in use */
 	size_t num_contexts_used;
+	/** The memory of the generic part of the profile contexts */
+	struct rohc_pool generic_ctxts_pool;
 	/** The last decompression context used by the decompressor */
 	struct rohc_decomp_ctxt *last_context;
 
@@ -142,11 +146,11 @@ struct rohc_decomp
 	/* CRC-related variables: */
 
 	/** The table to enable fast CRC-3 computation */
-	unsigned char crc_table_3[256];
+	unsigned char crc_table_3[ROHC_CRC_TABLE_LEN];
 	/** The table to enable fast CRC-7 computation */
-	unsigned char crc_table_7[256];
+	unsigned char crc_table_7[ROHC_CRC_TABLE_LEN];
 	/** The table to enable fast CRC-8 computation */
-	unsigned char crc_table_8[256];
+	unsigned char crc_table_8[ROHC_CRC_TABLE_LEN];
 
 
 	/** Some statistics about the decompression processes */
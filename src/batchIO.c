@@ -0,0 +1,386 @@
+#include "batchIO.h"
+
+// batched UDP I/O: several datagrams are read with a single recvmmsg()
+//and several bundles are sent with a single sendmmsg(). This saves
+//a lot of system calls when the packet rate is high
+// it is only used in UDP mode, and only if '-k' is higher than 1
+// with '-g', consecutive bundles of the same size are sent as a single GSO
+//super-datagram, and the kernel may coalesce the bundles received (GRO)
+
+
+// reserve the memory for the batches
+void initBatchIO(contextSimplemux* context)
+{
+  // nothing to do if batching is not enabled
+  if (context->batchSize <= 1)
+    return;
+
+  #ifdef ASSERT
+    assert(context->mode == UDP_MODE);
+    assert(context->batchSize <= MAXBATCH);
+  #endif
+
+  // a coalesced datagram (GRO) may contain several bundles
+  if (context->udpGro)
+    context->rxBufferSize = GRO_BUFSIZE;
+  else
+    context->rxBufferSize = BUFSIZE;
+
+  context->rxBatchMsgs = calloc(context->batchSize, sizeof(struct mmsghdr));
+  context->rxBatchIovecs = calloc(context->batchSize, sizeof(struct iovec));
+  context->rxBatchAddrs = calloc(context->batchSize, sizeof(struct sockaddr_in));
+  context->rxBatchBuffers = calloc(context->batchSize, context->rxBufferSize);
+  context->rxBatchSegmentSizes = calloc(context->batchSize, sizeof(int));
+  context->rxBatchControl = calloc(context->batchSize, UDP_CONTROL_SIZE);
+
+  context->txBatchMsgs = calloc(context->batchSize, sizeof(struct mmsghdr));
+  context->txBatchIovecs = calloc(context->batchSize, sizeof(struct iovec));
+  context->txBatchBuffers = calloc(context->batchSize, BUFSIZE);
+  context->txGsoMsgs = calloc(context->batchSize, sizeof(struct mmsghdr));
+  context->txGsoControl = calloc(context->batchSize, UDP_CONTROL_SIZE);
+
+  if ((context->rxBatchMsgs == NULL) || (context->rxBatchIovecs == NULL) ||
+      (context->rxBatchAddrs == NULL) || (context->rxBatchBuffers == NULL) ||
+      (context->rxBatchSegmentSizes == NULL) || (context->rxBatchControl == NULL) ||
+      (context->txBatchMsgs == NULL) || (context->txBatchIovecs == NULL) ||
+      (context->txBatchBuffers == NULL) || (context->txGsoMsgs == NULL) ||
+      (context->txGsoControl == NULL))
+  {
+    perror("[initBatchIO] could not reserve memory for the batches");
+    exit (EXIT_FAILURE);
+  }
+
+  // each message points to its own buffer
+  for (int i = 0; i < context->batchSize; i++) {
+    context->rxBatchIovecs[i].iov_base = context->rxBatchBuffers + i * context->rxBufferSize;
+    context->rxBatchMsgs[i].msg_hdr.msg_iov = &context->rxBatchIovecs[i];
+    context->rxBatchMsgs[i].msg_hdr.msg_iovlen = 1;
+    context->rxBatchMsgs[i].msg_hdr.msg_name = &context->rxBatchAddrs[i];
+
+    context->txBatchIovecs[i].iov_base = context->txBatchBuffers[i];
+    context->txBatchMsgs[i].msg_hdr.msg_iov = &context->txBatchIovecs[i];
+    context->txBatchMsgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  context->numBatchedTx = 0;
+
+  #ifdef DEBUG
+    do_debug_c( 1,
+                ANSI_COLOR_RESET,
+                "Batched UDP I/O enabled. Up to %i datagrams per system call\n",
+                context->batchSize);
+    if (context->udpGso)
+      do_debug_c( 1,
+                  ANSI_COLOR_RESET,
+                  "UDP GSO enabled. Bundles of the same size are sent in a single super-datagram\n");
+    if (context->udpGro)
+      do_debug_c( 1,
+                  ANSI_COLOR_RESET,
+                  "UDP GRO enabled. The bundles received may be coalesced by the kernel\n");
+  #endif
+}
+
+
+// returns the size of the bundles coalesced by the kernel (GRO) in a datagram,
+//or 0 if it has not been coalesced
+// declared as 'static' because it is only used in this .c file
+static int groSegmentSize(struct msghdr* message)
+{
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(message); cmsg != NULL; cmsg = CMSG_NXTHDR(message, cmsg)) {
+    if ((cmsg->cmsg_level == SOL_UDP) && (cmsg->cmsg_type == UDP_GRO)) {
+      int segmentSize;
+      memcpy(&segmentSize, CMSG_DATA(cmsg), sizeof(int));
+      return segmentSize;
+    }
+  }
+  return 0;
+}
+
+
+// read all the datagrams available in the UDP socket (up to 'batchSize')
+//with a single system call
+// each datagram is stored in 'rxBatchIovecs[i].iov_base', its length is in
+//'rxBatchMsgs[i].msg_len' and its source in 'rxBatchAddrs[i]'
+// if UDP GRO is used, a datagram may contain several bundles of 'rxBatchSegmentSizes[i]'
+//bytes (the last one may be shorter)
+// a datagram that did not fit in its buffer has been truncated by the kernel: it is
+//dropped, and its 'rxBatchSegmentSizes[i]' is 0
+// returns the number of datagrams read, or -1 if there was an error
+int readBatchFromNet(contextSimplemux* context)
+{
+  // the kernel overwrites these fields, so they have to be restored before each call
+  for (int i = 0; i < context->batchSize; i++) {
+    context->rxBatchIovecs[i].iov_len = context->rxBufferSize;
+    context->rxBatchMsgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    if (context->udpGro) {
+      context->rxBatchMsgs[i].msg_hdr.msg_control = context->rxBatchControl[i];
+      context->rxBatchMsgs[i].msg_hdr.msg_controllen = UDP_CONTROL_SIZE;
+    }
+  }
+
+  // MSG_DONTWAIT: poll() has said there is something to read, but
+  //I do not want to block waiting for a full batch
+  int numDatagrams = recvmmsg(context->udp_mode_fd,
+                              context->rxBatchMsgs,
+                              context->batchSize,
+                              MSG_DONTWAIT,
+                              NULL);
+
+  if (numDatagrams == -1) {
+    if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+      perror ("[readBatchFromNet] recvmmsg() UDP error");
+    return -1;
+  }
+
+  context->recvmmsgCalls++;
+  context->recvmmsgDatagrams = context->recvmmsgDatagrams + numDatagrams;
+
+  for (int i = 0; i < numDatagrams; i++) {
+    int length = context->rxBatchMsgs[i].msg_len;
+    int segmentSize = 0;
+
+    // the end of the datagram is missing, so its content cannot be demuxed
+    if (context->rxBatchMsgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+      #ifdef DEBUG
+        do_debug_c( 1,
+                    ANSI_COLOR_RED,
+                    "Datagram read from the UDP socket: longer than %i bytes. Dropped\n",
+                    context->rxBufferSize);
+      #endif
+      context->netPacketsTooLong++;
+      context->rxBatchSegmentSizes[i] = 0;
+      continue;
+    }
+
+    if (context->udpGro)
+      segmentSize = groSegmentSize(&context->rxBatchMsgs[i].msg_hdr);
+
+    if ((segmentSize > 0) && (segmentSize < length)) {
+      // several bundles have been coalesced
+      int numSegments = (length + segmentSize - 1) / segmentSize;
+      context->groReceives++;
+      context->groSegments = context->groSegments + numSegments;
+      context->udpDatagramsReceived = context->udpDatagramsReceived + numSegments;
+    }
+    else {
+      segmentSize = length;
+      context->udpDatagramsReceived++;
+    }
+
+    context->rxBatchSegmentSizes[i] = segmentSize;
+    context->udpBytesReceived = context->udpBytesReceived + length;
+  }
+
+  #ifdef DEBUG
+    do_debug_c( 3,
+                ANSI_COLOR_YELLOW,
+                "Read %i datagrams from the UDP socket with a single recvmmsg()\n",
+                numDatagrams);
+  #endif
+
+  return numDatagrams;
+}
+
+
+// send a datagram through the UDP socket
+// if batching is enabled, the datagram is copied to the transmission batch,
+//which is sent when it is full or when 'flushBatchedDatagrams()' is called
+// returns the number of bytes sent (or queued), or -1 if there was an error,
+//i.e. the same as sendto()
+int sendDatagramUdp(contextSimplemux* context,
+                    uint8_t* datagram,
+                    int length)
+{
+  struct iovec iov;
+  iov.iov_base = datagram;
+  iov.iov_len = length;
+
+  return sendDatagramUdpIovec(context, &iov, 1, length);
+}
+
+
+// send a datagram made of several pieces ('iovcnt' pieces, 'length' bytes in total)
+// without batching, the pieces are gathered by the kernel (sendmsg()). With
+//batching, they are copied to the transmission batch
+// returns the same as 'sendDatagramUdp()'
+int sendDatagramUdpIovec( contextSimplemux* context,
+                          struct iovec* iov,
+                          int iovcnt,
+                          int length)
+{
+  if (context->batchSize <= 1) {
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_name = &(context->remote);
+    message.msg_namelen = sizeof(context->remote);
+    message.msg_iov = iov;
+    message.msg_iovlen = iovcnt;
+
+    context->udpDatagramsSent++;
+    context->udpBytesSent = context->udpBytesSent + length;
+
+    return sendmsg(context->udp_mode_fd, &message, 0);
+  }
+
+  #ifdef ASSERT
+    assert(length <= BUFSIZE);
+  #endif
+
+  // store the datagram in the first free slot of the batch
+  uint8_t* slot = context->txBatchBuffers[context->numBatchedTx];
+  for (int i = 0; i < iovcnt; i++) {
+    memcpy(slot, iov[i].iov_base, iov[i].iov_len);
+    slot = slot + iov[i].iov_len;
+  }
+  context->txBatchIovecs[context->numBatchedTx].iov_len = length;
+  context->numBatchedTx++;
+
+  // the batch is full: send it now
+  if (context->numBatchedTx == context->batchSize)
+    flushBatchedDatagrams(context);
+
+  return length;
+}
+
+
+// group the datagrams of the transmission batch for UDP GSO: a group is a run of
+//consecutive datagrams of the same size (the last one may be shorter), and it is
+//sent as a single super-datagram that the kernel splits again. The order is kept
+// '*messages' is set to the array of messages to be passed to sendmmsg()
+// returns the number of messages
+// declared as 'static' because it is only used in this .c file
+static int buildGsoMessages(contextSimplemux* context,
+                            struct mmsghdr** messages)
+{
+  int numMessages = 0;
+  int first = 0;
+
+  while (first < context->numBatchedTx) {
+    int segmentSize = context->txBatchIovecs[first].iov_len;
+    int totalSize = segmentSize;
+    int last = first;
+
+    // add datagrams to the group while they have the same size
+    // a shorter one can be added, but it has to be the last one of the group
+    while ((last + 1 < context->numBatchedTx) &&
+           ((int)context->txBatchIovecs[last + 1].iov_len <= segmentSize) &&
+           (totalSize + context->txBatchIovecs[last + 1].iov_len <= GSO_MAX_SIZE))
+    {
+      last++;
+      totalSize = totalSize + context->txBatchIovecs[last].iov_len;
+      if ((int)context->txBatchIovecs[last].iov_len < segmentSize)
+        break;
+    }
+
+    struct msghdr* header = &context->txGsoMsgs[numMessages].msg_hdr;
+    memset(header, 0, sizeof(struct msghdr));
+    header->msg_name = &(context->remote);
+    header->msg_namelen = sizeof(context->remote);
+    header->msg_iov = &context->txBatchIovecs[first];
+    header->msg_iovlen = last - first + 1;
+
+    if (last > first) {
+      // tell the kernel the size of each segment
+      header->msg_control = context->txGsoControl[numMessages];
+      header->msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+
+      struct cmsghdr* cmsg = CMSG_FIRSTHDR(header);
+      cmsg->cmsg_level = SOL_UDP;
+      cmsg->cmsg_type = UDP_SEGMENT;
+      cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+      uint16_t gsoSize = segmentSize;
+      memcpy(CMSG_DATA(cmsg), &gsoSize, sizeof(uint16_t));
+
+      context->gsoSends++;
+      context->gsoSegments = context->gsoSegments + (last - first + 1);
+    }
+
+    numMessages++;
+    first = last + 1;
+  }
+
+  *messages = context->txGsoMsgs;
+  return numMessages;
+}
+
+
+// send all the datagrams stored in the transmission batch
+void flushBatchedDatagrams(contextSimplemux* context)
+{
+  int sent = 0;
+
+  for (int i = 0; i < context->numBatchedTx; i++) {
+    context->txBatchMsgs[i].msg_hdr.msg_name = &(context->remote);
+    context->txBatchMsgs[i].msg_hdr.msg_namelen = sizeof(context->remote);
+
+    context->udpBytesSent = context->udpBytesSent + context->txBatchIovecs[i].iov_len;
+  }
+  context->udpDatagramsSent = context->udpDatagramsSent + context->numBatchedTx;
+
+  // each message is a datagram of the batch
+  struct mmsghdr* messages = context->txBatchMsgs;
+  int numMessages = context->numBatchedTx;
+
+  // GSO: each message is a group of consecutive datagrams of the batch
+  if (context->udpGso)
+    numMessages = buildGsoMessages(context, &messages);
+
+  // number of datagrams of the batch already sent
+  int datagramsSent = 0;
+
+  // sendmmsg() may send only a part of the batch, so repeat until all of them have been sent
+  while (sent < numMessages) {
+    int result = sendmmsg(context->udp_mode_fd,
+                          &messages[sent],
+                          numMessages - sent,
+                          0);
+
+    if (result == -1) {
+      if (errno == EINTR)
+        continue;
+
+      // the kernel may refuse a GSO super-datagram even if UDP_SEGMENT was accepted by
+      //setsockopt(), e.g. without checksum offload (EIO), or if the segments do not
+      //fit in the MTU of the path (EINVAL). GSO is not used any more, and the rest of
+      //the batch is sent with a message per datagram
+      if (context->udpGso && ((errno == EIO) || (errno == EINVAL))) {
+        perror("sendmmsg() failed with UDP GSO. It will not be used any more");
+        context->udpGso = false;
+        messages = context->txBatchMsgs;
+        numMessages = context->numBatchedTx;
+        sent = datagramsSent;
+        continue;
+      }
+
+      // these errors do not depend on the traffic, so the program cannot go on
+      if ((errno == EBADF) || (errno == ENOTSOCK) || (errno == EFAULT) || (errno == EINVAL)) {
+        perror("sendmmsg() in UDP mode failed");
+        exit (EXIT_FAILURE);
+      }
+
+      // transient error (e.g. ENOBUFS, or ECONNREFUSED if the peer is not running yet):
+      //the rest of the batch is dropped
+      perror("sendmmsg() in UDP mode failed. The datagrams of the batch not sent are dropped");
+      context->sendmmsgDrops = context->sendmmsgDrops + context->numBatchedTx - datagramsSent;
+      break;
+    }
+
+    context->sendmmsgCalls++;
+    // each datagram of the batch is an iovec (with GSO, a message has several of them)
+    for (int i = sent; i < sent + result; i++)
+      datagramsSent = datagramsSent + messages[i].msg_hdr.msg_iovlen;
+    sent = sent + result;
+  }
+  context->sendmmsgDatagrams = context->sendmmsgDatagrams + datagramsSent;
+
+  #ifdef DEBUG
+    if (context->numBatchedTx > 0)
+      do_debug_c( 3,
+                  ANSI_COLOR_YELLOW,
+                  "Sent %i datagrams to the UDP socket with sendmmsg() (%i messages)\n",
+                  context->numBatchedTx,
+                  numMessages);
+  #endif
+
+  context->numBatchedTx = 0;
+}
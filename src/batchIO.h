@@ -0,0 +1,22 @@
+// header guard: avoids problems if this file is included twice
+#ifndef BATCHIO_H
+#define BATCHIO_H
+
+#include "commonFunctions.h"
+
+void initBatchIO(contextSimplemux* context);
+
+int readBatchFromNet(contextSimplemux* context);
+
+int sendDatagramUdp(contextSimplemux* context,
+                    uint8_t* datagram,
+                    int length);
+
+int sendDatagramUdpIovec( contextSimplemux* context,
+                          struct iovec* iov,
+                          int iovcnt,
+                          int length);
+
+void flushBatchedDatagrams(contextSimplemux* context);
+
+#endif  // BATCHIO_H
@@ -0,0 +1,500 @@
+#include "blastFec.h"
+#include "netToTunUtilities.h"
+
+// forward error correction for the blast flavor ('-F K:M' option)
+// the sender groups its blast packets in blocks of K consecutive identifiers.
+//After the K-th packet of a block, it sends M parity packets (protocolID
+//IPPROTO_BLAST_FEC). They are neither stored nor acknowledged
+// each parity packet is a linear combination, in GF(256), of the protected data
+//of the K packets: protocolID, size and payload, padded with zeroes to the longest one
+// - M = 1: the parity is the XOR of the K packets
+// - M > 1: Reed-Solomon erasure code, with the coefficients of a Cauchy matrix.
+//Any K of the K+M packets are enough to rebuild the block
+// the receiver keeps the last packets received and the parity packets. When the
+//number of lost packets of a block is not higher than the number of parity
+//packets received, it rebuilds them and delivers them as if they had arrived,
+//so they are acknowledged and the sender does not retransmit them
+
+// logarithm and exponential tables of GF(256), with the polynomial 0x11D
+// they are shared by all the queues, so they are built by 'main()' before the
+//threads of the queues start, and they are only read afterwards
+// declared as 'static' because they are only used in this .c file
+static uint8_t gfExp[512];
+static uint8_t gfLog[256];
+
+// build the tables of GF(256). It must be called before the threads are started
+void initGaloisField()
+{
+  int x = 1;
+  for (int i = 0; i < 255; i++) {
+    gfExp[i] = x;
+    gfLog[x] = i;
+    x = x << 1;
+    if (x & 0x100)
+      x = x ^ 0x11D;
+  }
+  // repeat the table, so the sum of two logarithms can be used directly
+  for (int i = 255; i < 512; i++)
+    gfExp[i] = gfExp[i - 255];
+}
+
+
+// declared as 'static' because it is only used in this .c file
+static uint8_t gfMultiply(uint8_t a, uint8_t b)
+{
+  if ((a == 0) || (b == 0))
+    return 0;
+  return gfExp[gfLog[a] + gfLog[b]];
+}
+
+
+// declared as 'static' because it is only used in this .c file
+static uint8_t gfInverse(uint8_t a)
+{
+  return gfExp[255 - gfLog[a]];
+}
+
+
+// dst = dst + c * src, for 'length' bytes (in GF(256) the sum is the XOR)
+// declared as 'static' because it is only used in this .c file
+static void gfMultiplyAdd(uint8_t* dst, uint8_t* src, uint8_t c, int length)
+{
+  if (c == 0)
+    return;
+
+  if (c == 1) {
+    for (int i = 0; i < length; i++)
+      dst[i] = dst[i] ^ src[i];
+    return;
+  }
+
+  int logC = gfLog[c];
+  for (int i = 0; i < length; i++) {
+    if (src[i] != 0)
+      dst[i] = dst[i] ^ gfExp[gfLog[src[i]] + logC];
+  }
+}
+
+
+// coefficient of packet 'i' in parity packet 'j'
+// with a single parity packet, it is the XOR of all the packets. Otherwise it
+//is the Cauchy matrix 1 / (x_j + y_i), with x_j = K + j and y_i = i
+// declared as 'static' because it is only used in this .c file
+static uint8_t fecCoefficient(int blockSize, int parityCount, int j, int i)
+{
+  if (parityCount == 1)
+    return 1;
+  return gfInverse((blockSize + j) ^ i);
+}
+
+
+// add a packet to the block that is being encoded
+// returns true if the block is complete, so its parity can be sent
+bool fecEncode(blastFecEncoder* encoder,
+               uint16_t identifier,
+               uint8_t protocolID,
+               uint16_t size,
+               uint8_t* payload)
+{
+  // the receiver finds the packets of a block from the identifier of the first
+  //one, so they must be consecutive. The identifier also grows when a packet is
+  //retransmitted: if that happens in the middle of a block, it is abandoned
+  //and a new one starts with this packet
+  if ((encoder->count > 0) && (identifier != (uint16_t)(encoder->firstIdentifier + encoder->count)))
+    fecResetEncoder(encoder);
+
+  if (encoder->count == 0)
+    encoder->firstIdentifier = identifier;
+
+  // protected data: protocolID, size and payload
+  uint8_t unit[BLAST_FEC_UNIT];
+  unit[0] = protocolID;
+  unit[1] = size >> 8;
+  unit[2] = size & 0xFF;
+  memcpy(&unit[3], payload, size);
+  int length = 3 + size;
+
+  for (int j = 0; j < encoder->parityCount; j++)
+    gfMultiplyAdd(encoder->parity[j],
+                  unit,
+                  fecCoefficient(encoder->blockSize, encoder->parityCount, j, encoder->count),
+                  length);
+
+  if (length > encoder->length)
+    encoder->length = length;
+
+  encoder->count++;
+  return (encoder->count == encoder->blockSize);
+}
+
+
+// start a new block
+void fecResetEncoder(blastFecEncoder* encoder)
+{
+  for (int j = 0; j < encoder->parityCount; j++)
+    memset(encoder->parity[j], 0, encoder->length);
+  encoder->length = 0;
+  encoder->count = 0;
+}
+
+
+// store a packet received, for rebuilding other packets of its block
+void fecStoreData(blastFecDecoder* decoder,
+                  uint16_t identifier,
+                  uint8_t protocolID,
+                  uint16_t size,
+                  uint8_t* payload)
+{
+  int slot = identifier % BLAST_FEC_DATA_RING;
+
+  if (size > BUFSIZE)
+    return;
+
+  decoder->data[slot][0] = protocolID;
+  decoder->data[slot][1] = size >> 8;
+  decoder->data[slot][2] = size & 0xFF;
+  memcpy(&decoder->data[slot][3], payload, size);
+  decoder->dataLength[slot] = 3 + size;
+  decoder->dataIdentifier[slot] = identifier;
+  decoder->dataValid[slot] = true;
+}
+
+
+// store a parity packet
+// returns the block it belongs to
+int fecStoreParity(blastFecDecoder* decoder,
+                   uint16_t firstIdentifier,
+                   simplemuxBlastFecHeader* fecHeader,
+                   uint8_t* parity,
+                   int length)
+{
+  int block;
+  for (block = 0; block < BLAST_FEC_PARITY_BLOCKS; block++) {
+    if (decoder->blocks[block].used && (decoder->blocks[block].firstIdentifier == firstIdentifier))
+      break;
+  }
+
+  // first parity packet of this block: replace the oldest one
+  if (block == BLAST_FEC_PARITY_BLOCKS) {
+    block = decoder->nextBlock;
+    decoder->nextBlock = (decoder->nextBlock + 1) % BLAST_FEC_PARITY_BLOCKS;
+
+    blastFecBlock* newBlock = &decoder->blocks[block];
+    newBlock->used = true;
+    newBlock->done = false;
+    newBlock->firstIdentifier = firstIdentifier;
+    newBlock->blockSize = fecHeader->blockSize;
+    newBlock->parityCount = fecHeader->parityCount;
+    newBlock->length = length;
+    memset(newBlock->received, 0, sizeof(newBlock->received));
+  }
+
+  blastFecBlock* thisBlock = &decoder->blocks[block];
+  if ((length == thisBlock->length) && (fecHeader->parityIndex < thisBlock->parityCount)) {
+    memcpy(thisBlock->parity[fecHeader->parityIndex], parity, length);
+    thisBlock->received[fecHeader->parityIndex] = true;
+  }
+  return block;
+}
+
+
+// rebuild the lost packets of a block, if there are enough parity packets
+// the rebuilt packets are stored in the ring, and their identifiers in 'rebuilt'
+// returns the number of packets rebuilt
+int fecDecode(blastFecDecoder* decoder, int block, uint16_t* rebuilt)
+{
+  blastFecBlock* thisBlock = &decoder->blocks[block];
+  if (thisBlock->done)
+    return 0;
+
+  int blockSize = thisBlock->blockSize;
+  int parityCount = thisBlock->parityCount;
+  int length = thisBlock->length;
+
+  // find the lost packets
+  int lost[BLAST_FEC_MAX_M];
+  int numLost = 0;
+  for (int i = 0; i < blockSize; i++) {
+    uint16_t identifier = thisBlock->firstIdentifier + i;
+    int slot = identifier % BLAST_FEC_DATA_RING;
+    if (!decoder->dataValid[slot] || (decoder->dataIdentifier[slot] != identifier)) {
+      if (numLost == parityCount)
+        return 0; // too many packets lost: wait for more packets
+      lost[numLost] = i;
+      numLost++;
+    }
+  }
+
+  if (numLost == 0) {
+    thisBlock->done = true;
+    return 0;
+  }
+
+  // select a parity packet for each lost packet
+  int rows[BLAST_FEC_MAX_M];
+  int numRows = 0;
+  for (int j = 0; (j < parityCount) && (numRows < numLost); j++) {
+    if (thisBlock->received[j]) {
+      rows[numRows] = j;
+      numRows++;
+    }
+  }
+  if (numRows < numLost)
+    return 0; // wait for more parity packets
+
+  // remove the packets received from the parity: the rest only depends on the lost ones
+  uint8_t syndrome[BLAST_FEC_MAX_M][BLAST_FEC_UNIT];
+  for (int r = 0; r < numLost; r++) {
+    memcpy(syndrome[r], thisBlock->parity[rows[r]], length);
+    for (int i = 0, k = 0; i < blockSize; i++) {
+      if ((k < numLost) && (lost[k] == i)) {
+        k++;
+        continue;
+      }
+      int slot = (uint16_t)(thisBlock->firstIdentifier + i) % BLAST_FEC_DATA_RING;
+      int dataLength = decoder->dataLength[slot];
+      if (dataLength > length)
+        return 0; // the packet does not belong to this block
+      gfMultiplyAdd(syndrome[r],
+                    decoder->data[slot],
+                    fecCoefficient(blockSize, parityCount, rows[r], i),
+                    dataLength);
+    }
+  }
+
+  // invert the matrix of the coefficients of the lost packets (Gauss-Jordan)
+  uint8_t matrix[BLAST_FEC_MAX_M][BLAST_FEC_MAX_M];
+  uint8_t inverse[BLAST_FEC_MAX_M][BLAST_FEC_MAX_M];
+  for (int r = 0; r < numLost; r++) {
+    for (int k = 0; k < numLost; k++) {
+      matrix[r][k] = fecCoefficient(blockSize, parityCount, rows[r], lost[k]);
+      inverse[r][k] = (r == k) ? 1 : 0;
+    }
+  }
+  for (int col = 0; col < numLost; col++) {
+    int pivot = col;
+    while ((pivot < numLost) && (matrix[pivot][col] == 0))
+      pivot++;
+    if (pivot == numLost)
+      return 0; // it cannot happen with a Cauchy matrix
+
+    for (int k = 0; k < numLost; k++) {
+      uint8_t temp = matrix[col][k]; matrix[col][k] = matrix[pivot][k]; matrix[pivot][k] = temp;
+      temp = inverse[col][k]; inverse[col][k] = inverse[pivot][k]; inverse[pivot][k] = temp;
+    }
+
+    uint8_t factor = gfInverse(matrix[col][col]);
+    for (int k = 0; k < numLost; k++) {
+      matrix[col][k] = gfMultiply(matrix[col][k], factor);
+      inverse[col][k] = gfMultiply(inverse[col][k], factor);
+    }
+
+    for (int r = 0; r < numLost; r++) {
+      uint8_t c = matrix[r][col];
+      if ((r == col) || (c == 0))
+        continue;
+      for (int k = 0; k < numLost; k++) {
+        matrix[r][k] = matrix[r][k] ^ gfMultiply(c, matrix[col][k]);
+        inverse[r][k] = inverse[r][k] ^ gfMultiply(c, inverse[col][k]);
+      }
+    }
+  }
+
+  // rebuild the lost packets
+  int numRebuilt = 0;
+  for (int k = 0; k < numLost; k++) {
+    uint16_t identifier = thisBlock->firstIdentifier + lost[k];
+    int slot = identifier % BLAST_FEC_DATA_RING;
+
+    memset(decoder->data[slot], 0, length);
+    for (int r = 0; r < numLost; r++)
+      gfMultiplyAdd(decoder->data[slot], syndrome[r], inverse[k][r], length);
+
+    int size = (decoder->data[slot][1] << 8) | decoder->data[slot][2];
+    if (3 + size > length)
+      continue; // wrong size: the parity does not correspond to these packets
+
+    decoder->dataLength[slot] = 3 + size;
+    decoder->dataIdentifier[slot] = identifier;
+    decoder->dataValid[slot] = true;
+    rebuilt[numRebuilt] = identifier;
+    numRebuilt++;
+  }
+
+  thisBlock->done = true;
+  return numRebuilt;
+}
+
+
+// deliver the rebuilt packets, as if they had arrived from the network
+// declared as 'static' because it is only used in this .c file
+static void deliverRebuiltPackets(contextSimplemux* context, uint16_t* rebuilt, int numRebuilt)
+{
+  for (int k = 0; k < numRebuilt; k++) {
+    int slot = rebuilt[k] % BLAST_FEC_DATA_RING;
+    uint8_t* unit = context->fecDecoder->data[slot];
+    int size = context->fecDecoder->dataLength[slot] - 3;
+
+    uint8_t packet[sizeof(simplemuxBlastHeader) + BUFSIZE];
+    simplemuxBlastHeader* header = (simplemuxBlastHeader*)packet;
+    header->packetSize = htons(size);
+    header->protocolID = unit[0];
+    header->identifier = htons(rebuilt[k]);
+    header->ACK = ACKNEEDED;
+    memcpy(&packet[sizeof(simplemuxBlastHeader)], &unit[3], size);
+
+    #ifdef DEBUG
+      do_debug_c( 1,
+                  ANSI_COLOR_BOLD_GREEN,
+                  " Blast packet with ID %i rebuilt with the parity (FEC)\n",
+                  rebuilt[k]);
+    #endif
+
+    context->fecRecovered++;
+    demuxPacketBlast(context, sizeof(simplemuxBlastHeader) + size, packet);
+  }
+}
+
+
+// reserve the memory for the encoder and the decoder
+void initBlastFec(contextSimplemux* context)
+{
+  context->fecEncoder = calloc(1, sizeof(blastFecEncoder));
+  context->fecDecoder = calloc(1, sizeof(blastFecDecoder));
+  if ((context->fecEncoder == NULL) || (context->fecDecoder == NULL)) {
+    perror("[initBlastFec] could not reserve memory for the FEC");
+    exit (EXIT_FAILURE);
+  }
+
+  context->fecEncoder->blockSize = context->fecBlockSize;
+  context->fecEncoder->parityCount = context->fecParityCount;
+}
+
+
+// add a blast packet that has been sent for the first time to the current
+//block. If the block is complete, send its parity packets
+void addToFecBlock(contextSimplemux* context,
+                   storedPacketBlast* packet)
+{
+  blastFecEncoder* encoder = context->fecEncoder;
+
+  if (!fecEncode(encoder,
+                 ntohs(packet->header.identifier),
+                 packet->header.protocolID,
+                 ntohs(packet->header.packetSize),
+                 packet->tunneledPacket))
+    return;
+
+  // a parity packet is 6 bytes longer than the longest blast packet of the block
+  //(FEC header, protocolID and size). If it does not fit in the MTU, the parity
+  //of this block is not sent, because it would be fragmented
+  int maxParityLength = context->sizeMax - sizeof(simplemuxBlastHeader) - sizeof(simplemuxBlastFecHeader);
+  if (context->blastPiggyback)
+    maxParityLength = maxParityLength - sizeof(simplemuxBlastPiggyback) - BLAST_SACK_BITMAP_SIZE;
+  if (context->numFlowRules > 0)
+    maxParityLength--;  // hybrid flavor marker
+
+  if (encoder->length > maxParityLength) {
+    context->fecParitySkipped = context->fecParitySkipped + encoder->parityCount;
+    fecResetEncoder(encoder);
+    return;
+  }
+
+  for (int j = 0; j < encoder->parityCount; j++) {
+    uint8_t buffer[sizeof(storedPacketBlast) + sizeof(simplemuxBlastFecHeader) + BLAST_FEC_UNIT];
+    storedPacketBlast* parityPacket = (storedPacketBlast*)buffer;
+    parityPacket->header.packetSize = htons(sizeof(simplemuxBlastFecHeader) + encoder->length);
+    parityPacket->header.protocolID = IPPROTO_BLAST_FEC;
+    parityPacket->header.identifier = htons(encoder->firstIdentifier);
+    parityPacket->header.ACK = ACKNEEDED;  // it is not stored, so it will not be retransmitted
+
+    simplemuxBlastFecHeader* fecHeader = (simplemuxBlastFecHeader*)parityPacket->tunneledPacket;
+    fecHeader->blockSize = encoder->blockSize;
+    fecHeader->parityIndex = j;
+    fecHeader->parityCount = encoder->parityCount;
+    memcpy(&parityPacket->tunneledPacket[sizeof(simplemuxBlastFecHeader)], encoder->parity[j], encoder->length);
+
+    sendPacketBlastFlavor(context, parityPacket);
+    context->fecParitySent++;
+
+    #ifdef DEBUG
+      do_debug_c( 2,
+                  ANSI_COLOR_BRIGHT_BLUE,
+                  " Sent FEC parity packet %i of %i of the block starting at ID %i (%i packets, %i bytes)\n",
+                  j + 1,
+                  encoder->parityCount,
+                  encoder->firstIdentifier,
+                  encoder->blockSize,
+                  encoder->length);
+    #endif
+  }
+
+  fecResetEncoder(encoder);
+}
+
+
+// keep a blast packet received, and rebuild the packets of its block if it
+//was the one missing
+void storeFecData(contextSimplemux* context,
+                  simplemuxBlastHeader* header,
+                  uint8_t* payload)
+{
+  blastFecDecoder* decoder = context->fecDecoder;
+  uint16_t identifier = ntohs(header->identifier);
+
+  fecStoreData(decoder, identifier, header->protocolID, ntohs(header->packetSize), payload);
+  context->receiveBytesCopied = context->receiveBytesCopied + ntohs(header->packetSize);
+
+  for (int block = 0; block < BLAST_FEC_PARITY_BLOCKS; block++) {
+    blastFecBlock* thisBlock = &decoder->blocks[block];
+    if (thisBlock->used && !thisBlock->done &&
+        ((uint16_t)(identifier - thisBlock->firstIdentifier) < thisBlock->blockSize))
+    {
+      uint16_t rebuilt[BLAST_FEC_MAX_M];
+      int numRebuilt = fecDecode(decoder, block, rebuilt);
+      deliverRebuiltPackets(context, rebuilt, numRebuilt);
+    }
+  }
+}
+
+
+// a parity packet has arrived: rebuild the lost packets of its block
+void processFecParity(contextSimplemux* context,
+                      simplemuxBlastHeader* header,
+                      uint8_t* payload,
+                      int length)
+{
+  simplemuxBlastFecHeader* fecHeader = (simplemuxBlastFecHeader*)payload;
+  int parityLength = length - sizeof(simplemuxBlastFecHeader);
+
+  if ((parityLength <= 3) || (parityLength > BLAST_FEC_UNIT) ||
+      (fecHeader->blockSize < 1) || (fecHeader->blockSize > BLAST_FEC_MAX_K) ||
+      (fecHeader->parityCount < 1) || (fecHeader->parityCount > BLAST_FEC_MAX_M))
+  {
+    perror("Problem with the received FEC parity packet\n");
+    return;
+  }
+
+  context->fecParityReceived++;
+
+  int block = fecStoreParity(context->fecDecoder,
+                             ntohs(header->identifier),
+                             fecHeader,
+                             &payload[sizeof(simplemuxBlastFecHeader)],
+                             parityLength);
+
+  uint16_t rebuilt[BLAST_FEC_MAX_M];
+  int numRebuilt = fecDecode(context->fecDecoder, block, rebuilt);
+
+  #ifdef DEBUG
+    do_debug_c( 2,
+                ANSI_COLOR_YELLOW,
+                " FEC parity packet %i of %i of the block starting at ID %i received. %i packets rebuilt\n",
+                fecHeader->parityIndex + 1,
+                fecHeader->parityCount,
+                ntohs(header->identifier),
+                numRebuilt);
+  #endif
+
+  deliverRebuiltPackets(context, rebuilt, numRebuilt);
+}
@@ -0,0 +1,99 @@
+// header guard: avoids problems if this file is included twice
+#ifndef BLASTFEC_H
+#define BLASTFEC_H
+
+#include "commonFunctions.h"
+#include "blastPackets.h"
+
+#define BLAST_FEC_MAX_K 16            // maximum number of blast packets of a block
+#define BLAST_FEC_MAX_M 4             // maximum number of parity packets of a block
+#define BLAST_FEC_UNIT (3 + BUFSIZE)  // protected data of a packet: protocolID, size and payload
+#define BLAST_FEC_DATA_RING 64        // received packets kept for rebuilding the lost ones (a power of 2, at least 2*BLAST_FEC_MAX_K)
+#define BLAST_FEC_PARITY_BLOCKS 4     // blocks whose parity packets are kept by the receiver
+
+
+// header of the payload of a parity packet. The parity data goes after it
+// the identifier of the blast header is the one of the first packet of the block
+typedef struct {
+  uint8_t blockSize;    // number of blast packets of the block (K)
+  uint8_t parityIndex;  // index of this parity packet (0 to M-1)
+  uint8_t parityCount;  // number of parity packets of the block (M)
+} __attribute__ ((__packed__)) simplemuxBlastFecHeader;
+
+
+// parity of the block that is being sent
+typedef struct blastFecEncoder {
+  int blockSize;                      // K
+  int parityCount;                    // M
+  int count;                          // blast packets already added to the current block
+  uint16_t firstIdentifier;           // identifier of the first packet of the current block
+  int length;                         // length of the longest protected data of the current block
+  uint8_t parity[BLAST_FEC_MAX_M][BLAST_FEC_UNIT];
+} blastFecEncoder;
+
+
+// parity packets of a block, kept by the receiver
+typedef struct blastFecBlock {
+  bool used;
+  bool done;                          // the lost packets have been rebuilt (or nothing was lost)
+  uint16_t firstIdentifier;
+  int blockSize;
+  int parityCount;
+  int length;                         // length of the parity data
+  bool received[BLAST_FEC_MAX_M];
+  uint8_t parity[BLAST_FEC_MAX_M][BLAST_FEC_UNIT];
+} blastFecBlock;
+
+
+// packets received recently and parity packets, for rebuilding the lost packets
+// a packet is stored in position 'identifier % BLAST_FEC_DATA_RING'
+typedef struct blastFecDecoder {
+  bool dataValid[BLAST_FEC_DATA_RING];
+  uint16_t dataIdentifier[BLAST_FEC_DATA_RING];
+  int dataLength[BLAST_FEC_DATA_RING];
+  uint8_t data[BLAST_FEC_DATA_RING][BLAST_FEC_UNIT];
+  blastFecBlock blocks[BLAST_FEC_PARITY_BLOCKS];
+  int nextBlock;                      // the next block to be replaced
+} blastFecDecoder;
+
+
+void initGaloisField();
+
+// encoder and decoder of the blocks
+bool fecEncode(blastFecEncoder* encoder,
+               uint16_t identifier,
+               uint8_t protocolID,
+               uint16_t size,
+               uint8_t* payload);
+
+void fecResetEncoder(blastFecEncoder* encoder);
+
+void fecStoreData(blastFecDecoder* decoder,
+                  uint16_t identifier,
+                  uint8_t protocolID,
+                  uint16_t size,
+                  uint8_t* payload);
+
+int fecStoreParity(blastFecDecoder* decoder,
+                   uint16_t firstIdentifier,
+                   simplemuxBlastFecHeader* fecHeader,
+                   uint8_t* parity,
+                   int length);
+
+int fecDecode(blastFecDecoder* decoder, int block, uint16_t* rebuilt);
+
+void initBlastFec(contextSimplemux* context);
+
+void addToFecBlock(contextSimplemux* context,
+                   storedPacketBlast* packet);
+
+void storeFecData(contextSimplemux* context,
+                  simplemuxBlastHeader* header,
+                  uint8_t* payload);
+
+void processFecParity(contextSimplemux* context,
+                      simplemuxBlastHeader* header,
+                      uint8_t* payload,
+                      int length);
+
+#endif  // BLASTFEC_H
@@ -1,11 +1,17 @@
-// taken from https://www.tutorialspoint.com/data_structures_algorithms/linked_list_program_in_c.htm
-
 #include "blastPackets.h"
 
-//display the list
-void printList(storedPacketBlast** head_ref)
+// the unconfirmed packets of the blast flavor are stored in a window: an
+//array with a position for each possible identifier, so a packet can be
+//found (e.g. when its ACK arrives) without traversing anything
+// the packets are also linked (in both directions) in the order they were
+//stored, so they can be visited in order for retransmitting them, and
+//removed from any position
+
+
+//display the window
+void printList(blastWindow* window)
 {
-  storedPacketBlast *ptr = *head_ref;
+  storedPacketBlast *ptr = window->first;
   printf("List of stored packets: [ ");
   
   while(ptr != NULL) {
@@ -19,142 +25,231 @@ void printList(storedPacketBlast** head_ref)
 }
 
 
-//insert link at the first location
-void insertFirst(storedPacketBlast** head_ref, uint16_t identifier, uint16_t size, uint8_t* payload)
-{
-  //create a link
-  storedPacketBlast *link = (storedPacketBlast*) malloc(sizeof(storedPacketBlast));
-  
-  link->header.identifier = htons(identifier);
-  link->header.packetSize = htons(size);
-  memcpy(link->tunneledPacket,payload,ntohs(link->header.packetSize));
-  
-  //point it to old first node
-  link->next = *head_ref;
-  
-  //point first to new first node
-  *head_ref = link;
-}
+// maximum size of the packets of each size class of the pool
+// declared as 'static' because it is only used in this .c file
+static const int blastSizeClasses[BLAST_SIZE_CLASSES] = {64, 128, 256, 512, 1024, BUFSIZE};
 
 
-// find the last packet
-storedPacketBlast* findLast( storedPacketBlast** head_ref)
+// take a slot of the pool for a packet of 'size' bytes
+// returns NULL if all the slots are in use
+// the limit ('-s') is on the slots in use, not on the slots reserved: the free
+//slots of a class cannot be used by another one, so a limit on the reserved
+//slots would make the other classes fail once a class had reserved all of them
+// declared as 'static' because it is only used in this .c file
+static storedPacketBlast* allocBlastSlot(blastPool* pool, uint16_t size)
 {
-  if(isEmpty(*head_ref)) {
-    //printf("[findLast] Empty list\n");
+  // all the slots are in use
+  if (pool->totalSlotsInUse >= pool->maxSlots) {
+    pool->failures++;
     return NULL;
   }
-  else {
-    // the list at least has 1 element
-    int length = 1;
-    storedPacketBlast *current = *head_ref;
-    while(current->next != NULL) {
-      current = current->next;
-      length ++;
+
+  // find the smallest class where the packet fits
+  int sizeClass = 0;
+  while ((sizeClass < BLAST_SIZE_CLASSES - 1) && (size > blastSizeClasses[sizeClass]))
+    sizeClass++;
+
+  // no free slot of this class: reserve a slab of them
+  // a class never has more slots than the limit
+  if ((pool->freeSlots[sizeClass] == NULL) && (pool->reservedSlotsClass[sizeClass] < pool->maxSlots)) {
+    int slotSize = sizeof(storedPacketBlast) + blastSizeClasses[sizeClass];
+    int numSlots = BLAST_SLAB_SLOTS;
+    if (numSlots > pool->maxSlots - pool->reservedSlotsClass[sizeClass])
+      numSlots = pool->maxSlots - pool->reservedSlotsClass[sizeClass];
+
+    uint8_t* slab = malloc(numSlots * slotSize);
+    if (slab != NULL) {
+      for (int i = 0; i < numSlots; i++) {
+        storedPacketBlast* slot = (storedPacketBlast*)(slab + i * slotSize);
+        slot->sizeClass = sizeClass;
+        slot->next = pool->freeSlots[sizeClass];
+        pool->freeSlots[sizeClass] = slot;
+      }
+      pool->reservedSlots = pool->reservedSlots + numSlots;
+      pool->reservedSlotsClass[sizeClass] = pool->reservedSlotsClass[sizeClass] + numSlots;
+      pool->reservedBytes = pool->reservedBytes + numSlots * slotSize;
     }
-    //printf("[findLast] Number of elements of the list: %d\n", length);
-    return current;     
   }
-}
 
+  storedPacketBlast* slot = pool->freeSlots[sizeClass];
+  if (slot == NULL) {
+    pool->failures++;
+    return NULL;
+  }
+
+  pool->freeSlots[sizeClass] = slot->next;
+  pool->slotsInUse[sizeClass]++;
+  pool->totalSlotsInUse++;
+  if (pool->totalSlotsInUse > pool->maxSlotsInUse)
+    pool->maxSlotsInUse = pool->totalSlotsInUse;
+  pool->allocations++;
 
-//insert packet at the last location
-storedPacketBlast* insertLast(storedPacketBlast** head_ref, uint16_t size, uint8_t* payload)
-{
-  // create a link
-  storedPacketBlast *link = (storedPacketBlast*) malloc(sizeof(storedPacketBlast));
+  return slot;
+}
 
-  // fill the content of the link  
-  if(size!=0)
-    link->header.packetSize = htons(size);
 
-  if(payload!=NULL)
-    memcpy(link->tunneledPacket,payload,ntohs(link->header.packetSize));
+// give a slot back to the pool
+// declared as 'static' because it is only used in this .c file
+static void freeBlastSlot(blastPool* pool, storedPacketBlast* slot)
+{
+  slot->next = pool->freeSlots[slot->sizeClass];
+  pool->freeSlots[slot->sizeClass] = slot;
+  pool->slotsInUse[slot->sizeClass]--;
+  pool->totalSlotsInUse--;
+}
 
-  link->next = NULL;
 
-  // check if this is the first packet
-  if(isEmpty(*head_ref)) {
-    *head_ref = link;
-    //printf("[insertLast] New link inserted in the first (and last) position (this is the only packet of the list)\n");
-  }
-  else {
-    // this is not the first packet
+// print the state of the pool of blast packets
+void printBlastPoolStatistics(blastPool* pool)
+{
+  fprintf(stderr,
+          " Blast pool: %i slots in use of %i (max %i), %i reserved (%"PRIu64" bytes), %"PRIu64" allocations, %"PRIu64" failures\n",
+          pool->totalSlotsInUse,
+          pool->maxSlots,
+          pool->maxSlotsInUse,
+          pool->reservedSlots,
+          pool->reservedBytes,
+          pool->allocations,
+          pool->failures);
+
+  fprintf(stderr, " Blast pool slots in use by size:");
+  for (int i = 0; i < BLAST_SIZE_CLASSES; i++)
+    fprintf(stderr, " <=%i %i%s", blastSizeClasses[i], pool->slotsInUse[i], (i < BLAST_SIZE_CLASSES - 1) ? "," : "\n");
+}
 
-    // find the last packet of the list
-    storedPacketBlast *last = findLast(head_ref);
 
-    // insert the new link
-    last->next = link;     
-    //printf("[insertLast] New link inserted\n");
+// reserve the index and the heap of the window. The pool cannot give more than
+//'maxSlots' slots, so there are never more packets stored (or scheduled), and
+//each entry of the index has one packet on average
+void initBlastWindow(blastWindow* window)
+{
+  int indexSize = 1;
+  while (indexSize < window->pool.maxSlots)
+    indexSize = indexSize * 2;
+
+  window->byIdentifier = calloc(indexSize, sizeof(storedPacketBlast*));
+  window->retransmissions = calloc(window->pool.maxSlots, sizeof(storedPacketBlast*));
+  if ((window->byIdentifier == NULL) || (window->retransmissions == NULL)) {
+    perror("[initBlastWindow] could not reserve memory for the window of blast packets");
+    exit (EXIT_FAILURE);
   }
-  return link;
+  window->indexMask = indexSize - 1;
 }
 
 
-//delete first item
-storedPacketBlast* deleteFirst(storedPacketBlast** head_ref)
+//insert packet at the last position of the window
+// if there was another packet with the same identifier (the identifier has
+//wrapped around), the old one is removed
+storedPacketBlast* insertLast(blastWindow* window, uint16_t identifier, uint16_t size, uint8_t* payload)
 {
-  //save reference to first link
-  storedPacketBlast *tempLink = *head_ref;
+  if(find(window, identifier) != NULL)
+    delete(window, identifier);
+
+  // take a slot of the pool
+  storedPacketBlast *link = allocBlastSlot(&window->pool, size);
+  if(link == NULL)
+    return NULL;
 
-  //mark next to first link as first 
-  *head_ref = (*head_ref)->next;
+  // fill the content of the link
+  link->header.identifier = htons(identifier);
+  link->heapPosition = -1;  // it is scheduled when it is sent
+  link->transmissions = 0;
+
+  link->header.packetSize = htons(size);
+
+  if(payload!=NULL)
+    memcpy(link->tunneledPacket,payload,ntohs(link->header.packetSize));
+
+  // link it after the last packet
+  link->prev = window->last;
+  link->next = NULL;
 
-  //return the deleted link
-  return tempLink;
+  if(window->last == NULL)
+    window->first = link;   // this is the only packet of the window
+  else
+    window->last->next = link;
+
+  window->last = link;
+  link->nextInIndex = window->byIdentifier[identifier & window->indexMask];
+  window->byIdentifier[identifier & window->indexMask] = link;
+  window->length++;
+
+  return link;
 }
 
 
-//is the list empty?
-bool isEmpty(storedPacketBlast* head_ref)
+//is the window empty?
+bool isEmpty(blastWindow* window)
 {
-  if(head_ref == NULL)
+  if(window->length == 0)
     return true;
   else
     return false;
 }
 
 
-int length(storedPacketBlast** head_ref)
+int length(blastWindow* window)
 {
-  int length = 0;
-  storedPacketBlast *current = *head_ref;
-
-  while(current!=NULL) {
-    length++;
-    current=current->next;
-  }
-  return length;
+  return window->length;
 }
 
 
-//find a link with given identifier
-storedPacketBlast* find(storedPacketBlast** head_ref, uint16_t identifier)
+//find the packet with a given identifier
+storedPacketBlast* find(blastWindow* window, uint16_t identifier)
 {
-  //start from the first link
-  storedPacketBlast* current = *head_ref;
+  // the entry may also have packets whose identifiers differ in the highest bits
+  storedPacketBlast* packet = window->byIdentifier[identifier & window->indexMask];
+  while ((packet != NULL) && (ntohs(packet->header.identifier) != identifier))
+    packet = packet->nextInIndex;
 
-  //if list is empty
-  if(head_ref == NULL) {
-    return NULL;
-  }
+  return packet;
+}
 
-  //navigate through list
-  while(ntohs(current->header.identifier) != identifier) {
 
-    //if it is last node
-    if(current->next == NULL) {
-      return NULL;
-    }
-    else {
-      //go to next link
-      current = current->next;
-    }
-  }     
+// piggyback ('-y' option): build in 'buffer' a copy of the packet with the
+//PIGGYBACKHEARTBEAT bit. If it is a data packet and there are pending ACKs, they
+//are added after the header (and they will not be sent in a separate ACK)
+// returns the length of the new packet
+// declared as 'static' because it is only used in this .c file
+static int buildPiggybackPacket(contextSimplemux* context,
+                                storedPacketBlast* packetToSend,
+                                uint8_t* buffer)
+{
+  simplemuxBlastHeader* header = (simplemuxBlastHeader*)buffer;
+  *header = packetToSend->header;
+  header->ACK = header->ACK | PIGGYBACKHEARTBEAT;
+  int length = sizeof(simplemuxBlastHeader);
+
+  if ((packetToSend->header.ACK == ACKNEEDED) && (context->pendingAckCount > 0)) {
+    // the bitmap is only sent up to its last non-zero byte
+    int bitmapLength = BLAST_SACK_BITMAP_SIZE;
+    while ((bitmapLength > 0) && (context->pendingAckBitmap[bitmapLength - 1] == 0))
+      bitmapLength--;
+
+    simplemuxBlastPiggyback* piggyback = (simplemuxBlastPiggyback*)&buffer[length];
+    piggyback->ackBase = htons(context->pendingAckBase);
+    piggyback->bitmapLength = bitmapLength;
+    length = length + sizeof(simplemuxBlastPiggyback);
+    memcpy(&buffer[length], context->pendingAckBitmap, bitmapLength);
+    length = length + bitmapLength;
+
+    header->ACK = header->ACK | PIGGYBACKACK;
+
+    #ifdef DEBUG
+      do_debug_c( 2,
+                  ANSI_COLOR_BOLD_GREEN,
+                  "  Selective ACK added to the blast packet. First ID %i, %i packets acknowledged\n",
+                  context->pendingAckBase,
+                  context->pendingAckCount);
+    #endif
 
-  //if data found, return the current Link
-  return current;
+    context->blastAcksPiggybacked++;
+    memset(context->pendingAckBitmap, 0, BLAST_SACK_BITMAP_SIZE);
+    context->pendingAckCount = 0;
+  }
+
+  memcpy(&buffer[length], packetToSend->tunneledPacket, ntohs(packetToSend->header.packetSize));
+  return length + ntohs(packetToSend->header.packetSize);
 }
 
 
@@ -167,6 +262,28 @@ void sendPacketBlastFlavor( contextSimplemux* context,
   // calculate the length of the Simplemux header + the tunneled packet
   int total_length = sizeof(simplemuxBlastHeader) + ntohs(packetToSend->header.packetSize);
 
+  // the header and the payload are contiguous in 'packetToSend'
+  uint8_t* packetBuffer = (uint8_t *)&(packetToSend->header);
+
+  // piggyback: every packet except the heartbeats tells the other side that
+  //this one is alive, so the heartbeat period starts again
+  uint8_t piggybackBuffer[sizeof(simplemuxBlastHeader) + sizeof(simplemuxBlastPiggyback) + BLAST_SACK_BITMAP_SIZE + BUFSIZE];
+  if (context->blastPiggyback && (packetToSend->header.ACK != HEARTBEAT)) {
+    total_length = buildPiggybackPacket(context, packetToSend, piggybackBuffer);
+    packetBuffer = piggybackBuffer;
+    context->lastBlastHeartBeatSent = GetTimeStamp();
+  }
+
+  // hybrid flavor: the blast packets share the socket with the bundles, so
+  //they are preceded by a byte that no bundle starts with
+  uint8_t hybridBuffer[1 + sizeof(piggybackBuffer)];
+  if (context->numFlowRules > 0) {
+    hybridBuffer[0] = HYBRID_BLAST_MARKER;
+    memcpy(&hybridBuffer[1], packetBuffer, total_length);
+    packetBuffer = hybridBuffer;
+    total_length++;
+  }
+
   switch (context->mode) {
     case UDP_MODE:
       #ifdef DEBUG
@@ -191,20 +308,18 @@ void sendPacketBlastFlavor( contextSimplemux* context,
       #endif
 
       // send the packet
-      if (sendto( context->udp_mode_fd,
-                  &(packetToSend->header),
-                  total_length,
-                  0,
-                  (struct sockaddr *)&(context->remote),
-                  sizeof(context->remote))==-1)
+      if (sendDatagramUdp(context,
+                          packetBuffer,
+                          total_length)==-1)
       {
         perror("sendto() in UDP mode failed");
         exit (EXIT_FAILURE);
       }
       else {
         context->tun2net++;
-        // only increase the identifier for regular blast packets
-        if (packetToSend->header.ACK == ACKNEEDED) {
+        // only increase the identifier for regular blast packets (parity packets
+        //carry the identifier of their block)
+        if ((packetToSend->header.ACK == ACKNEEDED) && (packetToSend->header.protocolID != IPPROTO_BLAST_FEC)) {
           context->blastIdentifier++;
         }
       }
@@ -235,6 +350,18 @@ void sendPacketBlastFlavor( contextSimplemux* context,
                       0, // in blast mode, no packet from tun/tap is sent in an ACK
                       htons(packetToSend->header.identifier));
           }
+          else if (packetToSend->header.ACK == SELECTIVEACK) {
+            // selective ACK: the identifier is the first one acknowledged
+            fprintf ( context->log_file,
+                      "%"PRIu64"\tsent\tmuxed\t%i\t%"PRIu32"\tto\t%s\t%d\t%i\t\tblastSACK\t%"PRIu16"\n",
+                      GetTimeStamp(),
+                      total_length + IPv4_HEADER_SIZE + UDP_HEADER_SIZE,
+                      context->tun2net,
+                      inet_ntoa(context->remote.sin_addr),
+                      ntohs(context->remote.sin_port),
+                      0, // in blast mode, no packet from tun/tap is sent in an ACK
+                      htons(packetToSend->header.identifier));
+          }
           else {
             // blast packet
             #ifdef ASSERT
@@ -280,7 +407,8 @@ void sendPacketBlastFlavor( contextSimplemux* context,
 
       // build the header
       struct iphdr ipheader;  
-      uint8_t ipprotocol = IPPROTO_SIMPLEMUX_BLAST;
+      // in hybrid flavor, the protocol of the bundles is used
+      uint8_t ipprotocol = (context->numFlowRules > 0) ? context->ipprotocol : IPPROTO_SIMPLEMUX_BLAST;
       BuildIPHeader(&ipheader,
                     total_length,
                     ipprotocol,
@@ -290,7 +418,7 @@ void sendPacketBlastFlavor( contextSimplemux* context,
       // build the full IP multiplexed packet
       uint8_t full_ip_packet[BUFSIZE]; // the full IP packet will be stored here
       BuildFullIPPacket(ipheader,
-                        (uint8_t *)&(packetToSend->header),
+                        packetBuffer,
                         total_length,
                         full_ip_packet);
 
@@ -307,8 +435,9 @@ void sendPacketBlastFlavor( contextSimplemux* context,
       }
       else {
         context->tun2net++;
-        // only increase the identifier for regular blast packets
-        if (packetToSend->header.ACK == ACKNEEDED) {
+        // only increase the identifier for regular blast packets (parity packets
+        //carry the identifier of their block)
+        if ((packetToSend->header.ACK == ACKNEEDED) && (packetToSend->header.protocolID != IPPROTO_BLAST_FEC)) {
           context->blastIdentifier++;
         }
       }
@@ -339,6 +468,18 @@ void sendPacketBlastFlavor( contextSimplemux* context,
                       0, // in blast mode, no packet from tun/tap is sent in an ACK
                       htons(packetToSend->header.identifier));
           }
+          else if (packetToSend->header.ACK == SELECTIVEACK) {
+            // selective ACK: the identifier is the first one acknowledged
+            fprintf ( context->log_file,
+                      "%"PRIu64"\tsent\tmuxed\t%i\t%"PRIu32"\tto\t%s\t\t%i\t\tblastSACK\t%"PRIu16"\n",
+                      GetTimeStamp(),
+                      total_length + IPv4_HEADER_SIZE,
+                      context->tun2net,
+                      inet_ntoa(context->remote.sin_addr),
+                      // there is no port in network mode
+                      0, // in blast mode, no packet from tun/tap is sent in an ACK
+                      htons(packetToSend->header.identifier));
+          }
           else {
             // blast packet
             #ifdef ASSERT
@@ -363,300 +504,525 @@ void sendPacketBlastFlavor( contextSimplemux* context,
 }
 
 
-// send again the packets which sentTimestamp + period >= now
-int sendExpiredPackets( contextSimplemux* context,
-                        uint64_t now)
-{
-  int sentPackets = 0; // number of packets sent
-  storedPacketBlast *current = context->unconfirmedPacketsBlast;
-  
-  while(current != NULL) {
-    #ifdef DEBUG
-      do_debug_c( 3,
-                  ANSI_COLOR_BOLD_GREEN,
-                  "  Packet %d. Stored timestamp: %"PRIu64" us\n",
-                  ntohs(current->header.identifier),
-                  current->sentTimestamp);
-    #endif
-       
-    if(current->sentTimestamp + context->period < now) {
+// heap of retransmissions: the packet whose retransmission is the first one
+//is at position 0, and the children of position i are 2i+1 and 2i+2
 
-      #ifdef DEBUG
-        do_debug_c( 3,
-                    ANSI_COLOR_BOLD_GREEN,
-                    "   Sending packet %d. Updated timestamp: %"PRIu64" us\n",
-                    ntohs(current->header.identifier),
-                    now); 
+// exchange two positions of the heap
+// declared as 'static' because it is only used in this .c file
+static void heapSwap(blastWindow* window, int i, int j)
+{
+  storedPacketBlast* temp = window->retransmissions[i];
+  window->retransmissions[i] = window->retransmissions[j];
+  window->retransmissions[j] = temp;
+  window->retransmissions[i]->heapPosition = i;
+  window->retransmissions[j]->heapPosition = j;
+}
 
-        do_debug_c( 3,
-                    ANSI_COLOR_BOLD_GREEN,
-                    "         Reason: Stored timestamp (%"PRIu64") + period (%"PRIu64") < now (%"PRIu64")\n",
-                    current->sentTimestamp,
-                    context->period,
-                    now);
-      #endif
 
-      // this packet has to be sent
-      current->sentTimestamp = now;
+// move a packet up until its parent is not later than it
+// declared as 'static' because it is only used in this .c file
+static void heapUp(blastWindow* window, int i)
+{
+  while (i > 0) {
+    int parent = (i - 1) / 2;
+    if (window->retransmissions[parent]->retransmissionTimestamp <= window->retransmissions[i]->retransmissionTimestamp)
+      break;
+    heapSwap(window, i, parent);
+    i = parent;
+  }
+}
 
-      // send the packet
-      sendPacketBlastFlavor(context, current);
 
-      sentPackets++;
-    }
-    else {
-      #ifdef DEBUG
-        do_debug_c( 3,
-                    ANSI_COLOR_BOLD_GREEN,
-                    "   Not sending packet %d. Last sent at timestamp: %"PRIu64" us\n",
-                    ntohs(current->header.identifier),
-                    current->sentTimestamp);
+// move a packet down until its children are not earlier than it
+// declared as 'static' because it is only used in this .c file
+static void heapDown(blastWindow* window, int i)
+{
+  while (1) {
+    int smallest = i;
+    int left = 2 * i + 1;
+    int right = 2 * i + 2;
+
+    if ((left < window->numScheduled) &&
+        (window->retransmissions[left]->retransmissionTimestamp < window->retransmissions[smallest]->retransmissionTimestamp))
+      smallest = left;
+    if ((right < window->numScheduled) &&
+        (window->retransmissions[right]->retransmissionTimestamp < window->retransmissions[smallest]->retransmissionTimestamp))
+      smallest = right;
+
+    if (smallest == i)
+      break;
+    heapSwap(window, i, smallest);
+    i = smallest;
+  }
+}
 
-        do_debug_c( 3,
-                    ANSI_COLOR_BOLD_GREEN,
-                    "         Reason: Stored timestamp (%"PRIu64") + period (%"PRIu64") >= now (%"PRIu64")\n",
-                    current->sentTimestamp,
-                    context->period,
-                    now);
-      #endif
-    }
 
-    current = current->next;
+// set the moment when a packet has to be sent again (O(log n))
+// if the packet was already scheduled, its retransmission is moved
+void scheduleRetransmission(blastWindow* window, storedPacketBlast* packet, uint64_t when)
+{
+  packet->retransmissionTimestamp = when;
+
+  if (packet->heapPosition < 0) {
+    // add it at the end of the heap
+    packet->heapPosition = window->numScheduled;
+    window->retransmissions[window->numScheduled] = packet;
+    window->numScheduled++;
+    heapUp(window, packet->heapPosition);
+  }
+  else {
+    heapUp(window, packet->heapPosition);
+    heapDown(window, packet->heapPosition);
   }
-
-  return sentPackets;
 }
 
 
-uint64_t findLastSentTimestamp (storedPacketBlast* head_ref)
+// remove a packet from the heap of retransmissions (O(log n))
+// declared as 'static' because it is only used in this .c file
+static void unscheduleRetransmission(blastWindow* window, storedPacketBlast* packet)
 {
-  //start from the first link
-  storedPacketBlast* current = head_ref;
+  int i = packet->heapPosition;
+  if (i < 0)
+    return;
+
+  // the last packet of the heap takes its place
+  window->numScheduled--;
+  if (i != window->numScheduled) {
+    window->retransmissions[i] = window->retransmissions[window->numScheduled];
+    window->retransmissions[i]->heapPosition = i;
+    heapUp(window, i);
+    heapDown(window, window->retransmissions[i]->heapPosition);
+  }
+  packet->heapPosition = -1;
+}
 
-  #ifdef DEBUG
-    //printList(&head_ref);
-  #endif
 
-  if(head_ref == NULL) {
+// return the moment of the next retransmission (O(1)), or 0 if no packet is waiting
+uint64_t findNextRetransmission(blastWindow* window)
+{
+  if (window->numScheduled == 0)
     return 0;
-  }
-
-  // I take the first packet of the list as the initial value of 'lastSentTimestamp'
 
-  // first packet: it has been sent for sure
   #ifdef DEBUG
     do_debug_c( 3,
                 ANSI_COLOR_BOLD_GREEN,
-                "  Timestamp of packet %d: %"PRIu64" us\n",
-                current->header.identifier,
-                current->sentTimestamp);
+                "  Next retransmission: packet %d at %"PRIu64" us\n",
+                ntohs(window->retransmissions[0]->header.identifier),
+                window->retransmissions[0]->retransmissionTimestamp);
   #endif
 
-  // this packet has been sent before
-  uint64_t lastSentTimestamp = current->sentTimestamp;
+  return window->retransmissions[0]->retransmissionTimestamp;
+}
 
-  #ifdef DEBUG
-    uint16_t lastSentIdentifier = ntohs(current->header.identifier);
-    do_debug_c( 3,
-                ANSI_COLOR_BOLD_GREEN,
-                "  Oldest timestamp so far: packet %d. Timestamp: %"PRIu64" us\n",
-                lastSentIdentifier,
-                lastSentTimestamp);
-  #endif
 
-  // move to the second packet
-  current=current->next;
+// update the RTT estimation with a new measurement (RFC 6298)
+// declared as 'static' because it is only used in this .c file
+static void updateRtt(blastRttEstimator* rtt, uint64_t sample)
+{
+  if (rtt->samples == 0) {
+    rtt->srtt = sample;
+    rtt->rttvar = sample / 2;
+  }
+  else {
+    uint64_t difference = (rtt->srtt > sample) ? rtt->srtt - sample : sample - rtt->srtt;
+    rtt->rttvar = (3 * rtt->rttvar + difference) / 4;
+    rtt->srtt = (7 * rtt->srtt + sample) / 8;
+  }
+  rtt->samples++;
+
+  if (4 * rtt->rttvar > BLAST_RTO_GRANULARITY)
+    rtt->rto = rtt->srtt + 4 * rtt->rttvar;
+  else
+    rtt->rto = rtt->srtt + BLAST_RTO_GRANULARITY;
+}
+
+
+// remove an acknowledged packet from the window
+// if it has only been sent once, the time since it was sent is an RTT sample
+//(Karn's rule: the ACK of a retransmitted packet is ambiguous)
+bool acknowledgeBlastPacket(blastWindow* window, uint16_t identifier, uint64_t now)
+{
+  storedPacketBlast* packet = find(window, identifier);
+  if (packet == NULL)
+    return false;
+
+  if ((packet->transmissions == 1) && (now >= packet->sentTimestamp))
+    updateRtt(&window->rtt, now - packet->sentTimestamp);
+
+  return delete(window, identifier);
+}
+
+
+// time (us) until a packet has to be sent again, after sending it
+// without '-R' it is the period. With '-R' it is the timeout obtained from the
+//RTT (the period until the first sample), never below the floor. It is doubled
+//after each retransmission of the packet, up to BLAST_RTO_MAX_BACKOFF times
+uint64_t blastRetransmissionTimeout(contextSimplemux* context, storedPacketBlast* packet)
+{
+  if (!context->blastAdaptiveRto)
+    return context->period;
+
+  blastRttEstimator* rtt = &context->unconfirmedPacketsBlast.rtt;
+  uint64_t timeout = (rtt->samples == 0) ? context->period : rtt->rto;
+
+  if (timeout < context->blastRtoFloor)
+    timeout = context->blastRtoFloor;
+
+  int backoff = packet->transmissions - 1;
+  if (backoff > BLAST_RTO_MAX_BACKOFF)
+    backoff = BLAST_RTO_MAX_BACKOFF;
+  if (backoff > 0)
+    timeout = timeout << backoff;
+
+  if (timeout > BLAST_RTO_MAX)
+    timeout = BLAST_RTO_MAX;
+
+  return timeout;
+}
 
-  // navigate through the rest of the list
-  while(current != NULL) {
-    #ifdef DEBUG
-      do_debug_c( 3,
-                  ANSI_COLOR_BOLD_GREEN,
-                  "  Timestamp of packet %d: %"PRIu64" us\n",
-                  current->header.identifier,
-                  current->sentTimestamp);
-    #endif
 
-    if(current->sentTimestamp < lastSentTimestamp) {
-      // this packet has been sent even before
-      lastSentTimestamp = current->sentTimestamp;
-       
+// pacing ('-x' option): the blast packets are limited to 'blastPacingRate'
+//packets per second with a token bucket of BLAST_PACING_BURST packets
+// first transmissions have priority: they are always sent immediately, but
+//they take a token, so the retransmissions only use the rate they leave.
+//The retransmissions wait in the heap until there is a token
+
+// add the tokens earned since the last update
+// declared as 'static' because it is only used in this .c file
+static void refillBlastPacingTokens(contextSimplemux* context, uint64_t now)
+{
+  if (now > context->blastPacingLastRefill) {
+    context->blastPacingTokens = context->blastPacingTokens +
+                                 (double)(now - context->blastPacingLastRefill) * context->blastPacingRate / 1000000;
+    if (context->blastPacingTokens > BLAST_PACING_BURST)
+      context->blastPacingTokens = BLAST_PACING_BURST;
+  }
+  context->blastPacingLastRefill = now;
+}
+
+
+// a packet has been sent for the first time (priority lane)
+// the debt is limited, so the retransmissions are not delayed indefinitely
+void takeBlastPacingToken(contextSimplemux* context, uint64_t now)
+{
+  refillBlastPacingTokens(context, now);
+  if (context->blastPacingTokens > -BLAST_PACING_BURST)
+    context->blastPacingTokens = context->blastPacingTokens - 1;
+}
+
+
+// moment when the pacer will allow the next retransmission
+uint64_t blastPacingReadyTime(contextSimplemux* context, uint64_t now)
+{
+  refillBlastPacingTokens(context, now);
+  if (context->blastPacingTokens >= 1)
+    return now;
+  return now + (uint64_t)((1 - context->blastPacingTokens) * 1000000 / context->blastPacingRate) + 1;
+}
+
+
+// send again the packets whose retransmission moment (sentTimestamp + timeout) has arrived
+// only those packets are visited: they are taken from the top of the heap
+// with pacing, the packets that do not get a token stay in the heap
+int sendExpiredPackets( contextSimplemux* context,
+                        uint64_t now)
+{
+  blastWindow* window = &context->unconfirmedPacketsBlast;
+  int sentPackets = 0; // number of packets sent
+
+  // each packet is sent at most once
+  int pending = window->numScheduled;
+
+  if (context->blastPacingRate > 0)
+    refillBlastPacingTokens(context, now);
+
+  while ( (pending > 0) &&
+          (window->retransmissions[0]->retransmissionTimestamp <= now))
+  {
+    if ((context->blastPacingRate > 0) && (context->blastPacingTokens < 1)) {
       #ifdef DEBUG
-        lastSentIdentifier = ntohs(current->header.identifier);
+        do_debug_c( 3,
+                    ANSI_COLOR_BOLD_GREEN,
+                    "   Retransmission of packet %d delayed by the pacer\n",
+                    ntohs(window->retransmissions[0]->header.identifier));
       #endif
+      context->blastPacerDeferrals++;
+      break;
     }
 
+    storedPacketBlast *current = window->retransmissions[0];
+
     #ifdef DEBUG
       do_debug_c( 3,
                   ANSI_COLOR_BOLD_GREEN,
-                  "  Oldest timestamp so far: packet %d. Timestamp: %"PRIu64" us\n",
-                  lastSentIdentifier,
-                  lastSentTimestamp);
+                  "   Sending packet %d. Updated timestamp: %"PRIu64" us\n",
+                  ntohs(current->header.identifier),
+                  now); 
+
+      do_debug_c( 3,
+                  ANSI_COLOR_BOLD_GREEN,
+                  "         Reason: Stored timestamp (%"PRIu64") + timeout (%"PRIu64") <= now (%"PRIu64")\n",
+                  current->sentTimestamp,
+                  current->retransmissionTimestamp - current->sentTimestamp,
+                  now);
     #endif
 
-    current=current->next;
+    // this packet has to be sent. Schedule its next retransmission
+    current->sentTimestamp = now;
+    if (current->transmissions < 255)
+      current->transmissions++;
+    scheduleRetransmission(window, current, now + blastRetransmissionTimeout(context, current));
+    context->blastRetransmissions++;
+    if (context->blastPacingRate > 0)
+      context->blastPacingTokens = context->blastPacingTokens - 1;
+
+    // send the packet
+    sendPacketBlastFlavor(context, current);
+
+    sentPackets++;
+    pending--;
   }
 
-  #ifdef DEBUG
-    do_debug_c( 3,
-                ANSI_COLOR_BOLD_GREEN,
-                "  Oldest timestamp: packet %d. Timestamp: %"PRIu64" us\n",
-                lastSentIdentifier,
-                lastSentTimestamp);
-  #endif
+  if (sentPackets > context->blastMaxRetransmissionBurst)
+    context->blastMaxRetransmissionBurst = sentPackets;
 
-  return lastSentTimestamp;
+  return sentPackets;
 }
 
 
-//delete a link with a given identifier
-// inspired by https://www.geeksforgeeks.org/linked-list-set-3-deleting-node/
-bool delete(storedPacketBlast** head_ref, uint16_t identifier)
+//delete the packet with a given identifier
+bool delete(blastWindow* window, uint16_t identifier)
 {
-  storedPacketBlast* temp = *head_ref, *prev;
-
-  // If the head node itself holds the key to be deleted
-  if (temp != NULL && ntohs(temp->header.identifier) == identifier) {
-    *head_ref = temp->next; // Changed head
-    free(temp); // free old head
-    return true;
-  }
-
-  // Search for the key to be deleted, keep track of the
-  // previous node as we need to change 'prev->next'
-  while (temp != NULL && ntohs(temp->header.identifier) != identifier) {
-    prev = temp;
-    temp = temp->next;
-  }
+  storedPacketBlast* temp = find(window, identifier);
 
-  // If the key was not present in linked list
+  // the packet is not in the window
   if (temp == NULL)
     return false;
 
-  // Unlink the node from linked list
-  prev->next = temp->next;
+  // unlink it from its neighbours
+  if (temp->prev == NULL)
+    window->first = temp->next;
+  else
+    temp->prev->next = temp->next;
+
+  if (temp->next == NULL)
+    window->last = temp->prev;
+  else
+    temp->next->prev = temp->prev;
+
+  unscheduleRetransmission(window, temp);
+
+  // remove it from its entry of the index
+  int entry = identifier & window->indexMask;
+  if (window->byIdentifier[entry] == temp) {
+    window->byIdentifier[entry] = temp->nextInIndex;
+  }
+  else {
+    storedPacketBlast* previous = window->byIdentifier[entry];
+    while (previous->nextInIndex != temp)
+      previous = previous->nextInIndex;
+    previous->nextInIndex = temp->nextInIndex;
+  }
+
+  window->length--;
 
-  free(temp); // Free memory
+  freeBlastSlot(&window->pool, temp); // the slot can be used by another packet
 
   return true;
 }
 
 
-void reverse(storedPacketBlast** head_ref)
+// duplicate suppression at the receiver: a packet is not delivered again if
+//another one with the same identifier was delivered less than
+//TIME_UNTIL_SENDING_AGAIN_BLAST ago
+// only the BLAST_DUPLICATE_WINDOW identifiers behind the highest one are
+//remembered. An older identifier is delivered, as it may never have been
+//delivered before: if it was considered a copy, it would be ACKed and lost
+// the time is stored per block, so an identifier is forgotten
+//TIME_UNTIL_SENDING_AGAIN_BLAST after the first delivery of its block
+
+// returns true if a packet with this identifier has been delivered recently
+bool isDuplicateBlast(blastDuplicateWindow* window, uint16_t identifier, uint64_t now)
 {
-  storedPacketBlast* prev    = NULL;
-  storedPacketBlast* current = *head_ref;
-  storedPacketBlast* next;
-
-  while (current != NULL) {
-    next  = current->next;
-    current->next = prev;    
-    prev = current;
-    current = next;
-  }
+  // nothing delivered recently: all the identifiers have expired
+  if (!window->started || (now - window->lastDelivery >= TIME_UNTIL_SENDING_AGAIN_BLAST))
+    return false;
 
-  *head_ref = prev;
-}
+  // newer than all the identifiers delivered (it wraps around after 65535)
+  uint16_t ahead = identifier - window->highest;
+  if ((ahead != 0) && (ahead < 0x8000))
+    return false;
 
+  // too old to be in the window: it cannot be known if it has been delivered
+  uint16_t behind = window->highest - identifier;
+  if (behind >= BLAST_DUPLICATE_WINDOW)
+    return false;
 
-void test()
-{
-  storedPacketBlast *head = NULL;
-
-  uint8_t packet1[BUFSIZE]= "Hello World";
-  uint8_t packet2[BUFSIZE]= "Hello World2";
-  uint16_t packetSize1 = 11;
-  uint16_t packetSize2 = 12;
-
-  storedPacketBlast *last = findLast(&head);
-  printf("Last element of the list: ");
-  printList(&last);
-
-  insertFirst(&head,1,packetSize1,packet1);
-  insertFirst(&head,2,packetSize2,packet2);
-  insertFirst(&head,3,packetSize1,packet1);
-  insertFirst(&head,4,packetSize2,packet2);
-  insertFirst(&head,5,packetSize1,packet1);
-  insertFirst(&head,6,packetSize2,packet2);
-  printf("Original List: "); 
-  //print list
-  printList(&head);
-
-  storedPacketBlast *current = insertLast(&head,7,/*packetSize2,*/packet2); 
-  current->header.packetSize=packetSize2;
-
-  printf("List with 7 elements: "); 
-
-  //print list
-  printList(&head);
-
-  last = findLast(&head);
-  printf("Last element of the list: ");
-  printList(&last);
-
-  while(!isEmpty(head)) {        
-    storedPacketBlast *temp = deleteFirst(&head);
-    printf("\nDeleted value:");
-    printf("(%d) ",temp->header.identifier);
-  }  
-
-  printf("\nList after deleting all items: ");
-  printList(&head);
-
-  last = findLast(&head);
-  printf("Last element of the list: ");
-  printList(&last);
-
-  insertFirst(&head,5,packetSize1,packet1);
-  insertFirst(&head,1,packetSize1,packet1);
-  insertFirst(&head,2,packetSize2,packet2);
-  insertFirst(&head,3,packetSize1,packet1);
-  insertFirst(&head,4,packetSize2,packet2);
-  insertFirst(&head,6,packetSize2,packet2); 
-  
-  printf("\nRestored List: ");
-  printList(&head);
-  printf("\n");  
+  int position = identifier % BLAST_DUPLICATE_WINDOW;
+  int block = position / BLAST_DUPLICATE_BLOCK;
+
+  // the block has expired
+  if ((uint32_t)(now / 1000) - window->blockTimestamp[block] >= TIME_UNTIL_SENDING_AGAIN_BLAST / 1000)
+    return false;
 
-  last = findLast(&head);
-  printf("Last element of the list: ");
-  printList(&last);
+  return (window->delivered[block] >> (position % BLAST_DUPLICATE_BLOCK)) & 1;
+}
 
-  storedPacketBlast *foundLink = find(&head,4);
 
-  if(foundLink != NULL) {
-    printf("Element found: ");
-    printf("(%d) ",foundLink->header.identifier);
-    printf("\n");  
+// store that a packet with this identifier has been delivered
+void recordBlastDelivery(blastDuplicateWindow* window, uint16_t identifier, uint64_t now)
+{
+  uint32_t nowMs = now / 1000;
+  int position = identifier % BLAST_DUPLICATE_WINDOW;
+  int block = position / BLAST_DUPLICATE_BLOCK;
+
+  if (!window->started || (now - window->lastDelivery >= TIME_UNTIL_SENDING_AGAIN_BLAST)) {
+    // start again: the window only has this identifier
+    memset(window->delivered, 0, sizeof(window->delivered));
+    window->blockTimestamp[block] = nowMs;
+    window->highest = identifier;
+    window->started = true;
   }
   else {
-    printf("Element not found");
-  }
+    uint16_t ahead = identifier - window->highest;
+    if ((ahead != 0) && (ahead < 0x8000)) {
+      // the window moves forward. The blocks it enters are emptied, because
+      //they had the identifiers that are now too old
+      // there are 65536 / BLAST_DUPLICATE_BLOCK blocks of identifiers before wrapping around
+      int newBlocks = ((identifier / BLAST_DUPLICATE_BLOCK) - (window->highest / BLAST_DUPLICATE_BLOCK)) & (0xFFFF / BLAST_DUPLICATE_BLOCK);
+      if (newBlocks > BLAST_DUPLICATE_BLOCKS)
+        newBlocks = BLAST_DUPLICATE_BLOCKS;
+      for (int i = 0; i < newBlocks; i++) {
+        int emptied = (block - i + BLAST_DUPLICATE_BLOCKS) % BLAST_DUPLICATE_BLOCKS;
+        window->delivered[emptied] = 0;
+        window->blockTimestamp[emptied] = nowMs;
+      }
+      window->highest = identifier;
+    }
+    else if ((uint16_t)(window->highest - identifier) >= BLAST_DUPLICATE_WINDOW) {
+      // too old to be stored
+      return;
+    }
 
-  if (delete(&head,4)) {
-    printf("Element %d found\n", 4);
+    // the block has expired: its identifiers are forgotten
+    if (nowMs - window->blockTimestamp[block] >= TIME_UNTIL_SENDING_AGAIN_BLAST / 1000) {
+      window->delivered[block] = 0;
+      window->blockTimestamp[block] = nowMs;
+    }
   }
-  printf("List after deleting the found item: ");
-  printList(&head);
-  printf("\n");
-  foundLink = find(&head,4);
-
-  if(foundLink != NULL) {
-    printf("Element found: ");
-    printf("(%d) ",foundLink->header.identifier);
-    printf("\n");
+
+  window->delivered[block] = window->delivered[block] | ((uint64_t)1 << (position % BLAST_DUPLICATE_BLOCK));
+  window->lastDelivery = now;
+}
+
+
+// selective ACKs ('-A' option): instead of an ACK per packet, the receiver
+//accumulates the identifiers that have arrived, and it sends a single ACK with
+//the first identifier and a bitmap of the next ones
+// the ACK is sent when 'blastAckEvery' identifiers are pending, or when the
+//first one has waited BLAST_ACK_DELAY (or half the period, if it is smaller)
+
+// remove from the window all the packets acknowledged by a selective ACK
+// it returns the number of packets removed
+int processSelectiveAck(blastWindow* window, uint16_t base, uint8_t* bitmap, int bitmapLength, uint64_t now)
+{
+  int removed = 0;
+
+  if(acknowledgeBlastPacket(window, base, now))
+    removed++;
+
+  for (int i = 0; i < bitmapLength; i++) {
+    if (bitmap[i] == 0)
+      continue;
+    for (int bit = 0; bit < 8; bit++) {
+      if (bitmap[i] & (1 << bit)) {
+        // the identifier wraps around after 65535
+        if(acknowledgeBlastPacket(window, (uint16_t)(base + 1 + 8 * i + bit), now))
+          removed++;
+      }
+    }
   }
-  else {
-    printf("Element not found.");
+  return removed;
+}
+
+
+// add an identifier to the next selective ACK
+// if it does not fit in the bitmap, the pending ACK is sent first
+void addPendingAck(contextSimplemux* context, uint16_t identifier, uint64_t now)
+{
+  if (context->pendingAckCount > 0) {
+    // distance to the first pending identifier (it wraps around after 65535)
+    uint16_t offset = identifier - context->pendingAckBase;
+
+    if (offset == 0)
+      return; // it is already pending
+
+    if (offset <= 8 * BLAST_SACK_BITMAP_SIZE) {
+      int bit = offset - 1;
+      if ((context->pendingAckBitmap[bit / 8] & (1 << (bit % 8))) == 0) {
+        context->pendingAckBitmap[bit / 8] |= (1 << (bit % 8));
+        context->pendingAckCount++;
+      }
+      if (context->pendingAckCount >= context->blastAckEvery)
+        sendPendingAcks(context);
+      return;
+    }
+
+    // the identifier is before the first one, or too far from it
+    sendPendingAcks(context);
   }
 
-  printf("\n");
+  // this is the first identifier of a new ACK. Start the delayed-ACK timer
+  context->pendingAckBase = identifier;
+  context->pendingAckCount = 1;
+
+  uint64_t delay = BLAST_ACK_DELAY;
+  if (context->period / 2 < delay)
+    delay = context->period / 2;
+  context->pendingAckDeadline = now + delay;
+
+  if (context->pendingAckCount >= context->blastAckEvery)
+    sendPendingAcks(context);
+}
+
+
+// send a selective ACK with the pending identifiers
+void sendPendingAcks(contextSimplemux* context)
+{
+  if (context->pendingAckCount == 0)
+    return;
+
+  // the bitmap is only sent up to its last non-zero byte
+  int bitmapLength = BLAST_SACK_BITMAP_SIZE;
+  while ((bitmapLength > 0) && (context->pendingAckBitmap[bitmapLength - 1] == 0))
+    bitmapLength--;
+
+  uint8_t buffer[sizeof(storedPacketBlast) + BLAST_SACK_BITMAP_SIZE];
+  storedPacketBlast* ACK = (storedPacketBlast*)buffer;
+  ACK->header.packetSize = htons(bitmapLength); // the length is only that of the bitmap
+  ACK->header.protocolID = 0; // the bitmap is not a tunneled packet, so no protocolID is needed
+  ACK->header.identifier = htons(context->pendingAckBase);
+  ACK->header.ACK = SELECTIVEACK;
+  memcpy(ACK->tunneledPacket, context->pendingAckBitmap, bitmapLength);
 
-  reverse(&head);
-  printf("\nList after reversing the data: ");
-  printList(&head);
+  sendPacketBlastFlavor(context, ACK);
+
+  #ifdef DEBUG
+    do_debug_c( 1,
+                ANSI_COLOR_BOLD_GREEN,
+                " Sent blast selective ACK to the network. First ID ");
+    do_debug_c( 1,
+                ANSI_COLOR_RESET,
+                "%i",
+                context->pendingAckBase);
+    do_debug_c( 1,
+                ANSI_COLOR_BOLD_GREEN,
+                ", %i packets acknowledged, bitmap of %i bytes\n",
+                context->pendingAckCount,
+                bitmapLength);
+  #endif
 
-  last = findLast(&head);
-  printf("Last element of the list: ");
-  printList(&last);
-}
\ No newline at end of file
+  context->blastAcksSent++;
+  memset(context->pendingAckBitmap, 0, BLAST_SACK_BITMAP_SIZE);
+  context->pendingAckCount = 0;
+}
@@ -1,5 +1,3 @@
-// taken from https://www.tutorialspoint.com/data_structures_algorithms/linked_list_program_in_c.htm
-
 // header guard: avoids problems if this file is included twice
 #ifndef PACKETSTOSEND_H
 #define PACKETSTOSEND_H
@@ -11,12 +9,19 @@
 //#include <sys/socket.h>
 
 #include "commonFunctions.h"
+#include "batchIO.h"
+#include "ioUring.h"
 
 #define MASK 0x03
+#define SELECTIVEACK 0x03
 #define HEARTBEAT 0x02
 #define THISISANACK 0x01
 #define ACKNEEDED 0x00
 
+// piggyback ('-y' option): bits added to the ACK field, over MASK
+#define PIGGYBACKHEARTBEAT 0x04 // the sender of the packet is alive, so it also works as a heartbeat
+#define PIGGYBACKACK 0x08       // a selective ACK (simplemuxBlastPiggyback) goes between the header and the payload
+
 
 // header of the packet to be sent
 typedef struct {
@@ -26,38 +31,52 @@ typedef struct {
   uint16_t identifier; // use 'htons()' when writing it because this field will be sent through the network
                        // use 'ntohs()' when reading it from the network
   uint8_t ACK; // 0:this is a packet that requires an ACK; 1:the packet is an ACK; 2: the packet is a heartbeat
+               // 3: the packet is a selective ACK. It acknowledges 'identifier', and its payload is a bitmap:
+               //bit i (LSB first) of byte j acknowledges 'identifier' + 1 + 8*j + i
 } __attribute__ ((__packed__)) simplemuxBlastHeader;
 
 
+// selective ACK carried by a blast packet ('-y' option). It goes after the header,
+//followed by the bitmap. 'packetSize' of the header only counts the payload
+typedef struct {
+  uint16_t ackBase;     // first identifier acknowledged. Use 'htons()' and 'ntohs()'
+  uint8_t bitmapLength; // bytes of the bitmap (as the payload of a SELECTIVEACK packet)
+} __attribute__ ((__packed__)) simplemuxBlastPiggyback;
+
+
 // include the payload and also other parameters that are not sent through the network
+// the header and the payload are the last fields, because they are sent together.
+//The size of the payload depends on the size class of the slot of the pool
 typedef struct storedPacketBlast {
-  simplemuxBlastHeader header;
-  uint8_t tunneledPacket[BUFSIZE];
   uint64_t sentTimestamp; // last moment when this packet was sent
-  struct storedPacketBlast *next;
+  uint64_t retransmissionTimestamp; // moment when this packet has to be sent again
+  int heapPosition;       // position in the heap of retransmissions of the window (-1: not scheduled)
+  uint8_t sizeClass;      // size class of the slot of the pool where the packet is stored
+  uint8_t transmissions;  // number of times the packet has been sent (Karn's rule and backoff)
+  struct storedPacketBlast *prev; // previous packet stored in the window
+  struct storedPacketBlast *next; // next packet stored in the window (or next free slot of the pool)
+  struct storedPacketBlast *nextInIndex; // next packet in the same entry of the index of the window
+  simplemuxBlastHeader header;
+  uint8_t tunneledPacket[];
 } __attribute__ ((__packed__)) storedPacketBlast;
 
 
-//display the list
-void printList(storedPacketBlast** head_ref);
-
-//insert link at the first location
-void insertFirst(storedPacketBlast** head_ref, uint16_t identifier, uint16_t size, uint8_t* payload);
-
-storedPacketBlast* findLast(storedPacketBlast** head_ref);
+//reserve the index and the heap of the window, for the slots of its pool
+void initBlastWindow(blastWindow* window);
 
-storedPacketBlast* insertLast(storedPacketBlast** head_ref, uint16_t size, uint8_t* payload);
+//display the packets of the window
+void printList(blastWindow* window);
 
-//delete first item
-storedPacketBlast* deleteFirst(storedPacketBlast** head_ref);
+//insert a packet at the last position of the window. It returns NULL if there is no free slot
+storedPacketBlast* insertLast(blastWindow* window, uint16_t identifier, uint16_t size, uint8_t* payload);
 
-//is list empty
-bool isEmpty(storedPacketBlast* head_ref);
+//is the window empty
+bool isEmpty(blastWindow* window);
 
-int length(storedPacketBlast** head_ref);
+int length(blastWindow* window);
 
-//find a link with given identifier
-storedPacketBlast* find(storedPacketBlast** head_ref, uint16_t identifier);
+//find the packet with a given identifier
+storedPacketBlast* find(blastWindow* window, uint16_t identifier);
 
 void sendPacketBlastFlavor(contextSimplemux* context,
                            storedPacketBlast* packetToSend);
@@ -65,13 +84,32 @@ void sendPacketBlastFlavor(contextSimplemux* context,
 int sendExpiredPackets( contextSimplemux* context,
                         uint64_t now);
 
-uint64_t findLastSentTimestamp(storedPacketBlast* head_ref);
+void scheduleRetransmission(blastWindow* window, storedPacketBlast* packet, uint64_t when);
+
+uint64_t findNextRetransmission(blastWindow* window);
+
+//delete the packet with a given identifier
+bool delete(blastWindow* window, uint16_t identifier);
+
+//remove an acknowledged packet, measuring the RTT if it was sent only once
+bool acknowledgeBlastPacket(blastWindow* window, uint16_t identifier, uint64_t now);
+
+uint64_t blastRetransmissionTimeout(contextSimplemux* context, storedPacketBlast* packet);
+
+void takeBlastPacingToken(contextSimplemux* context, uint64_t now);
+
+uint64_t blastPacingReadyTime(contextSimplemux* context, uint64_t now);
+
+int processSelectiveAck(blastWindow* window, uint16_t base, uint8_t* bitmap, int bitmapLength, uint64_t now);
+
+void addPendingAck(contextSimplemux* context, uint16_t identifier, uint64_t now);
+
+void sendPendingAcks(contextSimplemux* context);
 
-//delete a link with given identifier
-bool delete(storedPacketBlast** head_ref, uint16_t identifier);
+bool isDuplicateBlast(blastDuplicateWindow* window, uint16_t identifier, uint64_t now);
 
-void reverse(storedPacketBlast** head_ref);
+void recordBlastDelivery(blastDuplicateWindow* window, uint16_t identifier, uint64_t now);
 
-uint64_t findLastSentTimestamp(storedPacketBlast* head_ref);
+void printBlastPoolStatistics(blastPool* pool);
 
 #endif // PACKETSTOSEND_H
\ No newline at end of file
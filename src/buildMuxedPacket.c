@@ -1,16 +1,39 @@
 #include "buildMuxedPacket.h"
 
 
+// prepare the pieces of the multiplexed packets
+// in network mode, the outer IP header is built here once. Only its length,
+//ID and checksum are updated for each multiplexed packet
+void initBundleIovecs(contextSimplemux* context)
+{
+  context->numBundleIovecs = 0;
+
+  context->bundleIovecs[0].iov_base = &context->bundleIpHeader;
+  context->bundleIovecs[0].iov_len = sizeof(struct iphdr);
+
+  if (context->mode == NETWORK_MODE)
+    BuildIPHeader(&context->bundleIpHeader,
+                  0,
+                  context->ipprotocol,
+                  context->local,
+                  context->remote);
+}
+
+
 // it takes all the variables where packets are stored, and builds a multiplexed packet
 // 'single_prot': if all the packets belong to the same protocol
-// the multiplexed packet is stored in 'mux_packet'
+// nothing is copied: the multiplexed packet is described in 'bundleIovecs', which
+//point to the separators, the protocol fields and the stored packets
 // returns: the length of the multiplexed packet
 uint16_t buildMultiplexedPacket ( contextSimplemux* context,
-                                  int single_prot,
-                                  uint8_t mux_packet[BUFSIZE])
+                                  int single_prot)
 {
   int length = 0;
 
+  // the first piece is reserved for the outer IP header
+  struct iovec* iov = &context->bundleIovecs[1];
+  int numIovecs = 0;
+
   // for each packet, write
   // - the separator
   // - the protocol field (if required)
@@ -42,24 +65,28 @@ uint16_t buildMultiplexedPacket ( contextSimplemux* context,
     #endif
 
     // add the separator
-    for (int l = 0; l < context->sizeSeparatorsToMultiplex[k] ; l++) {
-      #ifdef DEBUG
+    #ifdef DEBUG
+      for (int l = 0; l < context->sizeSeparatorsToMultiplex[k] ; l++) {
         do_debug_c( 2,
                     ANSI_COLOR_RESET,
                     "%02x",
                     context->separatorsToMultiplex[k][l]);
-      #endif
+      }
+    #endif
 
-      mux_packet[length] = context->separatorsToMultiplex[k][l];
-      length ++;
-    }
+    iov[numIovecs].iov_base = context->separatorsToMultiplex[k];
+    iov[numIovecs].iov_len = context->sizeSeparatorsToMultiplex[k];
+    numIovecs ++;
+    length = length + context->sizeSeparatorsToMultiplex[k];
 
     // add the Protocol field
     if (context->flavor == 'N') { // normal flavor
       // add the 'Protocol' field if necessary
       if ( (k==0) || (single_prot == 0 ) ) {
         // the protocol field is always present in the first separator (k=0), and maybe in the rest
-        mux_packet[length] = context->protocol[k];
+        iov[numIovecs].iov_base = &context->protocol[k];
+        iov[numIovecs].iov_len = 1;
+        numIovecs ++;
         length ++;
 
         #ifdef DEBUG
@@ -72,7 +99,9 @@ uint16_t buildMultiplexedPacket ( contextSimplemux* context,
     }
     else {  // fast flavor
       // in fast flavor, always add the Protocol field
-      mux_packet[length] = context->protocol[k];
+      iov[numIovecs].iov_base = &context->protocol[k];
+      iov[numIovecs].iov_len = 1;
+      numIovecs ++;
       length ++;
 
       #ifdef DEBUG
@@ -83,34 +112,85 @@ uint16_t buildMultiplexedPacket ( contextSimplemux* context,
       #endif
     }
     
-    // add the bytes of the packet itself
-    memcpy( &mux_packet[length],
-            context->packetsToMultiplex[k],
-            context->sizePacketsToMultiplex[k]);
-
+    // add the packet itself
+    iov[numIovecs].iov_base = context->packetsToMultiplex[k];
+    iov[numIovecs].iov_len = context->sizePacketsToMultiplex[k];
+    numIovecs ++;
     length = length + context->sizePacketsToMultiplex[k];
   }
   #ifdef DEBUG
     do_debug_c( 2, ANSI_COLOR_RESET, "\n");
   #endif
 
+  #ifdef ASSERT
+    assert(length <= BUFSIZE);
+  #endif
+
+  context->numBundleIovecs = numIovecs;
+
   return length;
 }
 
 
+// send the multiplexed packet built by 'buildMultiplexedPacket()' with a single
+//system call: sendmsg() in UDP and network mode, writev() in TCP mode (through
+//the TCP send queue)
+// returns the same as sendto()/write(): -1 if there was an error
+int sendBundle (contextSimplemux* context,
+                uint16_t total_length)
+{
+  switch (context->mode) {
+    case UDP_MODE:
+      return sendDatagramUdpIovec(context,
+                                  &context->bundleIovecs[1],
+                                  context->numBundleIovecs,
+                                  total_length);
+
+    case NETWORK_MODE: ;
+      // update the fields of the prebuilt header that change in each packet
+      // the ID is increased as 'BuildIPHeader()' does
+      context->bundleIpHeader.tot_len = htons(sizeof(struct iphdr) + total_length);
+      context->bundleIpHeader.id = htons(ntohs(context->bundleIpHeader.id) + 1);
+      context->bundleIpHeader.check = 0;
+      context->bundleIpHeader.check = in_cksum((unsigned short *)&context->bundleIpHeader, sizeof(struct iphdr));
+
+      struct msghdr message;
+      memset(&message, 0, sizeof(message));
+      message.msg_name = &(context->remote);
+      message.msg_namelen = sizeof(struct sockaddr);
+      message.msg_iov = context->bundleIovecs;    // the IP header is included
+      message.msg_iovlen = context->numBundleIovecs + 1;
+
+      return sendmsg(context->network_mode_fd, &message, 0);
+
+    // the TCP socket is non-blocking: the bundle may be queued (or dropped)
+    case TCP_CLIENT_MODE:
+      return sendBundleTcp( context,
+                            context->tcp_client_fd,
+                            &context->bundleIovecs[1],
+                            context->numBundleIovecs,
+                            total_length);
+
+    case TCP_SERVER_MODE:
+      return sendBundleTcp( context,
+                            context->tcp_server_fd,
+                            &context->bundleIovecs[1],
+                            context->numBundleIovecs,
+                            total_length);
+  }
+
+  return -1;
+}
+
+
 void sendMultiplexedPacket (contextSimplemux* context,
                             uint16_t total_length,
-                            uint8_t muxed_packet[BUFSIZE],
                             uint64_t time_difference)
 {
   switch (context->mode) {
     case UDP_MODE:
       // send the packet. I don't need to build the header, because I have a UDP socket
-      if (sendto( context->udp_mode_fd,
-                  muxed_packet, total_length,
-                  0,
-                  (struct sockaddr *)&(context->remote),
-                  sizeof(context->remote)) == -1)
+      if (sendBundle(context, total_length) == -1)
       {
         perror("sendto() in UDP mode failed");
         exit (EXIT_FAILURE);                
@@ -179,29 +259,9 @@ void sendMultiplexedPacket (contextSimplemux* context,
       }
     break;
     
-    case NETWORK_MODE: ;
-      // build the header
-      struct iphdr ipheader;
-      BuildIPHeader(&ipheader,
-                    total_length,
-                    context->ipprotocol,
-                    context->local,
-                    context->remote);
-
-      // build full IP multiplexed packet
-      uint8_t full_ip_packet[BUFSIZE];
-      BuildFullIPPacket(ipheader,
-                        muxed_packet,
-                        total_length,
-                        full_ip_packet);
-
-      // send the multiplexed packet
-      if (sendto (context->network_mode_fd,
-                  full_ip_packet,
-                  total_length + sizeof(struct iphdr),
-                  0,
-                  (struct sockaddr *)&(context->remote),
-                  sizeof (struct sockaddr)) < 0)
+    case NETWORK_MODE:
+      // send the multiplexed packet, preceded by the prebuilt IP header
+      if (sendBundle(context, total_length) < 0)
       {
         perror ("sendto() in Network mode failed ");
         exit (EXIT_FAILURE);
@@ -259,9 +319,7 @@ void sendMultiplexedPacket (contextSimplemux* context,
     case TCP_CLIENT_MODE:
       // send the packet. I don't need to build the header, because I have a TCP socket
       
-      if (write(context->tcp_client_fd,
-                muxed_packet,
-                total_length) == -1)
+      if (sendBundle(context, total_length) == -1)
       {
         perror("write() in TCP client mode failed");
         exit (EXIT_FAILURE);
@@ -342,9 +400,7 @@ void sendMultiplexedPacket (contextSimplemux* context,
         #endif
       }
       else {
-        if (write(context->tcp_server_fd,
-                  muxed_packet,
-                  total_length)==-1)
+        if (sendBundle(context, total_length) == -1)
         {
           perror("write() in TCP server mode failed");
           exit (EXIT_FAILURE);
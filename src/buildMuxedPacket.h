@@ -9,14 +9,18 @@
 #endif
 
 #include "blastPackets.h"
+#include "tcpSender.h"
+
+void initBundleIovecs(contextSimplemux* context);
 
 uint16_t buildMultiplexedPacket ( contextSimplemux* context,
-                                  int single_prot,
-                                  uint8_t mux_packet[BUFSIZE]);
+                                  int single_prot);
+
+int sendBundle (contextSimplemux* context,
+                uint16_t total_length);
 
 void sendMultiplexedPacket (contextSimplemux* context,
                             uint16_t total_length,
-                            uint8_t muxed_packet[BUFSIZE],
                             uint64_t time_difference);
 
 #endif // BUILDMUXEDPACKET_H
\ No newline at end of file
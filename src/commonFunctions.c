@@ -8,44 +8,57 @@ int debug;            // 0:no debug
 
 #ifdef USINGROHC
   // global variables related to RoHC compression (defined as 'extern' in the .h file)
-  unsigned int seed;
-  rohc_status_t status;
+  // they are thread-local ('__thread'): in multi-queue mode, each queue has
+  //its own compressor, decompressor and buffers
+  __thread unsigned int seed;
+  __thread rohc_status_t status;
 
-  struct rohc_comp *compressor;         // the ROHC compressor
-  struct rohc_decomp *decompressor;     // the ROHC decompressor
+  __thread struct rohc_comp *compressor;         // the ROHC compressor
+  __thread struct rohc_decomp *decompressor;     // the ROHC decompressor
 
   // define the buffers that will contain the packets to compress/decompress
-  // 'rohc_buf_init_empty' is a macro defined in 'rohc-1.7.0\src\common\rohc\rohc_buf.h'
-  // When you declare 'struct rohc_buf ip_packet = rohc_buf_init_empty(ip_buffer, BUFSIZE);',
-  //the macro 'rohc_buf_init_empty' will be expanded to initialize the ip_packet structure.
+  // the 'struct rohc_buf' variables are initialized in 'initRohcBuffers()', because
+  //a thread-local variable cannot be initialized with the address of another one
+  __thread uint8_t ip_buffer[BUFSIZE];     // the buffer that will contain the IPv4 packet to compress
+  __thread struct rohc_buf ip_packet;
+
+  __thread uint8_t rohc_buffer[BUFSIZE];   // the buffer that will contain the resulting ROHC packet
+  __thread struct rohc_buf rohc_packet;
+
+  __thread uint8_t ip_buffer_d[BUFSIZE];   // the buffer that will contain the resulting IP decompressed packet
+  __thread struct rohc_buf ip_packet_d;
+
+  __thread uint8_t rohc_buffer_d[BUFSIZE]; // the buffer that will contain the ROHC packet to decompress
+  __thread struct rohc_buf rohc_packet_d;
+
+  __thread uint8_t rcvd_feedback_buffer_d[BUFSIZE];  // the buffer that will contain the ROHC feedback packet received
+  __thread struct rohc_buf rcvd_feedback;
+
+  __thread uint8_t feedback_send_buffer_d[BUFSIZE];  // the buffer that will contain the ROHC feedback packet to be sent
+  __thread struct rohc_buf feedback_send;
+
 
+  // initialize the buffers of the calling thread
+  // 'rohc_buf_init_empty' is a macro defined in 'rohc-1.7.0\src\common\rohc\rohc_buf.h'
   // The next code initializes the ip_packet structure with the ip_buffer pointer and BUFSIZE
   //as the maximum length, while setting the other fields to zero
   // Here's how the code would look after substituting the macro:
-  /*struct rohc_buf ip_packet = {
+  /*ip_packet = (struct rohc_buf) {
       .time = { .sec = 0, .nsec = 0 },
       .data = ip_buffer,
       .max_len = BUFSIZE,
       .offset = 0,
       .len = 0
   };*/
-  uint8_t ip_buffer[BUFSIZE];     // the buffer that will contain the IPv4 packet to compress
-  struct rohc_buf ip_packet = rohc_buf_init_empty(ip_buffer, BUFSIZE);
-
-  uint8_t rohc_buffer[BUFSIZE];   // the buffer that will contain the resulting ROHC packet
-  struct rohc_buf rohc_packet = rohc_buf_init_empty(rohc_buffer, BUFSIZE);
-
-  uint8_t ip_buffer_d[BUFSIZE];   // the buffer that will contain the resulting IP decompressed packet
-  struct rohc_buf ip_packet_d = rohc_buf_init_empty(ip_buffer_d, BUFSIZE);
-
-  uint8_t rohc_buffer_d[BUFSIZE]; // the buffer that will contain the ROHC packet to decompress
-  struct rohc_buf rohc_packet_d = rohc_buf_init_empty(rohc_buffer_d, BUFSIZE);
-
-  uint8_t rcvd_feedback_buffer_d[BUFSIZE];  // the buffer that will contain the ROHC feedback packet received
-  struct rohc_buf rcvd_feedback = rohc_buf_init_empty(rcvd_feedback_buffer_d, BUFSIZE);
-
-  uint8_t feedback_send_buffer_d[BUFSIZE];  // the buffer that will contain the ROHC feedback packet to be sent
-  struct rohc_buf feedback_send = rohc_buf_init_empty(feedback_send_buffer_d, BUFSIZE);
+  void initRohcBuffers()
+  {
+    ip_packet = (struct rohc_buf) rohc_buf_init_empty(ip_buffer, BUFSIZE);
+    rohc_packet = (struct rohc_buf) rohc_buf_init_empty(rohc_buffer, BUFSIZE);
+    ip_packet_d = (struct rohc_buf) rohc_buf_init_empty(ip_buffer_d, BUFSIZE);
+    rohc_packet_d = (struct rohc_buf) rohc_buf_init_empty(rohc_buffer_d, BUFSIZE);
+    rcvd_feedback = (struct rohc_buf) rohc_buf_init_empty(rcvd_feedback_buffer_d, BUFSIZE);
+    feedback_send = (struct rohc_buf) rohc_buf_init_empty(feedback_send_buffer_d, BUFSIZE);
+  }
 #endif
 
 
@@ -2,6 +2,11 @@
 #ifndef COMMONFUNCTIONS_H
 #define COMMONFUNCTIONS_H
 
+// required for using recvmmsg() and sendmmsg(). It must be defined before including any system header
+#ifndef _GNU_SOURCE
+  #define _GNU_SOURCE
+#endif
+
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -11,6 +16,7 @@
 #include <stdbool.h>
 #include <stdint.h>         // required for using uint8_t, uint16_t, etc.
 #include <stdarg.h>
+#include <errno.h>
 #include <unistd.h>         // for using getopt()
 #include <time.h>
 #include <fcntl.h>
@@ -23,6 +29,17 @@
 #include <linux/tcp.h>      // makes it possible to use TCP_NODELAY (disable Nagle algorithm)
 #include <sys/ioctl.h>
 #include <sys/time.h>
+#include <sys/socket.h>     // for using recvmmsg() and sendmmsg()
+#include <sys/uio.h>        // for using writev()
+#include <netinet/udp.h>    // for using UDP_SEGMENT and UDP_GRO
+
+// not included in older libc headers
+#ifndef UDP_SEGMENT
+  #define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+  #define UDP_GRO 104
+#endif
 #include <arpa/inet.h>
 
 // Preprocessor directives: If you comment the next lines, the program will be a bit faster
@@ -30,6 +47,7 @@
 #define LOGFILE 1 // if you comment this line, logs are not allowed
 #define ASSERT 1  // if you comment this line, assertions are not allowed
 #define USINGROHC 1   // if you comment this line, RoHC will not be used
+#define USINGIOURING 1  // if you comment this line, the io_uring engine ('-u' option) will not be available
 
 #ifdef ASSERT
   #include <assert.h>     // for using assert()
@@ -51,6 +69,7 @@
 #define IPPROTO_IP_ON_IP 4        // IP on IP Protocol ID
 #define IPPROTO_ROHC 142          // ROHC Protocol ID
 #define IPPROTO_ETHERNET 143      // Ethernet Protocol ID
+#define IPPROTO_BLAST_FEC 145     // protocolID of the blast packets carrying parity ('-F'). Unassigned number according to IANA
 
 #define IPPROTO_SIMPLEMUX 253       // Simplemux Protocol ID (experimental number according to IANA)
 #define IPPROTO_SIMPLEMUX_FAST 254  // Simplemux Protocol ID (experimental number according to IANA)
@@ -90,6 +109,56 @@
 //it can be sent again
 #define TIME_UNTIL_SENDING_AGAIN_BLAST 5000000  
 
+// blast flavor: the receiver remembers the identifiers delivered in a window
+//behind the highest one. It is divided in blocks, each one with a timestamp
+#define BLAST_DUPLICATE_WINDOW 8192   // identifiers remembered behind the highest one (it must divide 65536)
+#define BLAST_DUPLICATE_BLOCK 64      // identifiers of each block (the bits of an uint64_t)
+#define BLAST_DUPLICATE_BLOCKS (BLAST_DUPLICATE_WINDOW / BLAST_DUPLICATE_BLOCK)
+
+// blast flavor: adaptive retransmission timeout ('-R' option), as in RFC 6298
+#define BLAST_RTO_GRANULARITY 1000  // the timeout is at least the smoothed RTT plus this (us)
+#define BLAST_RTO_MAX 1000000       // maximum timeout (us), including the backoff: the heartbeat period
+#define BLAST_RTO_MAX_BACKOFF 3     // each retransmission of a packet doubles its timeout, at most 2^3 times
+
+// blast flavor: pacing of the retransmissions ('-x' option)
+#define BLAST_PACING_BURST 4        // retransmissions that can be sent back-to-back after the pacer has been idle
+#define BLAST_PACING_MAX 10000000   // maximum rate (packets per second)
+
+#define DRAIN_BUCKETS 7           // number of bins of the histogram of the packets drained from tun/tap ('-a' option)
+
+#define LATENESS_BUCKETS 6        // number of bins of the histogram of the lateness of the period ('-j' option)
+
+#define MAXQUEUES 8               // maximum number of tun/tap queues (and worker threads) in multi-queue mode
+
+#define GRO_BUFSIZE 65535         // size of each reception buffer when UDP GRO is used: several bundles may be coalesced
+#define GSO_MAX_SIZE 65000        // maximum size of a UDP GSO super-datagram (the IP and UDP headers have to fit in 64 KB)
+#define UDP_CONTROL_SIZE 32       // size of the ancillary data of each GSO/GRO message. It must fit CMSG_SPACE(sizeof(int))
+
+#define TCP_READ_SIZE 65536       // maximum number of bytes read from the TCP socket in each read()
+#define TCP_STREAM_BUFSIZE (TCP_READ_SIZE + 3 + 65535)  // a read chunk, plus an incomplete record (separator and the maximum length)
+
+#define BLAST_SIZE_CLASSES 6      // number of size classes of the pool of blast packets
+#define BLAST_SLAB_SLOTS 32       // number of slots reserved each time a size class of the pool runs out of slots
+#define BLAST_POOL_DEFAULT 65536  // default maximum number of slots of the pool of blast packets ('-s')
+
+// hybrid flavor ('-C' option): flows sent in blast flavor, the rest in normal/fast flavor
+#define MAX_FLOW_RULES 16         // maximum number of rules of the classifier
+#define FLOW_ETHERTYPE 'E'        // the rule matches the EtherType (tun mode: 0x0800 or 0x86DD)
+#define FLOW_PROTOCOL 'P'         // the rule matches the IP protocol
+#define FLOW_PORT 'O'             // the rule matches the TCP/UDP/SCTP source or destination port
+#define FLOW_DSCP 'D'             // the rule matches the DSCP
+#define HYBRID_BLAST_MARKER 0xFF  // first byte of the blast packets in hybrid flavor. No normal or fast bundle
+                                  //starts with it, because the packets are smaller than 8192 bytes
+
+#define BLAST_SACK_BITMAP_SIZE 32 // bytes of the bitmap of a selective ACK: it covers 256 identifiers after the first one ('-A')
+#define BLAST_ACK_DELAY 2000      // maximum time (us) a selective ACK can be delayed. It is never more than half the period
+
+#define TCP_QUEUE_DEFAULT 256     // default number of bundles that can wait in the TCP send queue
+#define TCP_QUEUE_MAX 65536       // maximum size of the TCP send queue ('-w')
+#define TCP_WRITEV_MAX 64         // maximum number of queued bundles written with a single writev()
+
+#define MAXBATCH 64               // maximum number of datagrams read/sent with a single recvmmsg()/sendmmsg()
+
 #define MAXTIMEOUT 100000000.0    // maximum value of the timeout (microseconds). (default 100 seconds)
 
 #ifdef USINGROHC
@@ -125,6 +194,79 @@
 #define ANSI_COLOR_CYAN         "\x1b[36m"
 
 
+// pool of slots for the unconfirmed packets of the blast flavor
+// there are several size classes, so a small packet does not use a BUFSIZE slot
+// the slots are reserved in slabs the first time they are needed, and they are
+//reused when the ACK arrives (they are never freed)
+// '-s' limits the slots in use of all the classes. Each class can reserve up to
+//that number of slots, so the packets of any size can be stored while there is
+//a slot left
+typedef struct blastPool {
+  struct storedPacketBlast* freeSlots[BLAST_SIZE_CLASSES];  // free slots of each size class, linked through 'next'
+  int maxSlots;                           // maximum number of slots in use of all the classes ('-s' option)
+  int reservedSlots;                      // slots reserved (in use or free) of all the classes
+  int reservedSlotsClass[BLAST_SIZE_CLASSES]; // slots reserved of each size class
+  int slotsInUse[BLAST_SIZE_CLASSES];     // slots in use of each size class
+  int totalSlotsInUse;                    // slots in use of all the classes
+  int maxSlotsInUse;                      // maximum number of slots in use at the same time
+  uint64_t reservedBytes;                 // memory reserved for the slots
+  uint64_t allocations;                   // number of slots given to packets
+  uint64_t failures;                      // packets that could not be stored because all the slots were in use
+} blastPool;
+
+
+// identifiers of the blast packets delivered recently, in order to discard the copies
+// it is a bitmap of the BLAST_DUPLICATE_WINDOW identifiers behind the highest one
+//delivered. The bit of an identifier is in position 'identifier % BLAST_DUPLICATE_WINDOW'
+// each block of BLAST_DUPLICATE_BLOCK identifiers has a coarse timestamp (ms): when
+//it is older than TIME_UNTIL_SENDING_AGAIN_BLAST, the bits of the block are ignored
+typedef struct blastDuplicateWindow {
+  uint64_t delivered[BLAST_DUPLICATE_BLOCKS];     // a bit per identifier: 1 if it has been delivered
+  uint32_t blockTimestamp[BLAST_DUPLICATE_BLOCKS]; // moment (ms) when each block started to be used
+  uint16_t highest;                               // highest identifier delivered
+  bool started;                                   // false if no identifier has been delivered yet
+  uint64_t lastDelivery;                          // moment (us) of the last delivery
+} blastDuplicateWindow;
+
+
+// round-trip time of the blast packets, measured with the ACKs (RFC 6298)
+// following Karn's rule, only the packets that have been sent once are measured:
+//the ACK of a retransmitted packet may correspond to any of its copies
+typedef struct blastRttEstimator {
+  uint64_t srtt;        // smoothed RTT (us)
+  uint64_t rttvar;      // variation of the RTT (us)
+  uint64_t rto;         // retransmission timeout obtained from them (us), without floor nor backoff
+  uint64_t samples;     // number of RTT measurements. 0: the RTT is still unknown
+} blastRttEstimator;
+
+
+// window of the unconfirmed packets of the blast flavor
+// each packet can be found directly from its identifier (insertion, ACK and lookup are O(1))
+//and the packets are also linked in the order they were stored
+// the retransmissions are scheduled in a min-heap, so the next one is found in O(1)
+// the arrays are reserved by 'initBlastWindow()' (only in blast and hybrid flavors),
+//with the size of the pool ('-s'): the window cannot hold more packets than that
+typedef struct blastWindow {
+  struct storedPacketBlast** byIdentifier;           // unconfirmed packets, indexed by 'identifier & indexMask'. The packets
+                                                     //of an entry are linked through 'nextInIndex'
+  int indexMask;                                     // the index has a power of 2 entries, not fewer than the slots of the pool
+  struct storedPacketBlast* first;                   // oldest packet stored
+  struct storedPacketBlast* last;                    // newest packet stored
+  int length;                                        // number of packets stored
+  struct storedPacketBlast** retransmissions;        // min-heap of the packets, ordered by the moment of their next retransmission
+  int numScheduled;                                  // number of packets in the heap
+  blastPool pool;                                    // slots where the packets are stored
+  blastRttEstimator rtt;                             // RTT measured with the ACKs of these packets
+} blastWindow;
+
+
+// rule of the classifier of the hybrid flavor
+typedef struct {
+  char field;       // FLOW_ETHERTYPE, FLOW_PROTOCOL, FLOW_PORT or FLOW_DSCP
+  int value;
+} flowRule;
+
+
 // Simplemux Fast header
 typedef struct {
   uint16_t packetSize; // use 'htons()' when writing it because this field will be sent through the network
@@ -145,6 +287,7 @@ typedef struct {
                 // 1: ROHC Unidirectional mode (headers are to be compressed/decompressed)
                 // 2: ROHC Bidirectional Optimistic mode
                 // 3: ROHC Bidirectional Reliable mode (not implemented yet)
+  struct rohc_comp* rohcCompressor; // the compressor of the thread of this queue (the statistics are printed by another thread)
   #endif
 
   // variables for managing the network interfaces
@@ -179,7 +322,11 @@ typedef struct {
   uint8_t packetsToMultiplex[MAXPKTS][BUFSIZE]; // content of each packet to be multiplexed 
   int sizeMuxedPacket;                          // accumulated size of the multiplexed packet
 
-  uint16_t length_muxed_packet;                 // length of the next TCP packet
+  // the multiplexed packet is not copied to a buffer: it is sent with a single
+  //sendmsg()/writev() using these pieces
+  struct iovec bundleIovecs[1 + 3 * MAXPKTS];   // outer IP header (network mode), and separator, protocol and content of each packet
+  int numBundleIovecs;                          // number of pieces of the multiplexed packet (the IP header is not included)
+  struct iphdr bundleIpHeader;                  // prebuilt outer IP header (network mode). Only the length, ID and checksum change
 
   uint64_t timeLastSent;          // timestamp (us) when the last multiplexed packet was sent
   uint64_t microsecondsLeft;      // the time (us) until the period expires 
@@ -188,14 +335,50 @@ typedef struct {
   bool acceptingTcpConnections;     // it is set to '1' if this is a TCP server and no connections have started
 
   // only for blast flavor
-  struct storedPacketBlast *unconfirmedPacketsBlast;     // pointer to the list of unconfirmed packets (blast flavor)
-  uint64_t blastTimestamps[0xFFFF+1];         // I will store 65536 different timestamps: one for each possible identifier
+  blastWindow unconfirmedPacketsBlast;        // unconfirmed packets (blast flavor)
+  blastDuplicateWindow deliveredBlast;        // identifiers delivered recently, for discarding the copies
   uint64_t lastBlastHeartBeatSent;            // timestamp of the last heartbeat sent
   uint64_t lastBlastHeartBeatReceived;
+  int blastAckEvery;                          // send a selective ACK every this number of packets ('-A'). 0: an ACK per packet
+  uint16_t pendingAckBase;                    // first identifier of the next selective ACK
+  uint8_t pendingAckBitmap[BLAST_SACK_BITMAP_SIZE]; // identifiers after 'pendingAckBase' covered by the next selective ACK
+  int pendingAckCount;                        // number of identifiers waiting to be acknowledged
+  uint64_t pendingAckDeadline;                // moment when the pending identifiers have to be acknowledged
+  uint64_t blastAcksSent;                     // ACKs sent (per-packet or selective)
+  uint64_t blastAcksReceived;                 // ACKs received (per-packet or selective)
+  uint64_t blastPacketsAcked;                 // unconfirmed packets removed from the window by the ACKs received
+  bool blastPiggyback;                        // ACKs and heartbeats go inside the blast packets sent ('-y')
+  uint64_t blastAcksPiggybacked;              // selective ACKs sent inside a blast packet
+  uint64_t blastHeartbeatsSent;               // heartbeats sent as separate packets
+  bool blastAdaptiveRto;                      // the retransmission timeout follows the RTT ('-R'). Otherwise it is the period
+  uint64_t blastRtoFloor;                     // minimum adaptive retransmission timeout (us)
+  uint64_t blastPacketsSent;                  // blast packets sent for the first time
+  uint64_t blastRetransmissions;              // blast packets sent again because their ACK did not arrive in time
+  uint32_t blastPacingRate;                   // maximum rate of the blast packets (packets per second) ('-x'). 0: no pacing
+  double blastPacingTokens;                   // packets that can be sent now (token bucket). First transmissions may leave it negative
+  uint64_t blastPacingLastRefill;             // moment when the tokens were last updated
+  uint64_t blastPacerDeferrals;               // times a due retransmission had to wait for a token
+  int blastMaxRetransmissionBurst;            // maximum number of retransmissions sent back-to-back
+  flowRule flowRules[MAX_FLOW_RULES];         // hybrid flavor: flows sent in blast flavor ('-C')
+  int numFlowRules;                           // hybrid flavor: number of rules. 0: the flavor is not hybrid. -1: wrong rules
+  uint64_t hybridBlastPackets;                // hybrid flavor: packets selected by the classifier (sent in blast flavor)
+  uint64_t hybridMuxedPackets;                // hybrid flavor: packets not selected (multiplexed)
+  int fecBlockSize;                           // FEC: blast packets of each block ('-F K:M'). 0: no FEC
+  int fecParityCount;                         // FEC: parity packets sent after each block
+  struct blastFecEncoder* fecEncoder;         // FEC: parity of the block that is being sent
+  struct blastFecDecoder* fecDecoder;         // FEC: packets received, for rebuilding the lost ones
+  uint64_t fecParitySent;                     // FEC: parity packets sent
+  uint64_t fecParitySkipped;                  // FEC: parity packets not sent because they did not fit in the MTU
+  uint64_t fecParityReceived;                 // FEC: parity packets received
+  uint64_t fecRecovered;                      // FEC: lost blast packets rebuilt with the parity
 
   // variables for counting the arrived and sent packets
   uint32_t tun2net;           // number of packets read from tun
   uint32_t net2tun;           // number of packets read from net
+  uint64_t tunPacketsWritten; // number of packets written to tun/tap
+  uint64_t receiveBytesCopied; // bytes copied by Simplemux between the reception from the network and the
+                              //write to tun/tap (the copies of the kernel and the RoHC decompressor are not included)
+  uint64_t netPacketsTooLong; // packets read from the network that were longer than BUFSIZE. They are dropped
   #ifdef USINGROHC
     uint32_t feedback_pkts;     // number of ROHC feedback packets
   #endif
@@ -237,9 +420,87 @@ typedef struct {
   uint8_t protocol_rec;               // protocol field of the received muxed packet
                                       // this varialbe has to be here: in case of TCP, it may be
                                       //necessary to store the value of the protocol between packets
-  uint16_t pendingBytesMuxedPacket;   // number of bytes that still have to be read (TCP, fast flavor)
-  uint16_t readTcpBytes;              // number of bytes of the content that have been read (TCP, fast flavor)
-  uint8_t readTcpSeparatorBytes;      // number of bytes of the fast separator that have been read (TCP, fast flavor)
+  uint8_t* tcpStreamBuffer;           // the TCP byte stream is read here in chunks, and the records are parsed from it
+  int tcpStreamBytes;                 // bytes in 'tcpStreamBuffer' not parsed yet (an incomplete record)
+  uint64_t tcpReads;                  // number of read() calls on the TCP socket
+  uint64_t tcpBytesRead;              // bytes read from the TCP socket
+  uint64_t tcpRecords;                // records (separator and packet/frame) parsed from the TCP stream
+
+  // non-blocking TCP sender (TCP modes)
+  uint8_t (*tcpQueueBuffers)[BUFSIZE];  // circular queue of the bundles waiting to be written to the TCP socket
+  int* tcpQueueLengths;                 // length of each queued bundle
+  uint64_t* tcpQueueTimestamps;         // moment (us) when each bundle was queued
+  int tcpQueueSize;                     // maximum number of bundles in the queue ('-w' option)
+  int tcpQueueHead;                     // slot of the first bundle of the queue
+  int tcpQueueCount;                    // number of bundles in the queue
+  int tcpQueueSentBytes;                // bytes of the first bundle that have already been written
+  uint64_t tcpSojournLimit;             // bundles that wait more than this (us) are dropped ('-W' option). 0: only tail drop
+  uint64_t tcpStallStart;               // moment (us) when the queue stopped being empty
+  uint64_t tcpStallTime;                // total time (us) with bundles waiting in the queue
+  uint64_t tcpWritevCalls;              // number of writev() calls on the TCP socket
+  uint64_t tcpBundlesQueued;            // bundles that could not be written immediately
+  uint64_t tcpTailDrops;                // bundles dropped because the queue was full
+  uint64_t tcpSojournDrops;             // bundles dropped because they waited too long
+  int tcpQueueMaxDepth;                 // maximum number of bundles in the queue
+
+  // variables for batched UDP I/O (only in UDP mode)
+  int batchSize;                        // maximum number of datagrams read/sent in a single system call ('-k' option). 1: no batching
+  struct mmsghdr* rxBatchMsgs;          // headers of the datagrams read with recvmmsg()
+  struct iovec* rxBatchIovecs;
+  struct sockaddr_in* rxBatchAddrs;     // source address of each datagram read
+  uint8_t* rxBatchBuffers;              // content of the datagrams read ('rxBufferSize' bytes each)
+  int rxBufferSize;                     // size of each reception buffer: BUFSIZE, or GRO_BUFSIZE if UDP GRO is used
+  struct mmsghdr* txBatchMsgs;          // headers of the datagrams to be sent with sendmmsg()
+  struct iovec* txBatchIovecs;
+  uint8_t (*txBatchBuffers)[BUFSIZE];   // content of each datagram to be sent
+  int numBatchedTx;                     // number of datagrams waiting in the transmission batch
+  uint64_t recvmmsgCalls;               // number of calls to recvmmsg()
+  uint64_t recvmmsgDatagrams;           // number of datagrams read with recvmmsg()
+  uint64_t sendmmsgCalls;               // number of calls to sendmmsg()
+  uint64_t sendmmsgDatagrams;           // number of datagrams sent with sendmmsg()
+  uint64_t sendmmsgDrops;               // datagrams dropped because sendmmsg() failed
+
+  // UDP segmentation offload (only in UDP mode, with batched I/O)
+  bool udpOffloadRequested;             // UDP GSO/GRO has been requested ('-g' option)
+  bool udpGso;                          // equal-sized bundles are sent as a single GSO super-datagram (UDP_SEGMENT)
+  bool udpGro;                          // the kernel may coalesce the bundles received (UDP_GRO)
+  int* rxBatchSegmentSizes;             // size of the bundles inside each datagram read (GRO). It is the length of the datagram if it was not coalesced
+  uint8_t (*rxBatchControl)[UDP_CONTROL_SIZE];  // ancillary data of each datagram read
+  struct mmsghdr* txGsoMsgs;            // messages passed to sendmmsg(): each one contains one or more datagrams of the batch
+  uint8_t (*txGsoControl)[UDP_CONTROL_SIZE];    // ancillary data (segment size) of each message
+  uint64_t gsoSends;                    // number of GSO super-datagrams sent
+  uint64_t gsoSegments;                 // number of bundles sent inside GSO super-datagrams
+  uint64_t groReceives;                 // number of coalesced datagrams received
+  uint64_t groSegments;                 // number of bundles received inside coalesced datagrams
+
+  // throughput of the UDP tunnel
+  uint64_t udpStartTime;                // timestamp (us) when the main loop started
+  uint64_t udpDatagramsSent;            // number of bundles sent to the UDP socket
+  uint64_t udpBytesSent;                // bytes sent to the UDP socket (UDP payload)
+  uint64_t udpDatagramsReceived;        // number of bundles read from the UDP socket
+  uint64_t udpBytesReceived;            // bytes read from the UDP socket (UDP payload)
+
+  // io_uring engine (only in UDP and network modes)
+  bool ioUringRequested;                // the io_uring engine has been requested ('-u' option)
+  struct ioUringEngine* ioUring;        // state of the io_uring engine. NULL if poll() is used
+
+  // multi-queue mode (only in UDP mode)
+  int numQueues;                        // number of tun/tap queues, each one served by a thread ('-q' option). 1: single queue
+  int queueIndex;                       // queue served by this context (0 to numQueues-1)
+  int tunQueueFds[MAXQUEUES];           // file descriptor of each tun/tap queue
+
+  // measurement of the lateness of the period ('-j' option)
+  bool measureLateness;                 // measure how late the period expires with respect to its deadline
+  uint64_t latenessSamples;             // number of expirations measured
+  uint64_t latenessTotal;               // sum of the lateness of all the expirations (us)
+  uint64_t latenessMax;                 // maximum lateness (us)
+  uint64_t latenessHistogram[LATENESS_BUCKETS]; // <10us, <50us, <100us, <500us, <1ms, >=1ms
+
+  // drain mode: several packets are read from tun/tap before evaluating the triggers ('-a' option)
+  int drainBudget;                      // maximum number of packets read from tun/tap in a single pass. 1: no draining
+  uint64_t drainBatches;                // number of passes
+  uint64_t drainPackets;                // number of packets read in all the passes
+  uint64_t drainHistogram[DRAIN_BUCKETS]; // size of the passes: 1, 2-3, 4-7, 8-15, 16-31, 32-63, 64 or more
 
 } contextSimplemux;
 
@@ -291,30 +552,32 @@ extern int debug;     // 0:no debug
                       // 3:maximum debug level
 
 #ifdef USINGROHC
-  // global variables related to RoHC compression
-  extern unsigned int seed;
-  extern rohc_status_t status;
+  // global variables related to RoHC compression. There is a copy per thread (queue)
+  extern __thread unsigned int seed;
+  extern __thread rohc_status_t status;
+
+  extern __thread struct rohc_comp *compressor;
+  extern __thread struct rohc_decomp *decompressor;
 
-  extern struct rohc_comp *compressor;
-  extern struct rohc_decomp *decompressor;
+  extern __thread uint8_t ip_buffer[BUFSIZE];
+  extern __thread struct rohc_buf ip_packet;
 
-  extern uint8_t ip_buffer[BUFSIZE];
-  extern struct rohc_buf ip_packet;
+  extern __thread uint8_t rohc_buffer[BUFSIZE];
+  extern __thread struct rohc_buf rohc_packet;
 
-  extern uint8_t rohc_buffer[BUFSIZE];
-  extern struct rohc_buf rohc_packet;
+  extern __thread uint8_t ip_buffer_d[BUFSIZE];
+  extern __thread struct rohc_buf ip_packet_d;
 
-  extern uint8_t ip_buffer_d[BUFSIZE];
-  extern struct rohc_buf ip_packet_d;
+  extern __thread uint8_t rohc_buffer_d[BUFSIZE];
+  extern __thread struct rohc_buf rohc_packet_d;
 
-  extern uint8_t rohc_buffer_d[BUFSIZE];
-  extern struct rohc_buf rohc_packet_d;
+  extern __thread uint8_t rcvd_feedback_buffer_d[BUFSIZE];
+  extern __thread struct rohc_buf rcvd_feedback;
 
-  extern uint8_t rcvd_feedback_buffer_d[BUFSIZE];
-  extern struct rohc_buf rcvd_feedback;
+  extern __thread uint8_t feedback_send_buffer_d[BUFSIZE];
+  extern __thread struct rohc_buf feedback_send;
 
-  extern uint8_t feedback_send_buffer_d[BUFSIZE];
-  extern struct rohc_buf feedback_send;
+  void initRohcBuffers();
 #endif  // USINGROHC
 
 #endif // COMMONFUNCTIONS_H
\ No newline at end of file
@@ -6,9 +6,9 @@
 void usage(char* progname) {
   fprintf(stderr, "Usage:\n");
   #ifdef USINGROHC
-    fprintf(stderr, "%s -i <ifacename> -e <ifacename> -c <peerIP> -M <'network' or 'udp' or 'tcpclient' or 'tcpserver'> [-T 'tun' or 'tap'] [-p <port>] [-d <debug_level>] [-r <ROHC_option>] [-n <num_mux_tun>] [-m <MTU>] [-B <num_bytes_threshold>] [-t <timeout (microsec)>] [-P <period (microsec)>] [-l <log file name>] [-L] [-f] [-b]\n\n" , progname);
+    fprintf(stderr, "%s -i <ifacename> -e <ifacename> -c <peerIP> -M <'network' or 'udp' or 'tcpclient' or 'tcpserver'> [-T 'tun' or 'tap'] [-p <port>] [-d <debug_level>] [-r <ROHC_option>] [-n <num_mux_tun>] [-m <MTU>] [-B <num_bytes_threshold>] [-t <timeout (microsec)>] [-P <period (microsec)>] [-k <batch_size>] [-u] [-q <queues>] [-j] [-a <budget>] [-g] [-w <max queued>] [-W <sojourn us>] [-s <slots>] [-A <packets per ACK>] [-y] [-F <K:M>] [-R <min timeout us>] [-x <packets per second>] [-C <rules>] [-l <log file name>] [-L] [-f] [-b]\n\n" , progname);
   #else
-    fprintf(stderr, "%s -i <ifacename> -e <ifacename> -c <peerIP> -M <'network' or 'udp' or 'tcpclient' or 'tcpserver'> [-T 'tun' or 'tap'] [-p <port>] [-d <debug_level>] [-n <num_mux_tun>] [-m <MTU>] [-B <num_bytes_threshold>] [-t <timeout (microsec)>] [-P <period (microsec)>] [-l <log file name>] [-L] [-f] [-b]\n\n" , progname);
+    fprintf(stderr, "%s -i <ifacename> -e <ifacename> -c <peerIP> -M <'network' or 'udp' or 'tcpclient' or 'tcpserver'> [-T 'tun' or 'tap'] [-p <port>] [-d <debug_level>] [-n <num_mux_tun>] [-m <MTU>] [-B <num_bytes_threshold>] [-t <timeout (microsec)>] [-P <period (microsec)>] [-k <batch_size>] [-u] [-q <queues>] [-j] [-a <budget>] [-g] [-w <max queued>] [-W <sojourn us>] [-s <slots>] [-A <packets per ACK>] [-y] [-F <K:M>] [-R <min timeout us>] [-x <packets per second>] [-C <rules>] [-l <log file name>] [-L] [-f] [-b]\n\n" , progname);
   #endif
   fprintf(stderr, "%s -h\n", progname);
   fprintf(stderr, "\n");
@@ -31,6 +31,21 @@ void usage(char* progname) {
   fprintf(stderr, "-B <num_bytes_threshold>: size threshold (bytes) to trigger the departure of packets (default MTU-28 in transport mode and MTU-20 in network mode)\n");
   fprintf(stderr, "-t <timeout (microsec)>: timeout (in usec) to trigger the departure of packets\n");
   fprintf(stderr, "-P <period (microsec)>: period (in usec) to trigger the departure of packets. If ( timeout < period ) then the timeout has no effect\n");
+  fprintf(stderr, "-k <batch_size>: number of datagrams read/sent with a single system call (recvmmsg/sendmmsg), default 1, max 64. Only in UDP mode\n");
+  fprintf(stderr, "-u: use the io_uring engine instead of poll() (it falls back to poll() if io_uring is not available). Only in UDP and network mode\n");
+  fprintf(stderr, "-q <queues>: number of tun/tap queues, each one served by its own thread, socket and RoHC compressor, default 1, max 8. Queue i uses ports port+2i and port_feedback+2i. The peer must use the same value. Only in UDP mode\n");
+  fprintf(stderr, "-j: measure how late the period expires with respect to its deadline. The average, the maximum and a histogram are printed with the statistics (SIGUSR1)\n");
+  fprintf(stderr, "-a <budget>: drain mode. Read up to <budget> packets from tun/tap in a single pass and evaluate the triggers once per pass, default 1. Not in blast flavor\n");
+  fprintf(stderr, "-g: use UDP segmentation offload: bundles of the same size are sent as a single GSO super-datagram, and the bundles received may be coalesced by the kernel (GRO). Only in UDP mode, with -k, and not with -u\n");
+  fprintf(stderr, "-w <max queued>: maximum number of bundles waiting in the TCP send queue when the socket is full (default 256). When the queue is full, new bundles are dropped. Only in TCP modes\n");
+  fprintf(stderr, "-W <sojourn us>: drop the queued bundles that have waited more than this time in the TCP send queue (default 0: only tail drop). Only in TCP modes\n");
+  fprintf(stderr, "-s <slots>: maximum number of blast packets stored while waiting for their ACK (default and max 65536). The memory is reserved in slabs of several size classes when needed, and each class can reserve up to this number of slots. If all the slots are in use, new packets are sent once but not retransmitted. Only in blast flavor\n");
+  fprintf(stderr, "-A <packets per ACK>: send selective ACKs, each one acknowledging up to this number of blast packets (max 257) with a bitmap. A selective ACK is also sent when the first pending packet has waited 2 ms (or half the period, if it is smaller). By default an ACK is sent per packet. Selective ACKs are always understood, so this option only changes the ACKs sent. Only in blast flavor\n");
+  fprintf(stderr, "-y: piggyback the selective ACKs and the heartbeats on the blast packets sent to the other side. A separate ACK is only sent if no blast packet is sent before the delayed-ACK timer expires (or when the bitmap is full, or every <packets per ACK> if -A is set), and a separate heartbeat if nothing has been sent for a heartbeat period. It changes the format of the blast packets, so both sides must use it. Only in blast flavor\n");
+  fprintf(stderr, "-F <K:M>: forward error correction. After every K blast packets (max 16), send M parity packets (max 4, default 1), so the receiver can rebuild up to M lost packets of the block without waiting for a retransmission. M = 1 is a XOR of the block; a higher M uses a Reed-Solomon code. The parity packets are not acknowledged nor retransmitted, and they are 6 bytes longer than the longest packet of the block: they are not sent if they do not fit in the MTU. Both sides must use it. Only in blast flavor\n");
+  fprintf(stderr, "-R <min timeout us>: adaptive retransmission timeout. The RTT is measured with the ACKs (only for packets sent once), and a packet is retransmitted after the smoothed RTT plus four times its variation (at least 1 ms more than the RTT), instead of after the period. The period is used until the first measurement. The timeout is never below <min timeout>: use the period to keep it as a floor, or 0. It is doubled after each retransmission of a packet (at most 8 times, and never above 1 s). Only in blast flavor\n");
+  fprintf(stderr, "-x <packets per second>: pace the retransmissions of blast packets, so the packets due at the same time are spread instead of being sent back-to-back. A token bucket limits the blast packets to this rate, with bursts of up to 4 retransmissions. The packets read from tun/tap are never delayed: they are sent first, and the retransmissions use the rate they leave. Only in blast flavor\n");
+  fprintf(stderr, "-C <rules>: hybrid flavor. The packets/frames that match any of the rules are sent in blast flavor, and the rest are multiplexed in normal or fast (-f) flavor, through the same socket. The rules are separated by commas: ethertype=<n> (in tun mode 0x0800 or 0x86DD; in tap mode the one after the 802.1Q tag, if any), proto=<n> (IP protocol), port=<n> (TCP/UDP/SCTP source or destination port), dscp=<n>. E.g. '-C ethertype=0x88b8,dscp=46'. The blast options (-s, -A, -y, -R, -x, -F) apply to the selected flows, and the period (-P) is required. Both sides must use it. Only in UDP and network modes\n");
   fprintf(stderr, "-l <log file name>: log file name. Use 'stdout' if you want the log data in standard output\n");
   fprintf(stderr, "-L: use default log file name (day and hour Y-m-d_H.M.S)\n");
   fprintf(stderr, "-h: prints this help text\n");
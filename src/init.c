@@ -1,4 +1,66 @@
 #include "init.h"
+#include "blastFec.h"
+
+// read the value of a numeric option. The whole text must be a number
+// it returns the number, or -1 if the text is not a non-negative number. The value
+//is range-checked by 'checkCommandLineOptions()'
+// declared as 'static' because it is only used in this .c file
+static long long parseNonNegative(char* text)
+{
+  char* end;
+  errno = 0;
+  long long value = strtoll(text, &end, 10);
+
+  if ((end == text) || (*end != '\0') || (errno != 0) || (value < 0))
+    return -1;
+
+  return value;
+}
+
+
+// hybrid flavor ('-C' option): read the rules of the flows that are sent in
+//blast flavor. They are separated by commas, e.g. "ethertype=0x88b8,dscp=46,port=102"
+// it returns the number of rules, or -1 if they are not correct
+// declared as 'static' because it is only used in this .c file
+static int parseFlowRules(contextSimplemux* context, char* rules)
+{
+  char copy[256];
+  strncpy(copy, rules, sizeof(copy) - 1);
+  copy[sizeof(copy) - 1] = '\0';
+
+  int numRules = 0;
+  char* savePointer;
+  for (char* rule = strtok_r(copy, ",", &savePointer); rule != NULL; rule = strtok_r(NULL, ",", &savePointer)) {
+    char* equal = strchr(rule, '=');
+    if ((equal == NULL) || (numRules == MAX_FLOW_RULES))
+      return -1;
+    *equal = '\0';
+
+    char* end;
+    long value = strtol(equal + 1, &end, 0);  // decimal or hexadecimal (0x)
+    if ((*end != '\0') || (end == equal + 1) || (value < 0) || (value > 0xFFFF))
+      return -1;
+
+    if (strcmp(rule, "ethertype") == 0)
+      context->flowRules[numRules].field = FLOW_ETHERTYPE;
+    else if ((strcmp(rule, "proto") == 0) && (value <= 0xFF))
+      context->flowRules[numRules].field = FLOW_PROTOCOL;
+    else if (strcmp(rule, "port") == 0)
+      context->flowRules[numRules].field = FLOW_PORT;
+    else if ((strcmp(rule, "dscp") == 0) && (value <= 0x3F))
+      context->flowRules[numRules].field = FLOW_DSCP;
+    else
+      return -1;
+
+    context->flowRules[numRules].value = value;
+    numRules++;
+  }
+
+  if (numRules == 0)
+    return -1;
+  return numRules;
+}
+
 
 // set the initial values of the context variables
 void initContext(contextSimplemux* context)
@@ -6,16 +68,50 @@ void initContext(contextSimplemux* context)
   context->flavor = 'N';  // by default 'normal flavor' is selected
   #ifdef USINGROHC
   context->rohcMode = 0;  // by default it is 0: ROHC is not used
+  context->rohcCompressor = NULL;
   #endif
   context->numPktsStoredFromTun = 0; 
   context->sizeMuxedPacket = 0;
-  context->unconfirmedPacketsBlast = NULL;
+  memset(&context->unconfirmedPacketsBlast, 0, sizeof(blastWindow));
+  context->unconfirmedPacketsBlast.pool.maxSlots = BLAST_POOL_DEFAULT;
   context->tun2net = 0;
   context->net2tun = 0;
+  context->tunPacketsWritten = 0;
+  context->receiveBytesCopied = 0;
+  context->netPacketsTooLong = 0;
   #ifdef USINGROHC
   context->feedback_pkts = 0;
   #endif
   context->blastIdentifier = 0;
+  context->blastAckEvery = 0;   // by default, an ACK per packet
+  context->blastPiggyback = false;
+  context->blastAcksPiggybacked = 0;
+  context->blastHeartbeatsSent = 0;
+  context->blastAdaptiveRto = false;  // by default, the retransmission timeout is the period
+  context->blastRtoFloor = 0;
+  context->blastPacketsSent = 0;
+  context->blastRetransmissions = 0;
+  context->blastPacingRate = 0; // by default, no pacing
+  context->blastPacingTokens = BLAST_PACING_BURST;
+  context->blastPacingLastRefill = 0;
+  context->blastPacerDeferrals = 0;
+  context->blastMaxRetransmissionBurst = 0;
+  context->numFlowRules = 0;    // by default, the flavor is not hybrid
+  context->hybridBlastPackets = 0;
+  context->hybridMuxedPackets = 0;
+  context->fecBlockSize = 0;    // by default, no FEC
+  context->fecParityCount = 0;
+  context->fecEncoder = NULL;
+  context->fecDecoder = NULL;
+  context->fecParitySent = 0;
+  context->fecParitySkipped = 0;
+  context->fecParityReceived = 0;
+  context->fecRecovered = 0;
+  context->pendingAckCount = 0;
+  memset(context->pendingAckBitmap, 0, BLAST_SACK_BITMAP_SIZE);
+  context->blastAcksSent = 0;
+  context->blastAcksReceived = 0;
+  context->blastPacketsAcked = 0;
   context->acceptingTcpConnections = false;
   context->remote_ip[0] = '\0';
   context->local_ip[0] = '\0';
@@ -36,9 +132,56 @@ void initContext(contextSimplemux* context)
   context->userMtu = 0;
   context->firstHeaderWritten = 0;
   context->sizeSeparatorFastMode = sizeof(uint16_t) + sizeof(uint8_t); // the separator has a 2-byte and a 1-byte fields
-  context->pendingBytesMuxedPacket = 0;
-  context->readTcpBytes = 0;
-  context->readTcpSeparatorBytes = 0;
+  context->tcpStreamBuffer = NULL;
+  context->tcpStreamBytes = 0;
+  context->tcpReads = 0;
+  context->tcpBytesRead = 0;
+  context->tcpRecords = 0;
+  context->tcpQueueBuffers = NULL;
+  context->tcpQueueSize = TCP_QUEUE_DEFAULT;
+  context->tcpQueueHead = 0;
+  context->tcpQueueCount = 0;
+  context->tcpQueueSentBytes = 0;
+  context->tcpSojournLimit = 0;   // by default, only tail drop
+  context->tcpStallStart = 0;
+  context->tcpStallTime = 0;
+  context->tcpWritevCalls = 0;
+  context->tcpBundlesQueued = 0;
+  context->tcpTailDrops = 0;
+  context->tcpSojournDrops = 0;
+  context->tcpQueueMaxDepth = 0;
+  context->batchSize = 1;     // by default, no batching: one datagram per system call
+  context->numBatchedTx = 0;
+  context->recvmmsgCalls = 0;
+  context->recvmmsgDatagrams = 0;
+  context->sendmmsgCalls = 0;
+  context->sendmmsgDatagrams = 0;
+  context->sendmmsgDrops = 0;
+  context->udpOffloadRequested = false; // by default, no UDP segmentation offload
+  context->udpGso = false;
+  context->udpGro = false;
+  context->gsoSends = 0;
+  context->gsoSegments = 0;
+  context->groReceives = 0;
+  context->groSegments = 0;
+  context->udpStartTime = 0;
+  context->udpDatagramsSent = 0;
+  context->udpBytesSent = 0;
+  context->udpDatagramsReceived = 0;
+  context->udpBytesReceived = 0;
+  context->ioUringRequested = false;  // by default, poll() is used
+  context->ioUring = NULL;
+  context->numQueues = 1;     // by default, a single tun/tap queue
+  context->queueIndex = 0;
+  context->measureLateness = false;
+  context->latenessSamples = 0;
+  context->latenessTotal = 0;
+  context->latenessMax = 0;
+  memset(context->latenessHistogram, 0, sizeof(context->latenessHistogram));
+  context->drainBudget = 1;   // by default, one packet is read from tun/tap in each iteration
+  context->drainBatches = 0;
+  context->drainPackets = 0;
+  memset(context->drainHistogram, 0, sizeof(context->drainHistogram));
 }
 
 
@@ -50,9 +193,9 @@ void parseCommandLine(int argc, char *argv[], contextSimplemux* context)
   char tunnel_mode_string[4];
 
   #ifdef USINGROHC
-  while((option = getopt(argc, argv, "i:e:M:T:c:p:n:B:t:P:l:d:r:m:fbhL")) > 0) {
+  while((option = getopt(argc, argv, "i:e:M:T:c:p:n:B:t:P:l:d:r:m:k:q:a:w:W:s:A:F:R:x:C:jgyufbhL")) > 0) {
   #else
-  while((option = getopt(argc, argv, "i:e:M:T:c:p:n:B:t:P:l:d:m:fbhL")) > 0) {
+  while((option = getopt(argc, argv, "i:e:M:T:c:p:n:B:t:P:l:d:m:k:q:a:w:W:s:A:F:R:x:C:jgyufbhL")) > 0) {
   #endif
 
     switch(option) {
@@ -199,6 +342,58 @@ void parseCommandLine(int argc, char *argv[], contextSimplemux* context)
         context->period = atoll(optarg);
         context->microsecondsLeft = context->period; 
         break;
+      case 'k':            // number of datagrams read/sent with a single system call
+        context->batchSize = atoi(optarg);
+        break;
+      case 'q':            // number of tun/tap queues (one thread per queue)
+        context->numQueues = atoi(optarg);
+        break;
+      case 'a':            // maximum number of packets read from tun/tap in a single pass
+        context->drainBudget = atoi(optarg);
+        break;
+      case 'w':            // maximum number of bundles in the TCP send queue
+        context->tcpQueueSize = atoi(optarg);
+        break;
+      case 'W':            // maximum time (us) that a bundle can wait in the TCP send queue
+        context->tcpSojournLimit = atoll(optarg);
+        break;
+      case 's':            // maximum number of slots of the pool of blast packets
+        context->unconfirmedPacketsBlast.pool.maxSlots = atoi(optarg);
+        break;
+      case 'A':            // selective ACKs: send an ACK every N blast packets
+        context->blastAckEvery = atoi(optarg);
+        break;
+      case 'y':            // piggyback the ACKs and the heartbeats on blast data packets
+        context->blastPiggyback = true;
+        break;
+      case 'R':            // adaptive retransmission timeout, with a floor (us)
+        context->blastAdaptiveRto = true;
+        // a wrong value becomes out of range (-1), so it is rejected by 'checkCommandLineOptions()'
+        context->blastRtoFloor = (uint64_t)parseNonNegative(optarg);
+        break;
+      case 'x':            // pacing of the blast packets (packets per second)
+        context->blastPacingRate = (uint32_t)parseNonNegative(optarg);
+        break;
+      case 'C':            // hybrid flavor: rules of the flows sent in blast flavor
+        context->numFlowRules = parseFlowRules(context, optarg);
+        break;
+      case 'F':            // FEC: 'K:M' sends M parity packets every K blast packets ('K' alone: M = 1)
+        context->fecParityCount = 1;
+        sscanf(optarg, "%i:%i", &context->fecBlockSize, &context->fecParityCount);
+        break;
+      case 'g':            // UDP segmentation offload (GSO and GRO)
+        context->udpOffloadRequested = true;
+        break;
+      case 'j':            // measure the lateness of the period
+        context->measureLateness = true;
+        break;
+      case 'u':            // use the io_uring engine instead of poll()
+        #ifdef USINGIOURING
+          context->ioUringRequested = true;
+        #else
+          my_err("This binary has been compiled without the io_uring engine. Using poll()\n");
+        #endif
+        break;
       default:
         my_err("Unknown option %c\n", option);
         usage(argv[0]);
@@ -261,6 +456,164 @@ int checkCommandLineOptions(int argc, char *progname, contextSimplemux* context)
     return 0;
   }
 
+  // the batch size cannot be higher than MAXBATCH
+  else if((context->batchSize < 1) || (context->batchSize > MAXBATCH)) {
+    my_err("The batch size (-k %i) must be between 1 and %i\n", context->batchSize, MAXBATCH);
+    usage(progname);
+    return 0;
+  }
+
+  // batched I/O uses recvmmsg() and sendmmsg(), so it only makes sense with a UDP socket
+  else if((context->batchSize > 1) && (context->mode != UDP_MODE)) {
+    my_err("Batched I/O (-k) is only available in UDP mode ('-M udp')\n");
+    usage(progname);
+    return 0;
+  }
+
+  // GSO/GRO work on the batches of datagrams read/sent with recvmmsg()/sendmmsg()
+  else if((context->udpOffloadRequested) && ((context->mode != UDP_MODE) || (context->batchSize <= 1))) {
+    my_err("UDP GSO/GRO (-g) is only available in UDP mode ('-M udp'), with batched I/O (-k)\n");
+    usage(progname);
+    return 0;
+  }
+
+  // the size of the TCP send queue cannot be higher than TCP_QUEUE_MAX
+  else if((context->tcpQueueSize < 1) || (context->tcpQueueSize > TCP_QUEUE_MAX)) {
+    my_err("The size of the TCP send queue (-w %i) must be between 1 and %i\n", context->tcpQueueSize, TCP_QUEUE_MAX);
+    usage(progname);
+    return 0;
+  }
+
+  // the TCP send queue is only used in TCP modes
+  else if(((context->tcpQueueSize != TCP_QUEUE_DEFAULT) || (context->tcpSojournLimit > 0)) &&
+          (context->mode != TCP_SERVER_MODE) && (context->mode != TCP_CLIENT_MODE)) {
+    my_err("The TCP send queue (-w, -W) is only used in TCP server ('-M tcpserver') and TCP client mode ('-M tcpclient')\n");
+    usage(progname);
+    return 0;
+  }
+
+  // the number of slots of the pool of blast packets cannot be higher than BLAST_POOL_DEFAULT
+  else if((context->unconfirmedPacketsBlast.pool.maxSlots < 1) || (context->unconfirmedPacketsBlast.pool.maxSlots > BLAST_POOL_DEFAULT)) {
+    my_err("The number of slots of the pool of blast packets (-s %i) must be between 1 and %i\n", context->unconfirmedPacketsBlast.pool.maxSlots, BLAST_POOL_DEFAULT);
+    usage(progname);
+    return 0;
+  }
+
+  // the pool is only used in blast and hybrid flavors
+  else if((context->unconfirmedPacketsBlast.pool.maxSlots != BLAST_POOL_DEFAULT) && (context->flavor != 'B') && (context->numFlowRules == 0)) {
+    my_err("The pool of blast packets (-s) is only used in blast flavor ('-b') and hybrid flavor ('-C')\n");
+    usage(progname);
+    return 0;
+  }
+
+  // a selective ACK cannot cover more identifiers than its first one plus the bitmap
+  else if((context->blastAckEvery < 0) || (context->blastAckEvery > 1 + 8 * BLAST_SACK_BITMAP_SIZE)) {
+    my_err("The number of packets per selective ACK (-A %i) must be between 1 and %i\n", context->blastAckEvery, 1 + 8 * BLAST_SACK_BITMAP_SIZE);
+    usage(progname);
+    return 0;
+  }
+
+  // selective ACKs and piggybacking are only used in blast and hybrid flavors
+  else if(((context->blastAckEvery > 0) || context->blastPiggyback) && (context->flavor != 'B') && (context->numFlowRules == 0)) {
+    my_err("Selective ACKs (-A) and piggybacking (-y) are only used in blast flavor ('-b') and hybrid flavor ('-C')\n");
+    usage(progname);
+    return 0;
+  }
+
+  // the adaptive retransmission timeout is only used in blast and hybrid flavors
+  else if(context->blastAdaptiveRto && (context->flavor != 'B') && (context->numFlowRules == 0)) {
+    my_err("The adaptive retransmission timeout (-R) is only used in blast flavor ('-b') and hybrid flavor ('-C')\n");
+    usage(progname);
+    return 0;
+  }
+
+  // the floor of the adaptive retransmission timeout cannot be higher than its maximum
+  else if(context->blastAdaptiveRto && (context->blastRtoFloor > BLAST_RTO_MAX)) {
+    my_err("The floor of the adaptive retransmission timeout (-R) must be a number between 0 and %i us\n", BLAST_RTO_MAX);
+    usage(progname);
+    return 0;
+  }
+
+  // the pacing rate must be a positive number of packets per second
+  else if(context->blastPacingRate > BLAST_PACING_MAX) {
+    my_err("The pacing rate (-x) must be a number between 1 and %i packets per second\n", BLAST_PACING_MAX);
+    usage(progname);
+    return 0;
+  }
+
+  // pacing is only used in blast and hybrid flavors
+  else if((context->blastPacingRate > 0) && (context->flavor != 'B') && (context->numFlowRules == 0)) {
+    my_err("Pacing (-x) is only used in blast flavor ('-b') and hybrid flavor ('-C')\n");
+    usage(progname);
+    return 0;
+  }
+
+  // FEC: the block and the number of parity packets are limited by the size of the coder
+  else if((context->fecParityCount != 0) &&
+          ((context->fecBlockSize < 1) || (context->fecBlockSize > BLAST_FEC_MAX_K) ||
+           (context->fecParityCount < 1) || (context->fecParityCount > BLAST_FEC_MAX_M)))
+  {
+    my_err("FEC (-F K:M) requires between 1 and %i packets per block, and between 1 and %i parity packets\n", BLAST_FEC_MAX_K, BLAST_FEC_MAX_M);
+    usage(progname);
+    return 0;
+  }
+
+  // FEC is only used in blast and hybrid flavors
+  else if((context->fecBlockSize > 0) && (context->flavor != 'B') && (context->numFlowRules == 0)) {
+    my_err("FEC (-F) is only used in blast flavor ('-b') and hybrid flavor ('-C')\n");
+    usage(progname);
+    return 0;
+  }
+
+  // the io_uring engine only reads datagrams or IP packets, not TCP streams
+  else if((context->ioUringRequested) && (context->mode != UDP_MODE) && (context->mode != NETWORK_MODE)) {
+    my_err("The io_uring engine (-u) is only available in UDP ('-M udp') and network mode ('-M network')\n");
+    usage(progname);
+    return 0;
+  }
+
+  // the io_uring engine does not split the datagrams coalesced by UDP GRO
+  else if((context->ioUringRequested) && (context->udpOffloadRequested)) {
+    my_err("The io_uring engine (-u) cannot be used with UDP segmentation offload (-g)\n");
+    usage(progname);
+    return 0;
+  }
+
+  // the number of queues cannot be higher than MAXQUEUES
+  else if((context->numQueues < 1) || (context->numQueues > MAXQUEUES)) {
+    my_err("The number of queues (-q %i) must be between 1 and %i\n", context->numQueues, MAXQUEUES);
+    usage(progname);
+    return 0;
+  }
+
+  // each queue uses its own UDP port, so multi-queue mode is only available in UDP mode
+  else if((context->numQueues > 1) && (context->mode != UDP_MODE)) {
+    my_err("Multi-queue mode (-q) is only available in UDP mode ('-M udp')\n");
+    usage(progname);
+    return 0;
+  }
+
+  // the drain budget cannot be higher than MAXPKTS
+  else if((context->drainBudget < 1) || (context->drainBudget > MAXPKTS)) {
+    my_err("The drain budget (-a %i) must be between 1 and %i\n", context->drainBudget, MAXPKTS);
+    usage(progname);
+    return 0;
+  }
+
+  // in blast flavor each packet is sent as soon as it arrives, so there is nothing to drain
+  else if((context->drainBudget > 1) && (context->flavor == 'B')) {
+    my_err("Drain mode (-a) is not available in blast flavor (-b)\n");
+    usage(progname);
+    return 0;
+  }
+
+  // the hybrid flavor multiplexes the flows that are not selected
+  else if((context->numFlowRules != 0) && (context->flavor == 'B')) {
+    my_err("The hybrid flavor (-C) sends the selected flows in blast flavor and multiplexes the rest in normal or fast flavor (-f). It is not compatible with -b\n");
+    usage(progname);
+    return 0;
+  }
+
   // blast flavor is restricted
   else if(context->flavor == 'B') {
     if((context->mode== TCP_SERVER_MODE) || (context->mode== TCP_CLIENT_MODE)){
@@ -295,6 +648,37 @@ int checkCommandLineOptions(int argc, char *progname, contextSimplemux* context)
       usage(progname);
       return 0;      
     }
+    // piggyback: the ACKs wait for a data packet in the other direction. If
+    //'-A' is not set, a separate ACK is only sent when the bitmap is full or
+    //the delayed-ACK timer expires
+    if(context->blastPiggyback && (context->blastAckEvery == 0))
+      context->blastAckEvery = 1 + 8 * BLAST_SACK_BITMAP_SIZE;
+  }
+
+  // hybrid flavor is restricted: the blast packets need a UDP or IP socket
+  else if(context->numFlowRules != 0) {
+    if(context->numFlowRules < 0) {
+      my_err("Wrong rules of the hybrid flavor (-C). Use up to %i rules separated by commas: ethertype=<n>, proto=<n>, port=<n> or dscp=<n>\n", MAX_FLOW_RULES);
+      usage(progname);
+      return 0;
+    }
+    if((context->mode== TCP_SERVER_MODE) || (context->mode== TCP_CLIENT_MODE)){
+      my_err("hybrid flavor (-C) is not allowed in TCP server ('-M tcpserver') and TCP client mode ('-M tcpclient')\n");
+      usage(progname);
+      return 0;
+    }
+    if(context->numQueues > 1) {
+      my_err("hybrid flavor (-C) is not compatible with several tun/tap queues (-q)\n");
+      usage(progname);
+      return 0;
+    }
+    if(context->period==MAXTIMEOUT) {
+      my_err("In hybrid flavor (-C) you must specify a period (-P). It is also used for the blast retransmissions\n");
+      usage(progname);
+      return 0;
+    }
+    if(context->blastPiggyback && (context->blastAckEvery == 0))
+      context->blastAckEvery = 1 + 8 * BLAST_SACK_BITMAP_SIZE;
   }
   return 1;
 }
@@ -355,22 +739,52 @@ static int tun_alloc( char *dev,    // the name of an interface (or '\0')
 }
 
 
+// in drain mode, the packets are read from tun/tap until there is nothing left,
+//so read() must not block
+// declared as 'static' because it is only used by 'initTunTapInterface()'
+static void setTunNonBlocking(contextSimplemux* context)
+{
+  if (context->drainBudget <= 1)
+    return;
+
+  for (int i = 0; i < context->numQueues; i++) {
+    int flags = fcntl(context->tunQueueFds[i], F_GETFL, 0);
+    if ((flags < 0) || (fcntl(context->tunQueueFds[i], F_SETFL, flags | O_NONBLOCK) < 0)) {
+      perror("[setTunNonBlocking] could not set the tun/tap interface as non-blocking");
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+
 // initialize tun/tap interface
 void initTunTapInterface(contextSimplemux* context)
 {
+  // in multi-queue mode, the kernel distributes the packets between the queues
+  //according to a hash of the flow, so all the packets of a flow go to the same queue
+  int queueFlag = 0;
+  if (context->numQueues > 1)
+    queueFlag = IFF_MULTI_QUEUE;
+
   if (context->tunnelMode == TUN_MODE) {
     // tun tunnel mode (i.e. send IP packets)
 
     // initialize tun interface for native packets
-    if ( (context->tun_fd = tun_alloc(context->tun_if_name, IFF_TUN | IFF_NO_PI)) < 0 ) {
-      my_err("Error connecting to tun/tap interface for capturing native packets %s\n", context->tun_if_name);
-      exit(1);
+    // in multi-queue mode, each call attaches a new queue to the same interface
+    for (int i = 0; i < context->numQueues; i++) {
+      if ( (context->tunQueueFds[i] = tun_alloc(context->tun_if_name, IFF_TUN | IFF_NO_PI | queueFlag)) < 0 ) {
+        my_err("Error connecting to tun/tap interface for capturing native packets %s\n", context->tun_if_name);
+        exit(1);
+      }
     }
+    context->tun_fd = context->tunQueueFds[0];
+    setTunNonBlocking(context);
     #ifdef DEBUG
       do_debug_c( 1,
                   ANSI_COLOR_RESET,
-                  "Successfully connected to tun/tap interface for native packets %s\n",
-                  context->tun_if_name);
+                  "Successfully connected to tun/tap interface for native packets %s (%i queues)\n",
+                  context->tun_if_name,
+                  context->numQueues);
     #endif
   }
   else if (context->tunnelMode == TAP_MODE) {
@@ -385,10 +799,15 @@ void initTunTapInterface(contextSimplemux* context)
     #endif  
 
     // initialize tap interface for native packets
-    if ( (context->tun_fd = tun_alloc(context->tun_if_name, IFF_TAP | IFF_NO_PI)) < 0 ) {
-      my_err("Error connecting to tap interface %s for capturing native Ethernet frames\n", context->tun_if_name);
-      exit(1);
+    // in multi-queue mode, each call attaches a new queue to the same interface
+    for (int i = 0; i < context->numQueues; i++) {
+      if ( (context->tunQueueFds[i] = tun_alloc(context->tun_if_name, IFF_TAP | IFF_NO_PI | queueFlag)) < 0 ) {
+        my_err("Error connecting to tap interface %s for capturing native Ethernet frames\n", context->tun_if_name);
+        exit(1);
+      }
     }
+    context->tun_fd = context->tunQueueFds[0];
+    setTunNonBlocking(context);
     #ifdef DEBUG
       do_debug_c( 1,
                   ANSI_COLOR_RESET,
@@ -560,11 +979,14 @@ void initTriggerParameters(contextSimplemux* context)
 // initializations for blast flavor
 void initBlastFlavor(contextSimplemux* context)
 {
-  // fill the vector of timestamps with zeroes
-  for(int i=0; i < 0xFFFF + 1; i++) {
-    context->blastTimestamps[i] = 0;
-  }
+  // no identifier has been delivered yet
+  memset(&context->deliveredBlast, 0, sizeof(blastDuplicateWindow));
   // fill the variables 'lastBlastHeartBeatSent' and 'lastBlastHeartBeatReceived'
   context->lastBlastHeartBeatSent = context->timeLastSent;
   context->lastBlastHeartBeatReceived = 0; // this means that I have received no heartbeats yet
+  // the unconfirmed packets are indexed by their identifier
+  initBlastWindow(&context->unconfirmedPacketsBlast);
+  // FEC: reserve the encoder and the decoder
+  if (context->fecBlockSize > 0)
+    initBlastFec(context);
 }
\ No newline at end of file
@@ -0,0 +1,874 @@
+#include "ioUring.h"
+#include "tunToNet.h"
+#include "netToTun.h"
+
+// optional io_uring engine ('-u' option). It replaces poll() and the read()/write()
+//calls of the main loop:
+// - multishot reads are kept armed on tun/tap and on the network socket, so
+//the kernel fills the packets in provided buffer rings without any system call
+// - the packets demuxed from the network are written to tun/tap with submissions
+//that are passed to the kernel in a batch, once per iteration of the main loop.
+//The writes of a batch are linked, so they are done in order. A packet is written
+//from the provided buffer where the bundle was received, without copying it
+// If io_uring cannot be started, the program goes on with poll()
+// liburing is not used, in order not to add a dependency: the rings are
+//managed directly with the system calls
+
+
+#ifdef USINGIOURING
+
+// wrappers of the io_uring system calls (there is no glibc wrapper for them)
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params* params)
+{
+  return (int) syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_io_uring_enter(int fd,
+                              unsigned toSubmit,
+                              unsigned minComplete,
+                              unsigned flags,
+                              void* arg,
+                              size_t argSize)
+{
+  return (int) syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argSize);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void* arg, unsigned nrArgs)
+{
+  return (int) syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs);
+}
+
+
+// pass the pending submissions to the kernel, without waiting for completions
+static void submitPending(ioUringEngine* engine)
+{
+  while (engine->toSubmit > 0) {
+    int result = sys_io_uring_enter(engine->ringFd, engine->toSubmit, 0, 0, NULL, 0);
+    engine->enterCalls++;
+
+    if (result < 0) {
+      if ((errno == EINTR) || (errno == EAGAIN) || (errno == EBUSY))
+        continue;
+      perror("[submitPending] io_uring_enter() failed");
+      exit(EXIT_FAILURE);
+    }
+    engine->toSubmit = engine->toSubmit - result;
+  }
+}
+
+
+// get a free entry of the submission queue. If the queue is full, the pending
+//submissions are passed to the kernel first
+static struct io_uring_sqe* getSqe(ioUringEngine* engine)
+{
+  unsigned head = __atomic_load_n(engine->sqHead, __ATOMIC_ACQUIRE);
+  unsigned tail = *engine->sqTail;
+
+  if (tail - head >= engine->sqEntries) {
+    submitPending(engine);
+    head = __atomic_load_n(engine->sqHead, __ATOMIC_ACQUIRE);
+  }
+
+  struct io_uring_sqe* sqe = &engine->sqes[tail & engine->sqMask];
+  memset(sqe, 0, sizeof(struct io_uring_sqe));
+  engine->sqArray[tail & engine->sqMask] = tail & engine->sqMask;
+
+  // the entry is published now, but the kernel only sees it in the next io_uring_enter()
+  __atomic_store_n(engine->sqTail, tail + 1, __ATOMIC_RELEASE);
+  engine->toSubmit++;
+
+  return sqe;
+}
+
+
+// give a buffer back to its provided buffer ring, so the kernel can fill it again
+static void recycleBuffer(ioUringEngine* engine, int group, uint16_t bid)
+{
+  struct io_uring_buf* buf = &engine->bufRing[group]->bufs[engine->bufRingTail[group] & (IOURING_NUM_BUFFERS - 1)];
+
+  buf->addr = (uint64_t)(uintptr_t)(engine->buffers[group] + (bid * IOURING_BUFFER_SIZE));
+  buf->len = IOURING_BUFFER_SIZE;
+  buf->bid = bid;
+
+  engine->bufRingTail[group]++;
+  __atomic_store_n(&engine->bufRing[group]->tail, engine->bufRingTail[group], __ATOMIC_RELEASE);
+}
+
+
+// create a provided buffer ring and fill it with all its buffers
+// returns 1 if everything is correct, 0 otherwise
+static int initBufferRing(ioUringEngine* engine, int group)
+{
+  size_t ringSize = IOURING_NUM_BUFFERS * sizeof(struct io_uring_buf);
+
+  // the ring must be page-aligned
+  engine->bufRing[group] = mmap(NULL, ringSize, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+  if (engine->bufRing[group] == MAP_FAILED) {
+    engine->bufRing[group] = NULL;
+    return 0;
+  }
+
+  engine->buffers[group] = malloc(IOURING_NUM_BUFFERS * IOURING_BUFFER_SIZE);
+  if (engine->buffers[group] == NULL)
+    return 0;
+
+  struct io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = (uint64_t)(uintptr_t)engine->bufRing[group];
+  reg.ring_entries = IOURING_NUM_BUFFERS;
+  reg.bgid = group;
+
+  if (sys_io_uring_register(engine->ringFd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    return 0;
+
+  engine->bufRingTail[group] = 0;
+  for (int i = 0; i < IOURING_NUM_BUFFERS; i++)
+    recycleBuffer(engine, group, i);
+
+  return 1;
+}
+
+
+// arm the read on tun/tap. It is multishot if the kernel supports it
+static void armTunRead(contextSimplemux* context)
+{
+  ioUringEngine* engine = context->ioUring;
+  struct io_uring_sqe* sqe = getSqe(engine);
+
+  if (engine->tunMultishot) {
+    sqe->opcode = IOURING_OP_READ_MULTISHOT;
+    sqe->len = 0;   // the size of the provided buffer is used
+  }
+  else {
+    sqe->opcode = IORING_OP_READ;
+    sqe->len = IOURING_BUFFER_SIZE;
+  }
+  sqe->fd = context->tun_fd;
+  sqe->off = 0;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = IOURING_TUN_GROUP;
+  sqe->user_data = IOURING_TUN_READ;
+}
+
+
+// arm the multishot read on the network socket
+static void armNetRead(contextSimplemux* context)
+{
+  ioUringEngine* engine = context->ioUring;
+  struct io_uring_sqe* sqe = getSqe(engine);
+
+  if (context->mode == UDP_MODE) {
+    // recvmsg() is needed in order to know the source port
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = context->udp_mode_fd;
+    sqe->addr = (uint64_t)(uintptr_t)&engine->recvMsgHeader;
+    sqe->len = 1;
+  }
+  else {
+    // network mode: the IP header is read with the packet
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = context->network_mode_fd;
+  }
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = IOURING_NET_GROUP;
+  sqe->user_data = IOURING_NET_READ;
+}
+
+
+#ifdef USINGROHC
+// the feedback socket is not read by the engine: a multishot poll reports
+//when it is readable, and the main loop reads it
+static void armFeedbackPoll(contextSimplemux* context)
+{
+  struct io_uring_sqe* sqe = getSqe(context->ioUring);
+
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = context->feedback_fd;
+  sqe->poll32_events = POLLIN;
+  sqe->len = IORING_POLL_ADD_MULTI;
+  sqe->user_data = IOURING_FEEDBACK_POLL;
+}
+#endif
+
+
+// release everything reserved by a failed 'initIoUring()'
+static void releaseIoUring(ioUringEngine* engine)
+{
+  for (int group = 0; group < 2; group++) {
+    if (engine->bufRing[group] != NULL)
+      munmap(engine->bufRing[group], IOURING_NUM_BUFFERS * sizeof(struct io_uring_buf));
+    free(engine->buffers[group]);
+  }
+  if (engine->sqes != NULL)
+    munmap(engine->sqes, engine->sqesSize);
+  if (engine->sqRingPtr != NULL)
+    munmap(engine->sqRingPtr, engine->sqRingSize);
+  if (engine->ringFd >= 0)
+    close(engine->ringFd);
+  free(engine->writeBuffers);
+  free(engine);
+}
+
+
+// start the io_uring engine
+// returns 1 if it has been started, 0 if io_uring is not available. In that
+//case, the program has to go on with poll()
+int initIoUring(contextSimplemux* context)
+{
+  ioUringEngine* engine = calloc(1, sizeof(ioUringEngine));
+  if (engine == NULL)
+    return 0;
+  engine->ringFd = -1;
+
+  // create the instance. The flags reduce the overhead of the completions,
+  //but they are only available in recent kernels
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN;
+  engine->ringFd = sys_io_uring_setup(IOURING_ENTRIES, &params);
+  if ((engine->ringFd < 0) && (errno == EINVAL)) {
+    memset(&params, 0, sizeof(params));
+    engine->ringFd = sys_io_uring_setup(IOURING_ENTRIES, &params);
+  }
+  if (engine->ringFd < 0) {
+    perror("[initIoUring] io_uring_setup() failed");
+    releaseIoUring(engine);
+    return 0;
+  }
+
+  // both queues are mapped at once, and the timeout of io_uring_enter() is needed
+  if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG)) {
+    my_err("[initIoUring] the kernel is too old for the io_uring engine\n");
+    releaseIoUring(engine);
+    return 0;
+  }
+
+  // map the submission and completion queues
+  engine->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  engine->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if (engine->cqRingSize > engine->sqRingSize)
+    engine->sqRingSize = engine->cqRingSize;
+  engine->cqRingSize = engine->sqRingSize;
+
+  engine->sqRingPtr = mmap( NULL, engine->sqRingSize, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, engine->ringFd, IORING_OFF_SQ_RING);
+  if (engine->sqRingPtr == MAP_FAILED) {
+    engine->sqRingPtr = NULL;
+    perror("[initIoUring] mmap() of the rings failed");
+    releaseIoUring(engine);
+    return 0;
+  }
+  engine->cqRingPtr = engine->sqRingPtr;
+
+  engine->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+  engine->sqes = mmap(NULL, engine->sqesSize, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, engine->ringFd, IORING_OFF_SQES);
+  if (engine->sqes == MAP_FAILED) {
+    engine->sqes = NULL;
+    perror("[initIoUring] mmap() of the submission entries failed");
+    releaseIoUring(engine);
+    return 0;
+  }
+
+  uint8_t* sq = engine->sqRingPtr;
+  engine->sqHead = (unsigned*)(sq + params.sq_off.head);
+  engine->sqTail = (unsigned*)(sq + params.sq_off.tail);
+  engine->sqArray = (unsigned*)(sq + params.sq_off.array);
+  engine->sqMask = *(unsigned*)(sq + params.sq_off.ring_mask);
+  engine->sqEntries = *(unsigned*)(sq + params.sq_off.ring_entries);
+
+  uint8_t* cq = engine->cqRingPtr;
+  engine->cqHead = (unsigned*)(cq + params.cq_off.head);
+  engine->cqTail = (unsigned*)(cq + params.cq_off.tail);
+  engine->cqMask = *(unsigned*)(cq + params.cq_off.ring_mask);
+  engine->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+  // provided buffer rings (Linux 5.19)
+  if ((initBufferRing(engine, IOURING_TUN_GROUP) == 0) || (initBufferRing(engine, IOURING_NET_GROUP) == 0)) {
+    perror("[initIoUring] the provided buffer rings could not be registered");
+    releaseIoUring(engine);
+    return 0;
+  }
+
+  // slots for the tun/tap writes
+  engine->writeBuffers = malloc(IOURING_TUN_WRITE_SLOTS * BUFSIZE);
+  if (engine->writeBuffers == NULL) {
+    releaseIoUring(engine);
+    return 0;
+  }
+  for (int i = 0; i < IOURING_TUN_WRITE_SLOTS; i++)
+    engine->freeWriteSlots[i] = i;
+  engine->numFreeWriteSlots = IOURING_TUN_WRITE_SLOTS;
+  engine->currentNetBuffer = -1;
+
+  // template of the recvmsg(): only the source address is needed
+  engine->recvMsgHeader.msg_namelen = sizeof(struct sockaddr_in);
+
+  engine->tunMultishot = true;
+  context->ioUring = engine;
+
+  // arm the reads
+  armTunRead(context);
+  armNetRead(context);
+  #ifdef USINGROHC
+    armFeedbackPoll(context);
+  #endif
+  submitPending(engine);
+
+  #ifdef DEBUG
+    do_debug_c( 1,
+                ANSI_COLOR_RESET,
+                "io_uring engine started. %u submission entries, %i buffers per ring\n",
+                engine->sqEntries,
+                IOURING_NUM_BUFFERS);
+  #endif
+
+  return 1;
+}
+
+
+// a packet has been read from tun/tap: process it as if poll() had reported it
+static void processTunCompletion(contextSimplemux* context, struct io_uring_cqe* cqe)
+{
+  ioUringEngine* engine = context->ioUring;
+
+  if (cqe->res < 0) {
+    if ((cqe->res == -EINVAL) && engine->tunMultishot) {
+      // multishot reads are not supported by this kernel (Linux 6.7): arm one read each time
+      engine->tunMultishot = false;
+      #ifdef DEBUG
+        do_debug_c( 1,
+                    ANSI_COLOR_RESET,
+                    "io_uring: multishot reads not supported on tun/tap. Using single reads\n");
+      #endif
+    }
+    else if (cqe->res != -ENOBUFS) {
+      errno = -cqe->res;
+      perror("Reading data");
+      exit(1);
+    }
+    // -ENOBUFS: all the buffers were in use. They have been recycled, so the read can be armed again
+    armTunRead(context);
+    return;
+  }
+
+  uint16_t bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+
+  // the tun/tap functions will get the packet through 'readFromTun()'
+  engine->pendingTunPacket = engine->buffers[IOURING_TUN_GROUP] + (bid * IOURING_BUFFER_SIZE);
+  engine->pendingTunPacketLength = cqe->res;
+
+  if (context->flavor == 'B') {
+    tunToNetBlastFlavor(context);
+  }
+  else {
+    // not in blast flavor
+
+    // increase the counter of the number of packets read from tun
+    context->tun2net++;
+
+    tunToNetNoBlastFlavor(context);
+  }
+  engine->pendingTunPacket = NULL;
+
+  recycleBuffer(engine, IOURING_TUN_GROUP, bid);
+
+  // the kernel has stopped the multishot read (or it was a single read)
+  if (!(cqe->flags & IORING_CQE_F_MORE))
+    armTunRead(context);
+}
+
+
+// drop a reference to a buffer of the network ring. When nobody uses it,
+//it is given back to the ring
+static void releaseNetBuffer(ioUringEngine* engine, int bid)
+{
+  engine->netBufferRefs[bid]--;
+  if (engine->netBufferRefs[bid] == 0)
+    recycleBuffer(engine, IOURING_NET_GROUP, bid);
+}
+
+
+// the packet read from the network has been processed: release its buffer,
+//and arm the read again if the kernel has stopped it
+static void finishNetCompletion(contextSimplemux* context,
+                                struct io_uring_cqe* cqe,
+                                uint16_t bid)
+{
+  context->ioUring->currentNetBuffer = -1;
+  releaseNetBuffer(context->ioUring, bid);
+
+  if (!(cqe->flags & IORING_CQE_F_MORE))
+    armNetRead(context);
+}
+
+
+// a packet has been read from the network socket: demux it or forward it
+static void processNetCompletion(contextSimplemux* context, struct io_uring_cqe* cqe)
+{
+  ioUringEngine* engine = context->ioUring;
+
+  if (cqe->res < 0) {
+    if (cqe->res == -EINVAL) {
+      my_err("io_uring: multishot reception is not supported by this kernel (Linux 6.0 is needed). Run without '-u'\n");
+      exit(1);
+    }
+    else if (cqe->res != -ENOBUFS) {
+      errno = -cqe->res;
+      perror ("[processNetCompletion] error reading from the network");
+    }
+    if (!(cqe->flags & IORING_CQE_F_MORE))
+      armNetRead(context);
+    return;
+  }
+
+  uint16_t bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+  uint8_t* buffer = engine->buffers[IOURING_NET_GROUP] + (bid * IOURING_BUFFER_SIZE);
+
+  // the buffer is kept until the bundle has been processed. The tun/tap writes
+  //of its packets add their own references
+  engine->netBufferRefs[bid] = 1;
+  engine->currentNetBuffer = bid;
+
+  if (context->mode == UDP_MODE) {
+    // the buffer starts with a header, followed by the source address and the payload
+    struct io_uring_recvmsg_out* out = (struct io_uring_recvmsg_out*)buffer;
+    uint8_t* name = buffer + sizeof(struct io_uring_recvmsg_out);
+    uint8_t* payload = name + engine->recvMsgHeader.msg_namelen + engine->recvMsgHeader.msg_controllen;
+
+    // 'payloadlen' is the length of the datagram, even if it did not fit in the
+    //provided buffer. A datagram longer than BUFSIZE is dropped: it could not be
+    //demuxed correctly, nor written to tun/tap
+    if ((out->flags & MSG_TRUNC) || (out->payloadlen > BUFSIZE)) {
+      #ifdef DEBUG
+        do_debug_c( 1,
+                    ANSI_COLOR_RED,
+                    "Datagram of %u bytes read from the UDP socket: too long. Dropped\n",
+                    out->payloadlen);
+      #endif
+      context->netPacketsTooLong++;
+      finishNetCompletion(context, cqe, bid);
+      return;
+    }
+
+    memcpy(&context->received, name, sizeof(struct sockaddr_in));
+
+    #ifdef DEBUG
+      do_debug_c( 3,
+                  ANSI_COLOR_YELLOW,
+                  "Read %i bytes from the UDP socket\n",
+                  out->payloadlen);
+    #endif
+
+    // check if the packet comes from the multiplexing port
+    int is_multiplexed_packet;
+    if (context->port == ntohs(context->received.sin_port))
+      is_multiplexed_packet = 1;
+    else
+      is_multiplexed_packet = 0;
+
+    deliverPacketFromNet( context,
+                          is_multiplexed_packet,
+                          out->payloadlen,
+                          out->payloadlen,
+                          payload);
+  }
+  else {
+    // network mode: the buffer starts with the IP header
+    #ifdef DEBUG
+      do_debug_c( 3,
+                  ANSI_COLOR_YELLOW,
+                  "Read %i bytes from the network socket\n",
+                  cqe->res);
+    #endif
+
+    // the buffer may be longer than BUFSIZE, so the packet is checked
+    if ((cqe->res < (int)sizeof(struct iphdr)) || (cqe->res - (int)sizeof(struct iphdr) > BUFSIZE)) {
+      context->netPacketsTooLong++;
+      finishNetCompletion(context, cqe, bid);
+      return;
+    }
+
+    struct iphdr ipheader;
+    GetIpHeader(&ipheader, buffer);
+
+    // only IP headers of 20 bytes are supported
+    int is_multiplexed_packet;
+    if ((ipheader.ihl & 0x0F) != 0x05) {
+      perror ("[processNetCompletion] in network mode, only IP headers of 20 bytes are supported");
+      is_multiplexed_packet = 0;
+    }
+    else if (ipheader.protocol == context->ipprotocol)
+      is_multiplexed_packet = 1;
+    else
+      is_multiplexed_packet = 0;
+
+    // the IP header is skipped
+    deliverPacketFromNet( context,
+                          is_multiplexed_packet,
+                          cqe->res - sizeof(struct iphdr),
+                          cqe->res - sizeof(struct iphdr),
+                          buffer + sizeof(struct iphdr));
+  }
+
+  finishNetCompletion(context, cqe, bid);
+}
+
+
+// submit the pending tun/tap writes as a chain of linked writes, so the kernel
+//does them in order even if one of them cannot be done at once
+// a chain is only submitted when the previous one has completed, because the
+//writes of two chains could be done at the same time
+static void flushTunWrites(contextSimplemux* context)
+{
+  ioUringEngine* engine = context->ioUring;
+
+  if ((engine->writesInFlight > 0) || (engine->numPendingWrites == 0))
+    return;
+
+  // the whole chain must be passed to the kernel in the same io_uring_enter()
+  unsigned head = __atomic_load_n(engine->sqHead, __ATOMIC_ACQUIRE);
+  if (*engine->sqTail - head + engine->numPendingWrites > engine->sqEntries)
+    submitPending(engine);
+
+  for (int i = 0; i < engine->numPendingWrites; i++) {
+    int slot = engine->pendingWriteSlots[i];
+
+    struct io_uring_sqe* sqe = getSqe(engine);
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = context->tun_fd;
+    sqe->off = 0;
+    sqe->addr = (uint64_t)(uintptr_t)engine->writeAddresses[slot];
+    sqe->len = engine->pendingWriteLengths[i];
+    sqe->user_data = IOURING_TUN_WRITE | ((uint64_t)slot << 8);
+
+    // the next write starts when this one has completed
+    if (i < engine->numPendingWrites - 1)
+      sqe->flags = IOSQE_IO_LINK;
+  }
+
+  engine->writesInFlight = engine->numPendingWrites;
+  engine->numPendingWrites = 0;
+}
+
+
+// a tun/tap write has completed: its slot can be used again, and the buffer
+//of the network ring it was written from is released
+// if the write has failed, the packet is dropped: a bad packet must not stop
+//the program. The writes linked after a failed one are cancelled (-ECANCELED)
+static void completeTunWrite(ioUringEngine* engine, struct io_uring_cqe* cqe)
+{
+  if (cqe->res < 0) {
+    if (cqe->res != -ECANCELED) {
+      errno = -cqe->res;
+      perror("could not write the packet to tun/tap. Dropped");
+    }
+    engine->tunWriteErrors++;
+  }
+
+  int slot = (int)(cqe->user_data >> 8);
+  if (engine->writeNetBuffers[slot] >= 0)
+    releaseNetBuffer(engine, engine->writeNetBuffers[slot]);
+
+  engine->freeWriteSlots[engine->numFreeWriteSlots] = slot;
+  engine->numFreeWriteSlots++;
+  engine->writesInFlight--;
+}
+
+
+// keep a completion, so it is processed later by 'ioUringWait()'
+static void deferCompletion(ioUringEngine* engine, struct io_uring_cqe* cqe)
+{
+  // the feedback socket only has to be reported once. If the poll has
+  //stopped, the flags of the last completion say it
+  if ((cqe->user_data & 0xFF) == IOURING_FEEDBACK_POLL) {
+    for (int i = engine->deferredHead; i < engine->numDeferred; i++) {
+      if ((engine->deferredCqes[i].user_data & 0xFF) == IOURING_FEEDBACK_POLL) {
+        engine->deferredCqes[i].flags = cqe->flags;
+        return;
+      }
+    }
+  }
+
+  // move the completions not yet processed to the beginning
+  if ((engine->numDeferred == IOURING_DEFERRED_CQES) && (engine->deferredHead > 0)) {
+    engine->numDeferred = engine->numDeferred - engine->deferredHead;
+    memmove(engine->deferredCqes, &engine->deferredCqes[engine->deferredHead], engine->numDeferred * sizeof(struct io_uring_cqe));
+    engine->deferredHead = 0;
+  }
+
+  if (engine->numDeferred == IOURING_DEFERRED_CQES) {
+    my_err("[deferCompletion] too many io_uring completions while waiting for a tun/tap write\n");
+    exit(EXIT_FAILURE);
+  }
+
+  engine->deferredCqes[engine->numDeferred] = *cqe;
+  engine->numDeferred++;
+}
+
+
+// all the tun/tap write slots are in use: wait until one of the writes completes
+// a packet cannot be written directly with write(), because it could be written
+//before the ones in flight. The completions of the other operations are kept,
+//and 'ioUringWait()' processes them later, in order
+static void waitForWriteSlot(contextSimplemux* context)
+{
+  ioUringEngine* engine = context->ioUring;
+
+  engine->tunWriteWaits++;
+
+  while (engine->numFreeWriteSlots == 0) {
+    // the writes may be waiting for the chain in flight
+    flushTunWrites(context);
+
+    int result = sys_io_uring_enter(engine->ringFd, engine->toSubmit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+    engine->enterCalls++;
+
+    if (result >= 0) {
+      engine->toSubmit = engine->toSubmit - result;
+    }
+    else if ((errno != EINTR) && (errno != EAGAIN) && (errno != EBUSY)) {
+      perror("[waitForWriteSlot] io_uring_enter() failed");
+      exit(EXIT_FAILURE);
+    }
+
+    unsigned head = *engine->cqHead;
+    unsigned tail = __atomic_load_n(engine->cqTail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+      struct io_uring_cqe cqe = engine->cqes[head & engine->cqMask];
+      head++;
+      __atomic_store_n(engine->cqHead, head, __ATOMIC_RELEASE);
+
+      if ((cqe.user_data & 0xFF) == IOURING_TUN_WRITE) {
+        completeTunWrite(engine, &cqe);
+        engine->completions++;
+      }
+      else {
+        deferCompletion(engine, &cqe);
+      }
+
+      tail = __atomic_load_n(engine->cqTail, __ATOMIC_ACQUIRE);
+    }
+  }
+}
+
+
+// process a completion of the engine
+static void processCompletion(contextSimplemux* context,
+                              struct pollfd* fds_poll,
+                              struct io_uring_cqe* cqe)
+{
+  switch (cqe->user_data & 0xFF) {
+    case IOURING_TUN_READ:
+      processTunCompletion(context, cqe);
+    break;
+
+    case IOURING_NET_READ:
+      processNetCompletion(context, cqe);
+    break;
+
+    case IOURING_TUN_WRITE:
+      completeTunWrite(context->ioUring, cqe);
+    break;
+
+    #ifdef USINGROHC
+    case IOURING_FEEDBACK_POLL:
+      fds_poll[2].revents = POLLIN;
+      if (!(cqe->flags & IORING_CQE_F_MORE))
+        armFeedbackPoll(context);
+    break;
+    #endif
+  }
+}
+
+
+// pass the pending submissions (e.g. tun/tap writes) to the kernel, wait for
+//completions (at most 'microsecondsLeft') and process them
+// it is used instead of poll(). The descriptors that are not read by the engine
+//(the feedback socket) are reported in 'fds_poll', in the same way as poll() does
+// returns
+//  >0  the number of completions processed
+//   0  the timeout has expired
+//  -1  a signal has interrupted the wait, or the kernel could not take the
+//submissions for now (EAGAIN, EBUSY) and there was nothing to process. The
+//timeout has not expired, so the caller has to wait again
+int ioUringWait(contextSimplemux* context,
+                struct pollfd* fds_poll,
+                uint64_t microsecondsLeft)
+{
+  ioUringEngine* engine = context->ioUring;
+
+  for (int i = 0; i < NUMBER_OF_SOCKETS; i++)
+    fds_poll[i].revents = 0;
+
+  // the tun/tap writes of the previous iteration
+  flushTunWrites(context);
+
+  unsigned head = *engine->cqHead;
+  unsigned tail = __atomic_load_n(engine->cqTail, __ATOMIC_ACQUIRE);
+  bool completionsReady = (head != tail) || (engine->deferredHead < engine->numDeferred);
+  bool busy = false;
+
+  if (!completionsReady || (engine->toSubmit > 0)) {
+    // submit and wait in a single system call
+    struct __kernel_timespec ts;
+    ts.tv_sec = microsecondsLeft / 1000000;
+    ts.tv_nsec = (microsecondsLeft % 1000000) * 1000;
+
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.ts = (uint64_t)(uintptr_t)&ts;
+
+    // do not wait if there are completions already, or if the time is over
+    unsigned minComplete = (!completionsReady && (microsecondsLeft > 0)) ? 1 : 0;
+
+    int result = sys_io_uring_enter(engine->ringFd,
+                                    engine->toSubmit,
+                                    minComplete,
+                                    IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                                    &arg,
+                                    sizeof(arg));
+    engine->enterCalls++;
+
+    if (result >= 0) {
+      engine->toSubmit = engine->toSubmit - result;
+    }
+    else if (errno == EINTR) {
+      return -1;
+    }
+    else if ((errno == EAGAIN) || (errno == EBUSY)) {
+      // the completions have to be processed before submitting more
+      busy = true;
+    }
+    else if (errno != ETIME) {
+      perror("[ioUringWait] io_uring_enter() failed");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  int processed = 0;
+
+  // process all the completions available. The ones kept while waiting for a
+  //tun/tap write slot are older, so they go first
+  // the processing may write to tun/tap and wait for a slot, so the head of the
+  //queue is read again each time
+  while (true) {
+    struct io_uring_cqe cqe;
+
+    if (engine->deferredHead < engine->numDeferred) {
+      cqe = engine->deferredCqes[engine->deferredHead];
+      engine->deferredHead++;
+      if (engine->deferredHead == engine->numDeferred) {
+        engine->deferredHead = 0;
+        engine->numDeferred = 0;
+      }
+    }
+    else {
+      head = *engine->cqHead;
+      if (head == __atomic_load_n(engine->cqTail, __ATOMIC_ACQUIRE))
+        break;
+
+      // copy the completion and release its entry before processing it
+      cqe = engine->cqes[head & engine->cqMask];
+      __atomic_store_n(engine->cqHead, head + 1, __ATOMIC_RELEASE);
+    }
+
+    processCompletion(context, fds_poll, &cqe);
+
+    engine->completions++;
+    processed++;
+  }
+
+  // nothing has happened, but the timeout has not expired
+  if (busy && (processed == 0))
+    return -1;
+
+  return processed;
+}
+
+#endif  // USINGIOURING
+
+
+// read a packet from tun/tap
+// if the io_uring engine is active, the packet has already been read by the
+//kernel into a provided buffer. Otherwise, it is equivalent to cread()
+int readFromTun(contextSimplemux* context,
+                uint8_t* buffer,
+                int size)
+{
+  #ifdef USINGIOURING
+    ioUringEngine* engine = context->ioUring;
+
+    if ((engine != NULL) && (engine->pendingTunPacket != NULL)) {
+      int length = engine->pendingTunPacketLength;
+      if (length > size)
+        length = size;
+
+      memcpy(buffer, engine->pendingTunPacket, length);
+      engine->pendingTunPacket = NULL;
+      return length;
+    }
+  #endif
+
+  return cread(context->tun_fd, buffer, size);
+}
+
+
+// write a packet to tun/tap
+// if the io_uring engine is active, the write is submitted together with the
+//rest of the submissions of this iteration of the main loop. Otherwise, it is
+//equivalent to cwrite()
+int writeToTun( contextSimplemux* context,
+                uint8_t* packet,
+                int length)
+{
+  context->tunPacketsWritten++;
+
+  #ifdef USINGIOURING
+    ioUringEngine* engine = context->ioUring;
+
+    if (engine != NULL) {
+      // the write slots have BUFSIZE bytes
+      if ((length < 0) || (length > BUFSIZE)) {
+        errno = EMSGSIZE;
+        return -1;
+      }
+
+      if (engine->numFreeWriteSlots == 0)
+        waitForWriteSlot(context);
+
+      engine->numFreeWriteSlots--;
+      int slot = engine->freeWriteSlots[engine->numFreeWriteSlots];
+
+      // a packet demuxed from the bundle being processed is written from the
+      //buffer of the network ring, which is kept until the write completes
+      uint8_t* netBuffer = NULL;
+      if (engine->currentNetBuffer >= 0)
+        netBuffer = engine->buffers[IOURING_NET_GROUP] + (engine->currentNetBuffer * IOURING_BUFFER_SIZE);
+
+      if ((netBuffer != NULL) && (packet >= netBuffer) && (packet + length <= netBuffer + IOURING_BUFFER_SIZE)) {
+        engine->writeAddresses[slot] = packet;
+        engine->writeNetBuffers[slot] = engine->currentNetBuffer;
+        engine->netBufferRefs[engine->currentNetBuffer]++;
+      }
+      else {
+        // e.g. a decompressed packet, or a blast packet rebuilt with FEC
+        memcpy(engine->writeBuffers[slot], packet, length);
+        context->receiveBytesCopied = context->receiveBytesCopied + length;
+        engine->writeAddresses[slot] = engine->writeBuffers[slot];
+        engine->writeNetBuffers[slot] = -1;
+      }
+
+      // it is submitted after the writes that are pending
+      engine->pendingWriteSlots[engine->numPendingWrites] = slot;
+      engine->pendingWriteLengths[engine->numPendingWrites] = length;
+      engine->numPendingWrites++;
+
+      engine->tunWritesBatched++;
+      return length;
+    }
+  #endif
+
+  return cwrite(context->tun_fd, packet, length);
+}
@@ -0,0 +1,119 @@
+// header guard: avoids problems if this file is included twice
+#ifndef IOURING_H
+#define IOURING_H
+
+#include "commonFunctions.h"
+
+#ifdef USINGIOURING
+  #include <poll.h>
+  #include <sys/mman.h>
+  #include <sys/syscall.h>
+  #include <linux/io_uring.h>
+
+  #define IOURING_ENTRIES 256             // size of the submission queue (the completion queue is twice this size)
+  #define IOURING_NUM_BUFFERS 256         // number of buffers of each provided buffer ring (it must be a power of 2)
+  #define IOURING_BUFFER_SIZE 4096        // size of each provided buffer. It must fit a packet (BUFSIZE) plus the recvmsg() header
+  #define IOURING_TUN_WRITE_SLOTS 128     // maximum number of tun/tap writes in flight (it must not be higher than IOURING_ENTRIES)
+  #define IOURING_DEFERRED_CQES (2 * IOURING_NUM_BUFFERS + 4) // completions kept while waiting for a tun/tap write slot: all
+                                          //the buffers of both rings, plus the end of each multishot operation
+
+  // not included in older kernel headers (Linux 6.7)
+  #define IOURING_OP_READ_MULTISHOT 49
+
+  // provided buffer groups
+  #define IOURING_TUN_GROUP 0             // buffers for the packets read from tun/tap
+  #define IOURING_NET_GROUP 1             // buffers for the bundles read from the network
+
+  // type of operation, stored in the lowest byte of the 'user_data' field of each submission
+  #define IOURING_TUN_READ 1
+  #define IOURING_NET_READ 2
+  #define IOURING_TUN_WRITE 3
+  #define IOURING_FEEDBACK_POLL 4
+
+  // state of the io_uring engine
+  typedef struct ioUringEngine {
+    int ringFd;                           // file descriptor of the io_uring instance
+
+    // submission queue
+    void* sqRingPtr;
+    size_t sqRingSize;
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned* sqArray;
+    unsigned sqMask;
+    unsigned sqEntries;
+    struct io_uring_sqe* sqes;
+    size_t sqesSize;
+    unsigned toSubmit;                    // number of submissions not yet passed to the kernel
+
+    // completion queue
+    void* cqRingPtr;
+    size_t cqRingSize;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned cqMask;
+    struct io_uring_cqe* cqes;
+
+    // provided buffer rings: one for tun/tap and one for the network socket
+    struct io_uring_buf_ring* bufRing[2];
+    uint8_t* buffers[2];
+    uint16_t bufRingTail[2];
+
+    bool tunMultishot;                    // false if the kernel does not support multishot reads (one read is armed each time)
+    struct msghdr recvMsgHeader;          // template for the multishot recvmsg() in UDP mode
+
+    // tun/tap writes. A packet that is in a buffer of the network ring is written
+    //from there, and the buffer is given back when the write completes. Other
+    //packets (e.g. decompressed or rebuilt ones) are copied to the slot
+    uint8_t (*writeBuffers)[BUFSIZE];
+    uint8_t* writeAddresses[IOURING_TUN_WRITE_SLOTS];   // packet written by each slot
+    int writeNetBuffers[IOURING_TUN_WRITE_SLOTS];       // buffer of the network ring used by each slot. -1 if the packet was copied
+    int freeWriteSlots[IOURING_TUN_WRITE_SLOTS];
+    int numFreeWriteSlots;
+
+    // references to each buffer of the network ring: the processing of the
+    //bundle, and the tun/tap writes of the packets it contains
+    int netBufferRefs[IOURING_NUM_BUFFERS];
+    int currentNetBuffer;                 // buffer of the network ring being processed. -1 if none
+
+    // tun/tap writes not yet submitted, in order. They are submitted as a chain
+    //of linked writes, and the next chain waits until this one has completed
+    int pendingWriteSlots[IOURING_TUN_WRITE_SLOTS];
+    int pendingWriteLengths[IOURING_TUN_WRITE_SLOTS];
+    int numPendingWrites;
+    int writesInFlight;                   // writes of the chain submitted
+
+    // completions reaped while waiting for a free write slot. They are older
+    //than the ones in the completion queue, so they are processed first
+    struct io_uring_cqe deferredCqes[IOURING_DEFERRED_CQES];
+    int deferredHead;                     // first deferred completion not yet processed
+    int numDeferred;
+
+    // packet read from tun/tap, waiting to be consumed by 'readFromTun()'
+    uint8_t* pendingTunPacket;
+    int pendingTunPacketLength;
+
+    // counters
+    uint64_t enterCalls;                  // number of calls to io_uring_enter()
+    uint64_t completions;                 // number of completions processed
+    uint64_t tunWritesBatched;            // tun/tap writes submitted through the ring
+    uint64_t tunWriteWaits;               // tun/tap writes that had to wait for a free slot
+    uint64_t tunWriteErrors;              // tun/tap writes that failed or were cancelled (the packets are dropped)
+  } ioUringEngine;
+
+  int initIoUring(contextSimplemux* context);
+
+  int ioUringWait(contextSimplemux* context,
+                  struct pollfd* fds_poll,
+                  uint64_t microsecondsLeft);
+#endif
+
+int readFromTun(contextSimplemux* context,
+                uint8_t* buffer,
+                int size);
+
+int writeToTun( contextSimplemux* context,
+                uint8_t* packet,
+                int length);
+
+#endif  // IOURING_H
@@ -1,6 +1,7 @@
 #include "netToTun.h"
 
-/* Reads a multiplexed packet from the network
+/* Reads a multiplexed packet from the network (UDP and network modes)
+ * in TCP mode, 'readStreamFromTcp()' is used instead
  * it returns:
  * 1  a multiplexed packet has been read from the network
  * 0  a correct but not multiplexed packet has been read from the network
@@ -12,7 +13,6 @@ int readPacketFromNet(contextSimplemux* context,
                       uint16_t* packet_length )
 {
   int is_multiplexed_packet = -1;
-  uint8_t buffer_from_net_aux[BUFSIZE];
 
   if (context->mode == UDP_MODE) {
     // a packet has been received from the network, destined to the multiplexing port
@@ -29,6 +29,9 @@ int readPacketFromNet(contextSimplemux* context,
       perror ("[readPacketFromNet] recvfrom() UDP error");
     }
     else {
+      context->udpDatagramsReceived++;
+      context->udpBytesReceived = context->udpBytesReceived + *nread_from_net;
+
       #ifdef DEBUG
         do_debug_c( 3,
                     ANSI_COLOR_YELLOW,
@@ -52,13 +55,28 @@ int readPacketFromNet(contextSimplemux* context,
   }
 
   else if (context->mode  == NETWORK_MODE) {
+    // no extensions of the IP header are supported
+    #ifdef ASSERT
+      assert(sizeof(struct iphdr) == IPv4_HEADER_SIZE);
+    #endif
+
     // a packet has been received from the network, destined to the local interface for muxed packets
-    *nread_from_net = cread ( context->network_mode_fd,
-                              buffer_from_net_aux,
-                              BUFSIZE);
+    // the IP header is not copied: readv() puts it in 'ipheader', and
+    //everything after it (usually the first 20 bytes) in 'buffer_from_net'
+    struct iphdr ipheader;
+    struct iovec iov[2];
+    iov[0].iov_base = &ipheader;
+    iov[0].iov_len = sizeof(struct iphdr);
+    iov[1].iov_base = buffer_from_net;
+    iov[1].iov_len = BUFSIZE;
+
+    *nread_from_net = readv ( context->network_mode_fd,
+                              iov,
+                              2);
 
     if (*nread_from_net==-1) {
-      perror ("[readPacketFromNet] cread() error in network mode");
+      perror ("[readPacketFromNet] readv() error in network mode");
+      exit(1);
     }
     else {
       #ifdef DEBUG
@@ -74,27 +92,12 @@ int readPacketFromNet(contextSimplemux* context,
                     " bytes from the network socket\n");
       #endif
     }    
-    // 'buffer_from_net' now contains the headers
-    //(IP and Simplemux) and the payload of
-    //a full packet or frame
-
-    // no extensions of the IP header are supported
-    #ifdef ASSERT
-      assert(sizeof(struct iphdr) == IPv4_HEADER_SIZE);
-    #endif
-
-    // copy from 'buffer_from_net_aux' everything except the IP header (usually the first 20 bytes)
-    memcpy (buffer_from_net,
-            buffer_from_net_aux + sizeof(struct iphdr),
-            *nread_from_net - sizeof(struct iphdr));
+    // 'buffer_from_net' now contains the Simplemux
+    //headers and the payload of a full packet or frame
 
     // correct the size of 'nread from net', substracting the size of the IP header
     *nread_from_net = *nread_from_net - sizeof(struct iphdr);
 
-    // Get IP Header of received packet
-    struct iphdr ipheader;
-    GetIpHeader(&ipheader,buffer_from_net_aux);
-
     // ensure that the IP header size is correct (20 bytes is the only supported option)
     // the length is expressed in the second half of the first byte
     // if it is 0x05, it means that the length is 20 bytes
@@ -111,355 +114,128 @@ int readPacketFromNet(contextSimplemux* context,
     }
   }
 
-  else if ((context->mode  == TCP_SERVER_MODE) || (context->mode  == TCP_CLIENT_MODE)) {
-
-    // some bytes have been received from the network, destined to the TCP socket
-    
-    // TCP mode requires fast flavor
-    #ifdef ASSERT
-      assert(context->flavor == 'F');
-    #endif
-
-    /* Once the sockets are connected, the client can read from it
-     * through a normal 'read' call on the socket descriptor.
-     * Read 'buffer_from_net' bytes
-     * This call returns up to N bytes of data. If there are fewer 
-     *bytes available than requested, the call returns the number currently available.
-     */
-    //*nread_from_net = read(context->tcp_server_fd, buffer_from_net, sizeof(buffer_from_net));
-    
-    // I only read one packet (at most) each time the program goes through this part
-
-    if (context->pendingBytesMuxedPacket == 0) {
-
-      // I have to start reading a new muxed packet: separator and payload
-      #ifdef DEBUG
-        do_debug_c( 3,
-                    ANSI_COLOR_YELLOW,
-                    "  Reading TCP. No pending bytes of the muxed packet. Start reading a new separator\n");
-      #endif
-
-      // read a separator (3 or 4 bytes), or a part of it
-      if (context->mode  == TCP_SERVER_MODE) {
-        *nread_from_net = read( context->tcp_server_fd,
-                                buffer_from_net,
-                                context->sizeSeparatorFastMode - context->readTcpSeparatorBytes);
-      }
-      else {
-        *nread_from_net = read( context->tcp_client_fd,
-                                buffer_from_net,
-                                context->sizeSeparatorFastMode - context->readTcpSeparatorBytes);
-      }
-      #ifdef DEBUG
-        do_debug_c (3,
-                    ANSI_COLOR_YELLOW,
-                    "   ");
-        do_debug_c (3,
-                    ANSI_COLOR_RESET,
-                    "%i",
-                    *nread_from_net);
-        do_debug_c (3,
-                    ANSI_COLOR_YELLOW,
-                    " bytes of the separator read from the TCP socket");
-      #endif
-
-      if(*nread_from_net < 0)  {
-        perror("[readPacketFromNet] read() error TCP mode");
-      }
-
-      else if(*nread_from_net == 0) {
-        // I have not read a multiplexed packet yet
-        is_multiplexed_packet = -1;
-      }
-
-      else if (*nread_from_net < context->sizeSeparatorFastMode - context->readTcpSeparatorBytes) {
-        #ifdef DEBUG
-          do_debug_c( 3,
-                      ANSI_COLOR_YELLOW,
-                      "  (part of the separator. Still %i bytes missing)\n",
-                      context->sizeSeparatorFastMode - context->readTcpSeparatorBytes - *nread_from_net);
-        #endif
-
-        // I have read part of the separator
-        context->readTcpSeparatorBytes = context->readTcpSeparatorBytes + *nread_from_net;
-
-        // I have not read a multiplexed packet yet
-        is_multiplexed_packet = -1;
-      }
-
-      else if(*nread_from_net == context->sizeSeparatorFastMode - context->readTcpSeparatorBytes) {
-        #ifdef DEBUG
-          do_debug_c( 3,
-                      ANSI_COLOR_YELLOW,
-                      " (the complete separator has ");
-          do_debug_c( 3,
-                      ANSI_COLOR_RESET,
-                      "%i",
-                      context->sizeSeparatorFastMode);
-          do_debug_c( 3,
-                      ANSI_COLOR_YELLOW,
-                      " bytes)\n");
-        #endif
-
-        // I have read the complete separator
-
-        // I can now obtain the length of the packet
-        // the first byte is the Most Significant Byte of the length
-        // the second byte is the Less Significant Byte of the length
-        context->length_muxed_packet = (buffer_from_net[0] << 8)  + buffer_from_net[1];
-        context->pendingBytesMuxedPacket = context->length_muxed_packet;
-
-        #ifdef DEBUG
-          do_debug_c( 2,
-                      ANSI_COLOR_YELLOW,
-                      "Read Fast separator from the TCP socket: Length ");
-          do_debug_c( 2,
-                      ANSI_COLOR_RESET,
-                      "%i",
-                      context->length_muxed_packet);
-          do_debug_c( 2,
-                      ANSI_COLOR_YELLOW,
-                      " (");
-          do_debug_c( 2,
-                      ANSI_COLOR_RESET,
-                      "0x%02x%02x",
-                      buffer_from_net[0],
-                      buffer_from_net[1]);
-          do_debug_c( 2,
-                      ANSI_COLOR_YELLOW,
-                      ")");
-        #endif
-
-        // read the Protocol field
-        context->protocol_rec = buffer_from_net[2];
-        #ifdef DEBUG
-          do_debug_c( 2,
-                      ANSI_COLOR_YELLOW,
-                      ". Protocol ");
-          do_debug_c( 2,
-                      ANSI_COLOR_RESET,
-                      "%i",
-                      context->protocol_rec);
-          do_debug_c( 2,
-                      ANSI_COLOR_YELLOW,
-                      " (");
-          do_debug_c( 2,
-                      ANSI_COLOR_RESET,
-                      "0x%02x",
-                      buffer_from_net[2]);
-          do_debug_c( 2,
-                      ANSI_COLOR_YELLOW,
-                      ")\n");
-        #endif
-
-        // read the packet itself (without the separator)
-        // I only read the length of the packet
-        if (context->mode  == TCP_SERVER_MODE) {
-          *nread_from_net = read( context->tcp_server_fd,
-                                  buffer_from_net,
-                                  context->pendingBytesMuxedPacket);
-        }
-        else {
-          *nread_from_net = read( context->tcp_client_fd,
-                                  buffer_from_net,
-                                  context->pendingBytesMuxedPacket);
-        }
-        #ifdef DEBUG
-          do_debug_c( 3,
-                      ANSI_COLOR_CYAN,
-                      "   ");
-          do_debug_c( 3,
-                      ANSI_COLOR_RESET,
-                      "%i",
-                      *nread_from_net);
-          do_debug_c( 3,
-                      ANSI_COLOR_CYAN,
-                      " bytes of the muxed packet read from the TCP socket");
-        #endif
-
-        if(*nread_from_net < 0)  {
-          perror("[readPacketFromNet] read() error TCP server mode");
-        }
-
-        else if (*nread_from_net < context->pendingBytesMuxedPacket) {
-          #ifdef DEBUG
-            do_debug_c( 3,
-                        ANSI_COLOR_CYAN,
-                        "  (part of a muxed packet). Pending ");
-            do_debug_c( 3,
-                        ANSI_COLOR_RESET,
-                        "%i",
-                        context->pendingBytesMuxedPacket - *nread_from_net);
-            do_debug_c( 3,
-                        ANSI_COLOR_CYAN,
-                        " bytes\n");
-          #endif
-
-          // I have not read the whole packet
-          // next time I will have to keep on reading
-          context->pendingBytesMuxedPacket = context->pendingBytesMuxedPacket - *nread_from_net;
-          context->readTcpBytes = context->readTcpBytes + *nread_from_net;
-
-          //do_debug(2,"Read %d bytes from the TCP socket. Total %d\n", *nread_from_net, context->readTcpBytes); 
-          // I have not finished reading a muxed packet
-          is_multiplexed_packet = -1;
-        }
-        else if (*nread_from_net == context->pendingBytesMuxedPacket) {
-          // I have read a complete packet
-          *packet_length = context->readTcpBytes + *nread_from_net;
-
-          #ifdef DEBUG
-            do_debug_c( 3,
-                        ANSI_COLOR_CYAN,
-                        " (complete muxed packet of ");
-            do_debug_c( 3,
-                        ANSI_COLOR_RESET,
-                        "%i",
-                        *packet_length);
-            do_debug_c( 3,
-                        ANSI_COLOR_CYAN,
-                        " bytes)\n");
-          #endif
+  else {
+    perror("[readPacketFromNet] Unknown mode");
+    return(-1);      
+  }
 
-          // reset the variables
-          context->readTcpSeparatorBytes = 0;
-          context->pendingBytesMuxedPacket = 0;
-          context->readTcpBytes = 0;
+  // the bundle is the whole payload
+  *packet_length = *nread_from_net;
 
-          // I have finished reading a muxed packet
-          is_multiplexed_packet = 1;
-        }
-      }              
-    }
-    else { // context->pendingBytesMuxedPacket > 0
-      // I have to finish reading the TCP payload
-      // I try to read 'pendingBytesMuxedPacket' and to put them at position 'context->readTcpBytes'
-      #ifdef DEBUG
-        do_debug_c( 3,
-                    ANSI_COLOR_CYAN,
-                    "  Reading TCP. %i TCP bytes pending of the previous payload\n",
-                    context->pendingBytesMuxedPacket);
-      #endif
+  return is_multiplexed_packet;
+}
 
-      if (context->mode  == TCP_SERVER_MODE) {
-        *nread_from_net = read( context->tcp_server_fd,
-                                &(buffer_from_net[(context->readTcpBytes)]),
-                                context->pendingBytesMuxedPacket);
-      }
-      else {
-        *nread_from_net = read( context->tcp_client_fd,
-                                &(buffer_from_net[(context->readTcpBytes)]),
-                                context->pendingBytesMuxedPacket);
-      }
-      #ifdef DEBUG
-        do_debug_c( 3,
-                    ANSI_COLOR_CYAN,
-                    "   %i bytes read from the TCP socket ",
-                    *nread_from_net);
-      #endif
+// allocate the buffer where the TCP byte stream is parsed (TCP modes)
+void initTcpStream(contextSimplemux* context)
+{
+  context->tcpStreamBuffer = malloc(TCP_STREAM_BUFSIZE);
+  if (context->tcpStreamBuffer == NULL) {
+    perror("malloc() failed for the TCP stream buffer");
+    exit(EXIT_FAILURE);
+  }
+  context->tcpStreamBytes = 0;
+}
 
-      if(*nread_from_net < 0)  {
-        perror("[readPacketFromNet] read() error TCP mode");
-      }
 
-      else if(*nread_from_net == 0) {
-        #ifdef DEBUG
-          do_debug_c( 3,
-                      ANSI_COLOR_RED,
-                      "  (I have read 0 bytes)\n");
-        #endif
-        is_multiplexed_packet = -1;
-      }
+// read a chunk of the TCP byte stream (up to TCP_READ_SIZE bytes) and deliver
+//all the complete records it contains. Each record is a fast separator
+//(length and protocol) followed by a packet/frame
+// an incomplete record at the end of the chunk is kept at the beginning of
+//the buffer, and it is completed by the next read
+// returns the number of bytes read, 0 if the peer has closed the connection,
+//or -1 if there was an error
+int readStreamFromTcp(contextSimplemux* context)
+{
+  int fd;
+  if (context->mode == TCP_SERVER_MODE)
+    fd = context->tcp_server_fd;
+  else
+    fd = context->tcp_client_fd;
+
+  // the buffer is big enough for an incomplete record plus a whole chunk
+  int nread = read( fd,
+                    &context->tcpStreamBuffer[context->tcpStreamBytes],
+                    TCP_READ_SIZE);
+
+  if (nread < 0) {
+    // the socket is non-blocking, so there may be nothing to read yet
+    if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+      perror("[readStreamFromTcp] read() error TCP mode");
+    return -1;
+  }
+  if (nread == 0)
+    return 0;
 
-      else if(*nread_from_net < context->pendingBytesMuxedPacket) {
-        #ifdef DEBUG
-          do_debug_c( 3,
-                      ANSI_COLOR_CYAN,
-                      "  (I have not yet read the whole muxed packet: pending ");
-          do_debug_c( 3,
-                      ANSI_COLOR_RESET,
-                      "%i",
-                      context->length_muxed_packet - *nread_from_net);
-          do_debug_c( 3,
-                      ANSI_COLOR_CYAN,
-                      " bytes)\n");
-        #endif
+  context->tcpReads++;
+  context->tcpBytesRead = context->tcpBytesRead + nread;
+  context->tcpStreamBytes = context->tcpStreamBytes + nread;
 
-        // I have not read the whole packet
-        // next time I will have to keep on reading
-        context->pendingBytesMuxedPacket = context->length_muxed_packet - *nread_from_net;
-        context->readTcpBytes = context->readTcpBytes + *nread_from_net;
+  #ifdef DEBUG
+    do_debug_c( 3,
+                ANSI_COLOR_YELLOW,
+                "Read %i bytes from the TCP socket. %i bytes in the stream buffer\n",
+                nread,
+                context->tcpStreamBytes);
+  #endif
 
-        // I have not finished to read the pending bytes of this packet
-        is_multiplexed_packet = -1;
-      }
-      else if(*nread_from_net == context->pendingBytesMuxedPacket) {
-        #ifdef DEBUG
-          do_debug_c( 3,
-                      ANSI_COLOR_CYAN,
-                      "   I have read all the pending bytes (");
-          do_debug_c( 3,
-                      ANSI_COLOR_RESET,
-                      "%i",
-                      *nread_from_net);
-          do_debug_c( 3,
-                      ANSI_COLOR_CYAN,
-                      ") of this muxed packet. Total ");
-          do_debug_c( 3,
-                      ANSI_COLOR_RESET,
-                      "%i",
-                      context->length_muxed_packet);
-          do_debug_c( 3,
-                      ANSI_COLOR_CYAN,
-                      " bytes\n",
-                      context->length_muxed_packet);
-        #endif
+  // parse all the complete records
+  int position = 0;
+  while (context->tcpStreamBytes - position >= context->sizeSeparatorFastMode) {
+    simplemuxFastHeader* fastHeader = (simplemuxFastHeader*) (&context->tcpStreamBuffer[position]);
+    uint16_t length = ntohs(fastHeader->packetSize);
+
+    // the packet/frame has not been completely received yet
+    if (context->tcpStreamBytes - position - context->sizeSeparatorFastMode < length)
+      break;
+
+    #ifdef DEBUG
+      do_debug_c( 2,
+                  ANSI_COLOR_YELLOW,
+                  "Read Fast separator from the TCP socket: Length ");
+      do_debug_c( 2,
+                  ANSI_COLOR_RESET,
+                  "%i",
+                  length);
+      do_debug_c( 2,
+                  ANSI_COLOR_YELLOW,
+                  ". Protocol ");
+      do_debug_c( 2,
+                  ANSI_COLOR_RESET,
+                  "%i\n",
+                  fastHeader->protocolID);
+    #endif
 
-        // I have read the pending bytes of this packet
-        context->pendingBytesMuxedPacket = 0;
-        //context->readTcpBytes = context->readTcpBytes + *nread_from_net;
+    // the protocol is used by 'demuxBundleFromNet()'
+    context->protocol_rec = fastHeader->protocolID;
 
-        *nread_from_net = context->readTcpBytes + *nread_from_net;
+    // the packet/frame is demuxed from the stream buffer, without copying it
+    deliverPacketFromNet( context,
+                          1,
+                          length,
+                          length,
+                          &context->tcpStreamBuffer[position + context->sizeSeparatorFastMode]);
 
-        // reset the variables
-        context->readTcpSeparatorBytes = 0;
-        context->readTcpBytes = 0;
-        is_multiplexed_packet = 1;
-      }
-      
-      else /*if(*nread_from_net > context->pendingBytesMuxedPacket) */ {
-        #ifdef DEBUG
-          do_debug_c( 1,
-                      ANSI_COLOR_RED,
-                      "ERROR: I have read all the pending bytes (");
-          do_debug_c( 1,
-                      ANSI_COLOR_RESET,
-                      "%i",
-                      context->pendingBytesMuxedPacket);
-          do_debug_c( 1,
-                      ANSI_COLOR_RED,
-                      ") of this muxed packet, and some more (");
-          do_debug_c( 1,
-                      ANSI_COLOR_RESET,
-                      "%i",
-                      *nread_from_net - context->pendingBytesMuxedPacket);
-          do_debug_c( 1,
-                      ANSI_COLOR_RED,
-                      "). Abort\n");
-        #endif
+    context->tcpRecords++;
+    position = position + context->sizeSeparatorFastMode + length;
+  }
 
-        // I have read the pending bytes of this packet, plus some more bytes
-        // it doesn't make sense, because I have only read 'context->pendingBytesMuxedPacket'
-        return(-1);
-      }              
-    }
-  } 
-  else {
-    perror("[readPacketFromNet] Unknown mode");
-    return(-1);      
+  // move the incomplete record (if any) to the beginning of the buffer
+  context->tcpStreamBytes = context->tcpStreamBytes - position;
+  if ((context->tcpStreamBytes > 0) && (position > 0)) {
+    memmove(context->tcpStreamBuffer,
+            &context->tcpStreamBuffer[position],
+            context->tcpStreamBytes);
+    context->receiveBytesCopied = context->receiveBytesCopied + context->tcpStreamBytes;
+
+    #ifdef DEBUG
+      do_debug_c( 3,
+                  ANSI_COLOR_YELLOW,
+                  "  %i bytes of an incomplete record kept for the next read\n",
+                  context->tcpStreamBytes);
+    #endif
   }
 
-  return is_multiplexed_packet;
+  return nread;
 }
 
 // demux and decompress a Simplemux bundle and extract each of the
@@ -495,6 +271,11 @@ int demuxBundleFromNet( contextSimplemux* context,
     demuxPacketBlast(context, nread_from_net, buffer_from_net);
   }
 
+  // hybrid flavor: the blast packets are preceded by a marker
+  else if((context->numFlowRules > 0) && (nread_from_net > 0) && (buffer_from_net[0] == HYBRID_BLAST_MARKER)) {
+    demuxPacketBlast(context, nread_from_net - 1, &buffer_from_net[1]);
+  }
+
   // no blast flavor (i.e. 'normal' or 'fast')
   else {
     // if the packet comes from the multiplexing port, I have to demux 
@@ -545,14 +326,9 @@ int demuxBundleFromNet( contextSimplemux* context,
 
       // this part is used by both Normal and Fast flavors
 
-      #ifdef ASSERT
-        // ensure that there is space to copy the packet
-        assert(demuxedPacketLength <= BUFSIZE);
-      #endif
-
-      // copy the demultiplexed packet to a new string 'demuxed_packet'
-      uint8_t demuxed_packet[BUFSIZE];
-      memcpy (demuxed_packet, &buffer_from_net[position], demuxedPacketLength);
+      // the demultiplexed packet is not copied: it is written to tun/tap
+      //from its position in the buffer where the bundle was received
+      uint8_t* demuxed_packet = &buffer_from_net[position];
 
       // at this point, I have extracted one packet/frame from the arrived muxed one
       // the demuxed packet is in 'demuxed_packet'
@@ -620,7 +396,7 @@ int demuxBundleFromNet( contextSimplemux* context,
           else {
             // the demuxed packet is a RoHC-compressed packet. Decompress it
             sendPacket = decompressRohcPacket(context,
-                                              demuxed_packet,
+                                              &demuxed_packet,
                                               &demuxedPacketLength,
                                               status,
                                               nread_from_net);
@@ -648,4 +424,68 @@ int demuxBundleFromNet( contextSimplemux* context,
     }              
   }
   return 1;
-}
\ No newline at end of file
+}
+
+// deliver a packet read from the network:
+// - if it is a Simplemux bundle, demux it and send its packets/frames to tun/tap
+// - otherwise, write it directly into the tun/tap interface
+void deliverPacketFromNet(contextSimplemux* context,
+                          int is_multiplexed_packet,
+                          int nread_from_net,
+                          uint16_t packet_length,
+                          uint8_t* buffer_from_net)
+{
+  // check if the packet is a multiplexed one
+  if (is_multiplexed_packet == -1) {
+    // I have read nothing
+  }
+  
+  else if (is_multiplexed_packet == 1) {
+    #ifdef USINGROHC
+    demuxBundleFromNet( context,
+                        nread_from_net,
+                        packet_length,
+                        buffer_from_net,
+                        &status);
+    #else
+    demuxBundleFromNet( context,
+                        nread_from_net,
+                        packet_length,
+                        buffer_from_net);
+    #endif
+  }
+
+  else { // is_multiplexed_packet == 0
+    // packet with the correct destination port, but a source port different from the multiplexing one
+    // if the packet does not come from the multiplexing port, write it directly into the tun interface
+    #ifdef DEBUG
+      do_debug_c( 1,
+                  ANSI_COLOR_RED,
+                  "NON-SIMPLEMUX PACKET #%"PRIu32": Non-multiplexed packet arrived to the Simplemux port. Writing %i bytes to tun/tap\n",
+                  context->net2tun,
+                  nread_from_net);
+    #endif
+    
+    if (writeToTun (context,
+                    buffer_from_net,
+                    nread_from_net) != nread_from_net)
+    {
+      perror("could not write the non-multiplexed packet correctly");
+    }
+    else {
+      // write the log file
+      if ( context->log_file != NULL ) {
+        // the packet is good
+        fprintf(context->log_file,
+                "%"PRIu64"\tforward\tnative\t%i\t%"PRIu32"\tfrom\t%s\t%d\n",
+                GetTimeStamp(),
+                nread_from_net,
+                context->net2tun,
+                inet_ntoa(context->remote.sin_addr),
+                ntohs(context->remote.sin_port));
+
+        fflush(context->log_file);              
+      }
+    }
+  }
+}
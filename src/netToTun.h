@@ -22,4 +22,14 @@ int demuxBundleFromNet( contextSimplemux* context,
                         uint8_t* buffer_from_net);
 #endif
 
+void initTcpStream(contextSimplemux* context);
+
+int readStreamFromTcp(contextSimplemux* context);
+
+void deliverPacketFromNet(contextSimplemux* context,
+                          int is_multiplexed_packet,
+                          int nread_from_net,
+                          uint16_t packet_length,
+                          uint8_t* buffer_from_net);
+
 #endif  // NETTOTUN_H
\ No newline at end of file
@@ -187,14 +187,14 @@
 
             //int length = ntohs(blastHeader->packetSize);
 
-            if (blastHeader->ACK == HEARTBEAT) {
+            if ((blastHeader->ACK & MASK) == HEARTBEAT) {
               // heartbeat
               fprintf ( context->log_file,
                         "%d\t%i\t\tblastHeartbeat",
                         ntohs(context->remote.sin_port),
                         0); // in blast mode, no packet from tun is sent in a heartbeat
             }
-            else if (blastHeader->ACK == THISISANACK) {
+            else if ((blastHeader->ACK & MASK) == THISISANACK) {
               // ACK
               fprintf ( context->log_file,
                         "%d\t%i\t\tblastACK\t%"PRIu16"",
@@ -202,10 +202,18 @@
                         0, // in blast mode, no packet from tun is sent in an ACK
                         htons(blastHeader->identifier));
             }
+            else if ((blastHeader->ACK & MASK) == SELECTIVEACK) {
+              // selective ACK: the identifier is the first one acknowledged
+              fprintf ( context->log_file,
+                        "%d\t%i\t\tblastSACK\t%"PRIu16"",
+                        ntohs(context->remote.sin_port),
+                        0, // in blast mode, no packet from tun is sent in an ACK
+                        htons(blastHeader->identifier));
+            }
             else {
               // blast packet
               #ifdef ASSERT
-                assert(blastHeader->ACK == ACKNEEDED);
+                assert((blastHeader->ACK & MASK) == ACKNEEDED);
               #endif
               fprintf ( context->log_file,
                         "%d\t%i\t\tblastPacket\t%"PRIu16"",
@@ -263,14 +271,14 @@
             // apply the structure of a blast mode packet
             simplemuxBlastHeader* blastHeader = (simplemuxBlastHeader*) (buffer_from_net);
 
-            if (blastHeader->ACK == HEARTBEAT) {
+            if ((blastHeader->ACK & MASK) == HEARTBEAT) {
               // heartbeat
               fprintf ( context->log_file,
                         "\t%i\t\tblastHeartbeat",
                         //ntohs(context->remote.sin_port),
                         0); // in blast mode, no packet from tun is sent in a heartbeat
             }
-            else if (blastHeader->ACK == THISISANACK) {
+            else if ((blastHeader->ACK & MASK) == THISISANACK) {
               // ACK
               fprintf ( context->log_file,
                         "\t%i\t\tblastACK\t%"PRIu16"",
@@ -278,10 +286,18 @@
                         0, // in blast mode, no packet from tun is sent in an ACK
                         htons(blastHeader->identifier));
             }
+            else if ((blastHeader->ACK & MASK) == SELECTIVEACK) {
+              // selective ACK: the identifier is the first one acknowledged
+              fprintf ( context->log_file,
+                        "\t%i\t\tblastSACK\t%"PRIu16"",
+                        //ntohs(context->remote.sin_port),
+                        0, // in blast mode, no packet from tun is sent in an ACK
+                        htons(blastHeader->identifier));
+            }
             else {
               // blast packet
               #ifdef ASSERT
-                assert(blastHeader->ACK == ACKNEEDED);
+                assert((blastHeader->ACK & MASK) == ACKNEEDED);
               #endif
               fprintf ( context->log_file,
                         "\t%i\t\tblastPacket\t%"PRIu16"",
@@ -321,6 +337,47 @@ void demuxPacketBlast(contextSimplemux* context,
       #endif
     }
 
+    // piggyback ('-y' option): the packet also works as a heartbeat, and it
+    //may carry a selective ACK between the header and the payload
+    int payloadOffset = sizeof(simplemuxBlastHeader);
+
+    if(blastHeader->ACK & PIGGYBACKHEARTBEAT)
+      context->lastBlastHeartBeatReceived = GetTimeStamp();
+
+    if(blastHeader->ACK & PIGGYBACKACK) {
+      simplemuxBlastPiggyback* piggyback = (simplemuxBlastPiggyback*) (&buffer_from_net[payloadOffset]);
+
+      if(piggyback->bitmapLength > BLAST_SACK_BITMAP_SIZE) {
+        perror("Problem with the length of the selective ACK of the received blast packet\n");
+        return;
+      }
+
+      int removed = processSelectiveAck(&context->unconfirmedPacketsBlast,
+                                        ntohs(piggyback->ackBase),
+                                        &buffer_from_net[payloadOffset + sizeof(simplemuxBlastPiggyback)],
+                                        piggyback->bitmapLength,
+                                        GetTimeStamp());
+
+      context->blastAcksReceived++;
+      context->blastPacketsAcked = context->blastPacketsAcked + removed;
+
+      #ifdef DEBUG
+        do_debug_c( 1,
+                    ANSI_COLOR_BOLD_GREEN,
+                    " It carries a blast selective ACK. First ID ");
+        do_debug_c( 1,
+                    ANSI_COLOR_RESET,
+                    "%i",
+                    ntohs(piggyback->ackBase));
+        do_debug_c( 1,
+                    ANSI_COLOR_BOLD_GREEN,
+                    ", %i packets removed from the confirmation-pending list\n",
+                    removed);
+      #endif
+
+      payloadOffset = payloadOffset + sizeof(simplemuxBlastPiggyback) + piggyback->bitmapLength;
+    }
+
     // check if this is an ACK or not
     if((blastHeader->ACK & MASK ) == THISISANACK) {
       if(packetLength!=0) {
@@ -369,7 +426,9 @@ void demuxPacketBlast(contextSimplemux* context,
             printList(&context->unconfirmedPacketsBlast);
         #endif
 
-        if(delete(&context->unconfirmedPacketsBlast,ntohs(blastHeader->identifier))==false) {
+        context->blastAcksReceived++;
+
+        if(acknowledgeBlastPacket(&context->unconfirmedPacketsBlast, ntohs(blastHeader->identifier), GetTimeStamp())==false) {
           #ifdef DEBUG
             do_debug_c( 2,
                         ANSI_COLOR_BOLD_GREEN,
@@ -377,6 +436,7 @@ void demuxPacketBlast(contextSimplemux* context,
           #endif
         }
         else {
+          context->blastPacketsAcked++;
           #ifdef DEBUG
             if (context->tunnelMode == TUN_MODE) {
               do_debug_c( 2,
@@ -418,6 +478,59 @@ void demuxPacketBlast(contextSimplemux* context,
         #endif
       }
     }
+    else if((blastHeader->ACK & MASK ) == SELECTIVEACK) {
+      // selective ACK: it acknowledges the identifier of the header, and the
+      //ones marked in the bitmap (its payload)
+      if(packetLength > BLAST_SACK_BITMAP_SIZE) {
+        perror("Problem with the length of the received blast selective ACK\n");
+        #ifdef DEBUG
+          do_debug_c( 1,
+                      ANSI_COLOR_RED,
+                      "Received wrong blast selective ACK: Its bitmap has %i bytes, but the maximum is %i\n",
+                      packetLength,
+                      BLAST_SACK_BITMAP_SIZE);
+        #endif
+      }
+      else {
+        // all the acknowledged packets are removed from the window in a single pass
+        int removed = processSelectiveAck(&context->unconfirmedPacketsBlast,
+                                          ntohs(blastHeader->identifier),
+                                          &buffer_from_net[payloadOffset],
+                                          packetLength,
+                                          GetTimeStamp());
+
+        context->blastAcksReceived++;
+        context->blastPacketsAcked = context->blastPacketsAcked + removed;
+
+        #ifdef DEBUG
+          do_debug_c( 1,
+                      ANSI_COLOR_BOLD_GREEN,
+                      " It is a blast selective ACK. First ID ");
+          do_debug_c( 1,
+                      ANSI_COLOR_RESET,
+                      "%i",
+                      ntohs(blastHeader->identifier));
+          do_debug_c( 1,
+                      ANSI_COLOR_BOLD_GREEN,
+                      ", bitmap of %i bytes. %i packets removed from the confirmation-pending list. Total ",
+                      packetLength,
+                      removed);
+          do_debug_c( 1,
+                      ANSI_COLOR_RESET,
+                      "%i",
+                      length(&context->unconfirmedPacketsBlast));
+          do_debug_c( 1,
+                      ANSI_COLOR_BOLD_GREEN,
+                      " stored\n");
+        #endif
+      }
+    }
+    else if(((blastHeader->ACK & MASK ) == ACKNEEDED) && (blastHeader->protocolID == IPPROTO_BLAST_FEC)) {
+      // parity packet ('-F' option): it is not delivered nor acknowledged. It is
+      //only used for rebuilding the lost packets of its block
+      if (context->fecDecoder != NULL)
+        processFecParity(context, blastHeader, &buffer_from_net[payloadOffset], packetLength);
+    }
     else if((blastHeader->ACK & MASK ) == ACKNEEDED) {
       #ifdef DEBUG
         do_debug_c( 1,
@@ -487,45 +600,37 @@ void demuxPacketBlast(contextSimplemux* context,
 
       uint64_t now = GetTimeStamp();
 
-      if(context->blastTimestamps[ntohs(blastHeader->identifier)] == 0) {
+      if(isDuplicateBlast(&context->deliveredBlast, ntohs(blastHeader->identifier), now) == false) {
         deliverThisPacket=true;
       }
       else {
-
-        if (now - context->blastTimestamps[ntohs(blastHeader->identifier)] < TIME_UNTIL_SENDING_AGAIN_BLAST) {
-          // a blast packet with this same ID has been sent recently
-          // do not send it again
-          #ifdef DEBUG
-            do_debug_c( 1,
-                        ANSI_COLOR_YELLOW,
-                        " The packet with ID ");
-            do_debug_c( 1,
-                        ANSI_COLOR_RESET,
-                        "%i",
-                        ntohs(blastHeader->identifier));
-            do_debug_c( 1,
-                        ANSI_COLOR_YELLOW,
-                        " has been sent recently to ",
-                        ntohs(blastHeader->identifier));
-            do_debug_c( 1,
-                        ANSI_COLOR_RESET,
-                        "%s",
-                        context->tun_if_name);
-            do_debug_c( 1,
-                        ANSI_COLOR_YELLOW,
-                        ". Do not send another copy\n");
-            do_debug_c( 3,
-                        ANSI_COLOR_YELLOW,
-                        "  now (%"PRIu64") - blastTimestamps[%i] (%"PRIu64") < %"PRIu64"\n\n",
-                        now,
-                        ntohs(blastHeader->identifier),
-                        context->blastTimestamps[ntohs(blastHeader->identifier)],
-                        TIME_UNTIL_SENDING_AGAIN_BLAST);
-          #endif
-        }
-        else {
-          deliverThisPacket=true;
-        }
+        // a blast packet with this same ID has been sent recently
+        // do not send it again
+        #ifdef DEBUG
+          do_debug_c( 1,
+                      ANSI_COLOR_YELLOW,
+                      " The packet with ID ");
+          do_debug_c( 1,
+                      ANSI_COLOR_RESET,
+                      "%i",
+                      ntohs(blastHeader->identifier));
+          do_debug_c( 1,
+                      ANSI_COLOR_YELLOW,
+                      " has been sent recently to ",
+                      ntohs(blastHeader->identifier));
+          do_debug_c( 1,
+                      ANSI_COLOR_RESET,
+                      "%s",
+                      context->tun_if_name);
+          do_debug_c( 1,
+                      ANSI_COLOR_YELLOW,
+                      ". Do not send another copy\n");
+          do_debug_c( 3,
+                      ANSI_COLOR_YELLOW,
+                      "  It was delivered less than %"PRIu64" us ago (highest ID delivered: %i)\n\n",
+                      TIME_UNTIL_SENDING_AGAIN_BLAST,
+                      context->deliveredBlast.highest);
+        #endif
       }
 
       if(deliverThisPacket) {
@@ -554,7 +659,7 @@ void demuxPacketBlast(contextSimplemux* context,
                         ANSI_COLOR_YELLOW,
                         ":\n");
 
-            dump_packet (packetLength, &buffer_from_net[sizeof(simplemuxBlastHeader)]);                    
+            dump_packet (packetLength, &buffer_from_net[payloadOffset]);                    
           }
           else {
             do_debug_c( 2,
@@ -591,9 +696,9 @@ void demuxPacketBlast(contextSimplemux* context,
                         "\n");
           #endif
 
-          if (cwrite (context->tun_fd,
-                      &buffer_from_net[sizeof(simplemuxBlastHeader)],
-                      packetLength ) != packetLength)
+          if (writeToTun (context,
+                          &buffer_from_net[payloadOffset],
+                          packetLength ) != packetLength)
           {
             perror("could not write the packet correctly (tun mode, blast)");
           }
@@ -636,7 +741,7 @@ void demuxPacketBlast(contextSimplemux* context,
 
           // update the timestamp when a packet with this identifier has been sent
           uint64_t now = GetTimeStamp();
-          context->blastTimestamps[ntohs(blastHeader->identifier)] = now;
+          recordBlastDelivery(&context->deliveredBlast, ntohs(blastHeader->identifier), now);
         }
         // tap mode
         else if(context->tunnelMode == TAP_MODE) {
@@ -671,9 +776,9 @@ void demuxPacketBlast(contextSimplemux* context,
                           "\n");
             #endif
 
-            if(cwrite ( context->tun_fd,
-                        &buffer_from_net[sizeof(simplemuxBlastHeader)],
-                        packetLength ) != packetLength)
+            if(writeToTun (context,
+                           &buffer_from_net[payloadOffset],
+                           packetLength ) != packetLength)
             {
               perror("could not write the frame correctly (tap mode, blast)");
             }
@@ -716,7 +821,7 @@ void demuxPacketBlast(contextSimplemux* context,
 
             // update the timestamp when a packet with this identifier has been sent
             uint64_t now = GetTimeStamp();
-            context->blastTimestamps[ntohs(blastHeader->identifier)] = now;
+            recordBlastDelivery(&context->deliveredBlast, ntohs(blastHeader->identifier), now);
           }
         }
         else {
@@ -725,60 +830,72 @@ void demuxPacketBlast(contextSimplemux* context,
         }
       }
 
+      // FEC: keep the packet, as it may be needed for rebuilding a lost one
+      if (deliverThisPacket && (context->fecDecoder != NULL))
+        storeFecData(context, blastHeader, &buffer_from_net[payloadOffset]);
+
       // this packet requires an ACK
-      // send the ACK as soon as the packet arrives
-      // send an ACK per arrived packet. Do not check if this is the first time it has arrived
-      struct storedPacketBlast ACK;
-      ACK.header.packetSize = 0; // the length is only that of the payload 
-      ACK.header.protocolID = 0; // the ACK does not have a payload, so no protocolID is needed
-      ACK.header.identifier = blastHeader->identifier;
-      ACK.header.ACK = THISISANACK;
+      if (context->blastAckEvery > 0) {
+        // selective ACKs: the identifier is added to the next ACK
+        addPendingAck(context, ntohs(blastHeader->identifier), now);
+      }
+      else {
+        // send the ACK as soon as the packet arrives
+        // send an ACK per arrived packet. Do not check if this is the first time it has arrived
+        struct storedPacketBlast ACK;
+        ACK.header.packetSize = 0; // the length is only that of the payload 
+        ACK.header.protocolID = 0; // the ACK does not have a payload, so no protocolID is needed
+        ACK.header.identifier = blastHeader->identifier;
+        ACK.header.ACK = THISISANACK;
 
-      sendPacketBlastFlavor(context, &ACK);
+        sendPacketBlastFlavor(context, &ACK);
 
-      #ifdef DEBUG
-        do_debug_c( 1,
-                    ANSI_COLOR_BOLD_GREEN,
-                    " Sent blast ACK to the network. ID ");
-        do_debug_c( 1,
-                    ANSI_COLOR_RESET,
-                    "%i",
-                    ntohs(ACK.header.identifier));
-        do_debug_c( 1,
-                    ANSI_COLOR_BOLD_GREEN,
-                    ", packetLength ");
-        do_debug_c( 1,
-                    ANSI_COLOR_RESET,
-                    "%i",
-                    sizeof(blastHeader));
-        do_debug_c( 1,
-                    ANSI_COLOR_BOLD_GREEN,
-                    " (Blast header) plus ");
-        if (context->mode==UDP_MODE) {
+        #ifdef DEBUG
+          do_debug_c( 1,
+                      ANSI_COLOR_BOLD_GREEN,
+                      " Sent blast ACK to the network. ID ");
           do_debug_c( 1,
                       ANSI_COLOR_RESET,
                       "%i",
-                      UDP_HEADER_SIZE + IPv4_HEADER_SIZE);
-        }
-        else {
-          #ifdef ASSERT
-            assert (context->mode==NETWORK_MODE);
-          #endif
+                      ntohs(ACK.header.identifier));
+          do_debug_c( 1,
+                      ANSI_COLOR_BOLD_GREEN,
+                      ", packetLength ");
           do_debug_c( 1,
                       ANSI_COLOR_RESET,
                       "%i",
-                      IPv4_HEADER_SIZE);
-        }
-        do_debug_c( 1,
-                    ANSI_COLOR_BOLD_GREEN,
-                    " (tunneling header) bytes\n");
+                      sizeof(blastHeader));
+          do_debug_c( 1,
+                      ANSI_COLOR_BOLD_GREEN,
+                      " (Blast header) plus ");
+          if (context->mode==UDP_MODE) {
+            do_debug_c( 1,
+                        ANSI_COLOR_RESET,
+                        "%i",
+                        UDP_HEADER_SIZE + IPv4_HEADER_SIZE);
+          }
+          else {
+            #ifdef ASSERT
+              assert (context->mode==NETWORK_MODE);
+            #endif
+            do_debug_c( 1,
+                        ANSI_COLOR_RESET,
+                        "%i",
+                        IPv4_HEADER_SIZE);
+          }
+          do_debug_c( 1,
+                      ANSI_COLOR_BOLD_GREEN,
+                      " (tunneling header) bytes\n");
 
-        do_debug_c( 2,
-                    ANSI_COLOR_BOLD_GREEN,
-                    "\n");
-      #endif
+          do_debug_c( 2,
+                      ANSI_COLOR_BOLD_GREEN,
+                      "\n");
+        #endif
+
+        context->blastAcksSent++;
 
-      // no need to add log here because 'sendPacketBlastFlavor()' already does it
+        // no need to add log here because 'sendPacketBlastFlavor()' already does it
+      }
     }
     else if((blastHeader->ACK & MASK ) == HEARTBEAT) {
       // heartbeat received
@@ -1338,9 +1455,9 @@ void sendPacketToTun (contextSimplemux* context,
                   "\n");
     #endif
 
-    if (cwrite (context->tun_fd,
-                demuxed_packet,
-                demuxedPacketLength ) != demuxedPacketLength)
+    if (writeToTun (context,
+                    demuxed_packet,
+                    demuxedPacketLength ) != demuxedPacketLength)
     {
       perror("could not write the demuxed packet correctly (tun mode)");
     }
@@ -1378,9 +1495,9 @@ void sendPacketToTun (contextSimplemux* context,
                     "\n");
       #endif
 
-      if (cwrite (context->tun_fd,
-                  demuxed_packet,
-                  demuxedPacketLength ) != demuxedPacketLength)
+      if (writeToTun (context,
+                      demuxed_packet,
+                      demuxedPacketLength ) != demuxedPacketLength)
       {
         perror("could not write the demuxed packet correctly (tap mode)");
       }
@@ -1420,9 +1537,13 @@ void sendPacketToTun (contextSimplemux* context,
 //the length of the demuxed (RoHC-compressed) packet. At the end,
 //it contains the length of the decompressed packet
 //
+// demuxed_packet is also modified: at the beginning, it points to the
+//RoHC-compressed packet (inside the buffer where the bundle was received).
+//At the end, it points to the decompressed packet (inside 'ip_packet_d')
+//
 // RoHC variables are global, so I don't need to pass them as arguments
 int decompressRohcPacket( contextSimplemux* context,
-                          uint8_t* demuxed_packet,
+                          uint8_t** demuxed_packet,
                           int* demuxedPacketLength,
                           rohc_status_t* status,
                           int nread_from_net)
@@ -1453,30 +1574,26 @@ int decompressRohcPacket( contextSimplemux* context,
     #endif
   }
   else {
-    // reset the buffers where the rohc packets, ip packets and feedback info are to be stored
+    // reset the buffers where the ip packets and feedback info are to be stored
     rohc_buf_reset (&ip_packet_d);
-    rohc_buf_reset (&rohc_packet_d);
     rohc_buf_reset (&rcvd_feedback);
     rohc_buf_reset (&feedback_send);
 
-    // Copy the compressed length and the compressed packet
-    rohc_packet_d.len = *demuxedPacketLength;
-
-    // Copy the packet itself
-    for (int l = 0; l < *demuxedPacketLength ; l++) {
-      rohc_buf_byte_at(rohc_packet_d, l) = demuxed_packet[l];
-    }
-    // I try to use memcpy instead, but it does not work properly
-    // memcpy(demuxed_packet, rohc_buf_data_at(rohc_packet_d, 0), demuxedPacketLength);
+    // the decompressor reads the compressed packet where it is, i.e. in the
+    //buffer where the bundle was received. It is not copied to 'rohc_packet_d'
+    const struct rohc_ts arrival_time = { .sec = 0, .nsec = 0 };
+    struct rohc_buf compressed_packet = rohc_buf_init_full( *demuxed_packet,
+                                                            *demuxedPacketLength,
+                                                            arrival_time);
 
     #ifdef DEBUG
       // dump the ROHC packet on terminal
-      dump_packet (*demuxedPacketLength, demuxed_packet);
+      dump_packet (*demuxedPacketLength, *demuxed_packet);
     #endif
 
     // decompress the packet
     *status = rohc_decompress3( decompressor,
-                                rohc_packet_d,
+                                compressed_packet,
                                 &ip_packet_d,
                                 &rcvd_feedback,
                                 &feedback_send);
@@ -1621,13 +1738,8 @@ int decompressRohcPacket( contextSimplemux* context,
         // ip_packet.len bytes of decompressed IP data available in ip_packet
         *demuxedPacketLength = ip_packet_d.len;
 
-        #ifdef ASSERT
-          // ensure that there is space to copy the packet
-          assert(*demuxedPacketLength <= BUFSIZE);
-        #endif
-
-        // copy the packet
-        memcpy(demuxed_packet, rohc_buf_data_at(ip_packet_d, 0), *demuxedPacketLength);
+        // the packet is not copied: the caller writes it to tun/tap from 'ip_packet_d'
+        *demuxed_packet = rohc_buf_data_at(ip_packet_d, 0);
 
         #ifdef DEBUG
           //dump the IP packet on the standard output
@@ -3,6 +3,7 @@
 #define NETTOTUNUTILITIES_H
 
 #include "blastPackets.h"
+#include "blastFec.h"
 
 #ifdef DEBUG
   void showDebugInfoFromNet(contextSimplemux* context,
@@ -40,7 +41,7 @@ void sendPacketToTun (contextSimplemux* context,
 
 #ifdef USINGROHC
   int decompressRohcPacket( contextSimplemux* context,
-                            uint8_t* demuxed_packet,
+                            uint8_t** demuxed_packet,
                             int* demuxedPacketLength,
                             rohc_status_t* status,
                             int nread_from_net);
@@ -4,7 +4,7 @@ void periodExpiredblastFlavor (contextSimplemux* context)
 {
   // blast flavor
   #ifdef ASSERT
-    assert(context->flavor == 'B');
+    assert((context->flavor == 'B') || (context->numFlowRules > 0));
   #endif
 
   // I may be here because of two different causes (both may have been accomplished):
@@ -13,8 +13,9 @@ void periodExpiredblastFlavor (contextSimplemux* context)
 
   uint64_t now_microsec = GetTimeStamp();
 
-  // - period expired
-  if(now_microsec - context->timeLastSent > context->period) {
+  // - period expired: the retransmission of at least one packet is due
+  uint64_t nextRetransmission = findNextRetransmission(&context->unconfirmedPacketsBlast);
+  if((nextRetransmission != 0) && (nextRetransmission <= now_microsec)) {
     if(now_microsec - context->lastBlastHeartBeatReceived > HEARTBEATDEADLINE) {
       // heartbeat from the other side not received recently
       //so it seems there are problems at the other side
@@ -78,6 +79,7 @@ void periodExpiredblastFlavor (contextSimplemux* context)
     heartBeat.header.ACK = HEARTBEAT;
 
     sendPacketBlastFlavor(context, &heartBeat);
+    context->blastHeartbeatsSent++;
 
     #ifdef DEBUG
       do_debug_c( 1,
@@ -478,11 +480,9 @@ void periodExpiredNoblastFlavor (contextSimplemux* context)
 
   // build the multiplexed packet
   uint16_t total_length;          // total length of the built multiplexed packet
-  uint8_t muxed_packet[BUFSIZE];  // stores the multiplexed packet
 
   total_length = buildMultiplexedPacket ( context,
-                                          single_protocol,
-                                          muxed_packet);
+                                          single_protocol);
 
   #ifdef DEBUG
     do_debug( 2,"\n");
@@ -491,28 +491,9 @@ void periodExpiredNoblastFlavor (contextSimplemux* context)
   // send the multiplexed packet
   switch (context->mode) {
     
-    case NETWORK_MODE: ;
-      // build the header
-      struct iphdr ipheader;
-      BuildIPHeader(&ipheader,
-                    total_length,
-                    context->ipprotocol,
-                    context->local,
-                    context->remote);
-
-      // build the full IP multiplexed packet
-      uint8_t full_ip_packet[BUFSIZE];
-      BuildFullIPPacket(ipheader,
-                        muxed_packet,
-                        total_length,
-                        full_ip_packet);
-
-      // send the packet
-      if (sendto (context->network_mode_fd,
-                  full_ip_packet, total_length + sizeof(struct iphdr),
-                  0,
-                  (struct sockaddr *) &(context->remote),
-                  sizeof (struct sockaddr)) < 0)
+    case NETWORK_MODE:
+      // send the packet, preceded by the prebuilt IP header
+      if (sendBundle(context, total_length) < 0)
       {
         perror ("sendto() failed ");
         exit (EXIT_FAILURE);
@@ -534,12 +515,7 @@ void periodExpiredNoblastFlavor (contextSimplemux* context)
     
     case UDP_MODE:
       // send the packet. I don't need to build the header, because I have a UDP socket  
-      if (sendto( context->udp_mode_fd,
-                  muxed_packet,
-                  total_length,
-                  0,
-                  (struct sockaddr *)&(context->remote),
-                  sizeof(context->remote))==-1)
+      if (sendBundle(context, total_length)==-1)
       {
         perror("sendto()");
         exit (EXIT_FAILURE);
@@ -563,9 +539,7 @@ void periodExpiredNoblastFlavor (contextSimplemux* context)
       // send the packet. I don't need to build the header, because I have a TCP socket
 
       // FIXME: This said 'tcp_welcoming_fd', but I think it was a bug            
-      if (write(context->tcp_server_fd,
-                muxed_packet,
-                total_length)==-1)
+      if (sendBundle(context, total_length)==-1)
       {
         perror("write() in TCP server mode failed");
         exit (EXIT_FAILURE);  
@@ -587,9 +561,7 @@ void periodExpiredNoblastFlavor (contextSimplemux* context)
 
     case TCP_CLIENT_MODE:
       // send the packet. I don't need to build the header, because I have a TCP socket  
-      if (write(context->tcp_client_fd,
-                muxed_packet,
-                total_length)==-1)
+      if (sendBundle(context, total_length)==-1)
       {
         perror("write() in TCP client mode failed");
         exit (EXIT_FAILURE);  
@@ -86,7 +86,7 @@ static bool rtp_detect( const uint8_t *const ip __attribute__((unused)),
 
 
 // initialize RoHC header compression
-// declared as 'static' because it is only used by 'main()'
+// declared as 'static' because it is only used by 'mainLoop()'
 static int initRohc(contextSimplemux* context)
 {
   // present some debug info
@@ -124,6 +124,7 @@ static int initRohc(contextSimplemux* context)
       return 1;*/
       goto error;
     }
+    context->rohcCompressor = compressor;
     
     #ifdef DEBUG
       do_debug_c(1, ANSI_COLOR_RESET, "RoHC compressor created. Profiles: ");
@@ -348,6 +349,742 @@ static int initRohc(contextSimplemux* context)
 }
 #endif
 
+// it is set when the SIGUSR1 signal arrives, and the statistics are printed in the main loop
+// it is thread-local ('__thread'): in multi-queue mode, each queue prints the
+//statistics of its own context in its own thread, so no thread reads the context
+//(or the RoHC compressor) of another one
+// declared as 'static' because it is only used in this .c file
+static __thread volatile sig_atomic_t statisticsRequested = 0;
+
+static void statisticsSignalHandler(int signum __attribute__((unused)))
+{
+  statisticsRequested = 1;
+}
+
+
+// threads of queues 1 to N-1 in multi-queue mode
+// they block SIGUSR1, so it always arrives to queue 0 (the thread of 'main()'),
+//which passes the request to each of them with SIGUSR2
+// declared as 'static' because it is only used in this .c file
+static pthread_t queueThreads[MAXQUEUES];
+
+
+// main loop of Simplemux: it waits for packets from tun/tap and from the network,
+//and for the expiration of the period
+// in multi-queue mode ('-q'), each queue runs its own copy of the loop in a thread, with its own context
+// declared as 'static' because it is only used in this .c file
+static void mainLoop(contextSimplemux* context)
+{
+  /** prepare the POLL structure **/
+  // it has size 3 (NUMBER_OF_SOCKETS), because it handles 3 sockets
+  // - tun/tap socket where demuxed packets are sent/received
+  // - feedback socket
+  // - socket where muxed packets are sent/received. It can be:
+  //      - Network mode: IP raw socket
+  //      - UDP mode: UDP socket
+  //      - TCP server mode
+  //      - TCP client mode
+  struct pollfd* fds_poll = malloc(NUMBER_OF_SOCKETS * sizeof(struct pollfd));
+  memset(fds_poll, 0, NUMBER_OF_SOCKETS * sizeof(struct pollfd));
+
+  fds_poll[0].fd = context->tun_fd;
+  fds_poll[0].events = POLLIN;
+
+  if ( context->mode== NETWORK_MODE )
+    fds_poll[1].fd = context->network_mode_fd;
+  else if ( context->mode== UDP_MODE )
+    fds_poll[1].fd = context->udp_mode_fd;
+  else if ( context->mode==TCP_SERVER_MODE )
+    fds_poll[1].fd = context->tcp_welcoming_fd;
+  else
+    fds_poll[1].fd = context->tcp_client_fd;
+  fds_poll[1].events = POLLIN;
+
+  #ifdef USINGROHC
+    fds_poll[2].fd = context->feedback_fd;
+    fds_poll[2].events = POLLIN;
+  #endif
+  
+  #ifdef USINGROHC
+    // the RoHC buffers are thread-local, so each queue has to initialize them
+    initRohcBuffers();
+
+    // If ROHC has been selected, it has to be initialized
+    // see the API here: https://rohc-lib.org/support/documentation/API/rohc-doc-1.7.0/
+    // in multi-queue mode, each queue has its own compressor and decompressor
+    initRohc(context);
+  #endif
+
+  // reserve the memory for batched UDP I/O (if enabled)
+  initBatchIO(context);
+
+  // prepare the pieces of the multiplexed packets (and the outer IP header in network mode)
+  initBundleIovecs(context);
+
+  // reserve the buffer where the TCP stream is parsed (TCP modes)
+  if ((context->mode == TCP_SERVER_MODE) || (context->mode == TCP_CLIENT_MODE)) {
+    initTcpStream(context);
+    initTcpSendQueue(context);
+  }
+
+  // the kernel may delay the expiration of each timeout by the 'timer slack' of the
+  //thread (50 us by default). Reduce it, so short periods expire on time
+  prctl(PR_SET_TIMERSLACK, 1UL);
+
+  // set the current moment as the moment of the last sending
+  context->timeLastSent = GetTimeStamp();  
+
+  // the throughput is calculated from this moment
+  context->udpStartTime = context->timeLastSent;
+    
+  // initializations for blast flavor (also used by the hybrid flavor)
+  if((context->flavor == 'B') || (context->numFlowRules > 0))
+    initBlastFlavor(context);
+
+  #ifdef USINGIOURING
+    // start the io_uring engine if requested. If it is not available, poll() is used
+    if (context->ioUringRequested) {
+      if (initIoUring(context) == 0)
+        my_err("io_uring is not available. Using poll()\n");
+    }
+  #endif
+
+  uint64_t now_microsec; // variable to store timestamps
+
+  /*****************************************/
+  /************** Main loop ****************/
+  /*****************************************/
+  while(1) {
+  
+    // Initialize the timeout data structure
+    // in hybrid flavor ('-C'), both the blast timers and the period are used
+    if((context->flavor == 'B') || (context->numFlowRules > 0)) {
+      // blast flavor
+      // the moment of the next retransmission is at the top of the heap
+      uint64_t nextRetransmission = findNextRetransmission(&context->unconfirmedPacketsBlast);
+
+      #ifdef DEBUG
+        if(debug > 2)
+          printList(&context->unconfirmedPacketsBlast);
+      #endif
+
+      now_microsec = GetTimeStamp();
+
+      // pacing: a due retransmission may have to wait for a token
+      if ((nextRetransmission != 0) && (context->blastPacingRate > 0)) {
+        uint64_t ready = blastPacingReadyTime(context, now_microsec);
+        if (ready > nextRetransmission)
+          nextRetransmission = ready;
+      }
+
+      if (nextRetransmission == 0) {
+        nextRetransmission = now_microsec + context->period;
+        #ifdef DEBUG
+          do_debug_c( 3,
+                      ANSI_COLOR_YELLOW,
+                      "%"PRIu64" No blast packet is waiting to be sent to the network\n",
+                      now_microsec);
+        #endif
+      }
+
+      if(nextRetransmission > now_microsec) {
+        context->microsecondsLeft = nextRetransmission - now_microsec;
+        #ifdef DEBUG
+          do_debug_c( 3,
+                      ANSI_COLOR_YELLOW,
+                      "%"PRIu64" The next blast packet will be sent in %"PRIu64" us\n",
+                      now_microsec,
+                      context->microsecondsLeft);
+        #endif      
+      }
+      else {
+        // the period is already expired
+        #ifdef DEBUG
+          do_debug_c( 3,
+                      ANSI_COLOR_YELLOW,
+                      "%"PRIu64" Call the poll with limit 0\n",
+                      now_microsec);
+        #endif
+        context->microsecondsLeft = 0;
+      }
+
+      // in blast flavor, heartbeats have to be sent periodically
+      // if the time to the next heartbeat is smaller than the time to the next sending of a blast packet,
+      //then the time has to be reduced
+      uint64_t microsecondsToNextHeartBeat = context->lastBlastHeartBeatSent + HEARTBEATPERIOD - now_microsec;
+
+      // choose the smallest one
+      if(microsecondsToNextHeartBeat < context->microsecondsLeft)
+        context->microsecondsLeft = microsecondsToNextHeartBeat;
+
+      // selective ACKs: the pending identifiers are acknowledged when the
+      //delayed-ACK timer expires
+      if(context->pendingAckCount > 0) {
+        if(context->pendingAckDeadline <= now_microsec)
+          sendPendingAcks(context);
+        else if(context->pendingAckDeadline - now_microsec < context->microsecondsLeft)
+          context->microsecondsLeft = context->pendingAckDeadline - now_microsec;
+      }
+    }
+
+    if(context->flavor != 'B') {
+      // not in blast flavor
+      now_microsec = GetTimeStamp();
+
+      uint64_t microsecondsLeft;
+      if ( context->period > (now_microsec - context->timeLastSent)) {
+        // the period is not expired
+        microsecondsLeft = (context->period - (now_microsec - context->timeLastSent));
+      }
+      else {
+        // the period is expired
+        microsecondsLeft = 0;
+      }        
+
+      // hybrid flavor: a blast timer may expire before the period
+      if ((context->numFlowRules == 0) || (microsecondsLeft < context->microsecondsLeft))
+        context->microsecondsLeft = microsecondsLeft;
+
+      #ifdef DEBUG
+        do_debug_c( 3,
+                    ANSI_COLOR_YELLOW,
+                    "Time last sending: %"PRIu64" us\n",
+                    context->timeLastSent);
+        do_debug_c( 3,
+                    ANSI_COLOR_YELLOW,
+                    "The next packet will be sent in %"PRIu64" us\n",
+                    context->microsecondsLeft);
+      #endif
+    }
+
+    // moment when the period (or the next blast retransmission) expires
+    uint64_t deadline = now_microsec + context->microsecondsLeft;
+
+    // the TCP socket is only polled for writing if there are bundles waiting in the send queue
+    if ((context->mode == TCP_SERVER_MODE) || (context->mode == TCP_CLIENT_MODE)) {
+      if (context->tcpQueueCount > 0)
+        fds_poll[1].events = POLLIN | POLLOUT;
+      else
+        fds_poll[1].events = POLLIN;
+    }
+
+    int fd2read;
+
+    #ifdef USINGIOURING
+    if (context->ioUring != NULL) {
+      /** IO_URING **/
+      // the engine waits (at most 'microsecondsLeft') and processes the packets
+      //read from tun/tap and from the network, so they are not reported in 'fds_poll'.
+      // It returns 0 if the timeout has expired
+      fd2read = ioUringWait(context, fds_poll, context->microsecondsLeft);
+    }
+    else
+    #endif
+    {
+      // ppoll() uses a timeout in nanoseconds, so periods below 1 ms are not rounded
+      //(poll() only accepts milliseconds)
+      struct timespec timeout;
+      timeout.tv_sec = context->microsecondsLeft / 1000000;
+      timeout.tv_nsec = (context->microsecondsLeft % 1000000) * 1000;
+
+      /** POLL **/
+      // check if a frame has arrived to any of the file descriptors
+      // - the first argument is the pollfd struct
+      // - the second argument is '3', i.e. the number of sockets NUMBER_OF_SOCKETS
+      // - third argument: the maximum time that ppoll() should block waiting
+      //   for a file descriptor to become ready
+      // - fourth argument: the signal mask is not modified
+      fd2read = ppoll(fds_poll, NUMBER_OF_SOCKETS, &timeout, NULL);
+    }
+
+    /********************************/
+    /**** Error in poll function ****/
+    /********************************/
+    if(fd2read < 0) {
+      if(fd2read == -1 || errno != EINTR ) {
+
+      }
+      else {
+        perror("Error in poll function");
+        return;
+      }
+    }
+
+    /*******************************************/
+    /**** A frame has arrived to one socket ****/
+    /*******************************************/
+    // a frame has arrived to one of the sockets in 'fds_poll'
+    else if (fd2read > 0) {
+
+      // the TCP socket accepts more bytes: write the bundles waiting in the send queue
+      if ((fds_poll[1].revents & POLLOUT) && (context->tcpQueueCount > 0))
+        flushTcpSendQueue(context);
+
+      /******************************************************************/
+      /*************** TCP connection request from a client *************/
+      /******************************************************************/
+      // a connection request has arrived to the welcoming socket
+      if ((fds_poll[1].revents & POLLIN) &&
+          (context->mode==TCP_SERVER_MODE) &&
+          (context->acceptingTcpConnections == true) )
+      {
+
+        // accept the connection
+        struct sockaddr_in TCPpair;
+        unsigned int len = sizeof(struct sockaddr);
+        context->tcp_server_fd = accept(context->tcp_welcoming_fd, (struct sockaddr*)&TCPpair, &len);
+        
+        if ( DISABLE_NAGLE == 1 ) {
+          // disable NAGLE algorigthm, see https://holmeshe.me/network-essentials-setsockopt-TCP_NODELAY/
+          int flags =1;
+          setsockopt(context->tcp_client_fd, IPPROTO_TCP, TCP_NODELAY, (void *)&flags, sizeof(flags));
+        }
+
+        // from now on, the TCP welcoming socket will NOT accept any other connection
+        context->acceptingTcpConnections = false;
+
+        if(context->tcp_server_fd <= 0) {
+          perror("Error in 'accept()': TCP welcoming Socket");
+        }
+
+        // change the descriptor to that of context->tcp_server_fd
+        // from now on, context->tcp_server_fd will be used
+        fds_poll[1].fd = context->tcp_server_fd;
+        //if(context->tcp_server_fd > maxfd) maxfd = context->tcp_server_fd;
+
+        // the bundles are written without blocking (see tcpSender.c)
+        setTcpNonBlocking(context->tcp_server_fd);
+        
+        #ifdef DEBUG
+          do_debug_c( 1,
+                      ANSI_COLOR_CYAN,
+                      "TCP connection started by the client. Socket for connecting to the client: %d\n",
+                      context->tcp_server_fd);
+        #endif       
+      }
+      
+      /*****************************************************************************/
+      /***************** NET to tun/tap. demux and decompress **********************/
+      /*****************************************************************************/
+
+      // data arrived at the network interface: read, demux, decompress and forward it.
+      // In TCP_SERVER_MODE, I will only enter here if the TCP connection is already started
+      // in the rest of modes, I will enter here if a muxed packet has arrived        
+      else if ( (fds_poll[1].revents & POLLIN) && 
+                ( ( (context->mode== TCP_SERVER_MODE) && (context->acceptingTcpConnections == false) ) ||
+                  (context->mode== NETWORK_MODE) || 
+                  (context->mode== UDP_MODE) ||
+                  (context->mode== TCP_CLIENT_MODE) ) )
+      {
+        if ((context->mode == UDP_MODE) && (context->batchSize > 1)) {
+          // batched UDP I/O: read all the datagrams available (up to 'batchSize') with a single system call
+          int num_datagrams = readBatchFromNet(context);
+
+          for (int i = 0; i < num_datagrams; i++) {
+            // the datagram has been truncated, so it is dropped
+            if (context->rxBatchSegmentSizes[i] == 0)
+              continue;
+
+            // the source of the datagram is needed for checking the port and for the log
+            context->received = context->rxBatchAddrs[i];
+
+            // check if the packet comes from the multiplexing port
+            int is_multiplexed_packet;
+            if (context->port == ntohs(context->received.sin_port))
+              is_multiplexed_packet = 1;
+            else
+              is_multiplexed_packet = 0;
+
+            // with UDP GRO, the datagram may contain several bundles coalesced by the
+            //kernel. All of them have 'rxBatchSegmentSizes[i]' bytes, except the last one
+            uint8_t* datagram = context->rxBatchIovecs[i].iov_base;
+            int remaining = context->rxBatchMsgs[i].msg_len;
+            do {
+              int length = remaining;
+              if (length > context->rxBatchSegmentSizes[i])
+                length = context->rxBatchSegmentSizes[i];
+
+              deliverPacketFromNet( context,
+                                    is_multiplexed_packet,
+                                    length,
+                                    length,
+                                    datagram);
+
+              datagram = datagram + length;
+              remaining = remaining - length;
+            } while (remaining > 0);
+          }
+        }
+        else if ((context->mode == TCP_SERVER_MODE) || (context->mode == TCP_CLIENT_MODE)) {
+          // read a chunk of the TCP stream and deliver all the complete records it contains
+          readStreamFromTcp(context);
+        }
+        else {
+          int is_multiplexed_packet;
+          int nread_from_net;                 // number of bytes read from network which will be demultiplexed
+          uint8_t buffer_from_net[BUFSIZE];   // stores the packet received from the network, before sending it to tun
+          uint16_t packet_length;
+
+          is_multiplexed_packet = readPacketFromNet(context,
+                                                    buffer_from_net,
+                                                    &nread_from_net,
+                                                    &packet_length);
+
+          // now 'buffer_from_net' may contain a full packet or frame
+          deliverPacketFromNet( context,
+                                is_multiplexed_packet,
+                                nread_from_net,
+                                packet_length,
+                                buffer_from_net);
+        }
+      }
+
+      #ifdef USINGROHC
+      /****************************************************************************************************************/    
+      /******* ROHC feedback packet from the remote decompressor to be delivered to the local compressor **************/
+      /****************************************************************************************************************/
+
+      /*** ROHC feedback data arrived at the network interface: read it in order to deliver it to the local compressor ***/
+
+      // the ROHC mode only affects the decompressor. So if I receive a ROHC feedback packet, I will use it
+      // this implies that if the origin is in ROHC Unidirectional mode and the destination in Bidirectional, feedback will still work
+      else if(fds_poll[2].revents & POLLIN)
+      {
+      
+        int nread_from_net; // number of bytes read from network which will be demultiplexed
+        uint8_t buffer_from_net[BUFSIZE];         // stores the packet received from the network, before sending it to tun
+
+        // a packet has been received from the network, destinated to the feedbadk port. 'slen_feedback' is the length of the IP address
+        socklen_t slen_feedback = sizeof(context->feedback);   // size of the socket. The type is like an int, but adequate for the size of the socket
+        nread_from_net = recvfrom ( context->feedback_fd,
+                                    buffer_from_net,
+                                    BUFSIZE,
+                                    0,
+                                    (struct sockaddr *)&(context->feedback_remote),
+                                    &slen_feedback );
+
+        if (nread_from_net == -1) perror ("recvfrom()");
+
+        // now buffer_from_net contains a full packet or frame.
+        // check if the packet comes (source port) from the feedback port (default 55556).  (Its destination port IS the feedback port)  
+        if (context->port_feedback == ntohs(context->feedback_remote.sin_port)) {
+
+          // the packet comes from the feedback port (default 55556)
+          #ifdef DEBUG
+            do_debug_c( 1,
+                        ANSI_COLOR_MAGENTA,
+                        "FEEDBACK PACKET #%lu: Read RoHC feedback packet (",
+                        context->feedback_pkts);
+            do_debug_c( 1,
+                        ANSI_COLOR_RESET,
+                        "%i",
+                        nread_from_net);
+            do_debug_c( 1,
+                        ANSI_COLOR_MAGENTA,
+                        " bytes) from ");
+            do_debug_c( 1,
+                        ANSI_COLOR_RESET,
+                        "%s",
+                        inet_ntoa(context->feedback_remote.sin_addr));
+            do_debug_c( 1,
+                        ANSI_COLOR_MAGENTA,
+                        ":");
+            do_debug_c( 1,
+                        ANSI_COLOR_RESET,
+                        "%d\n",
+                        ntohs(context->feedback_remote.sin_port));
+          #endif
+
+          context->feedback_pkts ++;
+
+          // write the log file
+          if ( context->log_file != NULL ) {
+            fprintf(context->log_file, "%"PRIu64"\trec\tRoHC feedback\t%i\t%"PRIu32"\tfrom\t%s\t%d\n",
+                    GetTimeStamp(),
+                    nread_from_net,
+                    context->feedback_pkts,
+                    inet_ntoa(context->feedback_remote.sin_addr),
+                    ntohs(context->feedback_remote.sin_port));
+
+            fflush(context->log_file);  // If the IO is buffered, I have to insert fflush(fp) after the write in order to avoid things lost when pressing Ctrl+C.
+          }
+
+          // reset the buffer where the packet is to be stored
+          rohc_buf_reset (&rohc_packet_d);
+
+          // Copy the compressed length and the compressed packet
+          rohc_packet_d.len = nread_from_net;
+    
+          // Copy the packet itself
+          for (int l = 0; l < nread_from_net ; l++) {
+            rohc_buf_byte_at(rohc_packet_d, l) = buffer_from_net[l];
+          }
+
+          #ifdef DEBUG
+            // dump the ROHC packet on terminal
+            if (debug>0) {
+              do_debug_c( 2,
+                          ANSI_COLOR_MAGENTA,
+                          " ROHC feedback packet received\n");
+
+              dump_packet ( rohc_packet_d.len, rohc_packet_d.data );
+
+              do_debug_c( 2,
+                          ANSI_COLOR_MAGENTA,
+                          "\n");
+            }
+
+
+            // deliver the feedback received to the local compressor
+            //https://rohc-lib.org/support/documentation/API/rohc-doc-1.7.0/group__rohc__comp.html    
+            if ( rohc_comp_deliver_feedback2 ( compressor, rohc_packet_d ) == false ) {
+              do_debug_c( 3,
+                          ANSI_COLOR_MAGENTA,
+                          "Error delivering feedback to the compressor");
+            }
+            else {
+              do_debug_c( 3,
+                          ANSI_COLOR_MAGENTA,
+                          "Feedback delivered to the compressor: %i bytes\n",
+                          rohc_packet_d.len);
+            }
+          #endif  
+          // the information received does not have to be decompressed, because it has been 
+          // generated as feedback on the other side.
+          // So I don't have to decompress the packet
+        }
+        else {
+
+          // packet with destination port 55556, but a source port different from the feedback one
+          // if the packet does not come from the feedback port, write it directly into the tun interface
+          #ifdef DEBUG
+            do_debug_c( 1,
+                        ANSI_COLOR_MAGENTA,
+                        "NON-FEEDBACK PACKET %"PRIu32": Non-feedback packet arrived to feecback port. Writing %i bytes to tun\n",
+                        context->net2tun, nread_from_net);
+          #endif
+
+          if (writeToTun (context,
+                          buffer_from_net,
+                          nread_from_net) != nread_from_net)
+          {
+            perror("could not write the non-feedback packet correctly");
+          }
+          else {
+            // write the log file
+            if ( context->log_file != NULL ) {
+              // the packet is good
+              fprintf(context->log_file,
+                      "%"PRIu64"\tforward\tnative\t%i\t%"PRIu32"\tfrom\t%s\t%d\n",
+                      GetTimeStamp(),
+                      nread_from_net,
+                      context->net2tun,
+                      inet_ntoa(context->remote.sin_addr),
+                      ntohs(context->remote.sin_port));
+
+              fflush(context->log_file);              
+            }
+          }
+        }
+      }
+      #endif
+
+      /**************************************************************************************/  
+      /***************** tun/tap to NET: compress and multiplex *****************************/
+      /**************************************************************************************/
+
+      // data arrived at tun/tap: read it, store it, and check if the stored
+      //packets should be written to the network
+
+      // FD_ISSET tests if a file descriptor is part of the set
+      //else if(FD_ISSET(context->tun_fd, &rd_set)) {
+      else if(fds_poll[0].revents & POLLIN)
+      {
+
+        if (context->flavor == 'B') {
+          tunToNetBlastFlavor(context);
+        }
+        else {
+          // not in blast flavor
+
+          if ((context->drainBudget > 1) && (context->ioUring == NULL)) {
+            // drain mode: read all the packets waiting in tun/tap
+            //(the io_uring engine delivers them one by one)
+            tunToNetDrain(context);
+          }
+          else {
+            // increase the counter of the number of packets read from tun
+            context->tun2net++;
+
+            tunToNetNoBlastFlavor(context);
+          }
+        }
+      }
+    }  
+
+    /*************************************************************************************/  
+    /*** Period expired: multiplex in normal/fast flavor; send expired in blast flavor ***/
+    /*************************************************************************************/  
+
+    // The period has expired
+    // Check if there is something stored, and send it
+    // since there is no new packet, it is not necessary to compress anything here
+    else {
+      // fd2read == 0
+      #ifdef DEBUG
+        do_debug_c( 3,
+                    ANSI_COLOR_RESET,
+                    "Poll timeout expired\n");
+      #endif
+
+      // measure how late the timeout has expired
+      if (context->measureLateness)
+        recordLateness(context, deadline, GetTimeStamp());
+      
+      if((context->flavor == 'B') || (context->numFlowRules > 0)) {
+        // blast flavor (or the blast flows of the hybrid flavor)
+        // send all the packets with 'now_microsec >= sentTimestamp + period'
+        periodExpiredblastFlavor (context);
+      }
+
+      // in hybrid flavor the timeout may be a blast timer, so the period may
+      //not have expired yet
+      if((context->flavor != 'B') &&
+         ((context->numFlowRules == 0) || (GetTimeStamp() - context->timeLastSent >= context->period)))
+      {
+        // not in blast flavor
+        if (context->numFlowRules > 0)
+          deadline = context->timeLastSent + context->period;
+
+        if ( context->numPktsStoredFromTun > 0 ) {
+          // There are some packets stored
+          //send them
+          periodExpiredNoblastFlavor (context);
+        }
+        else {
+          // No packet arrived
+          #ifdef DEBUG
+            do_debug_c( 3,
+                        ANSI_COLOR_RESET,
+                        "Period expired. Nothing to be sent\n");
+          #endif
+        }
+        // restart the period at its deadline, so the error does not accumulate
+        //from one period to the next one. If the program is more than a period
+        //late, the period is restarted now
+        now_microsec = GetTimeStamp();
+        if (now_microsec < deadline + context->period)
+          context->timeLastSent = deadline;
+        else
+          context->timeLastSent = now_microsec;
+        #ifdef DEBUG
+          do_debug_c( 3,
+                      ANSI_COLOR_YELLOW,
+                      "%"PRIu64" Period expired\n",
+                      context->timeLastSent);
+        #endif
+      }
+    }
+
+    // send the bundles that have been stored in the transmission batch during this iteration
+    if (context->numBatchedTx > 0)
+      flushBatchedDatagrams(context);
+
+    // the user has asked for the statistics (SIGUSR1)
+    if (statisticsRequested) {
+      statisticsRequested = 0;
+
+      // the lines of the queues are not mixed
+      flockfile(stderr);
+      printStatistics(context);
+      funlockfile(stderr);
+
+      // queue 0 wakes up the other queues, so they print theirs
+      if (context->queueIndex == 0) {
+        for (int i = 1; i < context->numQueues; i++)
+          pthread_kill(queueThreads[i], SIGUSR2);
+      }
+    }
+  }  // end while(1)
+
+  // free the variables
+  free(fds_poll);
+}
+
+
+// thread of a queue in multi-queue mode
+// declared as 'static' because it is only used in this .c file
+static void* queueWorker(void* arg)
+{
+  mainLoop((contextSimplemux*)arg);
+  return NULL;
+}
+
+
+// multi-queue mode: create a context for queues 1 to N-1, and start their threads
+// each queue has its own tun/tap queue, its own bundling state, its own UDP
+//socket and its own RoHC compressor. The kernel sends all the packets of a
+//flow to the same tun/tap queue, so the order of each flow is kept
+// the peer must use the same number of queues: queue i uses port 'port + 2*i'
+//and feedback port 'port_feedback + 2*i' in both sides
+// declared as 'static' because it is only used in this .c file
+static void startQueueWorkers(contextSimplemux* context)
+{
+  const int on = 1;   // needed when creating a socket
+
+  // the threads inherit the signal mask: they do not receive SIGUSR1
+  sigset_t statisticsSignal, previousMask;
+  sigemptyset(&statisticsSignal);
+  sigaddset(&statisticsSignal, SIGUSR1);
+  pthread_sigmask(SIG_BLOCK, &statisticsSignal, &previousMask);
+
+  for (int i = 1; i < context->numQueues; i++) {
+    // the context is too big for the stack of a thread
+    contextSimplemux* queueContext = malloc(sizeof(contextSimplemux));
+    if (queueContext == NULL) {
+      perror("[startQueueWorkers] could not reserve memory for the context of a queue");
+      exit(EXIT_FAILURE);
+    }
+
+    // the options are the same. The bundling state is still empty
+    memcpy(queueContext, context, sizeof(contextSimplemux));
+
+    queueContext->queueIndex = i;
+    queueContext->tun_fd = context->tunQueueFds[i];
+    queueContext->port = context->port + 2 * i;
+    #ifdef USINGROHC
+      queueContext->port_feedback = context->port_feedback + 2 * i;
+    #endif
+
+    // each queue has its own sockets
+    if (socketRequest(queueContext, on) == 1) {
+      my_err("Error creating the sockets of queue %i\n", i);
+      exit(1);
+    }
+    #ifdef USINGROHC
+      feedbackSocketRequest(queueContext);
+    #endif
+
+    if (pthread_create(&queueThreads[i], NULL, queueWorker, queueContext) != 0) {
+      perror("[startQueueWorkers] could not create the thread of a queue");
+      exit(EXIT_FAILURE);
+    }
+    pthread_detach(queueThreads[i]);
+
+    #ifdef DEBUG
+      do_debug_c( 1,
+                  ANSI_COLOR_RESET,
+                  "Queue %i started. Port %i\n",
+                  i,
+                  queueContext->port);
+    #endif
+  }
+
+  // queue 0 receives SIGUSR1
+  pthread_sigmask(SIG_SETMASK, &previousMask, NULL);
+}
+
+
 // main Simplemux program
 int main(int argc, char *argv[]) {
 
@@ -423,515 +1160,31 @@ int main(int argc, char *argv[]) {
     // initialize the triggering parameters
     initTriggerParameters(&context);
 
+    // the statistics are printed when SIGUSR1 is received (SIGUSR2 is used by
+    //queue 0 to pass it to the other queues in multi-queue mode)
+    signal(SIGUSR1, statisticsSignalHandler);
+    signal(SIGUSR2, statisticsSignalHandler);
+
     #ifdef USINGROHC
       // I only need the feedback socket if ROHC is activated
       //but I create it in case the other extreme sends ROHC packets
       feedbackSocketRequest(&context);
-      
-      // If ROHC has been selected, it has to be initialized
-      // see the API here: https://rohc-lib.org/support/documentation/API/rohc-doc-1.7.0/
-      initRohc(&context);
     #endif
 
     #ifdef DEBUG
       do_debug_c(1, ANSI_COLOR_RESET, "\n");
     #endif
-    
-    /** prepare the POLL structure **/
-    // it has size 3 (NUMBER_OF_SOCKETS), because it handles 3 sockets
-    // - tun/tap socket where demuxed packets are sent/received
-    // - feedback socket
-    // - socket where muxed packets are sent/received. It can be:
-    //      - Network mode: IP raw socket
-    //      - UDP mode: UDP socket
-    //      - TCP server mode
-    //      - TCP client mode
-    struct pollfd* fds_poll = malloc(NUMBER_OF_SOCKETS * sizeof(struct pollfd));
-    memset(fds_poll, 0, NUMBER_OF_SOCKETS * sizeof(struct pollfd));
-  
-    fds_poll[0].fd = context.tun_fd;
-    fds_poll[0].events = POLLIN;
-
-    if ( context.mode== NETWORK_MODE )
-      fds_poll[1].fd = context.network_mode_fd;
-    else if ( context.mode== UDP_MODE )
-      fds_poll[1].fd = context.udp_mode_fd;
-    else if ( context.mode==TCP_SERVER_MODE )
-      fds_poll[1].fd = context.tcp_welcoming_fd;
-    else
-      fds_poll[1].fd = context.tcp_client_fd;
-    fds_poll[1].events = POLLIN;
-
-    #ifdef USINGROHC
-      fds_poll[2].fd = context.feedback_fd;
-      fds_poll[2].events = POLLIN;
-    #endif
-    
-    // set the current moment as the moment of the last sending
-    context.timeLastSent = GetTimeStamp();  
-      
-    // initializations for blast flavor
-    if(context.flavor == 'B')
-      initBlastFlavor(&context);
-
-    uint64_t now_microsec; // variable to store timestamps
-
-    /*****************************************/
-    /************** Main loop ****************/
-    /*****************************************/
-    while(1) {
-    
-      // Initialize the timeout data structure
-      if(context.flavor == 'B') {
-        // blast flavor
-        context.timeLastSent = findLastSentTimestamp(context.unconfirmedPacketsBlast);
-
-        #ifdef DEBUG
-          if(debug > 2)
-            printList(&context.unconfirmedPacketsBlast);
-        #endif
-
-        now_microsec = GetTimeStamp();
-
-        if (context.timeLastSent == 0) {
-          context.timeLastSent = now_microsec;
-          #ifdef DEBUG
-            do_debug_c( 3,
-                        ANSI_COLOR_YELLOW,
-                        "%"PRIu64" No blast packet is waiting to be sent to the network\n",
-                        now_microsec);
-          #endif
-        }
-
-        if(context.timeLastSent + context.period > now_microsec) {
-          context.microsecondsLeft = context.timeLastSent + context.period - now_microsec;
-          #ifdef DEBUG
-            do_debug_c( 3,
-                        ANSI_COLOR_YELLOW,
-                        "%"PRIu64" The next blast packet will be sent in %"PRIu64" us\n",
-                        now_microsec,
-                        context.microsecondsLeft);
-          #endif      
-        }
-        else {
-          // the period is already expired
-          #ifdef DEBUG
-            do_debug_c( 3,
-                        ANSI_COLOR_YELLOW,
-                        "%"PRIu64" Call the poll with limit 0\n",
-                        now_microsec);
-          #endif
-          context.microsecondsLeft = 0;
-        }
-
-        // in blast flavor, heartbeats have to be sent periodically
-        // if the time to the next heartbeat is smaller than the time to the next sending of a blast packet,
-        //then the time has to be reduced
-        uint64_t microsecondsToNextHeartBeat = context.lastBlastHeartBeatSent + HEARTBEATPERIOD - now_microsec;
-
-        // choose the smallest one
-        if(microsecondsToNextHeartBeat < context.microsecondsLeft)
-          context.microsecondsLeft = microsecondsToNextHeartBeat;
-      }
-
-      else {
-        // not in blast flavor
-        now_microsec = GetTimeStamp();
-
-        if ( context.period > (now_microsec - context.timeLastSent)) {
-          // the period is not expired
-          context.microsecondsLeft = (context.period - (now_microsec - context.timeLastSent));
-        }
-        else {
-          // the period is expired
-          context.microsecondsLeft = 0;
-        }        
-
-        #ifdef DEBUG
-          do_debug_c( 3,
-                      ANSI_COLOR_YELLOW,
-                      "Time last sending: %"PRIu64" us\n",
-                      context.timeLastSent);
-          do_debug_c( 3,
-                      ANSI_COLOR_YELLOW,
-                      "The next packet will be sent in %"PRIu64" us\n",
-                      context.microsecondsLeft);
-        #endif
-      }
-
-      int milliseconds_left = (int)(context.microsecondsLeft / 1000.0);
-      
-      /** POLL **/
-      // check if a frame has arrived to any of the file descriptors
-      // - the first argument is the pollfd struct
-      // - the second argument is '3', i.e. the number of sockets NUMBER_OF_SOCKETS
-      // - third argument: the timeout specifies the number of milliseconds that
-      //   poll() should block waiting for a file descriptor to become ready.
-      int fd2read = poll(fds_poll, NUMBER_OF_SOCKETS, milliseconds_left);
-
-      /********************************/
-      /**** Error in poll function ****/
-      /********************************/
-      if(fd2read < 0) {
-        if(fd2read == -1 || errno != EINTR ) {
-  
-        }
-        else {
-          perror("Error in poll function");
-          return -1;
-        }
-      }
-  
-      /*******************************************/
-      /**** A frame has arrived to one socket ****/
-      /*******************************************/
-      // a frame has arrived to one of the sockets in 'fds_poll'
-      else if (fd2read > 0) {
-
-        /******************************************************************/
-        /*************** TCP connection request from a client *************/
-        /******************************************************************/
-        // a connection request has arrived to the welcoming socket
-        if ((fds_poll[1].revents & POLLIN) &&
-            (context.mode==TCP_SERVER_MODE) &&
-            (context.acceptingTcpConnections == true) )
-        {
-
-          // accept the connection
-          struct sockaddr_in TCPpair;
-          unsigned int len = sizeof(struct sockaddr);
-          context.tcp_server_fd = accept(context.tcp_welcoming_fd, (struct sockaddr*)&TCPpair, &len);
-          
-          if ( DISABLE_NAGLE == 1 ) {
-            // disable NAGLE algorigthm, see https://holmeshe.me/network-essentials-setsockopt-TCP_NODELAY/
-            int flags =1;
-            setsockopt(context.tcp_client_fd, IPPROTO_TCP, TCP_NODELAY, (void *)&flags, sizeof(flags));
-          }
-
-          // from now on, the TCP welcoming socket will NOT accept any other connection
-          context.acceptingTcpConnections = false;
-  
-          if(context.tcp_server_fd <= 0) {
-            perror("Error in 'accept()': TCP welcoming Socket");
-          }
-  
-          // change the descriptor to that of context.tcp_server_fd
-          // from now on, context.tcp_server_fd will be used
-          fds_poll[1].fd = context.tcp_server_fd;
-          //if(context.tcp_server_fd > maxfd) maxfd = context.tcp_server_fd;
-          
-          #ifdef DEBUG
-            do_debug_c( 1,
-                        ANSI_COLOR_CYAN,
-                        "TCP connection started by the client. Socket for connecting to the client: %d\n",
-                        context.tcp_server_fd);
-          #endif       
-        }
-        
-        /*****************************************************************************/
-        /***************** NET to tun/tap. demux and decompress **********************/
-        /*****************************************************************************/
-  
-        // data arrived at the network interface: read, demux, decompress and forward it.
-        // In TCP_SERVER_MODE, I will only enter here if the TCP connection is already started
-        // in the rest of modes, I will enter here if a muxed packet has arrived        
-        else if ( (fds_poll[1].revents & POLLIN) && 
-                  ( ( (context.mode== TCP_SERVER_MODE) && (context.acceptingTcpConnections == false) ) ||
-                    (context.mode== NETWORK_MODE) || 
-                    (context.mode== UDP_MODE) ||
-                    (context.mode== TCP_CLIENT_MODE) ) )
-        {
-          int is_multiplexed_packet;
-          int nread_from_net;                 // number of bytes read from network which will be demultiplexed
-          uint8_t buffer_from_net[BUFSIZE];   // stores the packet received from the network, before sending it to tun
-          uint16_t packet_length;
-
-          is_multiplexed_packet = readPacketFromNet(&context,
-                                                    buffer_from_net,
-                                                    &nread_from_net,
-                                                    &packet_length);
-    
-          // now 'buffer_from_net' may contain a full packet or frame.
-          // check if the packet is a multiplexed one
-          if (is_multiplexed_packet == -1) {
-            // I have read nothing
-          }
-          
-          else if (is_multiplexed_packet == 1) {
-            #ifdef USINGROHC
-            demuxBundleFromNet( &context,
-                                nread_from_net,
-                                packet_length,
-                                buffer_from_net,
-                                &status);
-            #else
-            demuxBundleFromNet( &context,
-                                nread_from_net,
-                                packet_length,
-                                buffer_from_net);
-            #endif
-          }
-  
-          else { // is_multiplexed_packet == 0
-            // packet with the correct destination port, but a source port different from the multiplexing one
-            // if the packet does not come from the multiplexing port, write it directly into the tun interface
-            #ifdef DEBUG
-              do_debug_c( 1,
-                          ANSI_COLOR_RED,
-                          "NON-SIMPLEMUX PACKET #%"PRIu32": Non-multiplexed packet arrived to the Simplemux port. Writing %i bytes to tun/tap\n",
-                          context.net2tun,
-                          nread_from_net);
-            #endif
-            
-            if (cwrite (context.tun_fd,
-                        buffer_from_net,
-                        nread_from_net) != nread_from_net)
-            {
-              perror("could not write the non-multiplexed packet correctly");
-            }
-            else {
-              // write the log file
-              if ( context.log_file != NULL ) {
-                // the packet is good
-                fprintf(context.log_file,
-                        "%"PRIu64"\tforward\tnative\t%i\t%"PRIu32"\tfrom\t%s\t%d\n",
-                        GetTimeStamp(),
-                        nread_from_net,
-                        context.net2tun,
-                        inet_ntoa(context.remote.sin_addr),
-                        ntohs(context.remote.sin_port));
-
-                fflush(context.log_file);              
-              }
-            }
-          }
-        }
-  
-        #ifdef USINGROHC
-        /****************************************************************************************************************/    
-        /******* ROHC feedback packet from the remote decompressor to be delivered to the local compressor **************/
-        /****************************************************************************************************************/
-  
-        /*** ROHC feedback data arrived at the network interface: read it in order to deliver it to the local compressor ***/
-  
-        // the ROHC mode only affects the decompressor. So if I receive a ROHC feedback packet, I will use it
-        // this implies that if the origin is in ROHC Unidirectional mode and the destination in Bidirectional, feedback will still work
-        else if(fds_poll[2].revents & POLLIN)
-        {
-        
-          int nread_from_net; // number of bytes read from network which will be demultiplexed
-          uint8_t buffer_from_net[BUFSIZE];         // stores the packet received from the network, before sending it to tun
-
-          // a packet has been received from the network, destinated to the feedbadk port. 'slen_feedback' is the length of the IP address
-          socklen_t slen_feedback = sizeof(context.feedback);   // size of the socket. The type is like an int, but adequate for the size of the socket
-          nread_from_net = recvfrom ( context.feedback_fd,
-                                      buffer_from_net,
-                                      BUFSIZE,
-                                      0,
-                                      (struct sockaddr *)&(context.feedback_remote),
-                                      &slen_feedback );
-  
-          if (nread_from_net == -1) perror ("recvfrom()");
-  
-          // now buffer_from_net contains a full packet or frame.
-          // check if the packet comes (source port) from the feedback port (default 55556).  (Its destination port IS the feedback port)  
-          if (context.port_feedback == ntohs(context.feedback_remote.sin_port)) {
-  
-            // the packet comes from the feedback port (default 55556)
-            #ifdef DEBUG
-              do_debug_c( 1,
-                          ANSI_COLOR_MAGENTA,
-                          "FEEDBACK PACKET #%lu: Read RoHC feedback packet (",
-                          context.feedback_pkts);
-              do_debug_c( 1,
-                          ANSI_COLOR_RESET,
-                          "%i",
-                          nread_from_net);
-              do_debug_c( 1,
-                          ANSI_COLOR_MAGENTA,
-                          " bytes) from ");
-              do_debug_c( 1,
-                          ANSI_COLOR_RESET,
-                          "%s",
-                          inet_ntoa(context.feedback_remote.sin_addr));
-              do_debug_c( 1,
-                          ANSI_COLOR_MAGENTA,
-                          ":");
-              do_debug_c( 1,
-                          ANSI_COLOR_RESET,
-                          "%d\n",
-                          ntohs(context.feedback_remote.sin_port));
-            #endif
-  
-            context.feedback_pkts ++;
-  
-            // write the log file
-            if ( context.log_file != NULL ) {
-              fprintf(context.log_file, "%"PRIu64"\trec\tRoHC feedback\t%i\t%"PRIu32"\tfrom\t%s\t%d\n",
-                      GetTimeStamp(),
-                      nread_from_net,
-                      context.feedback_pkts,
-                      inet_ntoa(context.feedback_remote.sin_addr),
-                      ntohs(context.feedback_remote.sin_port));
-
-              fflush(context.log_file);  // If the IO is buffered, I have to insert fflush(fp) after the write in order to avoid things lost when pressing Ctrl+C.
-            }
-  
-            // reset the buffer where the packet is to be stored
-            rohc_buf_reset (&rohc_packet_d);
-  
-            // Copy the compressed length and the compressed packet
-            rohc_packet_d.len = nread_from_net;
-      
-            // Copy the packet itself
-            for (int l = 0; l < nread_from_net ; l++) {
-              rohc_buf_byte_at(rohc_packet_d, l) = buffer_from_net[l];
-            }
-
-            #ifdef DEBUG
-              // dump the ROHC packet on terminal
-              if (debug>0) {
-                do_debug_c( 2,
-                            ANSI_COLOR_MAGENTA,
-                            " ROHC feedback packet received\n");
-
-                dump_packet ( rohc_packet_d.len, rohc_packet_d.data );
-
-                do_debug_c( 2,
-                            ANSI_COLOR_MAGENTA,
-                            "\n");
-              }
-
-  
-              // deliver the feedback received to the local compressor
-              //https://rohc-lib.org/support/documentation/API/rohc-doc-1.7.0/group__rohc__comp.html    
-              if ( rohc_comp_deliver_feedback2 ( compressor, rohc_packet_d ) == false ) {
-                do_debug_c( 3,
-                            ANSI_COLOR_MAGENTA,
-                            "Error delivering feedback to the compressor");
-              }
-              else {
-                do_debug_c( 3,
-                            ANSI_COLOR_MAGENTA,
-                            "Feedback delivered to the compressor: %i bytes\n",
-                            rohc_packet_d.len);
-              }
-            #endif  
-            // the information received does not have to be decompressed, because it has been 
-            // generated as feedback on the other side.
-            // So I don't have to decompress the packet
-          }
-          else {
-  
-            // packet with destination port 55556, but a source port different from the feedback one
-            // if the packet does not come from the feedback port, write it directly into the tun interface
-            #ifdef DEBUG
-              do_debug_c( 1,
-                          ANSI_COLOR_MAGENTA,
-                          "NON-FEEDBACK PACKET %"PRIu32": Non-feedback packet arrived to feecback port. Writing %i bytes to tun\n",
-                          context.net2tun, nread_from_net);
-            #endif
-
-            if (cwrite (context.tun_fd,
-                        buffer_from_net,
-                        nread_from_net) != nread_from_net)
-            {
-              perror("could not write the non-feedback packet correctly");
-            }
-            else {
-              // write the log file
-              if ( context.log_file != NULL ) {
-                // the packet is good
-                fprintf(context.log_file,
-                        "%"PRIu64"\tforward\tnative\t%i\t%"PRIu32"\tfrom\t%s\t%d\n",
-                        GetTimeStamp(),
-                        nread_from_net,
-                        context.net2tun,
-                        inet_ntoa(context.remote.sin_addr),
-                        ntohs(context.remote.sin_port));
-
-                fflush(context.log_file);              
-              }
-            }
-          }
-        }
-        #endif
-
-        /**************************************************************************************/  
-        /***************** tun/tap to NET: compress and multiplex *****************************/
-        /**************************************************************************************/
-  
-        // data arrived at tun/tap: read it, store it, and check if the stored
-        //packets should be written to the network
-  
-        // FD_ISSET tests if a file descriptor is part of the set
-        //else if(FD_ISSET(context.tun_fd, &rd_set)) {
-        else if(fds_poll[0].revents & POLLIN)
-        {
 
-          if (context.flavor == 'B') {
-            tunToNetBlastFlavor(&context);
-          }
-          else {
-            // not in blast flavor
+    // FEC: the tables of GF(256) are shared by all the queues
+    if (context.fecBlockSize > 0)
+      initGaloisField();
 
-            // increase the counter of the number of packets read from tun
-            context.tun2net++;
-
-            tunToNetNoBlastFlavor(&context);
-          }
-        }
-      }  
-
-      /*************************************************************************************/  
-      /*** Period expired: multiplex in normal/fast flavor; send expired in blast flavor ***/
-      /*************************************************************************************/  
-
-      // The period has expired
-      // Check if there is something stored, and send it
-      // since there is no new packet, it is not necessary to compress anything here
-      else {
-        // fd2read == 0
-        #ifdef DEBUG
-          do_debug_c( 3,
-                      ANSI_COLOR_RESET,
-                      "Poll timeout expired\n");
-        #endif
-        
-        if(context.flavor == 'B') {
-          // blast flavor
-          // go through the list and send all the packets with 'now_microsec > sentTimestamp + period'
-          periodExpiredblastFlavor (&context);
-        }
-        else {
-          // not in blast flavor
-          if ( context.numPktsStoredFromTun > 0 ) {
-            // There are some packets stored
-            //send them
-            periodExpiredNoblastFlavor (&context);
-          }
-          else {
-            // No packet arrived
-            #ifdef DEBUG
-              do_debug_c( 3,
-                          ANSI_COLOR_RESET,
-                          "Period expired. Nothing to be sent\n");
-            #endif
-          }
-          // restart the period
-          context.timeLastSent = now_microsec;
-          #ifdef DEBUG
-            do_debug_c( 3,
-                        ANSI_COLOR_YELLOW,
-                        "%"PRIu64" Period expired\n",
-                        context.timeLastSent);
-          #endif
-        }
-      }     
-    }  // end while(1)
+    // in multi-queue mode, queues 1 to N-1 run in their own threads
+    if (context.numQueues > 1)
+      startQueueWorkers(&context);
 
-    // free the variables
-    free(fds_poll);
+    // queue 0 runs in this thread
+    mainLoop(&context);
 
     return(0);
   }
@@ -1,3 +1,8 @@
+// required for using recvmmsg() and sendmmsg(). It must be defined before including any system header
+#ifndef _GNU_SOURCE
+  #define _GNU_SOURCE
+#endif
+
 //#include <stdio.h>
 //#include <stdlib.h>
 //#include <string.h>
@@ -9,6 +14,8 @@
 #include <ifaddrs.h>          // required for using getifaddrs()
 #include <netdb.h>            // required for using getifaddrs()
 #include <poll.h>
+#include <signal.h>
+#include <pthread.h>          // for the threads of the queues in multi-queue mode
 #include <fcntl.h>
 
 #include <net/if.h>
@@ -25,6 +32,7 @@
 #include <sys/socket.h>
 #include <sys/ioctl.h>
 #include <sys/stat.h>
+#include <sys/prctl.h>        // for reducing the timer slack
 
 #ifdef USINGROHC
   #include <rohc/rohc.h>        // for using header compression
@@ -36,4 +44,7 @@
 #include "socketRequest.h"
 #include "periodExpired.h"
 #include "netToTun.h"
-#include "tunToNet.h"
\ No newline at end of file
+#include "tunToNet.h"
+#include "batchIO.h"
+#include "tcpSender.h"
+#include "statistics.h"
\ No newline at end of file
@@ -145,6 +145,23 @@ int socketRequest(contextSimplemux* context, const int on)
     context->local.sin_addr.s_addr = inet_addr(context->local_ip);    // local IP; "htonl(INADDR_ANY)" would take the IP address of any interface
     context->local.sin_port = htons(context->port);            // local port
 
+    // UDP segmentation offload. If the kernel does not support it, the bundles are sent/read one by one
+    if (context->udpOffloadRequested) {
+      const int zero = 0;
+
+      // the segment size is set in each sendmsg(). This only checks that UDP_SEGMENT is supported (Linux 4.18)
+      if (setsockopt(context->udp_mode_fd, SOL_UDP, UDP_SEGMENT, &zero, sizeof(zero)) < 0)
+        perror("setsockopt() failed to set UDP_SEGMENT. UDP GSO will not be used ");
+      else
+        context->udpGso = true;
+
+      // let the kernel coalesce the bundles received (Linux 5.0)
+      if (setsockopt(context->udp_mode_fd, SOL_UDP, UDP_GRO, &on, sizeof(on)) < 0)
+        perror("setsockopt() failed to set UDP_GRO. UDP GRO will not be used ");
+      else
+        context->udpGro = true;
+    }
+
     // bind the socket "context->udp_mode_fd" to the local address and port
     if (bind(context->udp_mode_fd, (struct sockaddr *)&(context->local), sizeof(context->local))==-1) {
       perror("bind");
@@ -321,6 +338,9 @@ int socketRequest(contextSimplemux* context, const int on)
         int flags =1;
         setsockopt(context->tcp_client_fd, IPPROTO_TCP, TCP_QUICKACK, (void *)&flags, sizeof(flags));          
       }
+
+      // the bundles are written without blocking (see tcpSender.c)
+      setTcpNonBlocking(context->tcp_client_fd);
     }
   }
   return 0;
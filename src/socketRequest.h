@@ -3,6 +3,7 @@
 #define SOCKETREQUEST_H
 
 #include "commonFunctions.h"
+#include "tcpSender.h"
 
 int socketRequest(contextSimplemux* context, const int on);
 
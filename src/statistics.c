@@ -0,0 +1,258 @@
+#include "statistics.h"
+#include "ioUring.h"
+#include "blastPackets.h"
+
+// print the counters of the program in 'stderr'
+// it is called when the process receives the SIGUSR1 signal, e.g.
+//  $ kill -USR1 `pidof simplemux`
+// the counters are not written in the log file, in order not to alter its format
+// in multi-queue mode, it is called once per queue
+void printStatistics(contextSimplemux* context)
+{
+  fprintf(stderr, "Simplemux statistics at %"PRIu64" us\n", GetTimeStamp());
+  if (context->numQueues > 1)
+    fprintf(stderr, " Queue %i of %i\n", context->queueIndex, context->numQueues);
+  fprintf(stderr, " Packets read from tun/tap: %"PRIu32"\n", context->tun2net);
+  fprintf(stderr,
+          " Packets read from the network: %"PRIu32". Dropped because they were too long: %"PRIu64"\n",
+          context->net2tun,
+          context->netPacketsTooLong);
+  fprintf(stderr,
+          " Packets written to tun/tap: %"PRIu64". Bytes copied on the way: %"PRIu64" (%.1f per packet)\n",
+          context->tunPacketsWritten,
+          context->receiveBytesCopied,
+          (context->tunPacketsWritten > 0) ? (double)context->receiveBytesCopied / context->tunPacketsWritten : 0.0);
+
+  // batched UDP I/O
+  if (context->batchSize > 1) {
+    fprintf(stderr,
+            " recvmmsg(): %"PRIu64" calls, %"PRIu64" datagrams, average batch %.2f (max %i)\n",
+            context->recvmmsgCalls,
+            context->recvmmsgDatagrams,
+            (context->recvmmsgCalls > 0) ? (double)context->recvmmsgDatagrams / context->recvmmsgCalls : 0.0,
+            context->batchSize);
+    fprintf(stderr,
+            " sendmmsg(): %"PRIu64" calls, %"PRIu64" datagrams, average batch %.2f (max %i), %"PRIu64" dropped\n",
+            context->sendmmsgCalls,
+            context->sendmmsgDatagrams,
+            (context->sendmmsgCalls > 0) ? (double)context->sendmmsgDatagrams / context->sendmmsgCalls : 0.0,
+            context->batchSize,
+            context->sendmmsgDrops);
+  }
+
+  // throughput of the UDP tunnel
+  if (context->mode == UDP_MODE) {
+    uint64_t elapsed = GetTimeStamp() - context->udpStartTime;    // microseconds
+    fprintf(stderr,
+            " UDP sent: %"PRIu64" bundles, %"PRIu64" bytes, %.3f Mbps\n",
+            context->udpDatagramsSent,
+            context->udpBytesSent,
+            (elapsed > 0) ? (double)context->udpBytesSent * 8 / elapsed : 0.0);
+    fprintf(stderr,
+            " UDP received: %"PRIu64" bundles, %"PRIu64" bytes, %.3f Mbps\n",
+            context->udpDatagramsReceived,
+            context->udpBytesReceived,
+            (elapsed > 0) ? (double)context->udpBytesReceived * 8 / elapsed : 0.0);
+  }
+
+  // TCP stream reader
+  if ((context->mode == TCP_SERVER_MODE) || (context->mode == TCP_CLIENT_MODE))
+    fprintf(stderr,
+            " TCP received: %"PRIu64" bytes in %"PRIu64" reads, %"PRIu64" records (%.2f records per read)\n",
+            context->tcpBytesRead,
+            context->tcpReads,
+            context->tcpRecords,
+            (context->tcpReads > 0) ? (double)context->tcpRecords / context->tcpReads : 0.0);
+
+  // TCP send queue
+  if ((context->mode == TCP_SERVER_MODE) || (context->mode == TCP_CLIENT_MODE)) {
+    uint64_t stallTime = context->tcpStallTime;
+    if (context->tcpQueueCount > 0)
+      stallTime = stallTime + GetTimeStamp() - context->tcpStallStart;
+
+    fprintf(stderr,
+            " TCP send queue: %i bundles now (max %i of %i), %"PRIu64" bundles queued, %"PRIu64" writev() calls\n",
+            context->tcpQueueCount,
+            context->tcpQueueMaxDepth,
+            context->tcpQueueSize,
+            context->tcpBundlesQueued,
+            context->tcpWritevCalls);
+    fprintf(stderr,
+            " TCP send queue: stalled %"PRIu64" us, %"PRIu64" tail drops, %"PRIu64" sojourn drops\n",
+            stallTime,
+            context->tcpTailDrops,
+            context->tcpSojournDrops);
+  }
+
+  #ifdef USINGROHC
+    // contexts of the RoHC compressor. If many are recycled, the flows do not fit in the CID space
+    if ((context->rohcMode > 0) && (context->rohcCompressor != NULL)) {
+      rohc_comp_general_info_t rohcInfo;
+      rohcInfo.version_major = 0;
+      rohcInfo.version_minor = 1;
+      if (rohc_comp_get_general_info(context->rohcCompressor, &rohcInfo))
+        fprintf(stderr,
+                " RoHC compressor: %zu contexts in use, %lu packets, %lu contexts recycled\n",
+                rohcInfo.contexts_nr,
+                rohcInfo.packets_nr,
+                rohcInfo.contexts_recycled_nr);
+    }
+  #endif
+
+  // pool of blast packets and ACKs
+  if (context->numFlowRules > 0)
+    fprintf(stderr,
+            " Hybrid flavor: %"PRIu64" packets sent in blast flavor, %"PRIu64" multiplexed\n",
+            context->hybridBlastPackets,
+            context->hybridMuxedPackets);
+
+  if ((context->flavor == 'B') || (context->numFlowRules > 0)) {
+    printBlastPoolStatistics(&context->unconfirmedPacketsBlast.pool);
+
+    // ACKs of the blast flavor
+    fprintf(stderr,
+            " Blast ACKs: %"PRIu64" sent (%s), %"PRIu64" inside blast packets, %"PRIu64" received, %"PRIu64" packets acknowledged\n",
+            context->blastAcksSent,
+            (context->blastAckEvery > 0) ? "selective" : "one per packet",
+            context->blastAcksPiggybacked,
+            context->blastAcksReceived,
+            context->blastPacketsAcked);
+    fprintf(stderr,
+            " Blast heartbeats: %"PRIu64" sent%s\n",
+            context->blastHeartbeatsSent,
+            context->blastPiggyback ? " (the other packets also work as heartbeats)" : "");
+    blastRttEstimator* rtt = &context->unconfirmedPacketsBlast.rtt;
+    fprintf(stderr,
+            " Blast RTT: %"PRIu64" us (variation %"PRIu64" us, %"PRIu64" samples). Retransmission timeout: ",
+            rtt->srtt,
+            rtt->rttvar,
+            rtt->samples);
+    if (context->blastAdaptiveRto)
+      fprintf(stderr,
+              "%"PRIu64" us (adaptive, floor %"PRIu64" us)\n",
+              (rtt->samples == 0) ? context->period : rtt->rto,
+              context->blastRtoFloor);
+    else
+      fprintf(stderr,
+              "%"PRIu64" us (the period)\n",
+              context->period);
+    fprintf(stderr,
+            " Blast retransmissions: %"PRIu64" of %"PRIu64" packets sent (%.2f%%)\n",
+            context->blastRetransmissions,
+            context->blastPacketsSent,
+            (context->blastPacketsSent > 0) ? (double)context->blastRetransmissions * 100 / context->blastPacketsSent : 0.0);
+    fprintf(stderr,
+            " Blast retransmission bursts: at most %i packets back-to-back",
+            context->blastMaxRetransmissionBurst);
+    if (context->blastPacingRate > 0)
+      fprintf(stderr,
+              " (paced at %"PRIu32" packets/s, %"PRIu64" waits for a token)\n",
+              context->blastPacingRate,
+              context->blastPacerDeferrals);
+    else
+      fprintf(stderr, "\n");
+    if (context->fecBlockSize > 0)
+      fprintf(stderr,
+              " Blast FEC %i:%i: %"PRIu64" parity packets sent (%"PRIu64" not sent: longer than the MTU), %"PRIu64" received, %"PRIu64" lost packets rebuilt\n",
+              context->fecBlockSize,
+              context->fecParityCount,
+              context->fecParitySent,
+              context->fecParitySkipped,
+              context->fecParityReceived,
+              context->fecRecovered);
+  }
+
+  // UDP segmentation offload. GSO may have been stopped after an error of sendmmsg()
+  if (context->udpGso || (context->gsoSends > 0))
+    fprintf(stderr,
+            " UDP GSO: %"PRIu64" super-datagrams sent, containing %"PRIu64" bundles\n",
+            context->gsoSends,
+            context->gsoSegments);
+  if (context->udpGro)
+    fprintf(stderr,
+            " UDP GRO: %"PRIu64" coalesced datagrams received, containing %"PRIu64" bundles\n",
+            context->groReceives,
+            context->groSegments);
+
+  // drain mode
+  if (context->drainBudget > 1) {
+    fprintf(stderr,
+            " Drain: %"PRIu64" passes, %"PRIu64" packets read from tun/tap, average %.2f per pass (budget %i)\n",
+            context->drainBatches,
+            context->drainPackets,
+            (context->drainBatches > 0) ? (double)context->drainPackets / context->drainBatches : 0.0,
+            context->drainBudget);
+    fprintf(stderr,
+            " Drain histogram: 1 %"PRIu64", 2-3 %"PRIu64", 4-7 %"PRIu64", 8-15 %"PRIu64", 16-31 %"PRIu64", 32-63 %"PRIu64", >=64 %"PRIu64"\n",
+            context->drainHistogram[0],
+            context->drainHistogram[1],
+            context->drainHistogram[2],
+            context->drainHistogram[3],
+            context->drainHistogram[4],
+            context->drainHistogram[5],
+            context->drainHistogram[6]);
+  }
+
+  // lateness of the period
+  if (context->measureLateness) {
+    fprintf(stderr,
+            " Period lateness: %"PRIu64" expirations, average %.1f us, max %"PRIu64" us\n",
+            context->latenessSamples,
+            (context->latenessSamples > 0) ? (double)context->latenessTotal / context->latenessSamples : 0.0,
+            context->latenessMax);
+    fprintf(stderr,
+            " Period lateness histogram: <10us %"PRIu64", <50us %"PRIu64", <100us %"PRIu64", <500us %"PRIu64", <1ms %"PRIu64", >=1ms %"PRIu64"\n",
+            context->latenessHistogram[0],
+            context->latenessHistogram[1],
+            context->latenessHistogram[2],
+            context->latenessHistogram[3],
+            context->latenessHistogram[4],
+            context->latenessHistogram[5]);
+  }
+
+  #ifdef USINGIOURING
+    // io_uring engine
+    if (context->ioUring != NULL) {
+      fprintf(stderr,
+              " io_uring: %"PRIu64" calls to io_uring_enter(), %"PRIu64" completions (%.2f per call)\n",
+              context->ioUring->enterCalls,
+              context->ioUring->completions,
+              (context->ioUring->enterCalls > 0) ? (double)context->ioUring->completions / context->ioUring->enterCalls : 0.0);
+      fprintf(stderr,
+              " io_uring: %"PRIu64" tun/tap writes submitted in batches, %"PRIu64" waited for a free slot, %"PRIu64" failed\n",
+              context->ioUring->tunWritesBatched,
+              context->ioUring->tunWriteWaits,
+              context->ioUring->tunWriteErrors);
+    }
+  #endif
+}
+
+
+// store how late the period has expired with respect to its deadline ('-j' option)
+void recordLateness(contextSimplemux* context,
+                    uint64_t deadline,
+                    uint64_t now)
+{
+  // upper limit (us) of each bin of the histogram. The last one has no limit
+  static const uint64_t latenessLimits[LATENESS_BUCKETS - 1] = { 10, 50, 100, 500, 1000 };
+
+  // the wait may return slightly before the deadline (the clock has microsecond resolution)
+  uint64_t lateness = (now > deadline) ? now - deadline : 0;
+
+  context->latenessSamples++;
+  context->latenessTotal = context->latenessTotal + lateness;
+  if (lateness > context->latenessMax)
+    context->latenessMax = lateness;
+
+  int bucket = 0;
+  while ((bucket < LATENESS_BUCKETS - 1) && (lateness >= latenessLimits[bucket]))
+    bucket++;
+  context->latenessHistogram[bucket]++;
+
+  #ifdef DEBUG
+    do_debug_c( 3,
+                ANSI_COLOR_YELLOW,
+                "The period has expired %"PRIu64" us after its deadline\n",
+                lateness);
+  #endif
+}
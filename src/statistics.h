@@ -0,0 +1,13 @@
+// header guard: avoids problems if this file is included twice
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include "commonFunctions.h"
+
+void printStatistics(contextSimplemux* context);
+
+void recordLateness(contextSimplemux* context,
+                    uint64_t deadline,
+                    uint64_t now);
+
+#endif  // STATISTICS_H
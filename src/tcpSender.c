@@ -0,0 +1,241 @@
+#include "tcpSender.h"
+
+// non-blocking TCP sender: the TCP socket is non-blocking, so a slow peer or
+//a congested path does not stop the main loop (and the tun-to-net direction)
+// the bundles that cannot be written immediately are stored in a bounded
+//circular queue, and they are written with writev() when the socket is writable
+// when the queue is full, the new bundles are dropped (tail drop). With '-W',
+//the bundles that have waited too long in the queue are also dropped before
+//sending them (sojourn limit, as CoDel does)
+// only complete bundles are dropped, so the receiver never loses the
+//synchronization of the TCP stream
+
+
+// reserve the memory for the queue
+void initTcpSendQueue(contextSimplemux* context)
+{
+  context->tcpQueueBuffers = calloc(context->tcpQueueSize, BUFSIZE);
+  context->tcpQueueLengths = calloc(context->tcpQueueSize, sizeof(int));
+  context->tcpQueueTimestamps = calloc(context->tcpQueueSize, sizeof(uint64_t));
+
+  if ((context->tcpQueueBuffers == NULL) ||
+      (context->tcpQueueLengths == NULL) ||
+      (context->tcpQueueTimestamps == NULL))
+  {
+    perror("[initTcpSendQueue] could not reserve memory for the TCP send queue");
+    exit (EXIT_FAILURE);
+  }
+
+  context->tcpQueueHead = 0;
+  context->tcpQueueCount = 0;
+  context->tcpQueueSentBytes = 0;
+}
+
+
+// set the O_NONBLOCK flag of a TCP socket
+void setTcpNonBlocking(int fd)
+{
+  int flags = fcntl(fd, F_GETFL, 0);
+  if ((flags == -1) || (fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1)) {
+    perror("[setTcpNonBlocking] could not set the TCP socket as non-blocking");
+    exit (EXIT_FAILURE);
+  }
+}
+
+
+// return the descriptor of the connected TCP socket
+// declared as 'static' because it is only used in this .c file
+static int tcpSocket(contextSimplemux* context)
+{
+  if (context->mode == TCP_SERVER_MODE)
+    return context->tcp_server_fd;
+  else
+    return context->tcp_client_fd;
+}
+
+
+// add a bundle at the end of the queue. The pieces in 'iov' are copied to the slot
+// 'sentBytes' is the number of bytes of the bundle that have already been written
+// declared as 'static' because it is only used in this .c file
+static void enqueueBundle(contextSimplemux* context,
+                          struct iovec* iov,
+                          int iovcnt,
+                          int length,
+                          int sentBytes)
+{
+  int slot = (context->tcpQueueHead + context->tcpQueueCount) % context->tcpQueueSize;
+
+  int position = 0;
+  for (int i = 0; i < iovcnt; i++) {
+    memcpy(&context->tcpQueueBuffers[slot][position], iov[i].iov_base, iov[i].iov_len);
+    position = position + iov[i].iov_len;
+  }
+
+  context->tcpQueueLengths[slot] = length;
+  context->tcpQueueTimestamps[slot] = GetTimeStamp();
+
+  // the queue was empty: the socket starts being stalled now
+  if (context->tcpQueueCount == 0) {
+    context->tcpQueueSentBytes = sentBytes;
+    context->tcpStallStart = context->tcpQueueTimestamps[slot];
+  }
+
+  context->tcpQueueCount++;
+  context->tcpBundlesQueued++;
+  if (context->tcpQueueCount > context->tcpQueueMaxDepth)
+    context->tcpQueueMaxDepth = context->tcpQueueCount;
+}
+
+
+// remove the first bundle of the queue
+// declared as 'static' because it is only used in this .c file
+static void dequeueBundle(contextSimplemux* context)
+{
+  context->tcpQueueHead = (context->tcpQueueHead + 1) % context->tcpQueueSize;
+  context->tcpQueueCount--;
+  context->tcpQueueSentBytes = 0;
+
+  // the queue is now empty: the socket is not stalled anymore
+  if (context->tcpQueueCount == 0)
+    context->tcpStallTime = context->tcpStallTime + GetTimeStamp() - context->tcpStallStart;
+}
+
+
+// write a bundle to the TCP socket without blocking
+// if the queue is empty, the bundle is written directly from its pieces. If
+//the socket does not accept it (or only a part of it), the rest is queued
+// returns 'length' if the bundle has been written or queued, 0 if it has been
+//dropped, and -1 if there was an error
+int sendBundleTcp(contextSimplemux* context,
+                  int fd,
+                  struct iovec* iov,
+                  int iovcnt,
+                  int length)
+{
+  if (context->tcpQueueCount == 0) {
+    int written = writev(fd, iov, iovcnt);
+    context->tcpWritevCalls++;
+
+    if (written == length)
+      return length;
+
+    if (written == -1) {
+      if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+        return -1;
+      written = 0;
+    }
+
+    #ifdef DEBUG
+      do_debug_c( 3,
+                  ANSI_COLOR_YELLOW,
+                  "TCP socket full: %i of %i bytes of the bundle written. The rest is queued\n",
+                  written,
+                  length);
+    #endif
+
+    enqueueBundle(context, iov, iovcnt, length, written);
+    return length;
+  }
+
+  // there are bundles waiting, so this one has to go after them
+  if (context->tcpQueueCount == context->tcpQueueSize) {
+    #ifdef DEBUG
+      do_debug_c( 2,
+                  ANSI_COLOR_RED,
+                  "TCP send queue full (%i bundles). Bundle dropped\n",
+                  context->tcpQueueCount);
+    #endif
+
+    context->tcpTailDrops++;
+    return 0;
+  }
+
+  enqueueBundle(context, iov, iovcnt, length, 0);
+
+  // try to write the queue, including this bundle
+  flushTcpSendQueue(context);
+
+  return length;
+}
+
+
+// write the queued bundles to the TCP socket, as many as it accepts
+// several bundles are written with a single writev()
+void flushTcpSendQueue(contextSimplemux* context)
+{
+  uint64_t now = GetTimeStamp();
+
+  while (context->tcpQueueCount > 0) {
+
+    // drop the bundles that have waited more than the sojourn limit
+    // a bundle already written in part cannot be dropped
+    if (context->tcpSojournLimit > 0) {
+      while ( (context->tcpQueueCount > 0) &&
+              (context->tcpQueueSentBytes == 0) &&
+              (now - context->tcpQueueTimestamps[context->tcpQueueHead] > context->tcpSojournLimit))
+      {
+        #ifdef DEBUG
+          do_debug_c( 2,
+                      ANSI_COLOR_RED,
+                      "Bundle dropped from the TCP send queue after %"PRIu64" us\n",
+                      now - context->tcpQueueTimestamps[context->tcpQueueHead]);
+        #endif
+
+        context->tcpSojournDrops++;
+        dequeueBundle(context);
+      }
+      if (context->tcpQueueCount == 0)
+        return;
+    }
+
+    // gather the queued bundles
+    struct iovec iov[TCP_WRITEV_MAX];
+    int iovcnt = 0;
+    int total = 0;
+    while ((iovcnt < context->tcpQueueCount) && (iovcnt < TCP_WRITEV_MAX)) {
+      int slot = (context->tcpQueueHead + iovcnt) % context->tcpQueueSize;
+      int offset = (iovcnt == 0) ? context->tcpQueueSentBytes : 0;
+
+      iov[iovcnt].iov_base = &context->tcpQueueBuffers[slot][offset];
+      iov[iovcnt].iov_len = context->tcpQueueLengths[slot] - offset;
+      total = total + iov[iovcnt].iov_len;
+      iovcnt++;
+    }
+
+    int accepted = writev(tcpSocket(context), iov, iovcnt);
+    context->tcpWritevCalls++;
+
+    if (accepted == -1) {
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))
+        return;
+      perror("writev() in TCP mode failed");
+      exit (EXIT_FAILURE);
+    }
+
+    #ifdef DEBUG
+      do_debug_c( 3,
+                  ANSI_COLOR_YELLOW,
+                  "%i bytes of %i queued bundles written to the TCP socket\n",
+                  accepted,
+                  iovcnt);
+    #endif
+
+    // remove the bundles that have been completely written
+    int written = accepted;
+    while (written > 0) {
+      int pending = context->tcpQueueLengths[context->tcpQueueHead] - context->tcpQueueSentBytes;
+      if (written >= pending) {
+        written = written - pending;
+        dequeueBundle(context);
+      }
+      else {
+        context->tcpQueueSentBytes = context->tcpQueueSentBytes + written;
+        written = 0;
+      }
+    }
+
+    // the socket did not accept everything: wait until it is writable again
+    if (accepted < total)
+      return;
+  }
+}
@@ -0,0 +1,19 @@
+// header guard: avoids problems if this file is included twice
+#ifndef TCPSENDER_H
+#define TCPSENDER_H
+
+#include "commonFunctions.h"
+
+void initTcpSendQueue(contextSimplemux* context);
+
+void setTcpNonBlocking(int fd);
+
+int sendBundleTcp(contextSimplemux* context,
+                  int fd,
+                  struct iovec* iov,
+                  int iovcnt,
+                  int length);
+
+void flushTcpSendQueue(contextSimplemux* context);
+
+#endif  // TCPSENDER_H
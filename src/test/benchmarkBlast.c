@@ -0,0 +1,413 @@
+// microbenchmarks of the blast flavor. They are not part of simplemux: the
+//'benchmarkBlast' target builds them with the same sources
+// usage:
+//  benchmarkBlast                  runs all of them with the sizes used when they were written
+//  benchmarkBlast window <packets in flight> <rounds>
+//  benchmarkBlast retransmissions <outstanding packets> <wakeups>
+//  benchmarkBlast duplicates <packets> <lag> <other bytes per packet>
+//  benchmarkBlast fec <K> <M> <loss (0 to 1)> <packets>
+
+#include "../blastPackets.h"
+#include "../blastFec.h"
+
+
+// the previous implementation: a singly linked list, where the last packet and
+//the packet to delete are found by traversing it. Only used for comparing
+//it with the window in 'benchmarkBlastWindow()'
+static void listInsertLast(storedPacketBlast** head_ref, uint16_t identifier)
+{
+  storedPacketBlast *link = (storedPacketBlast*) malloc(sizeof(storedPacketBlast));
+  link->header.identifier = htons(identifier);
+  link->next = NULL;
+
+  if(*head_ref == NULL) {
+    *head_ref = link;
+  }
+  else {
+    storedPacketBlast *last = *head_ref;
+    while(last->next != NULL)
+      last = last->next;
+    last->next = link;
+  }
+}
+
+static bool listDelete(storedPacketBlast** head_ref, uint16_t identifier)
+{
+  storedPacketBlast* temp = *head_ref, *prev = NULL;
+
+  while (temp != NULL && ntohs(temp->header.identifier) != identifier) {
+    prev = temp;
+    temp = temp->next;
+  }
+  if (temp == NULL)
+    return false;
+
+  if (prev == NULL)
+    *head_ref = temp->next;
+  else
+    prev->next = temp->next;
+
+  free(temp);
+  return true;
+}
+
+
+// microbenchmark of the insertion and ACK of blast packets, with 'inFlight'
+//packets waiting for their ACK: in each round a new packet is stored, and
+//the ACK of a packet sent 'inFlight' packets before arrives
+// it compares the window with the previous linked list, and prints the
+//time per round (insertion + ACK) of each of them
+static void benchmarkBlastWindow(int inFlight, int rounds)
+{
+  // window
+  blastWindow* window = calloc(1, sizeof(blastWindow));
+  window->pool.maxSlots = BLAST_POOL_DEFAULT;
+  initBlastWindow(window);
+  uint16_t identifier = 0;
+
+  for(int i = 0; i < inFlight; i++)
+    insertLast(window, identifier++, 0, NULL);
+
+  uint64_t start = GetTimeStamp();
+  for(int i = 0; i < rounds; i++) {
+    insertLast(window, identifier, 0, NULL);
+    delete(window, (uint16_t)(identifier - inFlight));
+    identifier++;
+  }
+  uint64_t windowTime = GetTimeStamp() - start;
+
+  while(window->first != NULL)
+    delete(window, ntohs(window->first->header.identifier));
+  free(window->byIdentifier);
+  free(window->retransmissions);
+  free(window);
+
+  // linked list
+  storedPacketBlast* head = NULL;
+  identifier = 0;
+
+  for(int i = 0; i < inFlight; i++)
+    listInsertLast(&head, identifier++);
+
+  start = GetTimeStamp();
+  for(int i = 0; i < rounds; i++) {
+    listInsertLast(&head, identifier);
+    listDelete(&head, (uint16_t)(identifier - inFlight));
+    identifier++;
+  }
+  uint64_t listTime = GetTimeStamp() - start;
+
+  while(head != NULL)
+    listDelete(&head, ntohs(head->header.identifier));
+
+  printf("%i packets in flight, %i rounds (insertion + ACK): window %.1f ns per round, list %.1f ns per round\n",
+         inFlight,
+         rounds,
+         (double)windowTime * 1000 / rounds,
+         (double)listTime * 1000 / rounds);
+}
+
+
+// the previous scheduler: every wakeup visits all the stored packets to send
+//the expired ones, and then visits them again to find the oldest one (the
+//next wakeup). Only used for comparing it with the heap
+// returns the number of packets that would have been sent
+static int scanExpiredPackets(blastWindow* window, uint64_t now, uint64_t period, uint64_t* nextWakeup)
+{
+  int sentPackets = 0;
+  for (storedPacketBlast* current = window->first; current != NULL; current = current->next) {
+    if (current->sentTimestamp + period <= now) {
+      current->sentTimestamp = now;
+      sentPackets++;
+    }
+  }
+
+  uint64_t oldest = UINT64_MAX;
+  for (storedPacketBlast* current = window->first; current != NULL; current = current->next) {
+    if (current->sentTimestamp < oldest)
+      oldest = current->sentTimestamp;
+  }
+  *nextWakeup = oldest + period;
+
+  return sentPackets;
+}
+
+
+// CPU time (us) used by the process
+static uint64_t cpuTime()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+// microbenchmark of the scheduling of blast retransmissions, with
+//'outstanding' packets waiting for their ACK (none of them arrives)
+// the packets were sent 1 us apart and the period is 'outstanding' us, so
+//one packet expires every microsecond. Each wakeup happens at the next
+//retransmission moment, 10 us after the previous one. The packets are not
+//really sent, so only the cost of the scheduling is measured
+// it prints the CPU time per retransmission of the heap and of the previous scheduler
+static void benchmarkBlastRetransmissions(int outstanding, int rounds)
+{
+  uint64_t period = outstanding;
+  int step = 10;
+
+  blastWindow* window = calloc(1, sizeof(blastWindow));
+  window->pool.maxSlots = BLAST_POOL_DEFAULT;
+  initBlastWindow(window);
+  for (int i = 0; i < outstanding; i++) {
+    storedPacketBlast* packet = insertLast(window, i, 0, NULL);
+    packet->sentTimestamp = i;
+    scheduleRetransmission(window, packet, i + period);
+  }
+
+  // heap
+  uint64_t now = period;
+  uint64_t retransmissions = 0;
+  uint64_t start = cpuTime();
+  for (int i = 0; i < rounds; i++) {
+    now = now + step;
+    while (window->retransmissions[0]->retransmissionTimestamp <= now) {
+      storedPacketBlast* current = window->retransmissions[0];
+      current->sentTimestamp = now;
+      scheduleRetransmission(window, current, now + period);
+      retransmissions++;
+    }
+    findNextRetransmission(window);
+  }
+  uint64_t heapTime = cpuTime() - start;
+  uint64_t heapRetransmissions = retransmissions;
+
+  // previous scheduler, with the same packets
+  for (storedPacketBlast* current = window->first; current != NULL; current = current->next)
+    current->sentTimestamp = ntohs(current->header.identifier);
+
+  now = period;
+  retransmissions = 0;
+  start = cpuTime();
+  for (int i = 0; i < rounds; i++) {
+    uint64_t nextWakeup;
+    now = now + step;
+    retransmissions = retransmissions + scanExpiredPackets(window, now, period, &nextWakeup);
+  }
+  uint64_t scanTime = cpuTime() - start;
+
+  while (window->first != NULL)
+    delete(window, ntohs(window->first->header.identifier));
+  free(window->byIdentifier);
+  free(window->retransmissions);
+  free(window);
+
+  printf("%i outstanding packets, %i wakeups: heap %.1f ns of CPU per retransmission (%"PRIu64" retransmissions), scan %.1f ns of CPU per retransmission (%"PRIu64" retransmissions)\n",
+         outstanding,
+         rounds,
+         (double)heapTime * 1000 / heapRetransmissions,
+         heapRetransmissions,
+         (double)scanTime * 1000 / retransmissions,
+         retransmissions);
+}
+
+
+// microbenchmark of the duplicate suppression at the receiver: 'packets'
+//packets arrive with consecutive identifiers, and each one arrives again
+//'lag' packets later (a retransmission whose ACK was lost)
+// between two packets, 'otherBytes' bytes of a 16 MB buffer are read, as the
+//rest of the work of the receiver would do, so the structures compete for the cache
+// it prints the CPU time per packet and the size of the window and of the
+//previous array of 65536 timestamps
+static void benchmarkBlastDuplicates(int packets, int lag, int otherBytes)
+{
+  int otherSize = 16 * 1024 * 1024;
+  uint8_t* other = calloc(otherSize, 1);
+  int otherPosition = 0;
+  uint64_t otherSum = 0;
+
+  uint64_t now = 1000000;
+  uint64_t duplicates = 0;
+
+  // window
+  blastDuplicateWindow* window = calloc(1, sizeof(blastDuplicateWindow));
+
+  uint64_t start = cpuTime();
+  for (int i = 0; i < packets; i++) {
+    now = now + 10;
+    if (!isDuplicateBlast(window, (uint16_t)i, now))
+      recordBlastDelivery(window, (uint16_t)i, now);
+    if ((i >= lag) && isDuplicateBlast(window, (uint16_t)(i - lag), now))
+      duplicates++;
+    for (int j = 0; j < otherBytes; j = j + 64) {
+      otherSum = otherSum + other[otherPosition];
+      otherPosition = (otherPosition + 64) % otherSize;
+    }
+  }
+  uint64_t windowTime = cpuTime() - start;
+  uint64_t windowDuplicates = duplicates;
+  free(window);
+
+  // previous array: a timestamp per identifier
+  now = 1000000;
+  duplicates = 0;
+  uint64_t* timestamps = calloc(0xFFFF + 1, sizeof(uint64_t));
+
+  start = cpuTime();
+  for (int i = 0; i < packets; i++) {
+    now = now + 10;
+    uint16_t identifier = i;
+    if ((timestamps[identifier] == 0) || (now - timestamps[identifier] >= TIME_UNTIL_SENDING_AGAIN_BLAST))
+      timestamps[identifier] = now;
+    identifier = i - lag;
+    if ((i >= lag) && (timestamps[identifier] != 0) && (now - timestamps[identifier] < TIME_UNTIL_SENDING_AGAIN_BLAST))
+      duplicates++;
+    for (int j = 0; j < otherBytes; j = j + 64) {
+      otherSum = otherSum + other[otherPosition];
+      otherPosition = (otherPosition + 64) % otherSize;
+    }
+  }
+  uint64_t arrayTime = cpuTime() - start;
+  free(timestamps);
+  free(other);
+
+  printf("%i packets, copies %i packets later, %i other bytes per packet: window %.1f ns of CPU per packet (%"PRIu64" copies discarded, %zu bytes), array %.1f ns of CPU per packet (%"PRIu64" copies discarded, %zu bytes)%s\n",
+         packets,
+         lag,
+         otherBytes,
+         (double)windowTime * 1000 / packets,
+         windowDuplicates,
+         sizeof(blastDuplicateWindow),
+         (double)arrayTime * 1000 / packets,
+         duplicates,
+         (size_t)(0xFFFF + 1) * sizeof(uint64_t),
+         (otherSum == 1) ? " " : "");  // use 'otherSum', so the reads are not removed by the compiler
+}
+
+
+// loss simulation: 'packets' blast packets of 200 bytes are encoded in blocks of
+//'blockSize' with 'parityCount' parity packets, and each packet (data or parity)
+//is lost with probability 'loss'. The receiver rebuilds what it can
+// it prints the packets that would still need a retransmission, compared with
+//blast repetition (each packet sent twice, without waiting for the ACK), and
+//the CPU time of the encoder and the decoder
+static void benchmarkBlastFec(int blockSize, int parityCount, double loss, int packets)
+{
+  initGaloisField();
+
+  blastFecEncoder* encoder = calloc(1, sizeof(blastFecEncoder));
+  blastFecDecoder* decoder = calloc(1, sizeof(blastFecDecoder));
+  encoder->blockSize = blockSize;
+  encoder->parityCount = parityCount;
+
+  unsigned int seed = 1;
+  uint64_t lost = 0, rebuilt = 0, repetitionLost = 0, sentPackets = 0;
+  uint64_t encodeTime = 0, decodeTime = 0;
+  uint8_t payload[200];
+
+  for (int i = 0; i < packets; i++) {
+    uint16_t identifier = i;
+    for (int b = 0; b < (int)sizeof(payload); b++)
+      payload[b] = rand_r(&seed);
+
+    uint64_t start = cpuTime();
+    bool complete = fecEncode(encoder, identifier, IPPROTO_IP_ON_IP, sizeof(payload), payload);
+    encodeTime = encodeTime + cpuTime() - start;
+    sentPackets++;
+
+    // the packet is received (or lost)
+    if ((double)rand_r(&seed) / RAND_MAX >= loss) {
+      start = cpuTime();
+      fecStoreData(decoder, identifier, IPPROTO_IP_ON_IP, sizeof(payload), payload);
+      decodeTime = decodeTime + cpuTime() - start;
+    }
+    else
+      lost++;
+
+    // repetition: the packet is lost only if both copies are lost
+    if (((double)rand_r(&seed) / RAND_MAX < loss) && ((double)rand_r(&seed) / RAND_MAX < loss))
+      repetitionLost++;
+
+    if (!complete)
+      continue;
+
+    // send the parity packets of the block
+    int block = -1;
+    for (int j = 0; j < parityCount; j++) {
+      sentPackets++;
+      if ((double)rand_r(&seed) / RAND_MAX < loss)
+        continue;
+
+      simplemuxBlastFecHeader fecHeader = { blockSize, j, parityCount };
+      start = cpuTime();
+      block = fecStoreParity(decoder, encoder->firstIdentifier, &fecHeader, encoder->parity[j], encoder->length);
+      decodeTime = decodeTime + cpuTime() - start;
+    }
+    if (block >= 0) {
+      uint16_t rebuiltIdentifiers[BLAST_FEC_MAX_M];
+      start = cpuTime();
+      int numRebuilt = fecDecode(decoder, block, rebuiltIdentifiers);
+      decodeTime = decodeTime + cpuTime() - start;
+
+      // check that the rebuilt packets are right
+      for (int k = 0; k < numRebuilt; k++) {
+        int slot = rebuiltIdentifiers[k] % BLAST_FEC_DATA_RING;
+        if (decoder->dataLength[slot] == 3 + (int)sizeof(payload))
+          rebuilt++;
+      }
+    }
+    fecResetEncoder(encoder);
+  }
+
+  free(encoder);
+  free(decoder);
+
+  printf("FEC %i:%i, loss %.1f%%: overhead %.1f%%, %"PRIu64" of %i packets lost, %"PRIu64" rebuilt, %.3f%% still need a retransmission. Repetition (overhead 100%%): %.3f%% still need a retransmission. CPU: encode %.2f us, decode %.2f us per packet\n",
+         blockSize,
+         parityCount,
+         loss * 100,
+         (double)(sentPackets - packets) * 100 / packets,
+         lost,
+         packets,
+         rebuilt,
+         (double)(lost - rebuilt) * 100 / packets,
+         (double)repetitionLost * 100 / packets,
+         (double)encodeTime / packets,
+         (double)decodeTime / packets);
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc == 1) {
+    int inFlight[] = {16, 128, 512, 2048};
+    for (unsigned int i = 0; i < sizeof(inFlight) / sizeof(inFlight[0]); i++)
+      benchmarkBlastWindow(inFlight[i], 200000);
+
+    int outstanding[] = {100, 1000, 10000};
+    for (unsigned int i = 0; i < sizeof(outstanding) / sizeof(outstanding[0]); i++)
+      benchmarkBlastRetransmissions(outstanding[i], 20000);
+
+    benchmarkBlastDuplicates(10000000, 100, 0);
+    benchmarkBlastDuplicates(10000000, 5000, 0);
+    benchmarkBlastDuplicates(1000000, 100, 4096);
+    benchmarkBlastDuplicates(1000000, 5000, 4096);
+
+    double loss[] = {0.01, 0.05, 0.10};
+    int blocks[][2] = {{8, 1}, {8, 2}, {16, 4}, {4, 2}};
+    for (unsigned int i = 0; i < sizeof(loss) / sizeof(loss[0]); i++)
+      for (unsigned int j = 0; j < sizeof(blocks) / sizeof(blocks[0]); j++)
+        benchmarkBlastFec(blocks[j][0], blocks[j][1], loss[i], 200000);
+  }
+  else if ((argc == 4) && (strcmp(argv[1], "window") == 0))
+    benchmarkBlastWindow(atoi(argv[2]), atoi(argv[3]));
+  else if ((argc == 4) && (strcmp(argv[1], "retransmissions") == 0))
+    benchmarkBlastRetransmissions(atoi(argv[2]), atoi(argv[3]));
+  else if ((argc == 5) && (strcmp(argv[1], "duplicates") == 0))
+    benchmarkBlastDuplicates(atoi(argv[2]), atoi(argv[3]), atoi(argv[4]));
+  else if ((argc == 6) && (strcmp(argv[1], "fec") == 0))
+    benchmarkBlastFec(atoi(argv[2]), atoi(argv[3]), atof(argv[4]), atoi(argv[5]));
+  else {
+    fprintf(stderr, "Usage: %s [window <packets in flight> <rounds> | retransmissions <outstanding packets> <wakeups> | duplicates <packets> <lag> <other bytes> | fec <K> <M> <loss> <packets>]\n", argv[0]);
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,205 @@
+// checks of the FEC of the blast flavor ('-F' option): the lost packets of a
+//block are rebuilt byte by byte from the parity packets
+// it returns 0 if all the checks pass
+
+#include "../blastFec.h"
+
+#define TEST_PROTOCOL 4   // protocolID of the packets of the test
+
+
+// content of the packet with a given identifier: its size and its bytes depend on it
+static uint16_t testPacket(uint16_t identifier, uint8_t* payload)
+{
+  uint16_t size = 40 + (identifier * 37) % 1200;
+  for (int b = 0; b < size; b++)
+    payload[b] = (uint8_t)(identifier * 131 + b * 7);
+  return size;
+}
+
+
+// check that the decoder has the packet with this identifier, with the right content
+static bool checkRebuilt(blastFecDecoder* decoder, uint16_t identifier)
+{
+  uint8_t payload[BUFSIZE];
+  uint16_t size = testPacket(identifier, payload);
+  int slot = identifier % BLAST_FEC_DATA_RING;
+
+  return decoder->dataValid[slot] &&
+         (decoder->dataIdentifier[slot] == identifier) &&
+         (decoder->dataLength[slot] == 3 + size) &&
+         (decoder->data[slot][0] == TEST_PROTOCOL) &&
+         (decoder->data[slot][1] == (size >> 8)) &&
+         (decoder->data[slot][2] == (size & 0xFF)) &&
+         (memcmp(&decoder->data[slot][3], payload, size) == 0);
+}
+
+
+// encode a block of 'blockSize' packets starting at 'firstIdentifier', lose
+//'numLost' of them, and rebuild them with the last 'numLost' parity packets
+// returns the number of errors
+static int encodeLoseAndDecode(int blockSize, int parityCount, uint16_t firstIdentifier, int numLost)
+{
+  blastFecEncoder* encoder = calloc(1, sizeof(blastFecEncoder));
+  blastFecDecoder* decoder = calloc(1, sizeof(blastFecDecoder));
+  encoder->blockSize = blockSize;
+  encoder->parityCount = parityCount;
+
+  // the lost packets are spread over the block, and the last one is always lost
+  bool lost[BLAST_FEC_MAX_K] = { false };
+  for (int k = 0; k < numLost; k++)
+    lost[blockSize - 1 - (k * blockSize) / numLost] = true;
+
+  uint8_t payload[BUFSIZE];
+  bool complete = false;
+  for (int i = 0; i < blockSize; i++) {
+    uint16_t identifier = firstIdentifier + i;
+    uint16_t size = testPacket(identifier, payload);
+    complete = fecEncode(encoder, identifier, TEST_PROTOCOL, size, payload);
+    if (!lost[i])
+      fecStoreData(decoder, identifier, TEST_PROTOCOL, size, payload);
+  }
+
+  int errors = 0;
+  if (!complete || (encoder->firstIdentifier != firstIdentifier)) {
+    fprintf(stderr, "FAIL: FEC %i:%i, the block starting at %i is not complete\n", blockSize, parityCount, firstIdentifier);
+    errors++;
+  }
+
+  // the first parity packets are lost too, so the decoder uses the other rows
+  int block = -1;
+  for (int j = parityCount - numLost; j < parityCount; j++) {
+    simplemuxBlastFecHeader fecHeader = { blockSize, j, parityCount };
+    block = fecStoreParity(decoder, firstIdentifier, &fecHeader, encoder->parity[j], encoder->length);
+  }
+
+  uint16_t rebuilt[BLAST_FEC_MAX_M];
+  int numRebuilt = (block >= 0) ? fecDecode(decoder, block, rebuilt) : 0;
+  if (numRebuilt != numLost) {
+    fprintf(stderr, "FAIL: FEC %i:%i, %i of %i lost packets rebuilt\n", blockSize, parityCount, numRebuilt, numLost);
+    errors++;
+  }
+
+  for (int i = 0; i < blockSize; i++) {
+    if (!checkRebuilt(decoder, firstIdentifier + i)) {
+      fprintf(stderr, "FAIL: FEC %i:%i, %i lost, packet %i of the block is wrong\n", blockSize, parityCount, numLost, i);
+      errors++;
+    }
+  }
+
+  free(encoder);
+  free(decoder);
+  return errors;
+}
+
+
+// more packets lost than parity packets: nothing can be rebuilt
+// returns the number of errors
+static int tooManyLost(int blockSize, int parityCount)
+{
+  blastFecEncoder* encoder = calloc(1, sizeof(blastFecEncoder));
+  blastFecDecoder* decoder = calloc(1, sizeof(blastFecDecoder));
+  encoder->blockSize = blockSize;
+  encoder->parityCount = parityCount;
+
+  uint8_t payload[BUFSIZE];
+  for (int i = 0; i < blockSize; i++) {
+    uint16_t size = testPacket(i, payload);
+    fecEncode(encoder, i, TEST_PROTOCOL, size, payload);
+    if (i > parityCount)
+      fecStoreData(decoder, i, TEST_PROTOCOL, size, payload);
+  }
+
+  int block = -1;
+  for (int j = 0; j < parityCount; j++) {
+    simplemuxBlastFecHeader fecHeader = { blockSize, j, parityCount };
+    block = fecStoreParity(decoder, 0, &fecHeader, encoder->parity[j], encoder->length);
+  }
+
+  uint16_t rebuilt[BLAST_FEC_MAX_M];
+  int errors = 0;
+  if (fecDecode(decoder, block, rebuilt) != 0) {
+    fprintf(stderr, "FAIL: FEC %i:%i, packets rebuilt with %i lost\n", blockSize, parityCount, parityCount + 1);
+    errors++;
+  }
+
+  free(encoder);
+  free(decoder);
+  return errors;
+}
+
+
+// a retransmission takes an identifier in the middle of a block, so the
+//identifiers are not consecutive: the block is abandoned, and a new one
+//starts with the packet that broke it
+// returns the number of errors
+static int nonConsecutiveIdentifiers()
+{
+  int blockSize = 4;
+  int parityCount = 1;
+  blastFecEncoder* encoder = calloc(1, sizeof(blastFecEncoder));
+  blastFecDecoder* decoder = calloc(1, sizeof(blastFecDecoder));
+  encoder->blockSize = blockSize;
+  encoder->parityCount = parityCount;
+
+  // identifiers 10, 11, 13 (12 is a retransmission), 14, 15 and 16
+  uint16_t identifiers[] = { 10, 11, 13, 14, 15, 16 };
+  uint8_t payload[BUFSIZE];
+  int errors = 0;
+
+  for (int i = 0; i < 6; i++) {
+    uint16_t size = testPacket(identifiers[i], payload);
+    bool complete = fecEncode(encoder, identifiers[i], TEST_PROTOCOL, size, payload);
+
+    // the block is only complete with the fourth packet after the gap
+    if (complete != (i == 5)) {
+      fprintf(stderr, "FAIL: block %s after identifier %i\n", complete ? "complete" : "not complete", identifiers[i]);
+      errors++;
+    }
+
+    // 10 and 11 belonged to the abandoned block, and 15 is lost
+    if (identifiers[i] != 15)
+      fecStoreData(decoder, identifiers[i], TEST_PROTOCOL, size, payload);
+  }
+
+  if (encoder->firstIdentifier != 13) {
+    fprintf(stderr, "FAIL: the block starts at %i instead of 13\n", encoder->firstIdentifier);
+    errors++;
+  }
+
+  simplemuxBlastFecHeader fecHeader = { blockSize, 0, parityCount };
+  int block = fecStoreParity(decoder, encoder->firstIdentifier, &fecHeader, encoder->parity[0], encoder->length);
+  uint16_t rebuilt[BLAST_FEC_MAX_M];
+  int numRebuilt = fecDecode(decoder, block, rebuilt);
+
+  if ((numRebuilt != 1) || (rebuilt[0] != 15) || !checkRebuilt(decoder, 15)) {
+    fprintf(stderr, "FAIL: the packet lost after the abandoned block is not rebuilt correctly\n");
+    errors++;
+  }
+
+  free(encoder);
+  free(decoder);
+  return errors;
+}
+
+
+int main()
+{
+  int errors = 0;
+
+  initGaloisField();
+
+  // blocks of several sizes, one of them across the wrap-around of the identifiers
+  int blocks[][3] = { {4, 1, 100}, {8, 2, 1000}, {5, 3, 65533}, {BLAST_FEC_MAX_K, BLAST_FEC_MAX_M, 40000} };
+  for (unsigned int b = 0; b < sizeof(blocks) / sizeof(blocks[0]); b++) {
+    for (int numLost = 0; numLost <= blocks[b][1]; numLost++)
+      errors = errors + encodeLoseAndDecode(blocks[b][0], blocks[b][1], blocks[b][2], numLost);
+    errors = errors + tooManyLost(blocks[b][0], blocks[b][1]);
+  }
+
+  errors = errors + nonConsecutiveIdentifiers();
+
+  if (errors == 0)
+    fprintf(stderr, "PASS: FEC of blast packets\n");
+
+  return (errors == 0) ? 0 : 1;
+}
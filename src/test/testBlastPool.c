@@ -0,0 +1,86 @@
+// checks of the pool of slots of the blast flavor ('-s' option)
+// it returns 0 if all the checks pass
+
+#include "../blastPackets.h"
+
+#define TEST_SLOTS 64   // limit of slots in use of the pool ('-s')
+
+
+// fill the window with packets of 'size' bytes, and then remove them
+// returns the number of packets that could be stored
+static int fillAndEmpty(blastWindow* window, int packets, uint16_t size, uint16_t firstIdentifier)
+{
+  uint8_t payload[BUFSIZE];
+  memset(payload, 0xAB, size);
+
+  int stored = 0;
+  for (int i = 0; i < packets; i++) {
+    if (insertLast(window, firstIdentifier + i, size, payload) != NULL)
+      stored++;
+  }
+
+  for (int i = 0; i < packets; i++)
+    delete(window, firstIdentifier + i);
+
+  return stored;
+}
+
+
+int main()
+{
+  int errors = 0;
+
+  blastWindow* window = calloc(1, sizeof(blastWindow));
+  if (window == NULL) {
+    perror("calloc");
+    return 1;
+  }
+  window->pool.maxSlots = TEST_SLOTS;
+  initBlastWindow(window);
+
+  // a size class reserves all the slots; when they are free again, the
+  //packets of other sizes must still find a slot
+  int sizes[] = {100, 1000, 60, BUFSIZE, 100};
+  for (unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    int stored = fillAndEmpty(window, TEST_SLOTS, sizes[i], i * TEST_SLOTS);
+    if (stored != TEST_SLOTS) {
+      fprintf(stderr, "FAIL: %i of %i packets of %i bytes stored after other sizes\n", stored, TEST_SLOTS, sizes[i]);
+      errors++;
+    }
+  }
+
+  // the limit is on the slots in use of all the classes
+  uint8_t payload[BUFSIZE] = {0};
+  for (int i = 0; i < TEST_SLOTS; i++)
+    insertLast(window, i, (i % 2) ? 100 : 1000, payload);
+
+  if (insertLast(window, TEST_SLOTS, 60, payload) != NULL) {
+    fprintf(stderr, "FAIL: a packet was stored with the %i slots in use\n", TEST_SLOTS);
+    errors++;
+  }
+
+  // a slot is free again, so a packet of any size can use it
+  delete(window, 0);
+  if (insertLast(window, TEST_SLOTS, 60, payload) == NULL) {
+    fprintf(stderr, "FAIL: a packet could not be stored with a free slot\n");
+    errors++;
+  }
+
+  // identifiers 0 and TEST_SLOTS share an entry of the index, but only the second one is stored
+  if ((find(window, TEST_SLOTS) == NULL) || (find(window, 0) != NULL) || (find(window, 1) == NULL)) {
+    fprintf(stderr, "FAIL: the packets that share an entry of the index are not found correctly\n");
+    errors++;
+  }
+
+  if (window->pool.totalSlotsInUse != TEST_SLOTS) {
+    fprintf(stderr, "FAIL: %i slots in use, %i expected\n", window->pool.totalSlotsInUse, TEST_SLOTS);
+    errors++;
+  }
+
+  printBlastPoolStatistics(&window->pool);
+
+  if (errors == 0)
+    fprintf(stderr, "PASS: pool of blast packets\n");
+
+  return (errors == 0) ? 0 : 1;
+}
@@ -1,11 +1,14 @@
 #include "tunToNet.h"
 
-// packet/frame arrived at tun: read it, and send a blast packet to the network
-void tunToNetBlastFlavor (contextSimplemux* context)
+// a packet/frame has been read from tun: send it in a blast packet to the network
+// it is used in blast flavor, and in hybrid flavor for the selected flows
+// declared as 'static' because it is only used in this .c file
+static void sendFromTunBlastFlavor (contextSimplemux* context,
+                                    uint8_t* packet,
+                                    uint16_t size)
 {
-  // blast flavor
   #ifdef ASSERT
-    assert(context->flavor == 'B');
+    assert((context->flavor == 'B') || (context->numFlowRules > 0));
     assert((context->tunnelMode == TAP_MODE) || (context->tunnelMode == TUN_MODE));
   #endif
 
@@ -35,14 +38,32 @@ void tunToNetBlastFlavor (contextSimplemux* context)
                 "\n");
   #endif           
 
-  // add a new empty packet to the list
-  struct storedPacketBlast* thisPacket = insertLast(&context->unconfirmedPacketsBlast,0,NULL);
+  // add the packet to the window
+  // the ID is the 16 LSBs of 'blastIdentifier' (it is an uint32_t)
+  struct storedPacketBlast* thisPacket = insertLast(&context->unconfirmedPacketsBlast,
+                                                    (uint16_t)context->blastIdentifier,
+                                                    size,
+                                                    packet);
+
+  // all the slots of the pool are in use: the packet is sent once, but it is
+  //not stored, so it will not be retransmitted
+  uint8_t unstoredPacket[sizeof(storedPacketBlast) + BUFSIZE];
+  bool stored = (thisPacket != NULL);
+  if (!stored) {
+    thisPacket = (storedPacketBlast*)unstoredPacket;
+    thisPacket->heapPosition = -1;
+    // use 'htons()' because these fields will be sent through the network
+    thisPacket->header.identifier = htons((uint16_t)context->blastIdentifier);
+    thisPacket->header.packetSize = htons(size);
+    memcpy(thisPacket->tunneledPacket, packet, size);
 
-  // read the packet from context->tun_fd and add the data
-  // use 'htons()' because these fields will be sent through the network
-  thisPacket->header.packetSize = htons(cread (context->tun_fd, thisPacket->tunneledPacket, BUFSIZE));
-  // the ID is the 16 LSBs of 'tun2net' (it is an uint32_t)
-  thisPacket->header.identifier = htons((uint16_t)context->blastIdentifier); 
+    #ifdef DEBUG
+      do_debug_c( 1,
+                  ANSI_COLOR_RED,
+                  " No free slot in the pool of blast packets (%i slots). The packet will not be retransmitted\n",
+                  context->unconfirmedPacketsBlast.pool.maxSlots);
+    #endif
+  }
 
   #ifdef DEBUG
     if (context->tunnelMode == TUN_MODE) {
@@ -145,10 +166,20 @@ void tunToNetBlastFlavor (contextSimplemux* context)
 
   // No need to write in the log file here: it is done in 'sendPacketBlastFlavor()'
 
-  // the packet has been sent. Store the timestamp
+  // the packet has been sent. Store the timestamp and schedule its retransmission
   thisPacket->sentTimestamp = now;
-
-  if(now - (context->lastBlastHeartBeatReceived) > HEARTBEATDEADLINE) {
+  thisPacket->transmissions = 1;
+  context->blastPacketsSent++;
+  if (context->blastPacingRate > 0)
+    takeBlastPacingToken(context, now);
+  if (stored)
+    scheduleRetransmission(&context->unconfirmedPacketsBlast, thisPacket, now + blastRetransmissionTimeout(context, thisPacket));
+
+  // FEC: add the packet to the current block. The parity is sent after the last one
+  if (context->fecEncoder != NULL)
+    addToFecBlock(context, thisPacket);
+
+  if(stored && (now - (context->lastBlastHeartBeatReceived) > HEARTBEATDEADLINE)) {
     // heartbeat from the other side not received recently
     if(delete(&context->unconfirmedPacketsBlast,
               ntohs(thisPacket->header.identifier))==false)
@@ -234,7 +265,7 @@ void tunToNetBlastFlavor (contextSimplemux* context)
       }
     #endif
   }
-  else {
+  else if (stored) {
     #ifdef DEBUG
       do_debug_c( 3,
                   ANSI_COLOR_BRIGHT_BLUE,
@@ -283,10 +314,59 @@ void tunToNetBlastFlavor (contextSimplemux* context)
 }
 
 
-// packet/frame arrived at tun: read it, and check if:
-// - the packet has to be stored
-// - a multiplexed packet has to be sent to the network
-void tunToNetNoBlastFlavor (contextSimplemux* context)
+// packet/frame arrived at tun: read it, and send a blast packet to the network
+void tunToNetBlastFlavor (contextSimplemux* context)
+{
+  // blast flavor
+  #ifdef ASSERT
+    assert(context->flavor == 'B');
+  #endif
+
+  // read the packet from context->tun_fd
+  // it is read before storing it, because the slot of the pool depends on its size
+  uint8_t packet[BUFSIZE];
+  uint16_t size = readFromTun (context, packet, BUFSIZE);
+
+  sendFromTunBlastFlavor(context, packet, size);
+}
+
+
+// hybrid flavor ('-C' option): a packet/frame has been read from tun into
+//'packetsToMultiplex[numPktsStoredFromTun]'. If it belongs to a selected flow,
+//send it in a blast packet instead of adding it to the bundle
+// it returns true if the packet has been sent in blast flavor
+// declared as 'static' because it is only used in this .c file
+static bool divertToBlastFlavor (contextSimplemux* context)
+{
+  if (context->numFlowRules == 0)
+    return false;
+
+  uint8_t* packet = context->packetsToMultiplex[context->numPktsStoredFromTun];
+  uint16_t size = context->sizePacketsToMultiplex[context->numPktsStoredFromTun];
+
+  if (!isBlastFlow(context, packet, size)) {
+    context->hybridMuxedPackets++;
+    return false;
+  }
+
+  #ifdef DEBUG
+    do_debug_c( 2,
+                ANSI_COLOR_BRIGHT_BLUE,
+                "Hybrid flavor: %i bytes selected by the classifier. Sent in blast flavor\n",
+                size);
+  #endif
+
+  context->hybridBlastPackets++;
+  sendFromTunBlastFlavor(context, packet, size);
+  return true;
+}
+
+
+// a packet/frame has been read from tun into 'packetsToMultiplex[numPktsStoredFromTun]':
+//add it to the multiplexed bundle being built
+// it returns false if the packet has been dropped
+// declared as 'static' because it is only used in this .c file
+static bool storePacketFromTun (contextSimplemux* context)
 {
   // normal or fast flavor
   #ifdef ASSERT
@@ -294,11 +374,6 @@ void tunToNetNoBlastFlavor (contextSimplemux* context)
     assert( context->numPktsStoredFromTun < MAXPKTS ); // there must be space for one packet
   #endif
 
-  // read the packet from context->tun_fd, store it in the array, and store its size
-  context->sizePacketsToMultiplex[context->numPktsStoredFromTun] = cread (context->tun_fd,
-                                                                          context->packetsToMultiplex[context->numPktsStoredFromTun],
-                                                                          BUFSIZE);
-
   uint16_t size = context->sizePacketsToMultiplex[context->numPktsStoredFromTun];  
 
   #ifdef DEBUG
@@ -504,63 +579,161 @@ void tunToNetNoBlastFlavor (contextSimplemux* context)
       #endif
     }
     
-    // check if a multiplexed packet has to be sent
-    uint64_t now_microsec = GetTimeStamp();
-    uint64_t time_difference = now_microsec - context->timeLastSent;
+  }
+
+  return !dropPacket;
+}
+
+
+// evaluate the triggers (number of packets, size, timeout) and send the
+//multiplexed bundle if one of them has been reached
+// declared as 'static' because it is only used in this .c file
+static void checkTriggersNoBlastFlavor (contextSimplemux* context)
+{
+  // check if a multiplexed packet has to be sent
+  uint64_t now_microsec = GetTimeStamp();
+  uint64_t time_difference = now_microsec - context->timeLastSent;
+  #ifdef DEBUG
+    do_debug_c( 1,
+                ANSI_COLOR_BRIGHT_BLUE,
+                " Time since last trigger: %" PRIu64 " usec\n",
+                time_difference);
+  #endif
+
+  // if the packet limit or the size threshold are reached, send all the stored packets to the network
+  // do not worry about the MTU. if it is reached, a number of packets will be sent
+  if ((context->numPktsStoredFromTun == context->limitNumpackets) ||  // I have reached the maximum number
+      (context->numPktsStoredFromTun == MAXPKTS) ||                   // there is no more place in the buffer
+      (context->sizeMuxedPacket > context->sizeThreshold) ||          // size threshold
+      (time_difference > context->timeout ))                          // timeout expired
+  {
+    // sending triggered: a multiplexed packet has to be sent
+    int single_protocol = addSizeOfProtocolField(context);
+
     #ifdef DEBUG
-      do_debug_c( 1,
-                  ANSI_COLOR_BRIGHT_BLUE,
-                  " Time since last trigger: %" PRIu64 " usec\n",
-                  time_difference);
+      do_debug( 2,"\n");
+      debugInformationAboutTrigger(context, single_protocol, time_difference);
     #endif
 
-    // if the packet limit or the size threshold are reached, send all the stored packets to the network
-    // do not worry about the MTU. if it is reached, a number of packets will be sent
-    if ((context->numPktsStoredFromTun == context->limitNumpackets) ||  // I have reached the maximum number
-        (context->numPktsStoredFromTun == MAXPKTS) ||                   // there is no more place in the buffer
-        (context->sizeMuxedPacket > context->sizeThreshold) ||          // size threshold
-        (time_difference > context->timeout ))                          // timeout expired
-    {
-      // sending triggered: a multiplexed packet has to be sent
-      single_protocol = addSizeOfProtocolField(context);
+    // build the multiplexed packet including the current one
+    uint16_t total_length;          // total length of the built multiplexed packet
 
-      #ifdef DEBUG
-        do_debug( 2,"\n");
-        debugInformationAboutTrigger(context, single_protocol, time_difference);
-      #endif
+    total_length = buildMultiplexedPacket ( context,
+                                            single_protocol);
 
-      // build the multiplexed packet including the current one
-      uint16_t total_length;          // total length of the built multiplexed packet
-      uint8_t muxed_packet[BUFSIZE];  // stores the multiplexed packet
+    // send the multiplexed packet
+    sendMultiplexedPacket ( context,
+                            total_length,
+                            time_difference);
 
-      total_length = buildMultiplexedPacket ( context,
-                                              single_protocol,
-                                              muxed_packet);
+    // I have sent a packet, so I set to 0 the "first_header_written" bit
+    context->firstHeaderWritten = 0;
 
-      // send the multiplexed packet
-      sendMultiplexedPacket ( context,
-                              total_length,
-                              muxed_packet,
-                              time_difference);
+    // reset the length and the number of packets
+    context->sizeMuxedPacket = 0 ;
+    context->numPktsStoredFromTun = 0;
 
-      // I have sent a packet, so I set to 0 the "first_header_written" bit
-      context->firstHeaderWritten = 0;
+    // restart the period: update the time of the last packet sent
+    context->timeLastSent = now_microsec;
+  }
 
-      // reset the length and the number of packets
-      context->sizeMuxedPacket = 0 ;
-      context->numPktsStoredFromTun = 0;
+  #ifdef DEBUG
+  else {
+    // a multiplexed packet does not have to be sent. I have just accumulated this one
+    // just add a linefeed
+    do_debug(2, "\n");
 
-      // restart the period: update the time of the last packet sent
-      context->timeLastSent = now_microsec;
-    }
+  }
+  #endif
+}
 
-    #ifdef DEBUG
-    else {
-      // a multiplexed packet does not have to be sent. I have just accumulated this one
-      // just add a linefeed
-      do_debug(2, "\n");
 
+// packet/frame arrived at tun: read it, and check if:
+// - the packet has to be stored
+// - a multiplexed packet has to be sent to the network
+void tunToNetNoBlastFlavor (contextSimplemux* context)
+{
+  // read the packet from context->tun_fd, store it in the array, and store its size
+  context->sizePacketsToMultiplex[context->numPktsStoredFromTun] = readFromTun (context,
+                                                                              context->packetsToMultiplex[context->numPktsStoredFromTun],
+                                                                              BUFSIZE);
+
+  if (divertToBlastFlavor(context))
+    return;
+
+  if (storePacketFromTun(context))
+    checkTriggersNoBlastFlavor(context);
+}
+
+
+// drain mode ('-a' option): several packets/frames are waiting in tun.
+//Read all of them (up to 'drainBudget') without blocking, add them to the
+//bundle, and evaluate the triggers only once, after the last one
+// the loop also stops when the number of packets or the size threshold is
+//reached, so the bundle is the same it would be without draining
+void tunToNetDrain (contextSimplemux* context)
+{
+  #ifdef ASSERT
+    assert( (context->flavor == 'N') || (context->flavor == 'F') );
+    assert( context->drainBudget > 1 );
+  #endif
+
+  int batch = 0;          // number of packets read in this call
+  bool stored = false;    // at least one packet has been added to the bundle
+
+  while (batch < context->drainBudget) {
+
+    // a trigger has been reached: it has to be evaluated before reading more packets
+    // the first packet is always read: poll() has said it is there
+    if ((batch > 0) &&
+        ((context->numPktsStoredFromTun == context->limitNumpackets) ||
+         (context->numPktsStoredFromTun == MAXPKTS) ||
+         (context->sizeMuxedPacket > context->sizeThreshold)))
+      break;
+
+    // the file descriptor is non-blocking: read() returns -1 (EAGAIN) when tun is empty
+    int size = read(context->tun_fd,
+                    context->packetsToMultiplex[context->numPktsStoredFromTun],
+                    BUFSIZE);
+
+    if (size < 0) {
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+        break;
+      perror("Reading data");
+      exit(1);
     }
-    #endif
+
+    batch++;
+
+    // increase the counter of the number of packets read from tun
+    context->tun2net++;
+
+    context->sizePacketsToMultiplex[context->numPktsStoredFromTun] = size;
+
+    if (divertToBlastFlavor(context))
+      continue;
+
+    if (storePacketFromTun(context))
+      stored = true;
   }
-}
\ No newline at end of file
+
+  // store the size of this batch in the histogram (1, 2-3, 4-7, ... 64 or more)
+  if (batch > 0) {
+    int bucket = 0;
+    while ((bucket < DRAIN_BUCKETS - 1) && (batch >= (2 << bucket)))
+      bucket++;
+    context->drainHistogram[bucket]++;
+    context->drainBatches++;
+    context->drainPackets = context->drainPackets + batch;
+  }
+
+  #ifdef DEBUG
+    do_debug_c( 3,
+                ANSI_COLOR_BRIGHT_BLUE,
+                "Drained %i packets from tun/tap\n",
+                batch);
+  #endif
+
+  if (stored)
+    checkTriggersNoBlastFlavor(context);
+}
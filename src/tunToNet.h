@@ -3,8 +3,10 @@
 #define TUNTONET_H
 
 #include "tunToNetUtilities.h"
+#include "blastFec.h"
 
 void tunToNetBlastFlavor (contextSimplemux* context);
 void tunToNetNoBlastFlavor (contextSimplemux* context);
+void tunToNetDrain (contextSimplemux* context);
 
 #endif  // TUNTONET_H
\ No newline at end of file
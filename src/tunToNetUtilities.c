@@ -101,6 +101,88 @@ bool checkPacketSize (contextSimplemux* context, uint16_t size)
 }
 
 
+// hybrid flavor ('-C' option): check if a packet/frame read from tun/tap belongs
+//to one of the flows that have to be sent in blast flavor (any rule matches)
+// only the first IPv4/IPv6 header is parsed (no IPv6 extension headers). The
+//ports are only checked in TCP, UDP and SCTP packets that are not a fragment
+bool isBlastFlow(contextSimplemux* context, uint8_t* packet, int size)
+{
+  int etherType;
+  int offset = 0;   // position of the IP header
+
+  if (context->tunnelMode == TAP_MODE) {
+    if (size < 14)
+      return false;
+    etherType = (packet[12] << 8) | packet[13];
+    offset = 14;
+
+    // 802.1Q tag (e.g. GOOSE and Sampled Values frames usually carry one)
+    if ((etherType == 0x8100) && (size >= 18)) {
+      etherType = (packet[16] << 8) | packet[17];
+      offset = 18;
+    }
+  }
+  else {
+    // tun mode: the EtherType is given by the version of the IP packet
+    if (size < 1)
+      return false;
+    etherType = ((packet[0] >> 4) == 6) ? 0x86DD : 0x0800;
+  }
+
+  int protocol = -1;
+  int dscp = -1;
+  int transport = -1;   // position of the TCP/UDP/SCTP header
+  uint8_t* ip = &packet[offset];
+  int ipLength = size - offset;
+
+  if ((etherType == 0x0800) && (ipLength >= 20) && ((ip[0] >> 4) == 4)) {
+    protocol = ip[9];
+    dscp = ip[1] >> 2;
+    // only the first fragment has the ports
+    if ((((ip[6] & 0x1F) << 8) | ip[7]) == 0)
+      transport = (ip[0] & 0x0F) * 4;
+  }
+  else if ((etherType == 0x86DD) && (ipLength >= 40) && ((ip[0] >> 4) == 6)) {
+    protocol = ip[6];
+    dscp = ((ip[0] & 0x0F) << 2) | (ip[1] >> 6);
+    transport = 40;
+  }
+
+  int sourcePort = -1;
+  int destinationPort = -1;
+  if ((transport > 0) &&
+      ((protocol == IPPROTO_TCP) || (protocol == IPPROTO_UDP) || (protocol == IPPROTO_SCTP)) &&
+      (ipLength >= transport + 4))
+  {
+    sourcePort = (ip[transport] << 8) | ip[transport + 1];
+    destinationPort = (ip[transport + 2] << 8) | ip[transport + 3];
+  }
+
+  for (int i = 0; i < context->numFlowRules; i++) {
+    int value = context->flowRules[i].value;
+    switch (context->flowRules[i].field) {
+      case FLOW_ETHERTYPE:
+        if (etherType == value)
+          return true;
+        break;
+      case FLOW_PROTOCOL:
+        if (protocol == value)
+          return true;
+        break;
+      case FLOW_PORT:
+        if ((sourcePort == value) || (destinationPort == value))
+          return true;
+        break;
+      case FLOW_DSCP:
+        if (dscp == value)
+          return true;
+        break;
+    }
+  }
+  return false;
+}
+
+
 #ifdef USINGROHC
 void compressPacket(contextSimplemux* context, uint16_t size)
 {
@@ -461,11 +543,9 @@ void emptyBufferIfNeeded(contextSimplemux* context, int single_protocol)
 
     // build the multiplexed packet without the current one
     uint16_t total_length;          // total length of the built multiplexed packet
-    uint8_t muxed_packet[BUFSIZE];  // stores the multiplexed packet
 
     total_length = buildMultiplexedPacket ( context,
-                                            single_protocol,
-                                            muxed_packet);
+                                            single_protocol);
 
     #ifdef DEBUG
       if (context->flavor == 'N') {
@@ -840,12 +920,7 @@ void emptyBufferIfNeeded(contextSimplemux* context, int single_protocol)
     switch (context->mode) {
       case UDP_MODE:
         // send the packet
-        if (sendto( context->udp_mode_fd,
-                    muxed_packet,
-                    total_length,
-                    0,
-                    (struct sockaddr *)&(context->remote),
-                    sizeof(context->remote)) == -1)
+        if (sendBundle(context, total_length) == -1)
         {
           perror("sendto() in UDP mode failed");
           exit (EXIT_FAILURE);
@@ -871,9 +946,7 @@ void emptyBufferIfNeeded(contextSimplemux* context, int single_protocol)
 
       case TCP_CLIENT_MODE:
         // send the packet
-        if (write(context->tcp_client_fd,
-                  muxed_packet,
-                  total_length) == -1)
+        if (sendBundle(context, total_length) == -1)
         {
           perror("write() in TCP client mode failed");
           exit (EXIT_FAILURE);
@@ -907,9 +980,7 @@ void emptyBufferIfNeeded(contextSimplemux* context, int single_protocol)
         }
         else {
           // send the packet
-          if (write(context->tcp_server_fd,
-                    muxed_packet,
-                    total_length) == -1)
+          if (sendBundle(context, total_length) == -1)
           {
             perror("write() in TCP server mode failed");
             exit (EXIT_FAILURE);
@@ -934,22 +1005,9 @@ void emptyBufferIfNeeded(contextSimplemux* context, int single_protocol)
         }
       break;
       
-      case NETWORK_MODE: ;
-        // build the header
-        struct iphdr ipheader;
-        BuildIPHeader(&ipheader, total_length, context->ipprotocol, context->local, context->remote);
-
-        // build the full IP multiplexed packet
-        uint8_t full_ip_packet[BUFSIZE];
-        BuildFullIPPacket(ipheader, muxed_packet, total_length, full_ip_packet);
-
-        // send the packet
-        if (sendto (context->network_mode_fd,
-                    full_ip_packet,
-                    total_length + sizeof(struct iphdr),
-                    0,
-                    (struct sockaddr *)&(context->remote),
-                    sizeof (struct sockaddr)) < 0 )
+      case NETWORK_MODE:
+        // send the packet, preceded by the prebuilt IP header
+        if (sendBundle(context, total_length) < 0 )
         {
           perror ("sendto() in Network mode failed");
           exit (EXIT_FAILURE);
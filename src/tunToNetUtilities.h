@@ -6,6 +6,8 @@
 
 bool checkPacketSize (contextSimplemux* context, uint16_t size);
 
+bool isBlastFlow(contextSimplemux* context, uint8_t* packet, int size);
+
 #ifdef USINGROHC
 void compressPacket(contextSimplemux* context, uint16_t size);
 #endif